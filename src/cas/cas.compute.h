@@ -1,4 +1,31 @@
-cbuffer cb : register(b0) {
+// permutation defines, see add_shader_permutations in CMakeLists.txt
+#ifndef TILE_LIST
+#define TILE_LIST 0
+#endif
+#ifndef BILINEAR_ONLY
+#define BILINEAR_ONLY 0
+#endif
+#ifndef DEBUG_OVERLAY
+#define DEBUG_OVERLAY 0
+#endif
+#ifndef MSAA_INPUT
+#define MSAA_INPUT 0
+#endif
+#ifndef HDR_INPUT
+#define HDR_INPUT 0
+#endif
+#ifndef HALF_PRECISION
+#define HALF_PRECISION 0
+#endif
+
+#ifndef CAS_SHARPEN_ONLY
+#define CAS_SHARPEN_ONLY 0
+#endif
+#ifndef IN_PLACE
+#define IN_PLACE 0
+#endif
+
+struct EyeConstants {
 	uint4 const0;
 	uint4 const1;
 	uint2 inputOffset;
@@ -6,26 +33,98 @@ cbuffer cb : register(b0) {
 	uint2 inputTextureSize;
 	uint2 outputTextureSize;
 	uint2 projCentre;
+	uint2 viewportSize;
 	uint squaredRadius;
-	uint debugMode;
+	uint3 padding;
 };
 
+// both eyes can be processed in one dispatch, the Z group index selects the eye
+cbuffer cb : register(b0) {
+	EyeConstants eyes[2];
+};
+
+static uint4 const0;
+static uint4 const1;
+static uint2 inputOffset;
+static uint2 outputOffset;
+static uint2 inputTextureSize;
+static uint2 outputTextureSize;
+static uint2 projCentre;
+static uint2 viewportSize;
+static uint squaredRadius;
+
 SamplerState samLinearClamp : register(s0);
+#if MSAA_INPUT
+Texture2DMS<float4> InputTexture : register(t0);
+#else
 Texture2D InputTexture : register(t0);
+#endif
 RWTexture2D<float4> OutputTexture : register(u0);
 
+#if TILE_LIST
+// the workgroups' tiles, packed as x | y << 12 | eye << 24
+Buffer<uint> TileList : register(t1);
+#endif
+
 #define A_GPU 1
 #define A_HLSL 1
+#if HALF_PRECISION
+#define A_HALF
+#endif
 #define CAS_BETTER_DIAGONALS 1
 
 #include "ffx_a.h"
 
+#if IN_PLACE
+#include "../tiles/in_place_tile.h"
+#endif
+
+#if MSAA_INPUT
+static uint inputSamples;
+
+// average of all samples of the texel, so that no separate resolve pass is needed
+AF3 LoadResolved(ASU2 p) {
+	p = clamp(p, ASU2(0, 0), ASU2(inputTextureSize) - 1);
+	AF3 sum = AF3(0, 0, 0);
+	for (uint s = 0; s < inputSamples; ++s) {
+		sum += InputTexture.Load(p, s).rgb;
+	}
+	return sum / AF1(inputSamples);
+}
+#endif
+
+#if IN_PLACE
+// only sharpening is done in place, where input and output viewport are the same
+AF3 CasLoad(ASU2 p) {
+	return LoadInPlaceTile(p);
+}
+#elif MSAA_INPUT
+AF3 CasLoad(ASU2 p) {
+	return LoadResolved(p + inputOffset);
+}
+#else
 AF3 CasLoad(ASU2 p) {
 	return InputTexture.Load(int3(p + inputOffset, 0)).rgb;
 }
+#endif
+
+#include "../hdr/hdr_filter.h"
 
 // for transforming to linear color space, not needed (?)
-void CasInput(inout AF1 r, inout AF1 g, inout AF1 b) {}
+void CasInput(inout AF1 r, inout AF1 g, inout AF1 b) {
+#if HDR_INPUT
+	AF3 c = HdrToFilter(AF3(r, g, b));
+	r = c.r; g = c.g; b = c.b;
+#endif
+}
+
+#if HALF_PRECISION
+// loads stay in 32 bits, so that the HDR tonemap is applied before the values are narrowed
+AH3 CasLoadH(ASW2 p) {
+	return AH3(HdrToFilter(CasLoad(ASU2(p))));
+}
+void CasInputH(inout AH2 r, inout AH2 g, inout AH2 b) {}
+#endif
 
 #include "ffx_cas.h"
 
@@ -35,28 +134,97 @@ void CasInput(inout AF1 r, inout AF1 g, inout AF1 b) {}
 #define WITHOUT_UPSCALE false
 #endif
 
+void StoreOutput(ASU2 pos, AF3 c) {
+#if IN_PLACE
+	// partial tiles must not touch whatever lies next to the viewport in the game's texture
+	if (any(pos >= ASU2(viewportSize))) {
+		return;
+	}
+	// the game's alpha is kept, only this thread writes the texel
+	OutputTexture[AU2(pos)+outputOffset] = AF4(HdrFromFilter(c), OutputTexture[AU2(pos)+outputOffset].a);
+#else
+	OutputTexture[AU2(pos)+outputOffset] = AF4(HdrFromFilter(c), 1);
+#endif
+}
+
+#if HALF_PRECISION
+// filters the pixel and the one 8 to the right of it as a packed pair
+void CasPair(int2 pos) {
+	AH2 r, g, b;
+	CasFilterH(r, g, b, pos, const0, const1, WITHOUT_UPSCALE);
+	AH4 c0, c1;
+	CasDepack(c0, c1, r, g, b);
+	StoreOutput(pos, AF3(c0.rgb));
+	StoreOutput(pos + ASU2(8, 0), AF3(c1.rgb));
+}
+#else
 void Cas(int2 pos) {
 	AF3 c;
 	CasFilter(c.r, c.g, c.b, pos, const0, const1, WITHOUT_UPSCALE);
-	OutputTexture[ASU2(pos)+outputOffset] = AF4(c, 1);
+	StoreOutput(pos, c);
 }
+#endif
 
 void Bilinear(int2 pos) {
-	AF4 mul = AF4(1, 1, 1, 1) - debugMode * AF4(0, 0.3, 0.3, 0);
+#if DEBUG_OVERLAY
+	AF4 mul = AF4(1, 0.7, 0.7, 1);
+#else
+	AF4 mul = AF4(1, 1, 1, 1);
+#endif
 	float2 samplePos = ((float2(pos) + 0.5) * AF2_AU2(const0.xy) + float2(inputOffset)) / float2(inputTextureSize);
 	//float2 samplePos = (float2(pos + outputOffset) + 0.5) / outputTextureSize;
+#if MSAA_INPUT
+	AF2 texel = samplePos * AF2(inputTextureSize) - 0.5;
+	ASU2 base = ASU2(floor(texel));
+	AF2 f = texel - AF2(base);
+	AF3 top = lerp(LoadResolved(base), LoadResolved(base + ASU2(1, 0)), f.x);
+	AF3 bottom = lerp(LoadResolved(base + ASU2(0, 1)), LoadResolved(base + ASU2(1, 1)), f.x);
+	AF3 c = lerp(top, bottom, f.y);
+#else
 	AF3 c = InputTexture.SampleLevel(samLinearClamp, samplePos, 0).rgb;
+#endif
 	OutputTexture[ASU2(pos) + outputOffset] = AF4(c, 1) * mul;
 }
 
 [numthreads(64, 1, 1)]
 void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID) {
+#if TILE_LIST
+	uint tile = TileList[WorkGroupId.x];
+	WorkGroupId = uint3(tile & 0xfff, (tile >> 12) & 0xfff, tile >> 24);
+#endif
+	EyeConstants eye = eyes[WorkGroupId.z];
+	const0 = eye.const0;
+	const1 = eye.const1;
+	inputOffset = eye.inputOffset;
+	outputOffset = eye.outputOffset;
+	inputTextureSize = eye.inputTextureSize;
+	outputTextureSize = eye.outputTextureSize;
+	projCentre = eye.projCentre;
+	viewportSize = eye.viewportSize;
+	squaredRadius = eye.squaredRadius;
+#if MSAA_INPUT
+	uint width, height;
+	InputTexture.GetDimensions(width, height, inputSamples);
+#endif
+
 	AU2 gxy = ARmp8x8( LocalThreadId.x ) + AU2(WorkGroupId.x << 4u, WorkGroupId.y << 4u);
 
-	AU2 groupCentre = AU2((WorkGroupId.x << 4u) + 8u, (WorkGroupId.y << 4u) + 8u);
-	AU2 dc = projCentre - groupCentre;
-	if (dot(dc, dc) <= squaredRadius) {
-		// only apply CAS for workgroups inside the configured radius
+#if BILINEAR_ONLY
+	bool fullFilter = false;
+#else
+	bool fullFilter = true;
+#endif
+	if (fullFilter) {
+		// only apply CAS for tiles inside the configured radius
+#if IN_PLACE
+		StageInPlaceTile(LocalThreadId.x, ASU2(WorkGroupId.x << 4u, WorkGroupId.y << 4u), WorkGroupId.z, ASU2(outputOffset), ASU2(viewportSize));
+		GroupMemoryBarrierWithGroupSync();
+#endif
+#if HALF_PRECISION
+		CasPair(gxy);
+		gxy.y += 8u;
+		CasPair(gxy);
+#else
 		Cas(gxy);
 		gxy.x += 8u;
 		Cas(gxy);
@@ -64,6 +232,7 @@ void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID
 		Cas(gxy);
 		gxy.x -= 8u;
 		Cas(gxy);
+#endif
 	}
 	else {
 		// resort to cheaper bilinear sampling
@@ -1,2 +0,0 @@
-#define CAS_SHARPEN_ONLY 1
-#include "cas.compute.h"
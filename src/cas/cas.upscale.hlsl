@@ -1,2 +0,0 @@
-#define CAS_SHARPEN_ONLY 0
-#include "cas.compute.h"
@@ -19,6 +19,10 @@ namespace vrperfkit {
 		if (s == "cas") {
 			return UpscaleMethod::CAS;
 		}
+		if (s == "temporal") {
+			LogIfExperimental(UpscaleMethod::TEMPORAL);
+			return UpscaleMethod::TEMPORAL;
+		}
 		LOG_INFO << "Unknown upscaling method " << s << ", defaulting to FSR";
 		return UpscaleMethod::FSR;
 	}
@@ -31,6 +35,14 @@ namespace vrperfkit {
 			return "NIS";
 		case UpscaleMethod::CAS:
 			return "CAS";
+		case UpscaleMethod::TEMPORAL:
+			return "Temporal";
+		}
+	}
+
+	void LogIfExperimental(UpscaleMethod method) {
+		if (method == UpscaleMethod::TEMPORAL) {
+			LOG_INFO << "Temporal upscaling is experimental: it needs depth and pose from the game, and only gains detail if the game uses the jittered projections of IVRSystem";
 		}
 	}
 
@@ -56,18 +68,30 @@ namespace vrperfkit {
 
 	Config g_config;
 
-	void LoadConfig(const fs::path &configPath) {
-		g_config = Config();
-
+	YAML::Node LoadConfigFile(const fs::path &configPath) {
 		if (!exists(configPath)) {
 			LOG_ERROR << "Config file not found, falling back to defaults";
-			return;
+			return YAML::Node();
 		}
 
 		try {
 			std::ifstream cfgFile (configPath);
-			YAML::Node cfg = YAML::Load(cfgFile);
+			return YAML::Load(cfgFile);
+		}
+		catch (const YAML::Exception &e) {
+			LOG_ERROR << "Failed to load configuration file: " << e.msg;
+			return YAML::Node();
+		}
+	}
+
+	void LoadConfig(YAML::Node cfg) {
+		g_config = Config();
+
+		if (!cfg.IsMap()) {
+			return;
+		}
 
+		try {
 			YAML::Node upscaleCfg = cfg["upscaling"];
 			UpscaleConfig &upscaling= g_config.upscaling;
 			upscaling.enabled = upscaleCfg["enabled"].as<bool>(upscaling.enabled);
@@ -79,7 +103,11 @@ namespace vrperfkit {
 			}
 			upscaling.sharpness = std::max(0.f, upscaleCfg["sharpness"].as<float>(upscaling.sharpness));
 			upscaling.radius = std::max(0.f, upscaleCfg["radius"].as<float>(upscaling.radius));
+			upscaling.contrastThreshold = std::max(0.f, upscaleCfg["contrastThreshold"].as<float>(upscaling.contrastThreshold));
+			upscaling.lumaOnly = upscaleCfg["lumaOnly"].as<bool>(upscaling.lumaOnly);
+			upscaling.halfPrecision = upscaleCfg["halfPrecision"].as<bool>(upscaling.halfPrecision);
 			upscaling.applyMipBias = upscaleCfg["applyMipBias"].as<bool>(upscaling.applyMipBias);
+			upscaling.prewarmAllMethods = upscaleCfg["prewarmAllMethods"].as<bool>(upscaling.prewarmAllMethods);
 
 			YAML::Node dxvkCfg = cfg["dxvk"];
 			DxvkConfig &dxvk = g_config.dxvk;
@@ -95,10 +123,18 @@ namespace vrperfkit {
 			ffr.midRadius = ffrCfg["midRadius"].as<float>(ffr.midRadius);
 			ffr.outerRadius = ffrCfg["outerRadius"].as<float>(ffr.outerRadius);
 			ffr.overrideSingleEyeOrder = ffrCfg["overrideSingleEyeOrder"].as<std::string>(ffr.overrideSingleEyeOrder);
+			ffr.skipSquareTargets = ffrCfg["skipSquareTargets"].as<bool>(ffr.skipSquareTargets);
+			ffr.targetSizeTolerance = std::max(0, ffrCfg["targetSizeTolerance"].as<int>(ffr.targetSizeTolerance));
+
+			YAML::Node controlCfg = cfg["controlServer"];
+			ControlServerConfig &control = g_config.control;
+			control.enabled = controlCfg["enabled"].as<bool>(control.enabled);
+			control.pipeName = controlCfg["pipeName"].as<std::string>(control.pipeName);
 
 			g_config.debugMode = cfg["debugMode"].as<bool>(g_config.debugMode);
 
 			g_config.dllLoadPath = cfg["dllLoadPath"].as<std::string>(g_config.dllLoadPath);
+			g_config.profileDatabase = cfg["profileDatabase"].as<std::string>(g_config.profileDatabase);
 		}
 		catch (const YAML::Exception &e) {
 			LOG_ERROR << "Failed to load configuration file: " << e.msg;
@@ -112,6 +148,9 @@ namespace vrperfkit {
 			LOG_INFO << "    * Render scale: " << std::setprecision(2) << g_config.upscaling.renderScale;
 			LOG_INFO << "    * Sharpness:    " << std::setprecision(2) << g_config.upscaling.sharpness;
 			LOG_INFO << "    * Radius:       " << std::setprecision(2) << g_config.upscaling.radius;
+			LOG_INFO << "    * Contrast:     " << std::setprecision(2) << g_config.upscaling.contrastThreshold;
+			LOG_INFO << "    * Luma only:    " << PrintToggle(g_config.upscaling.lumaOnly);
+			LOG_INFO << "    * 16-bit math:  " << PrintToggle(g_config.upscaling.halfPrecision);
 			LOG_INFO << "    * MIP bias:     " << PrintToggle(g_config.upscaling.applyMipBias);
 		}
 		LOG_INFO << "  Fixed foveated rendering (" << FFRMethodToString(g_config.ffr.method) << ") is " << PrintToggle(g_config.ffr.enabled);
@@ -122,6 +161,12 @@ namespace vrperfkit {
 			if (!g_config.ffr.overrideSingleEyeOrder.empty()) {
 				LOG_INFO << "    * Eye order:    " << g_config.ffr.overrideSingleEyeOrder;
 			}
+			LOG_INFO << "    * Square RTs:   " << (g_config.ffr.skipSquareTargets ? "skipped" : "considered");
+			LOG_INFO << "    * Size slack:   " << g_config.ffr.targetSizeTolerance;
+		}
+		LOG_INFO << "  Control server is " << PrintToggle(g_config.control.enabled);
+		if (g_config.control.enabled) {
+			LOG_INFO << "    * Pipe name:    " << g_config.control.pipeName;
 		}
 		LOG_INFO << "  Debug mode is " << PrintToggle(g_config.debugMode);
 		FlushLog();
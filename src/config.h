@@ -1,8 +1,13 @@
 #pragma once
+#include "control_protocol.h"
 #include "types.h"
 
 #include <filesystem>
 
+namespace YAML {
+	class Node;
+}
+
 namespace vrperfkit {
 	struct UpscaleConfig {
 		bool enabled = false;
@@ -10,7 +15,15 @@ namespace vrperfkit {
 		float renderScale = 1.0f;
 		float sharpness = 0.7f;
 		float radius = 0.6f;
+		// tiles inside the radius whose input luma varies less than this take the cheap path, too; 0 disables
+		float contrastThreshold = 0.0f;
+		// run the full filter on luma only and sample chroma bilinearly; only FSR has such a mode
+		bool lumaOnly = false;
+		// use the 16-bit shader variants of FSR and CAS on GPUs that support them; off forces 32-bit math everywhere
+		bool halfPrecision = true;
 		bool applyMipBias = true;
+		// create the resources for all methods up front, so that switching methods never stalls a frame
+		bool prewarmAllMethods = false;
 	};
 
 	struct DxvkConfig {
@@ -30,14 +43,25 @@ namespace vrperfkit {
 		float outerRadius = 1.0f;
 		bool favorHorizontal = true;
 		std::string overrideSingleEyeOrder;
+		// render target classification: square targets are usually shadow maps, not eye targets
+		bool skipSquareTargets = true;
+		// how many pixels a render target may exceed the eye target size and still count as an eye target
+		int targetSizeTolerance = 2;
+	};
+
+	struct ControlServerConfig {
+		bool enabled = false;
+		std::string pipeName = control::DEFAULT_PIPE_NAME;
 	};
 
 	struct Config {
 		UpscaleConfig upscaling;
 		DxvkConfig dxvk;
 		FixedFoveatedConfig ffr;
+		ControlServerConfig control;
 		bool debugMode = false;
 		std::string dllLoadPath = "";
+		std::string profileDatabase = "vrperfkit_profiles.yml";
 
 		// not a config option, but a signal to take a capture of the final rendering output
 		bool captureOutput = false;
@@ -45,6 +69,8 @@ namespace vrperfkit {
 
 	extern Config g_config;
 
-	void LoadConfig(const std::filesystem::path &configPath);
+	// parses the config file once; the resulting node is shared by LoadConfig and LoadHotkeys
+	YAML::Node LoadConfigFile(const std::filesystem::path &configPath);
+	void LoadConfig(YAML::Node cfg);
 	void PrintCurrentConfig();
 }
@@ -0,0 +1,144 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// Binary protocol spoken over the control server's named pipe. Every message consists of a
+// MessageHeader immediately followed by payloadSize bytes of payload. The pipe runs in message
+// mode, so each message is written with a single WriteFile call.
+// This header is shared with the standalone control client and must not depend on anything else.
+
+namespace vrperfkit {
+	namespace control {
+		constexpr uint32_t PROTOCOL_VERSION = 2;
+		constexpr const char *DEFAULT_PIPE_NAME = "vrperfkit";
+		constexpr uint32_t MAX_MESSAGE_SIZE = 256;
+
+		enum class MessageType : uint8_t {
+			// client -> server
+			SetField = 1,
+			QueryState = 2,
+			Subscribe = 3,
+			Unsubscribe = 4,
+			Capture = 5,
+			Benchmark = 6,
+
+			// server -> client
+			State = 64,
+			FrameMetrics = 65,
+			BenchmarkResult = 66,
+			Error = 67,
+		};
+
+		enum class Field : uint8_t {
+			UpscalingEnabled,
+			UpscalingMethod,
+			RenderScale,
+			Sharpness,
+			Radius,
+			ApplyMipBias,
+			FFREnabled,
+			FFRInnerRadius,
+			FFRMidRadius,
+			FFROuterRadius,
+			FFRFavorHorizontal,
+			DebugMode,
+			ContrastThreshold,
+			LumaOnly,
+			HalfPrecision,
+			PrewarmAllMethods,
+			FFRMethod,
+			FFRSkipSquareTargets,
+			FFRTargetSizeTolerance,
+
+			Count
+		};
+
+		enum class ErrorCode : uint8_t {
+			UnknownMessage = 1,
+			MalformedMessage = 2,
+			UnknownField = 3,
+			BenchmarkRunning = 4,
+			InvalidValue = 5,
+		};
+
+#pragma pack(push, 1)
+		struct MessageHeader {
+			MessageType type;
+			uint8_t reserved;
+			uint16_t payloadSize;
+		};
+
+		struct SetFieldMessage {
+			Field field;
+			uint8_t reserved[3];
+			// booleans are transmitted as 0 or 1, methods as their numeric enum value. String options
+			// such as the pipe name or DLL paths only take effect at startup and cannot be set.
+			float value;
+		};
+
+		struct BenchmarkMessage {
+			uint32_t frameCount;
+		};
+
+		struct StateMessage {
+			uint32_t protocolVersion;
+			uint32_t frameIndex;
+			float values[(size_t)Field::Count];
+		};
+
+		struct FrameMetricsMessage {
+			uint32_t frameIndex;
+			float frameTimeMs;
+			// GPU queries are read without waiting for them, so this is the post-processing time of the
+			// latest frame whose queries had completed, usually two or three frames back; 0 if there was none
+			float postProcessGpuMs;
+		};
+
+		struct BenchmarkResultMessage {
+			uint32_t frameCount;
+			float avgFrameTimeMs;
+			float maxFrameTimeMs;
+			float avgPostProcessGpuMs;
+		};
+
+		struct ErrorMessage {
+			ErrorCode code;
+		};
+#pragma pack(pop)
+
+		inline const char *FieldName(Field field) {
+			switch (field) {
+			case Field::UpscalingEnabled: return "upscaling.enabled";
+			case Field::UpscalingMethod: return "upscaling.method";
+			case Field::RenderScale: return "upscaling.renderScale";
+			case Field::Sharpness: return "upscaling.sharpness";
+			case Field::Radius: return "upscaling.radius";
+			case Field::ApplyMipBias: return "upscaling.applyMipBias";
+			case Field::FFREnabled: return "fixedFoveated.enabled";
+			case Field::FFRInnerRadius: return "fixedFoveated.innerRadius";
+			case Field::FFRMidRadius: return "fixedFoveated.midRadius";
+			case Field::FFROuterRadius: return "fixedFoveated.outerRadius";
+			case Field::FFRFavorHorizontal: return "fixedFoveated.favorHorizontal";
+			case Field::DebugMode: return "debugMode";
+			case Field::ContrastThreshold: return "upscaling.contrastThreshold";
+			case Field::LumaOnly: return "upscaling.lumaOnly";
+			case Field::HalfPrecision: return "upscaling.halfPrecision";
+			case Field::PrewarmAllMethods: return "upscaling.prewarmAllMethods";
+			case Field::FFRMethod: return "fixedFoveated.method";
+			case Field::FFRSkipSquareTargets: return "fixedFoveated.skipSquareTargets";
+			case Field::FFRTargetSizeTolerance: return "fixedFoveated.targetSizeTolerance";
+			default: return "unknown";
+			}
+		}
+
+		inline bool FieldFromName(const char *name, Field &field) {
+			for (uint8_t i = 0; i < (uint8_t)Field::Count; ++i) {
+				if (std::strcmp(name, FieldName((Field)i)) == 0) {
+					field = (Field)i;
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+}
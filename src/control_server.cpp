@@ -0,0 +1,495 @@
+#include "control_server.h"
+#include "control_protocol.h"
+
+#include "config.h"
+#include "logging.h"
+#include "win_header_sane.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vrperfkit {
+	namespace {
+		using namespace control;
+
+		struct ClientRequest {
+			MessageType type;
+			SetFieldMessage setField;
+			BenchmarkMessage benchmark;
+		};
+
+		// client requests are only queued by the server thread and get applied on the render thread,
+		// so that config changes never happen in the middle of a frame
+		std::mutex g_requestMutex;
+		std::vector<ClientRequest> g_pendingRequests;
+
+		// outgoing messages are queued by the render thread and written by the server thread
+		const size_t MAX_QUEUED_MESSAGES = 256;
+		std::mutex g_outboxMutex;
+		std::vector<std::vector<uint8_t>> g_outbox;
+
+		HANDLE g_stopEvent = nullptr;
+		HANDLE g_outboxEvent = nullptr;
+		std::atomic_bool g_clientConnected = false;
+		std::atomic_bool g_metricsSubscribed = false;
+		std::atomic_bool g_benchmarkRunning = false;
+
+		// render thread state
+		uint32_t g_frameIndex = 0;
+		LARGE_INTEGER g_lastFrameTime = {};
+		float g_frameGpuTime = 0;
+
+		struct BenchmarkState {
+			uint32_t targetFrames = 0;
+			uint32_t frames = 0;
+			float summedFrameTime = 0;
+			float maxFrameTime = 0;
+			float summedGpuTime = 0;
+		};
+		BenchmarkState g_benchmark;
+
+		template<typename T>
+		void QueueMessage(MessageType type, const T &payload) {
+			std::vector<uint8_t> message (sizeof(MessageHeader) + sizeof(T));
+			MessageHeader header { type, 0, sizeof(T) };
+			memcpy(message.data(), &header, sizeof(header));
+			memcpy(message.data() + sizeof(header), &payload, sizeof(T));
+
+			{
+				std::lock_guard<std::mutex> lock (g_outboxMutex);
+				if (g_outbox.size() >= MAX_QUEUED_MESSAGES) {
+					// client is not reading, drop the message instead of piling up memory
+					return;
+				}
+				g_outbox.push_back(std::move(message));
+			}
+			SetEvent(g_outboxEvent);
+		}
+
+		void QueueError(ErrorCode code) {
+			QueueMessage(MessageType::Error, ErrorMessage { code });
+		}
+
+		void HandleClientMessage(const uint8_t *data, DWORD size) {
+			if (size < sizeof(MessageHeader)) {
+				QueueError(ErrorCode::MalformedMessage);
+				return;
+			}
+
+			MessageHeader header;
+			memcpy(&header, data, sizeof(header));
+			if (header.payloadSize != size - sizeof(MessageHeader)) {
+				QueueError(ErrorCode::MalformedMessage);
+				return;
+			}
+
+			ClientRequest request = {};
+			request.type = header.type;
+			const uint8_t *payload = data + sizeof(MessageHeader);
+			switch (header.type) {
+			case MessageType::SetField:
+				if (header.payloadSize != sizeof(SetFieldMessage)) {
+					QueueError(ErrorCode::MalformedMessage);
+					return;
+				}
+				memcpy(&request.setField, payload, sizeof(SetFieldMessage));
+				break;
+			case MessageType::Benchmark:
+				if (header.payloadSize != sizeof(BenchmarkMessage)) {
+					QueueError(ErrorCode::MalformedMessage);
+					return;
+				}
+				memcpy(&request.benchmark, payload, sizeof(BenchmarkMessage));
+				break;
+			case MessageType::QueryState:
+			case MessageType::Subscribe:
+			case MessageType::Unsubscribe:
+			case MessageType::Capture:
+				break;
+			default:
+				QueueError(ErrorCode::UnknownMessage);
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock (g_requestMutex);
+			g_pendingRequests.push_back(request);
+		}
+
+		bool FlushOutbox(HANDLE pipe, HANDLE writeEvent) {
+			std::vector<std::vector<uint8_t>> messages;
+			{
+				std::lock_guard<std::mutex> lock (g_outboxMutex);
+				messages.swap(g_outbox);
+			}
+
+			for (const auto &message : messages) {
+				OVERLAPPED overlapped = {};
+				overlapped.hEvent = writeEvent;
+				DWORD written = 0;
+				if (!WriteFile(pipe, message.data(), (DWORD)message.size(), nullptr, &overlapped) && GetLastError() != ERROR_IO_PENDING) {
+					return false;
+				}
+				if (!GetOverlappedResult(pipe, &overlapped, &written, TRUE)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// returns false if the server was asked to stop
+		bool ServeClient(HANDLE pipe) {
+			HANDLE readEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			HANDLE writeEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			uint8_t buffer[MAX_MESSAGE_SIZE];
+			bool keepRunning = true;
+			bool connected = true;
+
+			while (connected) {
+				OVERLAPPED overlapped = {};
+				overlapped.hEvent = readEvent;
+				ResetEvent(readEvent);
+				if (!ReadFile(pipe, buffer, sizeof(buffer), nullptr, &overlapped) && GetLastError() != ERROR_IO_PENDING) {
+					break;
+				}
+
+				bool readPending = true;
+				while (readPending) {
+					HANDLE events[] = { g_stopEvent, readEvent, g_outboxEvent };
+					DWORD result = WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, INFINITE);
+					if (result == WAIT_OBJECT_0 + 1) {
+						DWORD bytesRead = 0;
+						if (GetOverlappedResult(pipe, &overlapped, &bytesRead, FALSE)) {
+							HandleClientMessage(buffer, bytesRead);
+						}
+						else {
+							// client disconnected or sent a message that exceeds the protocol's size limit
+							connected = false;
+						}
+						readPending = false;
+					}
+					else if (result == WAIT_OBJECT_0 + 2) {
+						if (!FlushOutbox(pipe, writeEvent)) {
+							connected = false;
+						}
+					}
+					else {
+						keepRunning = connected = false;
+					}
+
+					if (!connected && readPending) {
+						CancelIo(pipe);
+						DWORD ignored;
+						GetOverlappedResult(pipe, &overlapped, &ignored, TRUE);
+						readPending = false;
+					}
+				}
+			}
+
+			CloseHandle(readEvent);
+			CloseHandle(writeEvent);
+			return keepRunning;
+		}
+
+		void ServerThread(std::wstring pipeName) {
+			HANDLE connectEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+			while (true) {
+				HANDLE pipe = CreateNamedPipeW(pipeName.c_str(),
+					PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+					PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+					1, 4096, 4096, 0, nullptr);
+				if (pipe == INVALID_HANDLE_VALUE) {
+					LOG_ERROR << "Failed to create control pipe " << pipeName << ": " << GetLastError();
+					break;
+				}
+
+				OVERLAPPED overlapped = {};
+				overlapped.hEvent = connectEvent;
+				ResetEvent(connectEvent);
+				bool clientConnected = ConnectNamedPipe(pipe, &overlapped) || GetLastError() == ERROR_PIPE_CONNECTED;
+				if (!clientConnected && GetLastError() == ERROR_IO_PENDING) {
+					HANDLE events[] = { g_stopEvent, connectEvent };
+					DWORD ignored;
+					if (WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, INFINITE) != WAIT_OBJECT_0 + 1) {
+						CancelIo(pipe);
+						GetOverlappedResult(pipe, &overlapped, &ignored, TRUE);
+						CloseHandle(pipe);
+						break;
+					}
+					clientConnected = GetOverlappedResult(pipe, &overlapped, &ignored, FALSE);
+				}
+
+				bool keepRunning = true;
+				if (clientConnected) {
+					LOG_INFO << "Control client connected";
+					g_clientConnected = true;
+					keepRunning = ServeClient(pipe);
+					g_clientConnected = false;
+					g_metricsSubscribed = false;
+					{
+						std::lock_guard<std::mutex> lock (g_outboxMutex);
+						g_outbox.clear();
+					}
+					{
+						// requests the client did not see applied must not carry over to the next client
+						std::lock_guard<std::mutex> lock (g_requestMutex);
+						g_pendingRequests.clear();
+					}
+					LOG_INFO << "Control client disconnected";
+				}
+
+				DisconnectNamedPipe(pipe);
+				CloseHandle(pipe);
+				if (!keepRunning) {
+					break;
+				}
+			}
+
+			CloseHandle(connectEvent);
+		}
+
+		float FieldValue(Field field) {
+			switch (field) {
+			case Field::UpscalingEnabled: return g_config.upscaling.enabled;
+			case Field::UpscalingMethod: return (float)g_config.upscaling.method;
+			case Field::RenderScale: return g_config.upscaling.renderScale;
+			case Field::Sharpness: return g_config.upscaling.sharpness;
+			case Field::Radius: return g_config.upscaling.radius;
+			case Field::ApplyMipBias: return g_config.upscaling.applyMipBias;
+			case Field::FFREnabled: return g_config.ffr.enabled;
+			case Field::FFRInnerRadius: return g_config.ffr.innerRadius;
+			case Field::FFRMidRadius: return g_config.ffr.midRadius;
+			case Field::FFROuterRadius: return g_config.ffr.outerRadius;
+			case Field::FFRFavorHorizontal: return g_config.ffr.favorHorizontal;
+			case Field::DebugMode: return g_config.debugMode;
+			case Field::ContrastThreshold: return g_config.upscaling.contrastThreshold;
+			case Field::LumaOnly: return g_config.upscaling.lumaOnly;
+			case Field::HalfPrecision: return g_config.upscaling.halfPrecision;
+			case Field::PrewarmAllMethods: return g_config.upscaling.prewarmAllMethods;
+			case Field::FFRMethod: return (float)g_config.ffr.method;
+			case Field::FFRSkipSquareTargets: return g_config.ffr.skipSquareTargets;
+			case Field::FFRTargetSizeTolerance: return (float)g_config.ffr.targetSizeTolerance;
+			default: return 0;
+			}
+		}
+
+		// the value must be finite; returns false if it is out of range for an enum field
+		bool ApplyField(Field field, float value) {
+			switch (field) {
+			case Field::UpscalingEnabled:
+				g_config.upscaling.enabled = value != 0;
+				break;
+			case Field::UpscalingMethod:
+				if (value < (float)UpscaleMethod::FSR || value > (float)UpscaleMethod::TEMPORAL) {
+					return false;
+				}
+				g_config.upscaling.method = (UpscaleMethod)(int)value;
+				LogIfExperimental(g_config.upscaling.method);
+				break;
+			case Field::RenderScale:
+				// only takes effect the next time the render resolution is queried by the game
+				g_config.upscaling.renderScale = std::max(0.5f, value);
+				break;
+			case Field::Sharpness:
+				g_config.upscaling.sharpness = std::min(1.f, std::max(0.f, value));
+				break;
+			case Field::Radius:
+				g_config.upscaling.radius = std::max(0.f, value);
+				break;
+			case Field::ApplyMipBias:
+				g_config.upscaling.applyMipBias = value != 0;
+				break;
+			case Field::FFREnabled:
+				g_config.ffr.enabled = value != 0;
+				break;
+			// the radii are kept in order, inner <= mid <= outer, by clamping to the neighbouring ones
+			case Field::FFRInnerRadius:
+				g_config.ffr.innerRadius = std::min(g_config.ffr.midRadius, std::max(0.f, value));
+				break;
+			case Field::FFRMidRadius:
+				g_config.ffr.midRadius = std::min(g_config.ffr.outerRadius, std::max(g_config.ffr.innerRadius, value));
+				break;
+			case Field::FFROuterRadius:
+				g_config.ffr.outerRadius = std::max(g_config.ffr.midRadius, value);
+				break;
+			case Field::FFRFavorHorizontal:
+				g_config.ffr.favorHorizontal = value != 0;
+				break;
+			case Field::DebugMode:
+				g_config.debugMode = value != 0;
+				break;
+			case Field::ContrastThreshold:
+				g_config.upscaling.contrastThreshold = std::max(0.f, value);
+				break;
+			case Field::LumaOnly:
+				g_config.upscaling.lumaOnly = value != 0;
+				break;
+			case Field::HalfPrecision:
+				g_config.upscaling.halfPrecision = value != 0;
+				break;
+			case Field::PrewarmAllMethods:
+				// only takes effect the next time the post processor is created
+				g_config.upscaling.prewarmAllMethods = value != 0;
+				break;
+			case Field::FFRMethod:
+				if (value != (float)FixedFoveatedMethod::VRS) {
+					return false;
+				}
+				g_config.ffr.method = (FixedFoveatedMethod)(int)value;
+				break;
+			case Field::FFRSkipSquareTargets:
+				g_config.ffr.skipSquareTargets = value != 0;
+				break;
+			case Field::FFRTargetSizeTolerance:
+				g_config.ffr.targetSizeTolerance = std::max(0, (int)std::min(value, 65536.f));
+				break;
+			default:
+				return false;
+			}
+
+			LOG_INFO << "Control client set " << FieldName(field) << " to " << FieldValue(field);
+			return true;
+		}
+
+		void SendState() {
+			StateMessage state = {};
+			state.protocolVersion = PROTOCOL_VERSION;
+			state.frameIndex = g_frameIndex;
+			for (uint8_t i = 0; i < (uint8_t)Field::Count; ++i) {
+				state.values[i] = FieldValue((Field)i);
+			}
+			QueueMessage(MessageType::State, state);
+		}
+
+		void ApplyRequest(const ClientRequest &request) {
+			switch (request.type) {
+			case MessageType::SetField:
+				if (request.setField.field >= Field::Count) {
+					QueueError(ErrorCode::UnknownField);
+				}
+				else if (!std::isfinite(request.setField.value) || !ApplyField(request.setField.field, request.setField.value)) {
+					QueueError(ErrorCode::InvalidValue);
+				}
+				else {
+					SendState();
+				}
+				break;
+			case MessageType::QueryState:
+				SendState();
+				break;
+			case MessageType::Subscribe:
+				g_metricsSubscribed = true;
+				break;
+			case MessageType::Unsubscribe:
+				g_metricsSubscribed = false;
+				break;
+			case MessageType::Capture:
+				g_config.captureOutput = true;
+				LOG_INFO << "Capturing output...";
+				break;
+			case MessageType::Benchmark:
+				if (g_benchmarkRunning) {
+					QueueError(ErrorCode::BenchmarkRunning);
+					break;
+				}
+				g_benchmark = BenchmarkState();
+				g_benchmark.targetFrames = std::max(1u, request.benchmark.frameCount);
+				g_benchmarkRunning = true;
+				LOG_INFO << "Starting benchmark over " << g_benchmark.targetFrames << " frames";
+				break;
+			default:
+				break;
+			}
+		}
+
+		void UpdateBenchmark(float frameTime, float gpuTime) {
+			g_benchmark.summedFrameTime += frameTime;
+			g_benchmark.maxFrameTime = std::max(g_benchmark.maxFrameTime, frameTime);
+			g_benchmark.summedGpuTime += gpuTime;
+			if (++g_benchmark.frames < g_benchmark.targetFrames) {
+				return;
+			}
+
+			BenchmarkResultMessage result;
+			result.frameCount = g_benchmark.frames;
+			result.avgFrameTimeMs = g_benchmark.summedFrameTime / g_benchmark.frames;
+			result.maxFrameTimeMs = g_benchmark.maxFrameTime;
+			result.avgPostProcessGpuMs = g_benchmark.summedGpuTime / g_benchmark.frames;
+			LOG_INFO << "Benchmark finished: average frame time " << result.avgFrameTimeMs << " ms, max "
+				<< result.maxFrameTimeMs << " ms, post-processing " << result.avgPostProcessGpuMs << " ms";
+			QueueMessage(MessageType::BenchmarkResult, result);
+			g_benchmarkRunning = false;
+		}
+	}
+
+	void StartControlServer() {
+		if (!g_config.control.enabled || g_stopEvent != nullptr) {
+			return;
+		}
+
+		std::wstring pipeName = L"\\\\.\\pipe\\" + std::wstring(g_config.control.pipeName.begin(), g_config.control.pipeName.end());
+		LOG_INFO << "Starting control server on " << pipeName;
+		g_stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		g_outboxEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+		// the thread is never joined: on process exit it is torn down by the OS, and joining while
+		// holding the loader lock in DllMain would deadlock
+		std::thread(ServerThread, pipeName).detach();
+	}
+
+	void StopControlServer() {
+		if (g_stopEvent != nullptr) {
+			SetEvent(g_stopEvent);
+		}
+	}
+
+	void ProcessControlRequests() {
+		if (g_stopEvent == nullptr) {
+			return;
+		}
+
+		LARGE_INTEGER now, frequency;
+		QueryPerformanceCounter(&now);
+		QueryPerformanceFrequency(&frequency);
+		float frameTime = g_lastFrameTime.QuadPart != 0 ? 1000.f * (now.QuadPart - g_lastFrameTime.QuadPart) / frequency.QuadPart : 0;
+		g_lastFrameTime = now;
+		float gpuTime = g_frameGpuTime;
+		g_frameGpuTime = 0;
+		++g_frameIndex;
+
+		if (!g_clientConnected) {
+			g_benchmarkRunning = false;
+			return;
+		}
+
+		std::vector<ClientRequest> requests;
+		{
+			std::lock_guard<std::mutex> lock (g_requestMutex);
+			requests.swap(g_pendingRequests);
+		}
+		for (const auto &request : requests) {
+			ApplyRequest(request);
+		}
+
+		if (g_metricsSubscribed) {
+			QueueMessage(MessageType::FrameMetrics, FrameMetricsMessage { g_frameIndex, frameTime, gpuTime });
+		}
+
+		if (g_benchmarkRunning && frameTime > 0) {
+			UpdateBenchmark(frameTime, gpuTime);
+		}
+	}
+
+	bool ControlServerWantsGpuTimings() {
+		return g_metricsSubscribed || g_benchmarkRunning;
+	}
+
+	void ReportPostProcessingGpuTime(float milliseconds) {
+		// reported per eye or stereo pass as the GPU finishes them, accumulated until the next frame's metrics
+		g_frameGpuTime += milliseconds;
+	}
+}
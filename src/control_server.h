@@ -0,0 +1,13 @@
+#pragma once
+
+namespace vrperfkit {
+	void StartControlServer();
+	void StopControlServer();
+
+	// applies queued client requests and publishes frame metrics; call once per frame from the render thread
+	void ProcessControlRequests();
+
+	// true if a connected client needs post-processing GPU timings (metrics subscription or running benchmark)
+	bool ControlServerWantsGpuTimings();
+	void ReportPostProcessingGpuTime(float milliseconds);
+}
@@ -1,8 +1,8 @@
 #include "d3d11_cas_upscaler.h"
 #include "d3d11_helper.h"
+#include "d3d11_shader_permutations.h"
 #include "logging.h"
-#include "shader_cas_upscale.h"
-#include "shader_cas_sharpen.h"
+#include "shader_cas_permutations.h"
 #include "config.h"
 
 #include "nis/NIS_Config.h"
@@ -20,60 +20,112 @@ namespace vrperfkit {
 		uint32_t inputTextureSize[2];
 		uint32_t outputTextureSize[2];
 		uint32_t projCentre[2];
+		uint32_t viewportSize[2];
 		uint32_t squaredRadius;
-		uint32_t debugMode;
+		uint32_t padding[3];
 	};
 
-	D3D11CasUpscaler::D3D11CasUpscaler(ID3D11Device *device) {
+	D3D11CasUpscaler::D3D11CasUpscaler(ID3D11Device *device, D3D11ResourceCache &resources) : resources(resources) {
 		LOG_INFO << "Creating D3D11 resources for CAS upscaling...";
 		device->GetImmediateContext(context.GetAddressOf());
 
-		CheckResult("creating CAS upscale shader", device->CreateComputeShader(g_CASUpscaleShader, sizeof(g_CASUpscaleShader), nullptr, upscaleShader.GetAddressOf()));
-		CheckResult("creating CAS sharpen shader", device->CreateComputeShader(g_CASSharpenShader, sizeof(g_CASSharpenShader), nullptr, sharpenShader.GetAddressOf()));
+		// other permutations are created when first needed
+		GetShaderPermutation(resources, g_CASPermutations, 0, "CAS shader");
+		GetShaderPermutation(resources, g_CASPermutations, SHADER_SHARPEN_ONLY, "CAS shader");
 
-		constantsBuffer = CreateConstantsBuffer(device, sizeof(ShaderConstants));
-		sampler = CreateLinearSampler(device);
+		// room for the constants of both eyes
+		for (int i = 0; i < CONSTANTS_SETS; ++i) {
+			constantsBuffers[i].reset(new D3D11ConstantBuffer(device, 2 * sizeof(ShaderConstants)));
+			tileLists[i].reset(new D3D11TileLists(device, resources));
+		}
+		tileEdges.reset(new D3D11TileEdges(device, resources));
+		sampler = resources.GetLinearSampler();
 	}
 
 	void D3D11CasUpscaler::Upscale(const D3D11PostProcessInput &input, const Viewport &outputViewport) {
+		Dispatch(&input, &outputViewport, 1);
+	}
+
+	void D3D11CasUpscaler::UpscaleStereo(const D3D11PostProcessInput *inputs, const Viewport *outputViewports) {
+		if (CanDispatchStereo(inputs, outputViewports)) {
+			Dispatch(inputs, outputViewports, 2);
+		}
+		else {
+			D3D11Upscaler::UpscaleStereo(inputs, outputViewports);
+		}
+	}
+
+	void D3D11CasUpscaler::Dispatch(const D3D11PostProcessInput *inputs, const Viewport *outputViewports, int eyeCount) {
+		// with multiple eyes, they share all views and sizes, so the first eye determines the pass setup
+		const D3D11PostProcessInput &first = inputs[0];
 		D3D11_TEXTURE2D_DESC td, otd;
-		input.inputTexture->GetDesc(&td);
-		input.outputTexture->GetDesc(&otd);
+		first.inputTexture->GetDesc(&td);
+		first.outputTexture->GetDesc(&otd);
 
-		context->CSSetSamplers(0, 1, sampler.GetAddressOf());
-		ID3D11ShaderResourceView *srvs[1] = {input.inputView};
-		context->CSSetShaderResources(0, 1, srvs);
+		uint32_t features = ShaderFeatures(resources, inputs, eyeCount);
+		int constantsSet = ConstantsSet(inputs, eyeCount);
+		// the tile classification binds resources of its own, so it has to run before this pass binds any
+		D3D11TileLists &tiles = *tileLists[constantsSet];
+		bool useTileLists = tiles.Update(inputs, outputViewports, eyeCount, 16, 16, features);
+		if (first.inPlace) {
+			// reads the input before this pass overwrites it, so it has to run before this pass binds anything, too
+			tileEdges->Save(inputs, outputViewports, eyeCount);
+			features |= SHADER_IN_PLACE;
+		}
+
+		context->CSSetSamplers(0, 1, &sampler);
+		// the output replaces the edge buffer's UAV first, as it could not be bound for reading otherwise
 		UINT uavCount = -1;
-		ID3D11UnorderedAccessView *uavs[] = {input.outputUav};
+		ID3D11UnorderedAccessView *uavs[] = {first.outputUav};
 		context->CSSetUnorderedAccessViews(0, 1, uavs, &uavCount);
+		if (first.inPlace) {
+			ID3D11ShaderResourceView *srvs[3] = {nullptr, nullptr, tileEdges->View()};
+			context->CSSetShaderResources(0, 3, srvs);
+		}
+		else {
+			ID3D11ShaderResourceView *srvs[1] = {first.inputView};
+			context->CSSetShaderResources(0, 1, srvs);
+		}
 
-		ShaderConstants constants;
-		CasSetup(constants.const0, constants.const1, g_config.upscaling.sharpness, 
-				input.inputViewport.width, input.inputViewport.height,
-				outputViewport.width, outputViewport.height);
-		constants.inputOffset[0] = input.inputViewport.x;
-		constants.inputOffset[1] = input.inputViewport.y;
-		constants.outputOffset[0] = outputViewport.x;
-		constants.outputOffset[1] = outputViewport.y;
-		constants.inputTextureSize[0] = td.Width;
-		constants.inputTextureSize[1] = td.Height;
-		constants.outputTextureSize[0] = otd.Width;
-		constants.outputTextureSize[1] = otd.Height;
-		float radius = 0.5f * g_config.upscaling.radius * outputViewport.height;
-		constants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
-		constants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
-		constants.squaredRadius = radius * radius;
-		constants.debugMode = g_config.debugMode;
-		context->UpdateSubresource(constantsBuffer.Get(), 0, nullptr, &constants, 0, 0);
-		context->CSSetConstantBuffers(0, 1, constantsBuffer.GetAddressOf());
+		ShaderConstants eyeConstants[2] = {};
+		for (int eye = 0; eye < eyeCount; ++eye) {
+			const D3D11PostProcessInput &input = inputs[eye];
+			const Viewport &outputViewport = outputViewports[eye];
+			ShaderConstants &constants = eyeConstants[eye];
+			CasSetup(constants.const0, constants.const1, g_config.upscaling.sharpness, 
+					input.inputViewport.width, input.inputViewport.height,
+					outputViewport.width, outputViewport.height);
+			constants.inputOffset[0] = input.inputViewport.x;
+			constants.inputOffset[1] = input.inputViewport.y;
+			constants.outputOffset[0] = outputViewport.x;
+			constants.outputOffset[1] = outputViewport.y;
+			constants.inputTextureSize[0] = td.Width;
+			constants.inputTextureSize[1] = td.Height;
+			constants.outputTextureSize[0] = otd.Width;
+			constants.outputTextureSize[1] = otd.Height;
+			float radius = 0.5f * g_config.upscaling.radius * outputViewport.height;
+			constants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
+			constants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
+			constants.viewportSize[0] = outputViewport.width;
+			constants.viewportSize[1] = outputViewport.height;
+			constants.squaredRadius = radius * radius;
+		}
+		constantsBuffers[constantsSet]->Update(eyeConstants);
+		constantsBuffers[constantsSet]->Bind(0);
 
-		if (input.inputViewport != outputViewport) {
-			// full upscaling pass
-			context->CSSetShader(upscaleShader.Get(), nullptr, 0);
-		} else {
+		if (first.inputViewport == outputViewports[0]) {
 			// just sharpening
-			context->CSSetShader(sharpenShader.Get(), nullptr, 0);
+			features |= SHADER_SHARPEN_ONLY;
+		}
+		if (useTileLists) {
+			// in place, the tiles that only get the cheap path can stay as they are
+			tiles.Dispatch(1,
+				GetShaderPermutation(resources, g_CASPermutations, features | SHADER_TILE_LIST, "CAS shader"),
+				first.inPlace ? nullptr : GetShaderPermutation(resources, g_CASPermutations, BilinearFeatures(features), "CAS shader"));
+		}
+		else {
+			context->CSSetShader(GetShaderPermutation(resources, g_CASPermutations, features, "CAS shader"), nullptr, 0);
+			context->Dispatch((outputViewports[0].width + 15) >> 4, (outputViewports[0].height + 15) >> 4, eyeCount);
 		}
-		context->Dispatch((outputViewport.width + 15) >> 4, (outputViewport.height + 15) >> 4, 1);
 	}
 }
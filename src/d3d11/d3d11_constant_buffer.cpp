@@ -0,0 +1,77 @@
+#include "d3d11_constant_buffer.h"
+
+#include <cstring>
+
+namespace vrperfkit {
+	D3D11ConstantBuffer::D3D11ConstantBuffer(ID3D11Device *device, uint32_t size) : size(size), contents(size) {
+		device->GetImmediateContext(context.GetAddressOf());
+		entrySize = (size + 255) & ~255u;
+
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+		if (SUCCEEDED(context.As(&context1))
+				&& SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))) {
+			useRing = options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+		}
+
+		if (useRing) {
+			D3D11_BUFFER_DESC bd;
+			bd.Usage = D3D11_USAGE_DYNAMIC;
+			bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			bd.MiscFlags = 0;
+			bd.StructureByteStride = 0;
+			bd.ByteWidth = entrySize * RING_ENTRIES;
+			CheckResult("creating constants ring buffer", device->CreateBuffer(&bd, nullptr, buffer.GetAddressOf()));
+		}
+		else {
+			buffer = CreateConstantsBuffer(device, size);
+		}
+	}
+
+	void D3D11ConstantBuffer::Update(const void *data) {
+		if (hasContents && memcmp(contents.data(), data, size) == 0) {
+			return;
+		}
+		memcpy(contents.data(), data, size);
+
+		if (!useRing) {
+			context->UpdateSubresource(buffer.Get(), 0, nullptr, data, 0, 0);
+			hasContents = true;
+			return;
+		}
+
+		// append behind the entry the GPU may still be reading, only discard once the ring wraps around
+		D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+		if (!hasContents) {
+			entryOffset = 0;
+			mapType = D3D11_MAP_WRITE_DISCARD;
+		}
+		else {
+			entryOffset += entrySize;
+			if (entryOffset + entrySize > entrySize * RING_ENTRIES) {
+				entryOffset = 0;
+				mapType = D3D11_MAP_WRITE_DISCARD;
+			}
+		}
+
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		CheckResult("mapping constants ring buffer", context->Map(buffer.Get(), 0, mapType, 0, &mapped));
+		memcpy((uint8_t*)mapped.pData + entryOffset, data, size);
+		context->Unmap(buffer.Get(), 0);
+		hasContents = true;
+	}
+
+	void D3D11ConstantBuffer::Bind(UINT slot) {
+		if (!useRing) {
+			context->CSSetConstantBuffers(slot, 1, buffer.GetAddressOf());
+			return;
+		}
+
+		UINT firstConstant = entryOffset / 16;
+		UINT numConstants = entrySize / 16;
+		// some runtimes ignore a changed offset if the same buffer is still bound, so unbind it first
+		ID3D11Buffer *nullBuffer = nullptr;
+		context1->CSSetConstantBuffers(slot, 1, &nullBuffer);
+		context1->CSSetConstantBuffers1(slot, 1, buffer.GetAddressOf(), &firstConstant, &numConstants);
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "d3d11_helper.h"
+
+#include <d3d11_1.h>
+#include <cstdint>
+#include <vector>
+
+namespace vrperfkit {
+	// Constant buffer that is only written when its contents actually change.
+	// If the device can bind constant buffer ranges (D3D11.1), changed contents are appended to a dynamic
+	// ring with MAP_WRITE_NO_OVERWRITE and bound at their offset, so the driver neither has to copy
+	// nor rename the buffer while the GPU may still be reading previous contents.
+	class D3D11ConstantBuffer {
+	public:
+		D3D11ConstantBuffer(ID3D11Device *device, uint32_t size);
+
+		// data must point to the full size given at creation
+		void Update(const void *data);
+		void Bind(UINT slot);
+
+	private:
+		static const uint32_t RING_ENTRIES = 16;
+
+		ComPtr<ID3D11DeviceContext> context;
+		ComPtr<ID3D11DeviceContext1> context1;
+		ComPtr<ID3D11Buffer> buffer;
+		bool useRing = false;
+		uint32_t size;
+		// ring entries must start at multiples of 16 constants, i.e. 256 bytes
+		uint32_t entrySize;
+		uint32_t entryOffset = 0;
+		std::vector<uint8_t> contents;
+		bool hasContents = false;
+	};
+}
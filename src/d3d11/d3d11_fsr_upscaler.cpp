@@ -1,9 +1,12 @@
 #include "d3d11_fsr_upscaler.h"
 
 #include "d3d11_helper.h"
+#include "d3d11_shader_permutations.h"
 #include "logging.h"
-#include "shader_fsr_easu.h"
-#include "shader_fsr_rcas.h"
+#include "shader_fsr_upscale_permutations.h"
+#include "shader_fsr_sharpen_permutations.h"
+
+#include <iterator>
 
 #define A_CPU
 #include "config.h"
@@ -16,80 +19,148 @@ namespace vrperfkit {
 		AU1 const1[4];
 		AU1 const2[4];
 		AU1 const3[4]; // store output offset in final 2
+		AU1 rcasConst[4]; // store output viewport size in final 2
 		AU1 projCentre[2];
 		AU1 squaredRadius;
-		AU1 _padding;
+		AU1 padding;
 	};
 
 	struct SharpenShaderConstants {
 		AU1 const0[4]; // store output offset in final 2
 		AU1 projCentre[2];
+		AU1 viewportSize[2];
 		AU1 squaredRadius;
-		AU1 debugMode;
+		AU1 padding[3];
 	};
 
-	D3D11FsrUpscaler::D3D11FsrUpscaler(ID3D11Device *device, uint32_t outputWidth, uint32_t outputHeight, DXGI_FORMAT format) {
+	D3D11FsrUpscaler::D3D11FsrUpscaler(ID3D11Device *device, D3D11ResourceCache &resources) : resources(resources) {
 		LOG_INFO << "Creating D3D11 resources for FSR upscaling...";
-		CheckResult("creating FSR upscale shader", device->CreateComputeShader(g_FSRUpscaleShader, sizeof(g_FSRUpscaleShader), nullptr, upscaleShader.GetAddressOf()));
-		CheckResult("creating FSR sharpen shader", device->CreateComputeShader(g_FSRSharpenShader, sizeof(g_FSRSharpenShader), nullptr, sharpenShader.GetAddressOf()));
+		// other permutations are created when first needed
+		GetShaderPermutation(resources, g_FSRUpscalePermutations, 0, "FSR upscale shader");
+		GetShaderPermutation(resources, g_FSRSharpenPermutations, 0, "FSR sharpen shader");
 
-		constantsBuffer = CreateConstantsBuffer(device, max(sizeof(UpscaleShaderConstants), sizeof(SharpenShaderConstants)));
-		upscaledTexture = CreatePostProcessTexture(device, outputWidth, outputHeight, format);
-		upscaledView = CreateShaderResourceView(device, upscaledTexture.Get());
-		upscaledUav = CreateUnorderedAccessView(device, upscaledTexture.Get());
-		sampler = CreateLinearSampler(device);
+		// room for the constants of both eyes
+		for (int i = 0; i < CONSTANTS_SETS; ++i) {
+			upscaleConstantsBuffers[i].reset(new D3D11ConstantBuffer(device, 2 * sizeof(UpscaleShaderConstants)));
+			sharpenConstantsBuffers[i].reset(new D3D11ConstantBuffer(device, 2 * sizeof(SharpenShaderConstants)));
+			tileLists[i].reset(new D3D11TileLists(device, resources));
+		}
+		tileEdges.reset(new D3D11TileEdges(device, resources));
+		sampler = resources.GetLinearSampler();
 
 		device->GetImmediateContext(context.GetAddressOf());
 	}
 
 	void D3D11FsrUpscaler::Upscale(const D3D11PostProcessInput &input, const Viewport &outputViewport) {
-		D3D11_TEXTURE2D_DESC td;
-		input.inputTexture->GetDesc(&td);
+		Dispatch(&input, &outputViewport, 1);
+	}
 
-		context->CSSetSamplers(0, 1, sampler.GetAddressOf());
-		ID3D11ShaderResourceView *srvs[1] = {input.inputView};
-		UINT uavCount = -1;
-		ID3D11UnorderedAccessView *uavs[] = {upscaledUav.Get()};
-		float radius = 0.5f * g_config.upscaling.radius * outputViewport.height;
+	void D3D11FsrUpscaler::UpscaleStereo(const D3D11PostProcessInput *inputs, const Viewport *outputViewports) {
+		if (CanDispatchStereo(inputs, outputViewports)) {
+			Dispatch(inputs, outputViewports, 2);
+		}
+		else {
+			D3D11Upscaler::UpscaleStereo(inputs, outputViewports);
+		}
+	}
 
-		if (input.inputViewport != outputViewport) {
-			// upscaling pass
-			UpscaleShaderConstants upscaleConstants;
-			FsrEasuConOffset(upscaleConstants.const0, upscaleConstants.const1, upscaleConstants.const2, upscaleConstants.const3,
-				input.inputViewport.width, input.inputViewport.height, td.Width, td.Height,
-				outputViewport.width, outputViewport.height,
-				input.inputViewport.x, input.inputViewport.y);
-			upscaleConstants.const3[2] = outputViewport.x;
-			upscaleConstants.const3[3] = outputViewport.y;
-			upscaleConstants.squaredRadius = radius * radius;
-			upscaleConstants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
-			upscaleConstants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
-			context->UpdateSubresource(constantsBuffer.Get(), 0, nullptr, &upscaleConstants, 0, 0);
+	void D3D11FsrUpscaler::Dispatch(const D3D11PostProcessInput *inputs, const Viewport *outputViewports, int eyeCount) {
+		// with multiple eyes, they share all views and sizes, so the first eye determines the pass setup
+		const D3D11PostProcessInput &first = inputs[0];
+		D3D11_TEXTURE2D_DESC td;
+		first.inputTexture->GetDesc(&td);
 
-			context->CSSetUnorderedAccessViews(0, 1, uavs, &uavCount);
-			context->CSSetConstantBuffers(0, 1, constantsBuffer.GetAddressOf());
-			context->CSSetShaderResources(0, 1, srvs);
-			context->CSSetShader(upscaleShader.Get(), nullptr, 0);
-			context->Dispatch((outputViewport.width + 15) >> 4, (outputViewport.height + 15) >> 4, 1);
-			srvs[0] = upscaledView.Get();
+		context->CSSetSamplers(0, 1, &sampler);
+		ID3D11ShaderResourceView *srvs[1] = {first.inputView};
+		UINT uavCount = -1;
+		ID3D11UnorderedAccessView *uavs[] = {first.outputUav};
+		float sharpness = 2.f - 2 * g_config.upscaling.sharpness;
+		uint32_t features = ShaderFeatures(resources, inputs, eyeCount);
+		int constantsSet = ConstantsSet(inputs, eyeCount);
+		// the tile classification binds resources of its own, so it has to run before this pass binds any
+		D3D11TileLists &tiles = *tileLists[constantsSet];
+		bool useTileLists = tiles.Update(inputs, outputViewports, eyeCount, 16, 16, features);
+		if (first.inPlace) {
+			// reads the input before this pass overwrites it, so it has to run before this pass binds anything, too
+			tileEdges->Save(inputs, outputViewports, eyeCount);
+			features |= SHADER_IN_PLACE;
 		}
+		const ShaderPermutation *permutations;
+		size_t permutationCount;
+		const char *shaderName;
 
-		// sharpening pass
-		SharpenShaderConstants sharpenConstants;
-		FsrRcasCon(sharpenConstants.const0, 2.f - 2 * g_config.upscaling.sharpness);
-		sharpenConstants.const0[2] = outputViewport.x;
-		sharpenConstants.const0[3] = outputViewport.y;
-		sharpenConstants.squaredRadius = radius * radius;
-		sharpenConstants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
-		sharpenConstants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
-		sharpenConstants.debugMode = g_config.debugMode ? 1 : 0;
-		context->UpdateSubresource(constantsBuffer.Get(), 0, nullptr, &sharpenConstants, 0, 0);
+		if (first.inputViewport != outputViewports[0]) {
+			// EASU and RCAS in a single pass, the upscaled tiles never leave groupshared memory
+			UpscaleShaderConstants upscaleConstants[2] = {};
+			for (int eye = 0; eye < eyeCount; ++eye) {
+				const D3D11PostProcessInput &input = inputs[eye];
+				const Viewport &outputViewport = outputViewports[eye];
+				UpscaleShaderConstants &constants = upscaleConstants[eye];
+				float radius = 0.5f * g_config.upscaling.radius * outputViewport.height;
+				FsrEasuConOffset(constants.const0, constants.const1, constants.const2, constants.const3,
+					input.inputViewport.width, input.inputViewport.height, td.Width, td.Height,
+					outputViewport.width, outputViewport.height,
+					input.inputViewport.x, input.inputViewport.y);
+				constants.const3[2] = outputViewport.x;
+				constants.const3[3] = outputViewport.y;
+				FsrRcasCon(constants.rcasConst, sharpness);
+				constants.rcasConst[2] = outputViewport.width;
+				constants.rcasConst[3] = outputViewport.height;
+				constants.squaredRadius = radius * radius;
+				constants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
+				constants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
+			}
+			upscaleConstantsBuffers[constantsSet]->Update(upscaleConstants);
+			upscaleConstantsBuffers[constantsSet]->Bind(0);
+			// the luma region the shader preloads only covers the taps of 1:1 scale or actual upscaling
+			if (g_config.upscaling.lumaOnly && first.inputViewport.width <= outputViewports[0].width && first.inputViewport.height <= outputViewports[0].height) {
+				features |= SHADER_LUMA_ONLY;
+			}
+			permutations = g_FSRUpscalePermutations;
+			permutationCount = std::size(g_FSRUpscalePermutations);
+			shaderName = "FSR upscale shader";
+		}
+		else {
+			// sharpening pass only
+			SharpenShaderConstants sharpenConstants[2] = {};
+			for (int eye = 0; eye < eyeCount; ++eye) {
+				const D3D11PostProcessInput &input = inputs[eye];
+				const Viewport &outputViewport = outputViewports[eye];
+				SharpenShaderConstants &constants = sharpenConstants[eye];
+				float radius = 0.5f * g_config.upscaling.radius * outputViewport.height;
+				FsrRcasCon(constants.const0, sharpness);
+				constants.const0[2] = outputViewport.x;
+				constants.const0[3] = outputViewport.y;
+				constants.viewportSize[0] = outputViewport.width;
+				constants.viewportSize[1] = outputViewport.height;
+				constants.squaredRadius = radius * radius;
+				constants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
+				constants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
+			}
+			sharpenConstantsBuffers[constantsSet]->Update(sharpenConstants);
+			sharpenConstantsBuffers[constantsSet]->Bind(0);
+			permutations = g_FSRSharpenPermutations;
+			permutationCount = std::size(g_FSRSharpenPermutations);
+			shaderName = "FSR sharpen shader";
+		}
 
-		uavs[0] = input.outputUav;
 		context->CSSetUnorderedAccessViews(0, 1, uavs, &uavCount);
-		context->CSSetConstantBuffers(0, 1, constantsBuffer.GetAddressOf());
-		context->CSSetShaderResources(0, 1, srvs);
-		context->CSSetShader(sharpenShader.Get(), nullptr, 0);
-		context->Dispatch((outputViewport.width + 15) >> 4, (outputViewport.height + 15) >> 4, 1);
+		if (first.inPlace) {
+			ID3D11ShaderResourceView *inPlaceSrvs[3] = {nullptr, nullptr, tileEdges->View()};
+			context->CSSetShaderResources(0, 3, inPlaceSrvs);
+		}
+		else {
+			context->CSSetShaderResources(0, 1, srvs);
+		}
+		if (useTileLists) {
+			// in place, the tiles that only get the cheap path can stay as they are
+			tiles.Dispatch(1,
+				GetShaderPermutation(resources, permutations, permutationCount, features | SHADER_TILE_LIST, shaderName),
+				first.inPlace ? nullptr : GetShaderPermutation(resources, permutations, permutationCount, BilinearFeatures(features), shaderName));
+		}
+		else {
+			context->CSSetShader(GetShaderPermutation(resources, permutations, permutationCount, features, shaderName), nullptr, 0);
+			context->Dispatch((outputViewports[0].width + 15) >> 4, (outputViewports[0].height + 15) >> 4, eyeCount);
+		}
 	}
 }
@@ -1,7 +1,12 @@
 #pragma once
+#include "d3d11_constant_buffer.h"
 #include "d3d11_post_processor.h"
+#include "d3d11_resource_cache.h"
+#include "d3d11_tile_edges.h"
+#include "d3d11_tile_lists.h"
 
 #include <d3d11.h>
+#include <memory>
 #include <wrl/client.h>
 
 using Microsoft::WRL::ComPtr;
@@ -9,17 +14,21 @@ using Microsoft::WRL::ComPtr;
 namespace vrperfkit {
 	class D3D11FsrUpscaler : public D3D11Upscaler {
 	public:
-		D3D11FsrUpscaler(ID3D11Device *device, uint32_t outputWidth, uint32_t outputHeight, DXGI_FORMAT format);
+		D3D11FsrUpscaler(ID3D11Device *device, D3D11ResourceCache &resources);
 		void Upscale(const D3D11PostProcessInput &input, const Viewport &outputViewport) override;
+		void UpscaleStereo(const D3D11PostProcessInput *inputs, const Viewport *outputViewports) override;
+		bool SupportsMultisampledInput() const override { return true; }
+		bool SupportsInPlaceSharpening() const override { return true; }
 
 	private:
 		ComPtr<ID3D11DeviceContext> context;
-		ComPtr<ID3D11ComputeShader> upscaleShader;
-		ComPtr<ID3D11ComputeShader> sharpenShader;
-		ComPtr<ID3D11Buffer> constantsBuffer;
-		ComPtr<ID3D11Texture2D> upscaledTexture;
-		ComPtr<ID3D11ShaderResourceView> upscaledView;
-		ComPtr<ID3D11UnorderedAccessView> upscaledUav;
-		ComPtr<ID3D11SamplerState> sampler;
+		D3D11ResourceCache &resources;
+		std::unique_ptr<D3D11ConstantBuffer> upscaleConstantsBuffers[CONSTANTS_SETS];
+		std::unique_ptr<D3D11ConstantBuffer> sharpenConstantsBuffers[CONSTANTS_SETS];
+		std::unique_ptr<D3D11TileLists> tileLists[CONSTANTS_SETS];
+		std::unique_ptr<D3D11TileEdges> tileEdges;
+		ID3D11SamplerState *sampler;
+
+		void Dispatch(const D3D11PostProcessInput *inputs, const Viewport *outputViewports, int eyeCount);
 	};
 }
@@ -67,11 +67,20 @@ namespace vrperfkit {
 		case DXGI_FORMAT_R16G16B16A16_TYPELESS:
 			return DXGI_FORMAT_R16G16B16A16_FLOAT;
 		case DXGI_FORMAT_R10G10B10A2_TYPELESS:
-			return DXGI_FORMAT_R10G10B10A2_UINT;
+			return DXGI_FORMAT_R10G10B10A2_UNORM;
 		case DXGI_FORMAT_R8G8B8A8_TYPELESS:
 			return DXGI_FORMAT_R8G8B8A8_UNORM;
 		case DXGI_FORMAT_B8G8R8A8_TYPELESS:
 			return DXGI_FORMAT_B8G8R8A8_UNORM;
+		// depth buffers, read through their depth component
+		case DXGI_FORMAT_R32G8X24_TYPELESS:
+			return DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS;
+		case DXGI_FORMAT_R32_TYPELESS:
+			return DXGI_FORMAT_R32_FLOAT;
+		case DXGI_FORMAT_R24G8_TYPELESS:
+			return DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+		case DXGI_FORMAT_R16_TYPELESS:
+			return DXGI_FORMAT_R16_UNORM;
 		default:
 			return format;
 		}
@@ -101,61 +110,36 @@ namespace vrperfkit {
 		}
 	}
 
-	void StoreD3D11State(ID3D11DeviceContext *context, D3D11State &state) {
-		context->VSGetShader(state.vertexShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
-		context->PSGetShader(state.pixelShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
-		context->CSGetShader(state.computeShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
-		context->IAGetInputLayout( state.inputLayout.ReleaseAndGetAddressOf() );
-		context->IAGetPrimitiveTopology( &state.topology );
-		context->IAGetVertexBuffers( 0, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, state.vertexBuffers, state.strides, state.offsets );
-		context->IAGetIndexBuffer(state.indexBuffer.ReleaseAndGetAddressOf(), &state.format, &state.offset);
-		context->OMGetRenderTargets( D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, state.renderTargets, state.depthStencil.GetAddressOf() );
-		context->RSGetState( state.rasterizerState.ReleaseAndGetAddressOf() );
-		context->OMGetDepthStencilState( state.depthStencilState.ReleaseAndGetAddressOf(), &state.stencilRef );
-		context->RSGetViewports( &state.numViewports, nullptr );
-		context->RSGetViewports( &state.numViewports, state.viewports );
-		context->VSGetConstantBuffers( 0, 1, state.vsConstantBuffer.GetAddressOf() );
-		context->PSGetConstantBuffers( 0, 1, state.psConstantBuffer.GetAddressOf() );
-		context->CSGetConstantBuffers(0, 1, state.csConstantBuffer.GetAddressOf());
-		context->CSGetShaderResources(0, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, state.csShaderResources);
-		context->CSGetUnorderedAccessViews(0, D3D11_1_UAV_SLOT_COUNT, state.csUavs);
-	}
-
-	void RestoreD3D11State(ID3D11DeviceContext *context, const D3D11State &state) {
-		context->VSSetShader(state.vertexShader.Get(), nullptr, 0);
-		context->PSSetShader(state.pixelShader.Get(), nullptr, 0);
-		context->CSSetShader(state.computeShader.Get(), nullptr, 0);
-		context->IASetInputLayout( state.inputLayout.Get() );
-		context->IASetPrimitiveTopology( state.topology );
-		context->IASetVertexBuffers( 0, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, state.vertexBuffers, state.strides, state.offsets );
-		for (int i = 0; i < D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT; ++i) {
-			if (state.vertexBuffers[i])
-				state.vertexBuffers[i]->Release();
-		}
-		context->IASetIndexBuffer( state.indexBuffer.Get(), state.format, state.offset );
-		context->OMSetRenderTargets( D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, state.renderTargets, state.depthStencil.Get() );
-		for (int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
-			if (state.renderTargets[i]) {
-				state.renderTargets[i]->Release();
-			}
-		}
-		context->RSSetState( state.rasterizerState.Get() );
-		context->OMSetDepthStencilState( state.depthStencilState.Get(), state.stencilRef );
-		context->RSSetViewports( state.numViewports, state.viewports );
-		context->VSSetConstantBuffers( 0, 1, state.vsConstantBuffer.GetAddressOf() );
-		context->PSSetConstantBuffers( 0, 1, state.psConstantBuffer.GetAddressOf() );
-		context->CSSetConstantBuffers(0, 1, state.csConstantBuffer.GetAddressOf());
-		context->CSSetShaderResources(0, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, state.csShaderResources);
-		for (int i = 0; i < D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT; ++i) {
-			if (state.csShaderResources[i])
-				state.csShaderResources[i]->Release();
+	bool IsMultisampledView(ID3D11ShaderResourceView *view) {
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvd;
+		view->GetDesc(&srvd);
+		return srvd.ViewDimension == D3D11_SRV_DIMENSION_TEXTURE2DMS || srvd.ViewDimension == D3D11_SRV_DIMENSION_TEXTURE2DMSARRAY;
+	}
+
+	bool IsHdrView(ID3D11ShaderResourceView *view) {
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvd;
+		view->GetDesc(&srvd);
+		// 10-bit UNORM input is left to the regular filters: the format does not tell whether it is PQ-encoded,
+		// and VR runtimes treat it as SDR anyway
+		switch (srvd.Format) {
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		case DXGI_FORMAT_R32G32B32_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+			return true;
+		default:
+			return false;
 		}
-		UINT initial = 0;
-		context->CSSetUnorderedAccessViews(0, D3D11_1_UAV_SLOT_COUNT, state.csUavs, &initial);
-		for (int i = 0; i < D3D11_1_UAV_SLOT_COUNT; ++i) {
-			if (state.csUavs[i])
-				state.csUavs[i]->Release();
+	}
+
+	bool SupportsTypedUavLoad(ID3D11Device *device, DXGI_FORMAT format) {
+		D3D11_FEATURE_DATA_FORMAT_SUPPORT2 support;
+		support.InFormat = TranslateTypelessFormats(format);
+		if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_FORMAT_SUPPORT2, &support, sizeof(support)))) {
+			return false;
 		}
+		UINT required = D3D11_FORMAT_SUPPORT2_UAV_TYPED_LOAD | D3D11_FORMAT_SUPPORT2_UAV_TYPED_STORE;
+		return (support.OutFormatSupport2 & required) == required;
 	}
 
 	ComPtr<ID3D11ShaderResourceView> CreateShaderResourceView(ID3D11Device *device, ID3D11Texture2D *texture, int arrayIndex) {
@@ -164,7 +148,15 @@ namespace vrperfkit {
 
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvd;
 		srvd.Format = TranslateTypelessFormats(td.Format);
-		if (td.ArraySize > 1) {
+		if (td.SampleDesc.Count > 1 && td.ArraySize > 1) {
+			srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DMSARRAY;
+			srvd.Texture2DMSArray.ArraySize = 1;
+			srvd.Texture2DMSArray.FirstArraySlice = arrayIndex;
+		}
+		else if (td.SampleDesc.Count > 1) {
+			srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DMS;
+		}
+		else if (td.ArraySize > 1) {
 			srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
 			srvd.Texture2DArray.ArraySize = 1;
 			srvd.Texture2DArray.FirstArraySlice = D3D11CalcSubresource(0, arrayIndex, td.MipLevels);
@@ -205,7 +197,7 @@ namespace vrperfkit {
 		return uav;
 	}
 
-	ComPtr<ID3D11Texture2D> CreateResolveTexture(ID3D11Device *device, ID3D11Texture2D *texture, DXGI_FORMAT format) {
+	D3D11_TEXTURE2D_DESC ResolveTextureDesc(ID3D11Texture2D *texture, DXGI_FORMAT format) {
 		D3D11_TEXTURE2D_DESC td;
 		texture->GetDesc(&td);
 		td.SampleDesc.Count = 1;
@@ -218,13 +210,10 @@ namespace vrperfkit {
 		if (format != DXGI_FORMAT_UNKNOWN) {
 			td.Format = format;
 		}
-
-		ComPtr<ID3D11Texture2D> tex;
-		CheckResult("creating resolve texture", device->CreateTexture2D(&td, nullptr, tex.GetAddressOf()));
-		return tex;
+		return td;
 	}
 
-	ComPtr<ID3D11Texture2D> CreatePostProcessTexture(ID3D11Device *device, uint32_t width, uint32_t height, DXGI_FORMAT format) {
+	D3D11_TEXTURE2D_DESC PostProcessTextureDesc(uint32_t width, uint32_t height, DXGI_FORMAT format) {
 		D3D11_TEXTURE2D_DESC td;
 		td.Width = width;
 		td.Height = height;
@@ -237,6 +226,18 @@ namespace vrperfkit {
 		td.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
 		td.CPUAccessFlags = 0;
 		td.MiscFlags = 0;
+		return td;
+	}
+
+	ComPtr<ID3D11Texture2D> CreateResolveTexture(ID3D11Device *device, ID3D11Texture2D *texture, DXGI_FORMAT format) {
+		D3D11_TEXTURE2D_DESC td = ResolveTextureDesc(texture, format);
+		ComPtr<ID3D11Texture2D> tex;
+		CheckResult("creating resolve texture", device->CreateTexture2D(&td, nullptr, tex.GetAddressOf()));
+		return tex;
+	}
+
+	ComPtr<ID3D11Texture2D> CreatePostProcessTexture(ID3D11Device *device, uint32_t width, uint32_t height, DXGI_FORMAT format) {
+		D3D11_TEXTURE2D_DESC td = PostProcessTextureDesc(width, height, format);
 		ComPtr<ID3D11Texture2D> texture;
 		CheckResult("creating post-process texture", device->CreateTexture2D(&td, nullptr, texture.GetAddressOf()));
 		return texture;
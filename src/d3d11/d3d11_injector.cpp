@@ -1,9 +1,16 @@
 #include "d3d11_injector.h"
 #include "hooks.h"
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <d3d11_1.h>
+
 namespace vrperfkit {
 	namespace {
-		bool alreadyInsideHook = false;
+		thread_local bool alreadyInsideHook = false;
 
 		class HookGuard {
 		public:
@@ -22,6 +29,80 @@ namespace vrperfkit {
 			bool state;
 		};
 
+		// union of the events any listener is interested in. When an event is not in here, the
+		// detour calls straight through to the original function.
+		// There is only ever a single injector alive at a time.
+		std::atomic_uint32_t g_activeEvents = 0;
+
+		bool IsEventActive(D3D11Event event) {
+			return (g_activeEvents.load(std::memory_order_relaxed) & event) != 0;
+		}
+
+		// Each thread that dispatches to listeners announces it through its own counter, which is odd while
+		// it is inside a dispatch. Changing the listeners waits for the odd counters to move on, which avoids
+		// a lock shared by all threads recording command lists. Threads are registered on their first dispatch,
+		// and their entries are never freed, since there are only ever a few of them.
+		struct alignas(64) DispatchState {
+			std::atomic_uint64_t sequence = 0;
+			int depth = 0;
+		};
+		std::mutex g_dispatchStatesMutex;
+		std::vector<DispatchState*> g_dispatchStates;
+
+		DispatchState *CurrentDispatchState() {
+			thread_local DispatchState *state = nullptr;
+			if (state == nullptr) {
+				state = new DispatchState;
+				std::lock_guard<std::mutex> lock (g_dispatchStatesMutex);
+				g_dispatchStates.push_back(state);
+			}
+			return state;
+		}
+
+		class DispatchGuard {
+		public:
+			DispatchGuard() : state(CurrentDispatchState()) {
+				// listeners may cause nested dispatches on the same thread
+				if (state->depth++ == 0) {
+					state->sequence.fetch_add(1, std::memory_order_seq_cst);
+				}
+			}
+
+			~DispatchGuard() {
+				if (--state->depth == 0) {
+					state->sequence.fetch_add(1, std::memory_order_release);
+				}
+			}
+
+		private:
+			DispatchState *state;
+		};
+
+		// waits until no other thread is still inside a dispatch that began before the call. Dispatches begin
+		// before the injector is looked up, so this also covers calls racing with the injector's destruction.
+		void WaitForDispatches() {
+			std::vector<DispatchState*> states;
+			{
+				std::lock_guard<std::mutex> lock (g_dispatchStatesMutex);
+				states = g_dispatchStates;
+			}
+			DispatchState *self = CurrentDispatchState();
+			for (DispatchState *state : states) {
+				uint64_t sequence = state->sequence.load(std::memory_order_seq_cst);
+				if (state == self || (sequence & 1) == 0) {
+					continue;
+				}
+				while (state->sequence.load(std::memory_order_acquire) == sequence) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		// Bumped whenever the context -> injector association may have changed, invalidating the per-thread caches.
+		// Destroying a context is not hooked, but a context reusing its address is only seen through the creation hooks,
+		// which bump it as well.
+		std::atomic_uint32_t g_injectorGeneration = 1;
+
 		template<typename T>
 		D3D11Injector *GetInjector(T *object) {
 			D3D11Injector *injector = nullptr;
@@ -30,32 +111,81 @@ namespace vrperfkit {
 			return injector;
 		}
 
+		D3D11Injector *LookupInjector(ID3D11DeviceContext *context) {
+			if (D3D11Injector *injector = GetInjector<ID3D11DeviceContext>(context)) {
+				return injector;
+			}
+			// deferred contexts the game created before the injector existed were never tagged, but their device is
+			ComPtr<ID3D11Device> device;
+			context->GetDevice(device.GetAddressOf());
+			return device ? GetInjector<ID3D11Device>(device.Get()) : nullptr;
+		}
+
+		// Most threads only ever record into a single context, so caching the last lookup per thread
+		// avoids going through GetPrivateData on every hooked call.
+		D3D11Injector *GetInjector(ID3D11DeviceContext *context) {
+			thread_local ID3D11DeviceContext *cachedContext = nullptr;
+			thread_local D3D11Injector *cachedInjector = nullptr;
+			thread_local uint32_t cachedGeneration = 0;
+
+			uint32_t generation = g_injectorGeneration.load(std::memory_order_acquire);
+			if (context != cachedContext || generation != cachedGeneration) {
+				cachedInjector = LookupInjector(context);
+				cachedContext = context;
+				cachedGeneration = generation;
+			}
+			return cachedInjector;
+		}
+
+		// Deferred contexts may or may not share their vtable with the immediate context, depending
+		// on the driver. Each detour can only hook a single target, so there is a second instance
+		// of every context detour for deferred contexts with a different vtable.
+		enum ContextHookVariant {
+			IMMEDIATE_CONTEXT,
+			DEFERRED_CONTEXT,
+		};
+
+		template<int Variant>
 		void D3D11ContextHook_PSSetSamplers(ID3D11DeviceContext *self, UINT StartSlot, UINT NumSamplers, ID3D11SamplerState * const *ppSamplers) {
+			if (!IsEventActive(D3D11_EVENT_PS_SET_SAMPLERS)) {
+				hooks::CallOriginal<D3D11ContextHook_PSSetSamplers<Variant>>()(self, StartSlot, NumSamplers, ppSamplers);
+				return;
+			}
+
 			HookGuard hookGuard;
 
-			D3D11Injector *injector = GetInjector(self);
-			if (injector != nullptr && !hookGuard.AlreadyInsideHook()) {
-				if (injector->PrePSSetSamplers(StartSlot, NumSamplers, ppSamplers)) {
+			if (!hookGuard.AlreadyInsideHook()) {
+				DispatchGuard dispatchGuard;
+				D3D11Injector *injector = GetInjector(self);
+				if (injector != nullptr && injector->PrePSSetSamplers(self, StartSlot, NumSamplers, ppSamplers)) {
 					return;
 				}
 			}
 
-			hooks::CallOriginal(D3D11ContextHook_PSSetSamplers)(self, StartSlot, NumSamplers, ppSamplers);
+			hooks::CallOriginal<D3D11ContextHook_PSSetSamplers<Variant>>()(self, StartSlot, NumSamplers, ppSamplers);
 		}
 
+		template<int Variant>
 		void D3D11ContextHook_OMSetRenderTargets(
 				ID3D11DeviceContext *self,
 				UINT NumViews, ID3D11RenderTargetView * const *ppRenderTargetViews,
 				ID3D11DepthStencilView *pDepthStencilView) {
+			if (!IsEventActive(D3D11_EVENT_OM_SET_RENDER_TARGETS)) {
+				hooks::CallOriginal<D3D11ContextHook_OMSetRenderTargets<Variant>>()(self, NumViews, ppRenderTargetViews, pDepthStencilView);
+				return;
+			}
+
 			HookGuard hookGuard;
 
-			hooks::CallOriginal(D3D11ContextHook_OMSetRenderTargets)(self, NumViews, ppRenderTargetViews, pDepthStencilView);
+			hooks::CallOriginal<D3D11ContextHook_OMSetRenderTargets<Variant>>()(self, NumViews, ppRenderTargetViews, pDepthStencilView);
 
+			DispatchGuard dispatchGuard;
 			if (D3D11Injector *injector = GetInjector(self)) {
-				injector->PostOMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
+				injector->PostOMSetRenderTargets(self, NumViews, ppRenderTargetViews, pDepthStencilView);
 			}
 		}
 
+		template<int Variant>
 		void D3D11ContextHook_OMSetRenderTargetsAndUnorderedAccessViews(
 				ID3D11DeviceContext *self,
 				UINT NumRTVs,
@@ -65,17 +195,62 @@ namespace vrperfkit {
 				UINT NumUAVs,
 				ID3D11UnorderedAccessView * const *ppUnorderedAccessViews,
 				const UINT *pUAVInitialCounts) {
+			if (!IsEventActive(D3D11_EVENT_OM_SET_RENDER_TARGETS)) {
+				hooks::CallOriginal<D3D11ContextHook_OMSetRenderTargetsAndUnorderedAccessViews<Variant>>()(self, NumRTVs, ppRenderTargetViews, pDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+				return;
+			}
+
 			HookGuard hookGuard;
 
-			hooks::CallOriginal(D3D11ContextHook_OMSetRenderTargetsAndUnorderedAccessViews)(self, NumRTVs, ppRenderTargetViews, pDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+			hooks::CallOriginal<D3D11ContextHook_OMSetRenderTargetsAndUnorderedAccessViews<Variant>>()(self, NumRTVs, ppRenderTargetViews, pDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
 
+			DispatchGuard dispatchGuard;
 			if (D3D11Injector *injector = GetInjector(self)) {
-				injector->PostOMSetRenderTargets(NumRTVs, ppRenderTargetViews, pDepthStencilView);
+				injector->PostOMSetRenderTargets(self, NumRTVs, ppRenderTargetViews, pDepthStencilView);
+			}
+		}
+
+		template<int Variant>
+		void InstallContextHooks(ID3D11DeviceContext *context) {
+			hooks::InstallVirtualFunctionHook<D3D11ContextHook_PSSetSamplers<Variant>>("ID3D11DeviceContext::PSSetSamplers", context, 10);
+			hooks::InstallVirtualFunctionHook<D3D11ContextHook_OMSetRenderTargets<Variant>>("ID3D11DeviceContext::OMSetRenderTargets", context, 33);
+			hooks::InstallVirtualFunctionHook<D3D11ContextHook_OMSetRenderTargetsAndUnorderedAccessViews<Variant>>("ID3D11DeviceContext::OMSetRenderTargetsAndUnorderedAccessViews", context, 34);
+		}
+
+		template<int Variant>
+		void RemoveContextHooks() {
+			hooks::RemoveHook<D3D11ContextHook_PSSetSamplers<Variant>>();
+			hooks::RemoveHook<D3D11ContextHook_OMSetRenderTargets<Variant>>();
+			hooks::RemoveHook<D3D11ContextHook_OMSetRenderTargetsAndUnorderedAccessViews<Variant>>();
+		}
+
+		void OnDeferredContextCreated(ID3D11Device *device, ID3D11DeviceContext *context) {
+			if (context == nullptr) {
+				return;
+			}
+			if (D3D11Injector *injector = GetInjector(device)) {
+				injector->OnDeferredContextCreated(context);
 			}
 		}
+
+		HRESULT D3D11DeviceHook_CreateDeferredContext(ID3D11Device *self, UINT ContextFlags, ID3D11DeviceContext **ppDeferredContext) {
+			HRESULT result = hooks::CallOriginal<D3D11DeviceHook_CreateDeferredContext>()(self, ContextFlags, ppDeferredContext);
+			if (SUCCEEDED(result) && ppDeferredContext != nullptr) {
+				OnDeferredContextCreated(self, *ppDeferredContext);
+			}
+			return result;
+		}
+
+		HRESULT D3D11Device1Hook_CreateDeferredContext1(ID3D11Device1 *self, UINT ContextFlags, ID3D11DeviceContext1 **ppDeferredContext) {
+			HRESULT result = hooks::CallOriginal<D3D11Device1Hook_CreateDeferredContext1>()(self, ContextFlags, ppDeferredContext);
+			if (SUCCEEDED(result) && ppDeferredContext != nullptr) {
+				OnDeferredContextCreated(self, *ppDeferredContext);
+			}
+			return result;
+		}
 	}
 
-	D3D11Injector::D3D11Injector(ComPtr<ID3D11Device> device) {
+	D3D11Injector::D3D11Injector(ComPtr<ID3D11Device> device) : listenerSet(new ListenerSet) {
 		this->device = device;
 		device->GetImmediateContext(context.GetAddressOf());
 
@@ -83,37 +258,99 @@ namespace vrperfkit {
 		UINT size = sizeof(instance);
 		device->SetPrivateData(__uuidof(D3D11Injector), size, &instance);
 		context->SetPrivateData(__uuidof(D3D11Injector), size, &instance);
+		++g_injectorGeneration;
+
+		InstallContextHooks<IMMEDIATE_CONTEXT>(context.Get());
 
-		hooks::InstallVirtualFunctionHook("ID3D11DeviceContext::PSSetSamplers", context.Get(), 10, (void*)&D3D11ContextHook_PSSetSamplers);
-		hooks::InstallVirtualFunctionHook("ID3D11DeviceContext::OMSetRenderTargets", context.Get(), 33, (void*)&D3D11ContextHook_OMSetRenderTargets);
-		hooks::InstallVirtualFunctionHook("ID3D11DeviceContext::OMSetRenderTargetsAndUnorderedAccessViews", context.Get(), 34, (void*)&D3D11ContextHook_OMSetRenderTargetsAndUnorderedAccessViews);
+		// Games usually create their deferred contexts at startup, long before the first frame is submitted and
+		// this injector is created, so the creation hooks below would never see them. A context of our own tells
+		// whether deferred contexts need their own set of hooks.
+		ComPtr<ID3D11DeviceContext> probeContext;
+		if (SUCCEEDED(device->CreateDeferredContext(0, probeContext.GetAddressOf()))) {
+			HookDeferredContextImplementation(probeContext.Get());
+		}
+
+		hooks::InstallVirtualFunctionHook<D3D11DeviceHook_CreateDeferredContext>("ID3D11Device::CreateDeferredContext", device.Get(), 27);
+		ComPtr<ID3D11Device1> device1;
+		if (SUCCEEDED(device->QueryInterface(device1.GetAddressOf()))) {
+			hooks::InstallVirtualFunctionHook<D3D11Device1Hook_CreateDeferredContext1>("ID3D11Device1::CreateDeferredContext1", device1.Get(), 44);
+		}
 	}
 
 	D3D11Injector::~D3D11Injector() {
-		hooks::RemoveHook((void*)&D3D11ContextHook_PSSetSamplers);
-		hooks::RemoveHook((void*)&D3D11ContextHook_OMSetRenderTargets);
-		hooks::RemoveHook((void*)&D3D11ContextHook_OMSetRenderTargetsAndUnorderedAccessViews);
+		hooks::RemoveHook<D3D11DeviceHook_CreateDeferredContext>();
+		hooks::RemoveHook<D3D11Device1Hook_CreateDeferredContext1>();
+		RemoveContextHooks<IMMEDIATE_CONTEXT>();
+		RemoveContextHooks<DEFERRED_CONTEXT>();
 
+		// deferred contexts created in the meantime still carry our pointer in their private data,
+		// but bumping the generation makes every thread look it up again, and there will be no hooks left to do so
 		device->SetPrivateData(__uuidof(D3D11Injector), 0, nullptr);
 		context->SetPrivateData(__uuidof(D3D11Injector), 0, nullptr);
+		++g_injectorGeneration;
+		g_activeEvents = 0;
+
+		// the listeners are usually destroyed right after us, so let calls that made it past the hooks finish
+		WaitForDispatches();
+		delete listenerSet.load();
 	}
 
 	void D3D11Injector::AddListener(D3D11Listener *listener) {
-		if (std::find(listeners.begin(), listeners.end(), listener) == listeners.end()) {
-			listeners.push_back(listener);
+		const ListenerSet *current = listenerSet.load();
+		if (std::find(current->listeners, current->listeners + current->count, listener) != current->listeners + current->count) {
+			return;
+		}
+		if (current->count == MAX_LISTENERS) {
+			LOG_ERROR << "Too many D3D11 listeners";
+			return;
 		}
+
+		ListenerSet *set = new ListenerSet;
+		for (int i = 0; i < current->count; ++i) {
+			set->listeners[set->count++] = current->listeners[i];
+		}
+		set->listeners[set->count++] = listener;
+		PublishListeners(set);
 	}
 
 	void D3D11Injector::RemoveListener(D3D11Listener *listener) {
-		auto it = std::find(listeners.begin(), listeners.end(), listener);
-		if (it != listeners.end()) {
-			listeners.erase(it);
+		const ListenerSet *current = listenerSet.load();
+		if (std::find(current->listeners, current->listeners + current->count, listener) == current->listeners + current->count) {
+			return;
+		}
+
+		ListenerSet *set = new ListenerSet;
+		for (int i = 0; i < current->count; ++i) {
+			if (current->listeners[i] != listener) {
+				set->listeners[set->count++] = current->listeners[i];
+			}
 		}
+		PublishListeners(set);
 	}
 
-	bool D3D11Injector::PrePSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState * const *ppSamplers) {
-		for (D3D11Listener *listener : listeners) {
-			if (listener->PrePSSetSamplers(startSlot, numSamplers, ppSamplers)) {
+	void D3D11Injector::PublishListeners(ListenerSet *set) {
+		ListenerSet *previous = listenerSet.exchange(set, std::memory_order_seq_cst);
+		UpdateInterests();
+		WaitForDispatches();
+		delete previous;
+	}
+
+	void D3D11Injector::UpdateInterests() {
+		ListenerSet *set = listenerSet.load();
+		uint32_t activeEvents = 0;
+		for (int i = 0; i < set->count; ++i) {
+			uint32_t interest = set->listeners[i]->EventInterest();
+			set->interests[i].store(interest, std::memory_order_relaxed);
+			activeEvents |= interest;
+		}
+		g_activeEvents.store(activeEvents, std::memory_order_relaxed);
+	}
+
+	bool D3D11Injector::PrePSSetSamplers(ID3D11DeviceContext *context, UINT startSlot, UINT numSamplers, ID3D11SamplerState * const *ppSamplers) {
+		const ListenerSet *set = listenerSet.load(std::memory_order_seq_cst);
+		for (int i = 0; i < set->count; ++i) {
+			if ((set->interests[i].load(std::memory_order_relaxed) & D3D11_EVENT_PS_SET_SAMPLERS)
+					&& set->listeners[i]->PrePSSetSamplers(context, startSlot, numSamplers, ppSamplers)) {
 				return true;
 			}
 		}
@@ -121,9 +358,29 @@ namespace vrperfkit {
 		return false;
 	}
 
-	void D3D11Injector::PostOMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) {
-		for (D3D11Listener *listener : listeners) {
-			listener->PostOMSetRenderTargets(numViews, renderTargetViews, depthStencilView);
+	void D3D11Injector::PostOMSetRenderTargets(ID3D11DeviceContext *context, UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) {
+		const ListenerSet *set = listenerSet.load(std::memory_order_seq_cst);
+		for (int i = 0; i < set->count; ++i) {
+			if (set->interests[i].load(std::memory_order_relaxed) & D3D11_EVENT_OM_SET_RENDER_TARGETS) {
+				set->listeners[i]->PostOMSetRenderTargets(context, numViews, renderTargetViews, depthStencilView);
+			}
+		}
+	}
+
+	void D3D11Injector::OnDeferredContextCreated(ID3D11DeviceContext *deferredContext) {
+		D3D11Injector *instance = this;
+		deferredContext->SetPrivateData(__uuidof(D3D11Injector), sizeof(instance), &instance);
+		// a new context may reuse the address of a released one that a thread still has cached
+		++g_injectorGeneration;
+		HookDeferredContextImplementation(deferredContext);
+	}
+
+	void D3D11Injector::HookDeferredContextImplementation(ID3D11DeviceContext *deferredContext) {
+		LPVOID *immediateVtable = *((LPVOID**)context.Get());
+		LPVOID *deferredVtable = *((LPVOID**)deferredContext);
+		if (deferredVtable[10] != immediateVtable[10] && !deferredContextHooksInstalled.exchange(true)) {
+			LOG_INFO << "Deferred contexts use a separate implementation, hooking them as well";
+			InstallContextHooks<DEFERRED_CONTEXT>(deferredContext);
 		}
 	}
 }
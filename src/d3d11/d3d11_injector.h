@@ -1,13 +1,24 @@
 #pragma once
 #include "d3d11_helper.h"
 
-#include <vector>
+#include <atomic>
 
 namespace vrperfkit {
+	enum D3D11Event : uint32_t {
+		D3D11_EVENT_PS_SET_SAMPLERS = 1 << 0,
+		D3D11_EVENT_OM_SET_RENDER_TARGETS = 1 << 1,
+	};
+
+	// Listener callbacks may be invoked concurrently from any thread that records into a deferred
+	// context. The context the call was made on is passed along and must be used for any state changes.
 	class D3D11Listener {
 	public:
-		virtual bool PrePSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *ppSamplers) { return false; }
-		virtual void PostOMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) {}
+		// bitmask of D3D11Event values the listener currently wants to receive. Queried once per frame
+		// from the render thread, so it may also be used to react to config changes.
+		virtual uint32_t EventInterest() { return 0; }
+
+		virtual bool PrePSSetSamplers(ID3D11DeviceContext *context, UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *ppSamplers) { return false; }
+		virtual void PostOMSetRenderTargets(ID3D11DeviceContext *context, UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) {}
 
 	protected:
 		~D3D11Listener() = default;
@@ -21,13 +32,34 @@ namespace vrperfkit {
 		void AddListener(D3D11Listener *listener);
 		void RemoveListener(D3D11Listener *listener);
 
-		bool PrePSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *ppSamplers);
-		void PostOMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView);
+		// only called from the hooks, which announce the dispatch before looking up the injector
+		bool PrePSSetSamplers(ID3D11DeviceContext *context, UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *ppSamplers);
+		void PostOMSetRenderTargets(ID3D11DeviceContext *context, UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView);
+
+		void OnDeferredContextCreated(ID3D11DeviceContext *context);
+
+		// re-queries the listeners' event interests; call once per frame
+		void UpdateInterests();
 
 	private:
 		ComPtr<ID3D11Device> device;
 		ComPtr<ID3D11DeviceContext> context;
+		std::atomic_bool deferredContextHooksInstalled = false;
+
+		// Listeners are only added or removed on the render thread, but read concurrently from all threads
+		// that go through our hooks. Every change publishes a new set and waits for dispatches still using
+		// the previous one, so a removed listener is never called again once RemoveListener returns.
+		static const int MAX_LISTENERS = 8;
+		struct ListenerSet {
+			int count = 0;
+			D3D11Listener *listeners[MAX_LISTENERS] = {};
+			std::atomic_uint32_t interests[MAX_LISTENERS] = {};
+		};
+		std::atomic<ListenerSet*> listenerSet;
+
+		void PublishListeners(ListenerSet *set);
 
-		std::vector<D3D11Listener*> listeners;
+		// installs the second set of context hooks if deferred contexts do not share the immediate context's vtable
+		void HookDeferredContextImplementation(ID3D11DeviceContext *deferredContext);
 	};
 }
@@ -1,45 +1,32 @@
 #include "d3d11_nis_upscaler.h"
 #include "d3d11_helper.h"
+#include "d3d11_shader_permutations.h"
 #include "logging.h"
-#include "shader_nis_upscale.h"
-#include "shader_nis_sharpen.h"
+#include "shader_nis_upscale_permutations.h"
+#include "shader_nis_sharpen_permutations.h"
 #include "config.h"
 
 #include "nis/NIS_Config.h"
 
+#include <iterator>
+
 namespace vrperfkit {
-	D3D11NisUpscaler::D3D11NisUpscaler(ID3D11Device *device) {
+	D3D11NisUpscaler::D3D11NisUpscaler(ID3D11Device *device, D3D11ResourceCache &resources) : resources(resources) {
 		LOG_INFO << "Creating D3D11 resources for NIS upscaling...";
 		device->GetImmediateContext(context.GetAddressOf());
 
-		CheckResult("creating NIS upscale shader", device->CreateComputeShader(g_NISUpscaleShader, sizeof(g_NISUpscaleShader), nullptr, upscaleShader.GetAddressOf()));
-		CheckResult("creating NIS sharpen shader", device->CreateComputeShader(g_NISSharpenShader, sizeof(g_NISSharpenShader), nullptr, sharpenShader.GetAddressOf()));
-
-		constantsBuffer = CreateConstantsBuffer(device, sizeof(NISConfig));
-		sampler = CreateLinearSampler(device);
+		// other permutations are created when first needed
+		GetShaderPermutation(resources, g_NISUpscalePermutations, 0, "NIS upscale shader");
+		GetShaderPermutation(resources, g_NISSharpenPermutations, 0, "NIS sharpen shader");
 
-		D3D11_TEXTURE2D_DESC td;
-		td.Width = kFilterSize / 4;
-		td.Height = kPhaseCount;
-		td.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-		td.MipLevels = 1;
-		td.ArraySize = 1;
-		td.SampleDesc.Count = 1;
-		td.SampleDesc.Quality = 0;
-		td.Usage = D3D11_USAGE_DEFAULT;
-		td.CPUAccessFlags = 0;
-		td.MiscFlags = 0;
-		D3D11_SUBRESOURCE_DATA texData;
-		texData.pSysMem = coef_scale;
-		texData.SysMemPitch = kFilterSize * 4;
-		texData.SysMemSlicePitch = kFilterSize * 4 * kPhaseCount;
-		CheckResult("creating NIS upscale coefficients texture", device->CreateTexture2D(&td, &texData, scalerCoeffTexture.GetAddressOf()));
-		texData.pSysMem = coef_usm;
-		CheckResult("creating NIS USM coefficients texture", device->CreateTexture2D(&td, &texData, usmCoeffTexture.GetAddressOf()));
+		for (int i = 0; i < CONSTANTS_SETS; ++i) {
+			constantsBuffers[i].reset(new D3D11ConstantBuffer(device, sizeof(NISConfig)));
+			tileLists[i].reset(new D3D11TileLists(device, resources));
+		}
+		sampler = resources.GetLinearSampler();
 
-		scalerCoeffView = CreateShaderResourceView(device, scalerCoeffTexture.Get());
-		usmCoeffView = CreateShaderResourceView(device, usmCoeffTexture.Get());
+		scalerCoeffView = resources.GetStaticTextureView(coef_scale, kFilterSize / 4, kPhaseCount, DXGI_FORMAT_R32G32B32A32_FLOAT, kFilterSize * 4, "NIS upscale coefficients texture");
+		usmCoeffView = resources.GetStaticTextureView(coef_usm, kFilterSize / 4, kPhaseCount, DXGI_FORMAT_R32G32B32A32_FLOAT, kFilterSize * 4, "NIS USM coefficients texture");
 	}
 
 	void D3D11NisUpscaler::Upscale(const D3D11PostProcessInput &input, const Viewport &outputViewport) {
@@ -47,14 +34,27 @@ namespace vrperfkit {
 		input.inputTexture->GetDesc(&td);
 		input.outputTexture->GetDesc(&otd);
 
-		context->CSSetSamplers(0, 1, sampler.GetAddressOf());
+		// NIS has no multi-sampled variant, such input is always resolved beforehand.
+		// Its 16-bit math has not been checked against 32 bits like that of FSR and CAS, so it is not built.
+		uint32_t features = ShaderFeatures(resources, &input, 1) & ~(SHADER_MSAA_INPUT | SHADER_HALF);
+		bool upscale = input.inputViewport != outputViewport;
+		// the upscale shader works on blocks of 32x24 output pixels, the sharpen shader on 32x32
+		UINT blockHeight = upscale ? 24 : 32;
+		int constantsSet = ConstantsSet(&input, 1);
+		// the tile classification binds resources of its own, so it has to run before this pass binds any
+		D3D11TileLists &tiles = *tileLists[constantsSet];
+		bool useTileLists = tiles.Update(&input, &outputViewport, 1, 32, blockHeight, features);
+
+		context->CSSetSamplers(0, 1, &sampler);
 		ID3D11ShaderResourceView *srvs[1] = {input.inputView};
 		context->CSSetShaderResources(0, 1, srvs);
 		UINT uavCount = -1;
 		ID3D11UnorderedAccessView *uavs[] = {input.outputUav};
 		context->CSSetUnorderedAccessViews(0, 1, uavs, &uavCount);
 
+		// cleared including padding, so that unchanged constants compare equal and are not uploaded again
 		NISConfig constants;
+		memset(&constants, 0, sizeof(constants));
 		NVScalerUpdateConfig(constants, g_config.upscaling.sharpness, input.inputViewport.x, input.inputViewport.y,
 				input.inputViewport.width, input.inputViewport.height, td.Width, td.Height,
 				outputViewport.x, outputViewport.y, outputViewport.width, outputViewport.height,
@@ -63,20 +63,26 @@ namespace vrperfkit {
 		constants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
 		constants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
 		constants.squaredRadius = radius * radius;
-		constants.debugMode = g_config.debugMode;
-		context->UpdateSubresource(constantsBuffer.Get(), 0, nullptr, &constants, 0, 0);
-		context->CSSetConstantBuffers(0, 1, constantsBuffer.GetAddressOf());
+		constantsBuffers[constantsSet]->Update(&constants);
+		constantsBuffers[constantsSet]->Bind(0);
 
-		if (input.inputViewport != outputViewport) {
+		if (upscale) {
 			// full upscaling pass
-			ID3D11ShaderResourceView *coeffViews[2] = {scalerCoeffView.Get(), usmCoeffView.Get()};
+			ID3D11ShaderResourceView *coeffViews[2] = {scalerCoeffView, usmCoeffView};
 			context->CSSetShaderResources(1, 2, coeffViews);
-			context->CSSetShader(upscaleShader.Get(), nullptr, 0);
-			context->Dispatch((UINT)std::ceil(outputViewport.width / 32.f), (UINT)std::ceil(outputViewport.height / 24.f), 1);
-		} else {
-			// just sharpening
-			context->CSSetShader(sharpenShader.Get(), nullptr, 0);
-			context->Dispatch((UINT)std::ceil(outputViewport.width / 32.f), (UINT)std::ceil(outputViewport.height / 32.f), 1);
+		}
+		const ShaderPermutation *permutations = upscale ? g_NISUpscalePermutations : g_NISSharpenPermutations;
+		size_t permutationCount = upscale ? std::size(g_NISUpscalePermutations) : std::size(g_NISSharpenPermutations);
+		const char *shaderName = upscale ? "NIS upscale shader" : "NIS sharpen shader";
+
+		if (useTileLists) {
+			tiles.Dispatch(3,
+				GetShaderPermutation(resources, permutations, permutationCount, features | SHADER_TILE_LIST, shaderName),
+				GetShaderPermutation(resources, permutations, permutationCount, BilinearFeatures(features), shaderName));
+		}
+		else {
+			context->CSSetShader(GetShaderPermutation(resources, permutations, permutationCount, features, shaderName), nullptr, 0);
+			context->Dispatch((outputViewport.width + 31) / 32, (outputViewport.height + blockHeight - 1) / blockHeight, 1);
 		}
 	}
 }
@@ -1,7 +1,11 @@
 #pragma once
+#include "d3d11_constant_buffer.h"
 #include "d3d11_post_processor.h"
+#include "d3d11_resource_cache.h"
+#include "d3d11_tile_lists.h"
 
 #include <d3d11.h>
+#include <memory>
 #include <wrl/client.h>
 
 using Microsoft::WRL::ComPtr;
@@ -9,18 +13,16 @@ using Microsoft::WRL::ComPtr;
 namespace vrperfkit {
 	class D3D11NisUpscaler : public D3D11Upscaler {
 	public:
-		D3D11NisUpscaler(ID3D11Device *device);
+		D3D11NisUpscaler(ID3D11Device *device, D3D11ResourceCache &resources);
 		void Upscale(const D3D11PostProcessInput &input, const Viewport &outputViewport) override;
 
 	private:
 		ComPtr<ID3D11DeviceContext> context;
-		ComPtr<ID3D11ComputeShader> upscaleShader;
-		ComPtr<ID3D11ComputeShader> sharpenShader;
-		ComPtr<ID3D11Buffer> constantsBuffer;
-		ComPtr<ID3D11SamplerState> sampler;
-		ComPtr<ID3D11Texture2D> scalerCoeffTexture;
-		ComPtr<ID3D11ShaderResourceView> scalerCoeffView;
-		ComPtr<ID3D11Texture2D> usmCoeffTexture;
-		ComPtr<ID3D11ShaderResourceView> usmCoeffView;
+		D3D11ResourceCache &resources;
+		std::unique_ptr<D3D11ConstantBuffer> constantsBuffers[CONSTANTS_SETS];
+		std::unique_ptr<D3D11TileLists> tileLists[CONSTANTS_SETS];
+		ID3D11SamplerState *sampler;
+		ID3D11ShaderResourceView *scalerCoeffView;
+		ID3D11ShaderResourceView *usmCoeffView;
 	};
 }
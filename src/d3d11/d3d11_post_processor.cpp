@@ -1,9 +1,13 @@
 #include "d3d11_post_processor.h"
 
 #include "config.h"
+#include "control_server.h"
 #include "d3d11_cas_upscaler.h"
 #include "d3d11_fsr_upscaler.h"
 #include "d3d11_nis_upscaler.h"
+#include "d3d11_shader_permutations.h"
+#include "d3d11_state.h"
+#include "d3d11_temporal_upscaler.h"
 #include "logging.h"
 #include "hooks.h"
 #include "ScreenGrab11.h"
@@ -11,14 +15,81 @@
 #include <sstream>
 
 namespace vrperfkit {
-	D3D11PostProcessor::D3D11PostProcessor(ComPtr<ID3D11Device> device) : device(device) {
+	void D3D11Upscaler::UpscaleStereo(const D3D11PostProcessInput *inputs, const Viewport *outputViewports) {
+		Upscale(inputs[0], outputViewports[0]);
+		Upscale(inputs[1], outputViewports[1]);
+	}
+
+	bool D3D11Upscaler::CanDispatchStereo(const D3D11PostProcessInput *inputs, const Viewport *outputViewports) {
+		return inputs[0].inputView == inputs[1].inputView
+			&& inputs[0].outputUav == inputs[1].outputUav
+			&& inputs[0].inputViewport.width == inputs[1].inputViewport.width
+			&& inputs[0].inputViewport.height == inputs[1].inputViewport.height
+			&& outputViewports[0].width == outputViewports[1].width
+			&& outputViewports[0].height == outputViewports[1].height
+			&& (inputs[0].inputViewport != outputViewports[0]) == (inputs[1].inputViewport != outputViewports[1]);
+	}
+
+	uint32_t D3D11Upscaler::ShaderFeatures(const D3D11ResourceCache &resources, const D3D11PostProcessInput *inputs, int eyeCount) {
+		// tiles outside the radius are split off by D3D11TileLists, which adds the respective flags
+		uint32_t features = 0;
+		if (g_config.debugMode) {
+			features |= SHADER_DEBUG;
+		}
+		if (IsMultisampledView(inputs[0].inputView)) {
+			features |= SHADER_MSAA_INPUT;
+		}
+		if (IsHdrView(inputs[0].inputView)) {
+			features |= SHADER_HDR;
+		}
+		if (g_config.upscaling.halfPrecision && resources.SupportsHalfPrecision()) {
+			features |= SHADER_HALF;
+		}
+		return features;
+	}
+
+	D3D11PostProcessor::D3D11PostProcessor(ComPtr<ID3D11Device> device) : device(device), resources(device.Get()), samplerCache(device) {
 		device->GetImmediateContext(context.GetAddressOf());
 	}
 
 	bool D3D11PostProcessor::Apply(const D3D11PostProcessInput &input, Viewport &outputViewport) {
+		return Process(&input, &outputViewport, 1);
+	}
+
+	bool D3D11PostProcessor::ApplyStereo(const D3D11PostProcessInput *inputs, Viewport *outputViewports) {
+		return Process(inputs, outputViewports, 2);
+	}
+
+	bool D3D11PostProcessor::AcceptsMultisampledInput() {
+		D3D11Upscaler *current = TryPrepareUpscaler();
+		return current != nullptr && current->SupportsMultisampledInput();
+	}
+
+	bool D3D11PostProcessor::AcceptsInPlaceSharpening() {
+		D3D11Upscaler *current = TryPrepareUpscaler();
+		return current != nullptr && current->SupportsInPlaceSharpening();
+	}
+
+	D3D11Upscaler * D3D11PostProcessor::TryPrepareUpscaler() {
+		if (!g_config.upscaling.enabled) {
+			return nullptr;
+		}
+		try {
+			PrepareUpscaler();
+		}
+		catch (const std::exception &e) {
+			LOG_ERROR << "Upscaling failed: " << e.what();
+			g_config.upscaling.enabled = false;
+			return nullptr;
+		}
+		return upscaler;
+	}
+
+	bool D3D11PostProcessor::Process(const D3D11PostProcessInput *inputs, Viewport *outputViewports, int eyeCount) {
 		bool didPostprocessing = false;
 
-		if (g_config.debugMode) {
+		bool profiling = g_config.debugMode || ControlServerWantsGpuTimings();
+		if (profiling) {
 			StartProfiling();
 		}
 
@@ -30,27 +101,43 @@ namespace vrperfkit {
 				// disable any RTs in case our input texture is still bound; otherwise using it as a view will fail
 				context->OMSetRenderTargets(0, nullptr, nullptr);
 
-				PrepareUpscaler(input.outputTexture);
-				D3D11_TEXTURE2D_DESC td;
-				input.outputTexture->GetDesc(&td);
-				outputViewport.x = outputViewport.y = 0;
-				outputViewport.width = td.Width;
-				outputViewport.height = td.Height;
-				if (input.mode == TextureMode::COMBINED) {
-					outputViewport.width /= 2;
-					if (input.eye == RIGHT_EYE) {
-						outputViewport.x += outputViewport.width;
+				PrepareUpscaler();
+				for (int i = 0; i < eyeCount; ++i) {
+					const D3D11PostProcessInput &input = inputs[i];
+					Viewport &outputViewport = outputViewports[i];
+					if (input.inPlace) {
+						outputViewport = input.inputViewport;
+						continue;
+					}
+					D3D11_TEXTURE2D_DESC td;
+					input.outputTexture->GetDesc(&td);
+					outputViewport.x = outputViewport.y = 0;
+					outputViewport.width = td.Width;
+					outputViewport.height = td.Height;
+					if (input.mode == TextureMode::COMBINED) {
+						outputViewport.width /= 2;
+						if (input.eye == RIGHT_EYE) {
+							outputViewport.x += outputViewport.width;
+						}
 					}
 				}
-				upscaler->Upscale(input, outputViewport);
+				if (eyeCount == 2) {
+					upscaler->UpscaleStereo(inputs, outputViewports);
+				}
+				else {
+					upscaler->Upscale(inputs[0], outputViewports[0]);
+				}
 
-				float newLodBias = -log2f(outputViewport.width / (float)input.inputViewport.width);
+				float newLodBias = -log2f(outputViewports[0].width / (float)inputs[0].inputViewport.width);
 				if (newLodBias != mipLodBias) {
-					LOG_DEBUG << "MIP LOD Bias changed from " << mipLodBias << " to " << newLodBias << ", recreating samplers";
-					passThroughSamplers.clear();
-					mappedSamplers.clear();
+					LOG_DEBUG << "MIP LOD Bias changed from " << mipLodBias << " to " << newLodBias;
 					mipLodBias = newLodBias;
 				}
+				// samplers the game started using since the last frame may still lack a replacement for the
+				// current bank; creating them here keeps sampler creation out of the PSSetSamplers hook
+				int bank = g_config.upscaling.applyMipBias ? D3D11SamplerCache::BankForBias(mipLodBias) : 0;
+				samplerCache.CreateBank(bank);
+				mipBiasBank.store(bank, std::memory_order_relaxed);
 
 				RestoreD3D11State(context.Get(), previousState);
 
@@ -62,74 +149,89 @@ namespace vrperfkit {
 			}
 		}
 
-		if (g_config.debugMode) {
-			EndProfiling();
+		if (profiling) {
+			EndProfiling(eyeCount);
 		}
 
-		if (g_config.captureOutput && input.eye == 0) {
-			SaveTextureToFile(didPostprocessing ? input.outputTexture : input.inputTexture);
+		for (int i = 0; i < eyeCount; ++i) {
+			if (g_config.captureOutput && inputs[i].eye == 0) {
+				SaveTextureToFile(didPostprocessing ? inputs[i].outputTexture : inputs[i].inputTexture);
+			}
 		}
 
 		return didPostprocessing;
 	}
 
-	bool D3D11PostProcessor::PrePSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState * const *ppSamplers) {
-		if (!g_config.upscaling.applyMipBias) {
-			passThroughSamplers.clear();
-			mappedSamplers.clear();
+	uint32_t D3D11PostProcessor::EventInterest() {
+		// without upscaling having happened, there is no bias to apply
+		if (!g_config.upscaling.applyMipBias || mipLodBias == 0) {
+			return 0;
+		}
+
+		return D3D11_EVENT_PS_SET_SAMPLERS;
+	}
+
+	bool D3D11PostProcessor::PrePSSetSamplers(ID3D11DeviceContext *context, UINT startSlot, UINT numSamplers, ID3D11SamplerState * const *ppSamplers) {
+		int bank = mipBiasBank.load(std::memory_order_relaxed);
+		if (!g_config.upscaling.applyMipBias || bank == 0) {
 			return false;
 		}
 
+		// only build a modified sampler list if at least one of the samplers actually gets replaced
 		ID3D11SamplerState *samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
-		memcpy(samplers, ppSamplers, numSamplers * sizeof(ID3D11SamplerState*));
+		bool replaced = false;
 		for (UINT i = 0; i < numSamplers; ++i) {
-			ID3D11SamplerState *orig = samplers[i];
-			if (orig == nullptr || passThroughSamplers.find(orig) != passThroughSamplers.end()) {
+			ID3D11SamplerState *replacement = samplerCache.GetReplacement(ppSamplers[i], bank);
+			if (replacement == nullptr) {
 				continue;
 			}
-
-			if (mappedSamplers.find(orig) == mappedSamplers.end()) {
-				D3D11_SAMPLER_DESC sd;
-				orig->GetDesc(&sd);
-				if (sd.MipLODBias != 0 || sd.MaxAnisotropy == 1) {
-					// do not mess with samplers that already have a bias or are not doing anisotropic filtering.
-					// should hopefully reduce the chance of causing rendering errors.
-					passThroughSamplers.insert(orig);
-					continue;
-				}
-				sd.MipLODBias = mipLodBias;
-				LOG_INFO << "Creating replacement sampler for " << orig << " with MIP LOD bias " << sd.MipLODBias;
-				device->CreateSamplerState(&sd, mappedSamplers[orig].GetAddressOf());
-				passThroughSamplers.insert(mappedSamplers[orig].Get());
+			if (!replaced) {
+				memcpy(samplers, ppSamplers, numSamplers * sizeof(ID3D11SamplerState*));
+				replaced = true;
 			}
+			samplers[i] = replacement;
+		}
 
-			samplers[i] = mappedSamplers[orig].Get();
+		if (!replaced) {
+			return false;
 		}
 
 		context->PSSetSamplers(startSlot, numSamplers, samplers);
 		return true;
 	}
 
-	void D3D11PostProcessor::PrepareUpscaler(ID3D11Texture2D *outputTexture) {
+	void D3D11PostProcessor::PrepareUpscaler() {
 		if (upscaler == nullptr || upscaleMethod != g_config.upscaling.method) {
-			D3D11_TEXTURE2D_DESC td;
-			outputTexture->GetDesc(&td);
+			if (upscaler == nullptr && g_config.upscaling.prewarmAllMethods) {
+				LOG_INFO << "Preparing all upscaling methods";
+				for (int method = 0; method < UPSCALE_METHOD_COUNT; ++method) {
+					GetUpscaler((UpscaleMethod)method);
+				}
+			}
 			upscaleMethod = g_config.upscaling.method;
-			switch (upscaleMethod) {
+			upscaler = GetUpscaler(upscaleMethod);
+		}
+	}
+
+	D3D11Upscaler * D3D11PostProcessor::GetUpscaler(UpscaleMethod method) {
+		auto &instance = upscalers[(int)method];
+		if (instance == nullptr) {
+			switch (method) {
 			case UpscaleMethod::FSR:
-				upscaler.reset(new D3D11FsrUpscaler(device.Get(), td.Width, td.Height, td.Format));
+				instance.reset(new D3D11FsrUpscaler(device.Get(), resources));
 				break;
 			case UpscaleMethod::NIS:
-				upscaler.reset(new D3D11NisUpscaler(device.Get()));
+				instance.reset(new D3D11NisUpscaler(device.Get(), resources));
 				break;
 			case UpscaleMethod::CAS:
-				upscaler.reset(new D3D11CasUpscaler(device.Get()));
+				instance.reset(new D3D11CasUpscaler(device.Get(), resources));
+				break;
+			case UpscaleMethod::TEMPORAL:
+				instance.reset(new D3D11TemporalUpscaler(device.Get(), resources, GetUpscaler(UpscaleMethod::FSR)));
 				break;
 			}
-
-			passThroughSamplers.clear();
-			mappedSamplers.clear();
 		}
+		return instance.get();
 	}
 
 	extern std::filesystem::path g_basePath;
@@ -175,30 +277,42 @@ namespace vrperfkit {
 		context->End(profileQueries[currentQuery].queryStart.Get());
 	}
 
-	void D3D11PostProcessor::EndProfiling() {
+	void D3D11PostProcessor::EndProfiling(int eyeCount) {
 		context->End(profileQueries[currentQuery].queryEnd.Get());
 		context->End(profileQueries[currentQuery].queryDisjoint.Get());
-
+		profileQueries[currentQuery].eyeCount = eyeCount;
+		profileQueries[currentQuery].pending = true;
 		currentQuery = (currentQuery + 1) % QUERY_COUNT;
-		while (context->GetData(profileQueries[currentQuery].queryDisjoint.Get(), nullptr, 0, 0) == S_FALSE) {
-			Sleep(1);
-		}
-		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
-		HRESULT result = context->GetData(profileQueries[currentQuery].queryDisjoint.Get(), &disjoint, sizeof(disjoint), 0);
-		if (result == S_OK && !disjoint.Disjoint) {
+
+		// Collect the results of earlier frames that the GPU has finished by now, oldest first, without waiting
+		// for any. A query still pending when its slot comes round again is overwritten and its frame not counted.
+		for (int i = 0; i < QUERY_COUNT; ++i) {
+			ProfileQuery &query = profileQueries[(currentQuery + i) % QUERY_COUNT];
+			if (!query.pending) {
+				continue;
+			}
+			D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+			if (context->GetData(query.queryDisjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+				break;
+			}
+			query.pending = false;
 			UINT64 begin, end;
-			context->GetData(profileQueries[currentQuery].queryStart.Get(), &begin, sizeof(UINT64), 0);
-			context->GetData(profileQueries[currentQuery].queryEnd.Get(), &end, sizeof(UINT64), 0);
+			if (disjoint.Disjoint
+					|| context->GetData(query.queryStart.Get(), &begin, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK
+					|| context->GetData(query.queryEnd.Get(), &end, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+				continue;
+			}
 			float duration = (end - begin) / float(disjoint.Frequency);
+			ReportPostProcessingGpuTime(1000.f * duration);
 			summedGpuTime += duration;
-			++countedQueries;
+			countedEyes += query.eyeCount;
 
-			if (countedQueries >= 500) {
-				float avgTimeMs = 1000.f / countedQueries * summedGpuTime;
-				// queries are done per eye, but we want the average for both eyes per frame
+			if (countedEyes >= 1000) {
+				float avgTimeMs = 1000.f / countedEyes * summedGpuTime;
+				// queries cover one or both eyes, but we want the average for both eyes per frame
 				avgTimeMs *= 2;
-				LOG_INFO << "Average GPU processing time for post-processing: " << avgTimeMs << " ms";
-				countedQueries = 0;
+				LOG_DEBUG << "Average GPU processing time for post-processing: " << avgTimeMs << " ms";
+				countedEyes = 0;
 				summedGpuTime = 0.f;
 			}
 		}
@@ -2,12 +2,26 @@
 #include "types.h"
 #include "d3d11_helper.h"
 #include "d3d11_injector.h"
+#include "d3d11_resource_cache.h"
+#include "d3d11_sampler_cache.h"
 
+#include <atomic>
 #include <memory>
-#include <unordered_map>
-#include <unordered_set>
 
 namespace vrperfkit {
+	// what temporal upscaling needs beyond the colour input, see D3D11TemporalUpscaler
+	struct D3D11TemporalInput {
+		// nullptr if the game did not submit depth and pose for this eye
+		ID3D11ShaderResourceView *depthView = nullptr;
+		// region of the depth texture that corresponds to the input viewport
+		Viewport depthViewport;
+		// maps the current frame's clip space to the previous frame's, in the orientation of the input viewport
+		float reprojection[4][4];
+		bool hasPreviousFrame = false;
+		// sub-pixel offset the game rendered this frame with, in uv units of the input viewport, see temporal_jitter.h
+		Point<float> jitter = { 0, 0 };
+	};
+
 	struct D3D11PostProcessInput {
 		ID3D11Texture2D *inputTexture;
 		ID3D11Texture2D *outputTexture;
@@ -18,11 +32,33 @@ namespace vrperfkit {
 		int eye;
 		TextureMode mode;
 		Point<float> projectionCenter;
+		D3D11TemporalInput temporal;
+		// the output is the input texture itself, with outputUav a view of it and the output viewport the input viewport
+		bool inPlace = false;
 	};
 
 	class D3D11Upscaler {
 	public:
 		virtual void Upscale(const D3D11PostProcessInput &input, const Viewport &outputViewport) = 0;
+		// processes both eyes; by default one after the other
+		virtual void UpscaleStereo(const D3D11PostProcessInput *inputs, const Viewport *outputViewports);
+		// true if the input view may be a multi-sampled texture, which then does not need to be resolved first
+		virtual bool SupportsMultisampledInput() const { return false; }
+		// true if sharpening without upscaling can write back into the input texture, see D3D11TileEdges
+		virtual bool SupportsInPlaceSharpening() const { return false; }
+
+	protected:
+		// true if both eyes read from and write to the same views with equally sized viewports,
+		// so that they can be handled by a single dispatch with per-eye constants
+		static bool CanDispatchStereo(const D3D11PostProcessInput *inputs, const Viewport *outputViewports);
+
+		// single-eye dispatches keep their constants per eye and stereo dispatches have their own set,
+		// so that within a frame none of them overwrites the constants of another
+		static const int CONSTANTS_SETS = 3;
+		static int ConstantsSet(const D3D11PostProcessInput *inputs, int eyeCount) { return eyeCount == 2 ? 2 : inputs[0].eye; }
+
+		// ShaderFeature flags of the permutation that covers all of the given eyes
+		static uint32_t ShaderFeatures(const D3D11ResourceCache &resources, const D3D11PostProcessInput *inputs, int eyeCount);
 	};
 
 	class D3D11PostProcessor : public D3D11Listener {
@@ -30,35 +66,55 @@ namespace vrperfkit {
 		D3D11PostProcessor(ComPtr<ID3D11Device> device);
 
 		bool Apply(const D3D11PostProcessInput &input, Viewport &outputViewport);
+		// processes both eyes with a single state save and restore
+		bool ApplyStereo(const D3D11PostProcessInput *inputs, Viewport *outputViewports);
+		// whether the current upscaler can take multi-sampled input as is; otherwise it must be resolved beforehand
+		bool AcceptsMultisampledInput();
+		// whether the current upscaler can sharpen in place, so that no separate output texture is needed
+		bool AcceptsInPlaceSharpening();
 
-		bool PrePSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState * const *ppSamplers) override;
+		uint32_t EventInterest() override;
+		bool PrePSSetSamplers(ID3D11DeviceContext *context, UINT startSlot, UINT numSamplers, ID3D11SamplerState * const *ppSamplers) override;
 
 	private:
 		ComPtr<ID3D11Device> device;
 		ComPtr<ID3D11DeviceContext> context;
-		std::unique_ptr<D3D11Upscaler> upscaler;
+		D3D11ResourceCache resources;
+		// upscalers are kept per method so that switching back and forth does not recreate them
+		static const int UPSCALE_METHOD_COUNT = 4;
+		std::unique_ptr<D3D11Upscaler> upscalers[UPSCALE_METHOD_COUNT];
+		D3D11Upscaler *upscaler = nullptr;
 		UpscaleMethod upscaleMethod;
 
-		void PrepareUpscaler(ID3D11Texture2D *outputTexture);
+		bool Process(const D3D11PostProcessInput *inputs, Viewport *outputViewports, int eyeCount);
+		void PrepareUpscaler();
+		// prepares the current upscaler outside of processing; nullptr if that fails, which disables upscaling
+		D3D11Upscaler * TryPrepareUpscaler();
+		D3D11Upscaler * GetUpscaler(UpscaleMethod method);
 		void SaveTextureToFile(ID3D11Texture2D *texture);
 
-		std::unordered_set<ID3D11SamplerState*> passThroughSamplers;
-		std::unordered_map<ID3D11SamplerState*, ComPtr<ID3D11SamplerState>> mappedSamplers;
+		// sampler replacement may be requested concurrently from threads recording deferred contexts,
+		// which only read the bank chosen for the current frame
+		D3D11SamplerCache samplerCache;
 		float mipLodBias = 0.0f;
+		std::atomic_int mipBiasBank = 0;
 
 		struct ProfileQuery {
 			ComPtr<ID3D11Query> queryDisjoint;
 			ComPtr<ID3D11Query> queryStart;
 			ComPtr<ID3D11Query> queryEnd;
+			int eyeCount = 0;
+			// issued, but its results have not been read yet
+			bool pending = false;
 		};
 		static const int QUERY_COUNT = 6;
 		ProfileQuery profileQueries[QUERY_COUNT];
 		int currentQuery = 0;
 		float summedGpuTime = 0.0f;
-		int countedQueries = 0;
+		int countedEyes = 0;
 
 		void CreateProfileQueries();
 		void StartProfiling();
-		void EndProfiling();
+		void EndProfiling(int eyeCount);
 	};
 }
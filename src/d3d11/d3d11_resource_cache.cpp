@@ -0,0 +1,53 @@
+#include "d3d11_resource_cache.h"
+#include "logging.h"
+
+namespace vrperfkit {
+	D3D11ResourceCache::D3D11ResourceCache(ID3D11Device *device) : device(device) {
+		D3D11_FEATURE_DATA_SHADER_MIN_PRECISION_SUPPORT precision = {};
+		if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_SHADER_MIN_PRECISION_SUPPORT, &precision, sizeof(precision)))) {
+			halfPrecision = (precision.AllOtherShaderStagesMinPrecision & D3D11_SHADER_MIN_PRECISION_16_BIT) != 0;
+		}
+		LOG_INFO << "16-bit shader math is " << (halfPrecision ? "supported" : "not supported");
+	}
+
+	ID3D11ComputeShader * D3D11ResourceCache::GetComputeShader(const void *bytecode, size_t size, const char *name) {
+		auto &shader = computeShaders[bytecode];
+		if (shader == nullptr) {
+			CheckResult(std::string("creating ") + name, device->CreateComputeShader(bytecode, size, nullptr, shader.GetAddressOf()));
+		}
+		return shader.Get();
+	}
+
+	ID3D11SamplerState * D3D11ResourceCache::GetLinearSampler() {
+		if (linearSampler == nullptr) {
+			linearSampler = CreateLinearSampler(device);
+		}
+		return linearSampler.Get();
+	}
+
+	ID3D11ShaderResourceView * D3D11ResourceCache::GetStaticTextureView(const void *data, uint32_t width, uint32_t height, DXGI_FORMAT format, uint32_t rowPitch, const char *name) {
+		auto &entry = staticTextures[data];
+		if (entry.second == nullptr) {
+			D3D11_TEXTURE2D_DESC td;
+			td.Width = width;
+			td.Height = height;
+			td.Format = format;
+			td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			td.MipLevels = 1;
+			td.ArraySize = 1;
+			td.SampleDesc.Count = 1;
+			td.SampleDesc.Quality = 0;
+			td.Usage = D3D11_USAGE_IMMUTABLE;
+			td.CPUAccessFlags = 0;
+			td.MiscFlags = 0;
+			D3D11_SUBRESOURCE_DATA texData;
+			texData.pSysMem = data;
+			texData.SysMemPitch = rowPitch;
+			texData.SysMemSlicePitch = rowPitch * height;
+			CheckResult(std::string("creating ") + name, device->CreateTexture2D(&td, &texData, entry.first.ReleaseAndGetAddressOf()));
+			entry.second = CreateShaderResourceView(device, entry.first.Get());
+		}
+		return entry.second.Get();
+	}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "d3d11_helper.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace vrperfkit {
+	// Device-scoped cache for static resources that the upscalers share or that are expensive to recreate.
+	// Upscaler instances come and go when switching methods, but what they need stays alive here.
+	class D3D11ResourceCache {
+	public:
+		D3D11ResourceCache(ID3D11Device *device);
+
+		// shaders are keyed by their (static) bytecode
+		ID3D11ComputeShader * GetComputeShader(const void *bytecode, size_t size, const char *name);
+		ID3D11SamplerState * GetLinearSampler();
+		// immutable texture initialized from static data, keyed by the data pointer
+		ID3D11ShaderResourceView * GetStaticTextureView(const void *data, uint32_t width, uint32_t height, DXGI_FORMAT format, uint32_t rowPitch, const char *name);
+
+		// whether compute shaders can actually run min16float math at 16 bits rather than promoting it to 32 bits
+		bool SupportsHalfPrecision() const { return halfPrecision; }
+
+	private:
+		ID3D11Device *device;
+		bool halfPrecision = false;
+		std::unordered_map<const void*, ComPtr<ID3D11ComputeShader>> computeShaders;
+		ComPtr<ID3D11SamplerState> linearSampler;
+		std::unordered_map<const void*, std::pair<ComPtr<ID3D11Texture2D>, ComPtr<ID3D11ShaderResourceView>>> staticTextures;
+	};
+}
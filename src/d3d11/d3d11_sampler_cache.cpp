@@ -0,0 +1,184 @@
+#include "d3d11_sampler_cache.h"
+
+#include "logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace vrperfkit {
+	namespace {
+		const int32_t NOT_FOUND = -2;
+		const int32_t PASS_THROUGH = -1;
+		const int32_t EMPTY_SLOT = -1;
+
+		size_t HashPointer(const void *ptr) {
+			uint64_t value = (uintptr_t)ptr;
+			return (size_t)((value >> 4) * 11400714819323198485ull);
+		}
+
+		uint64_t HashDesc(const D3D11_SAMPLER_DESC &desc) {
+			// FNV-1a over the raw description; the struct consists of 4-byte members only, so there is no padding
+			const uint8_t *bytes = (const uint8_t*)&desc;
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(desc); ++i) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+	}
+
+	D3D11SamplerCache::D3D11SamplerCache(ComPtr<ID3D11Device> device) : device(device) {
+		samplerTable.reset(new SamplerEntry[SAMPLER_CAPACITY]);
+		descs.resize(MAX_DESCS);
+		descTable.resize(2 * MAX_DESCS, EMPTY_SLOT);
+	}
+
+	D3D11SamplerCache::~D3D11SamplerCache() {
+		for (size_t i = 0; i < SAMPLER_CAPACITY; ++i) {
+			if (ID3D11SamplerState *sampler = samplerTable[i].sampler.load()) {
+				sampler->Release();
+			}
+		}
+		for (int32_t index = 0; index < descCount.load(); ++index) {
+			for (auto &bank : descs[index]->banks) {
+				if (ID3D11SamplerState *sampler = bank.load()) {
+					sampler->Release();
+				}
+			}
+		}
+	}
+
+	int D3D11SamplerCache::BankForBias(float mipLodBias) {
+		int bank = (int)roundf(-mipLodBias / BIAS_STEP);
+		return std::clamp(bank, 0, BANK_COUNT - 1);
+	}
+
+	ID3D11SamplerState * D3D11SamplerCache::GetReplacement(ID3D11SamplerState *sampler, int bank) {
+		if (sampler == nullptr || bank == 0) {
+			return nullptr;
+		}
+
+		int32_t descIndex = FindSampler(sampler);
+		if (descIndex == NOT_FOUND) {
+			descIndex = AddSampler(sampler);
+		}
+
+		if (descIndex == PASS_THROUGH) {
+			return nullptr;
+		}
+		return descs[descIndex]->banks[bank].load(std::memory_order_acquire);
+	}
+
+	void D3D11SamplerCache::CreateBank(int bank) {
+		if (bank == 0) {
+			return;
+		}
+		int32_t count = descCount.load(std::memory_order_acquire);
+		for (int32_t index = 0; index < count; ++index) {
+			CreateReplacement(*descs[index], bank);
+		}
+	}
+
+	void D3D11SamplerCache::CreateReplacement(DescEntry &entry, int bank) {
+		if (entry.banks[bank].load(std::memory_order_relaxed) != nullptr || entry.failed) {
+			return;
+		}
+
+		D3D11_SAMPLER_DESC sd = entry.desc;
+		sd.MipLODBias = -bank * BIAS_STEP;
+		ComPtr<ID3D11SamplerState> replacement;
+		HRESULT result = device->CreateSamplerState(&sd, replacement.GetAddressOf());
+		if (FAILED(result)) {
+			LOG_ERROR << "Failed to create replacement sampler: " << std::hex << result << std::dec;
+			entry.failed = true;
+			return;
+		}
+		{
+			// our replacements may be set again when the game's state is restored, make sure they are left alone
+			std::lock_guard<std::mutex> lock (insertMutex);
+			if (FindSampler(replacement.Get()) == NOT_FOUND) {
+				InsertSampler(replacement.Get(), PASS_THROUGH);
+			}
+		}
+		entry.banks[bank].store(replacement.Detach(), std::memory_order_release);
+	}
+
+	int32_t D3D11SamplerCache::FindSampler(ID3D11SamplerState *sampler) {
+		size_t mask = SAMPLER_CAPACITY - 1;
+		for (size_t i = HashPointer(sampler) & mask; ; i = (i + 1) & mask) {
+			ID3D11SamplerState *entry = samplerTable[i].sampler.load(std::memory_order_acquire);
+			if (entry == nullptr) {
+				return NOT_FOUND;
+			}
+			if (entry == sampler) {
+				return samplerTable[i].descIndex.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	int32_t D3D11SamplerCache::AddSampler(ID3D11SamplerState *sampler) {
+		std::lock_guard<std::mutex> lock (insertMutex);
+		// another thread may have added it in the meantime
+		int32_t descIndex = FindSampler(sampler);
+		if (descIndex != NOT_FOUND) {
+			return descIndex;
+		}
+
+		D3D11_SAMPLER_DESC sd;
+		sampler->GetDesc(&sd);
+		if (sd.MipLODBias != 0 || sd.MaxAnisotropy == 1) {
+			// do not mess with samplers that already have a bias or are not doing anisotropic filtering.
+			// should hopefully reduce the chance of causing rendering errors.
+			descIndex = PASS_THROUGH;
+		}
+		else {
+			descIndex = FindOrCreateDesc(sd);
+		}
+		InsertSampler(sampler, descIndex);
+		return descIndex;
+	}
+
+	void D3D11SamplerCache::InsertSampler(ID3D11SamplerState *sampler, int32_t descIndex) {
+		if (2 * (samplerCount + 1) > SAMPLER_CAPACITY) {
+			// can't happen with the device limit, but leave the sampler alone rather than filling up the table
+			return;
+		}
+
+		size_t mask = SAMPLER_CAPACITY - 1;
+		size_t i = HashPointer(sampler) & mask;
+		while (samplerTable[i].sampler.load(std::memory_order_relaxed) != nullptr) {
+			i = (i + 1) & mask;
+		}
+		sampler->AddRef();
+		samplerTable[i].descIndex.store(descIndex, std::memory_order_relaxed);
+		samplerTable[i].sampler.store(sampler, std::memory_order_release);
+		++samplerCount;
+	}
+
+	int32_t D3D11SamplerCache::FindOrCreateDesc(const D3D11_SAMPLER_DESC &desc) {
+		uint64_t hash = HashDesc(desc);
+		size_t mask = descTable.size() - 1;
+		size_t i = (size_t)hash & mask;
+		for (; descTable[i] != EMPTY_SLOT; i = (i + 1) & mask) {
+			const DescEntry &entry = *descs[descTable[i]];
+			if (entry.hash == hash && memcmp(&entry.desc, &desc, sizeof(desc)) == 0) {
+				return descTable[i];
+			}
+		}
+
+		int32_t index = descCount.load(std::memory_order_relaxed);
+		if (index == MAX_DESCS) {
+			return PASS_THROUGH;
+		}
+
+		LOG_DEBUG << "Found new sampler description to replace";
+		descs[index].reset(new DescEntry);
+		descs[index]->desc = desc;
+		descs[index]->hash = hash;
+		descTable[i] = index;
+		descCount.store(index + 1, std::memory_order_release);
+		return index;
+	}
+}
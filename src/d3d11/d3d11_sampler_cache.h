@@ -0,0 +1,71 @@
+#pragma once
+#include "d3d11_helper.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vrperfkit {
+	// Maps game samplers to replacements with a negative MIP LOD bias.
+	// Replacements are shared between all samplers with an identical description. They are created per
+	// quantized bias step by CreateBank on the render thread, so looking them up never has to create a
+	// sampler. Only the steps actually used are created, as D3D11 only allows 4096 sampler states per device.
+	// GetReplacement may be called concurrently from any thread. Samplers that were seen before are found
+	// without taking a lock; entries are only ever added, so the tables never need to be resized or swapped.
+	class D3D11SamplerCache {
+	public:
+		static constexpr float BIAS_STEP = 1.f / 32;
+		// renderScale is at least 0.5, so the bias never goes below -1
+		static constexpr int BANK_COUNT = 33;
+
+		D3D11SamplerCache(ComPtr<ID3D11Device> device);
+		~D3D11SamplerCache();
+
+		static int BankForBias(float mipLodBias);
+
+		// creates the replacements for the given bank for all descriptions seen so far; render thread only
+		void CreateBank(int bank);
+
+		// returns nullptr if the sampler should be used as is, or if its replacement for the bank does not exist yet
+		ID3D11SamplerState * GetReplacement(ID3D11SamplerState *sampler, int bank);
+
+	private:
+		// the device limit bounds the number of samplers, which keeps the tables at most half full
+		static const size_t SAMPLER_CAPACITY = 8192;
+		static const int32_t MAX_DESCS = 4096;
+
+		struct SamplerEntry {
+			// holds a reference so that the address can not be reused for a sampler with a different description.
+			// Published after descIndex, so a reader that finds the sampler also sees its description.
+			std::atomic<ID3D11SamplerState*> sampler = nullptr;
+			std::atomic<int32_t> descIndex = 0;
+		};
+
+		struct DescEntry {
+			D3D11_SAMPLER_DESC desc;
+			uint64_t hash;
+			// each holds a reference, published once created
+			std::atomic<ID3D11SamplerState*> banks[BANK_COUNT] = {};
+			bool failed = false;
+		};
+
+		ComPtr<ID3D11Device> device;
+		// open addressing tables with linear probing
+		std::unique_ptr<SamplerEntry[]> samplerTable;
+		std::vector<std::unique_ptr<DescEntry>> descs;
+		std::atomic<int32_t> descCount = 0;
+
+		// serializes adding entries, which only happens for samplers that were not seen before
+		std::mutex insertMutex;
+		size_t samplerCount = 0;
+		std::vector<int32_t> descTable;
+
+		int32_t FindSampler(ID3D11SamplerState *sampler);
+		int32_t AddSampler(ID3D11SamplerState *sampler);
+		void InsertSampler(ID3D11SamplerState *sampler, int32_t descIndex);
+		int32_t FindOrCreateDesc(const D3D11_SAMPLER_DESC &desc);
+		void CreateReplacement(DescEntry &entry, int bank);
+	};
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "d3d11_resource_cache.h"
+
+#include <cstdint>
+#include <exception>
+#include <string>
+
+namespace vrperfkit {
+	// Features that shaders are specialized for at build time, see add_shader_permutations in CMakeLists.txt.
+	// Values must match the SHADER_* variables there.
+	enum ShaderFeature : uint32_t {
+		// workgroups process the tiles listed in a buffer instead of a full grid, see D3D11TileLists
+		SHADER_TILE_LIST = 1 << 0,
+		// tint the area outside the radius
+		SHADER_DEBUG = 1 << 1,
+		// input is a multi-sampled texture whose samples are averaged as they are read
+		SHADER_MSAA_INPUT = 1 << 2,
+		SHADER_SHARPEN_ONLY = 1 << 3,
+		// cheap bilinear sampling for the tiles outside the foveation radius, instead of the full filter
+		SHADER_BILINEAR_ONLY = 1 << 4,
+		// linear input with values beyond 1, see IsHdrView
+		SHADER_HDR = 1 << 5,
+		// filter math in min16float, on GPUs that run it at 16 bits
+		SHADER_HALF = 1 << 6,
+		// only luma goes through the full filter, chroma is sampled bilinearly
+		SHADER_LUMA_ONLY = 1 << 7,
+		// sharpening writes back into the input texture, see D3D11TileEdges
+		SHADER_IN_PLACE = 1 << 8,
+	};
+
+	// the cheap path for tiles outside the radius only exists with tile lists, and as it does no filter math,
+	// it is built without the precision and luma variants, see the exclusions in CMakeLists.txt
+	inline uint32_t BilinearFeatures(uint32_t features) {
+		return (features & ~(SHADER_HALF | SHADER_LUMA_ONLY)) | SHADER_TILE_LIST | SHADER_BILINEAR_ONLY;
+	}
+
+	struct ShaderPermutation {
+		uint32_t features;
+		const void *bytecode;
+		size_t size;
+	};
+
+	// looks up the permutation for exactly the given features in a generated table, creating the shader on first use
+	inline ID3D11ComputeShader * GetShaderPermutation(D3D11ResourceCache &resources, const ShaderPermutation *permutations, size_t count, uint32_t features, const char *name) {
+		for (size_t i = 0; i < count; ++i) {
+			if (permutations[i].features == features) {
+				return resources.GetComputeShader(permutations[i].bytecode, permutations[i].size, name);
+			}
+		}
+		std::string message = std::string("No permutation of ") + name + " for features " + std::to_string(features);
+		throw std::exception(message.c_str());
+	}
+
+	template<size_t N>
+	ID3D11ComputeShader * GetShaderPermutation(D3D11ResourceCache &resources, const ShaderPermutation (&permutations)[N], uint32_t features, const char *name) {
+		return GetShaderPermutation(resources, permutations, N, features, name);
+	}
+}
@@ -0,0 +1,48 @@
+#include "d3d11_state.h"
+
+namespace vrperfkit {
+	void StoreD3D11State(ID3D11DeviceContext *context, D3D11State &state) {
+		context->CSGetShader(state.computeShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
+		if (SUCCEEDED(context->QueryInterface(state.context1.ReleaseAndGetAddressOf()))) {
+			state.context1->CSGetConstantBuffers1(0, 1, state.csConstantBuffer.ReleaseAndGetAddressOf(), &state.csConstantBufferFirst, &state.csConstantBufferCount);
+		}
+		else {
+			context->CSGetConstantBuffers(0, 1, state.csConstantBuffer.ReleaseAndGetAddressOf());
+		}
+		context->CSGetSamplers(0, 1, state.csSampler.ReleaseAndGetAddressOf());
+		context->CSGetShaderResources(0, D3D11State::CS_SRV_COUNT, state.csShaderResources);
+		context->CSGetUnorderedAccessViews(0, D3D11State::CS_UAV_COUNT, state.csUavs);
+		context->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, state.renderTargets, state.depthStencil.ReleaseAndGetAddressOf());
+	}
+
+	void RestoreD3D11State(ID3D11DeviceContext *context, const D3D11State &state) {
+		context->CSSetShader(state.computeShader.Get(), nullptr, 0);
+		if (state.context1 && state.csConstantBuffer) {
+			// the game may have bound a range of the buffer, which the plain setter would reset to offset 0
+			state.context1->CSSetConstantBuffers1(0, 1, state.csConstantBuffer.GetAddressOf(), &state.csConstantBufferFirst, &state.csConstantBufferCount);
+		}
+		else {
+			context->CSSetConstantBuffers(0, 1, state.csConstantBuffer.GetAddressOf());
+		}
+		context->CSSetSamplers(0, 1, state.csSampler.GetAddressOf());
+		context->CSSetShaderResources(0, D3D11State::CS_SRV_COUNT, state.csShaderResources);
+		for (UINT i = 0; i < D3D11State::CS_SRV_COUNT; ++i) {
+			if (state.csShaderResources[i])
+				state.csShaderResources[i]->Release();
+		}
+		// keep any append/consume counter as it is
+		UINT initial[D3D11State::CS_UAV_COUNT] = { (UINT)-1, (UINT)-1 };
+		context->CSSetUnorderedAccessViews(0, D3D11State::CS_UAV_COUNT, state.csUavs, initial);
+		for (UINT i = 0; i < D3D11State::CS_UAV_COUNT; ++i) {
+			if (state.csUavs[i]) {
+				state.csUavs[i]->Release();
+			}
+		}
+		context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, state.renderTargets, state.depthStencil.Get());
+		for (int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
+			if (state.renderTargets[i]) {
+				state.renderTargets[i]->Release();
+			}
+		}
+	}
+}
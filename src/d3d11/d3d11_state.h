@@ -0,0 +1,29 @@
+#pragma once
+#include <wrl/client.h>
+#include <d3d11_1.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace vrperfkit {
+	// the pipeline state that post-processing touches, which is all that needs to be saved and restored around it:
+	// the compute stage slots used by the upscalers, and the render targets unbound so the input can be read
+	struct D3D11State {
+		static const UINT CS_SRV_COUNT = 4;
+		static const UINT CS_UAV_COUNT = 2;
+
+		ComPtr<ID3D11ComputeShader> computeShader;
+		ComPtr<ID3D11Buffer> csConstantBuffer;
+		// the range the game bound, only known if the context supports offsets (D3D11.1)
+		ComPtr<ID3D11DeviceContext1> context1;
+		UINT csConstantBufferFirst = 0;
+		UINT csConstantBufferCount = 0;
+		ComPtr<ID3D11SamplerState> csSampler;
+		ID3D11ShaderResourceView *csShaderResources[CS_SRV_COUNT];
+		ID3D11UnorderedAccessView *csUavs[CS_UAV_COUNT];
+		ID3D11RenderTargetView *renderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+		ComPtr<ID3D11DepthStencilView> depthStencil;
+	};
+
+	void StoreD3D11State(ID3D11DeviceContext *context, D3D11State &state);
+	void RestoreD3D11State(ID3D11DeviceContext *context, const D3D11State &state);
+}
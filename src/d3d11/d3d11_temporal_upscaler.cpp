@@ -0,0 +1,114 @@
+#include "d3d11_temporal_upscaler.h"
+#include "d3d11_helper.h"
+#include "logging.h"
+#include "shader_temporal_upscale.h"
+
+#include <cstring>
+
+namespace vrperfkit {
+	namespace {
+		struct ShaderConstants {
+			float reprojection[4][4];
+			uint32_t inputOffset[2];
+			uint32_t inputSize[2];
+			float inputTextureSize[2];
+			uint32_t outputOffset[2];
+			uint32_t outputSize[2];
+			float blend;
+			uint32_t historyValid;
+			uint32_t depthOffset[2];
+			uint32_t depthSize[2];
+			float jitter[2];
+			float padding[2];
+		};
+
+		// weight of the current frame in the accumulated result
+		const float CURRENT_FRAME_WEIGHT = 0.1f;
+	}
+
+	D3D11TemporalUpscaler::D3D11TemporalUpscaler(ID3D11Device *device, D3D11ResourceCache &resources, D3D11Upscaler *fallback)
+			: device(device), resources(resources), fallback(fallback) {
+		LOG_INFO << "Creating D3D11 resources for temporal upscaling...";
+		device->GetImmediateContext(context.GetAddressOf());
+		shader = resources.GetComputeShader(g_TemporalUpscaleShader, sizeof(g_TemporalUpscaleShader), "temporal upscale shader");
+		for (int i = 0; i < CONSTANTS_SETS; ++i) {
+			constantsBuffers[i].reset(new D3D11ConstantBuffer(device, sizeof(ShaderConstants)));
+		}
+		sampler = resources.GetLinearSampler();
+	}
+
+	void D3D11TemporalUpscaler::Upscale(const D3D11PostProcessInput &input, const Viewport &outputViewport) {
+		History &eyeHistory = history[input.eye];
+		if (input.temporal.depthView == nullptr) {
+			eyeHistory.valid = false;
+			fallback->Upscale(input, outputViewport);
+			return;
+		}
+
+		PrepareHistory(eyeHistory, outputViewport);
+		int previous = eyeHistory.current;
+		int next = 1 - previous;
+
+		D3D11_TEXTURE2D_DESC td;
+		input.inputTexture->GetDesc(&td);
+
+		ShaderConstants constants;
+		memset(&constants, 0, sizeof(constants));
+		memcpy(constants.reprojection, input.temporal.reprojection, sizeof(constants.reprojection));
+		constants.inputOffset[0] = input.inputViewport.x;
+		constants.inputOffset[1] = input.inputViewport.y;
+		constants.inputSize[0] = input.inputViewport.width;
+		constants.inputSize[1] = input.inputViewport.height;
+		constants.inputTextureSize[0] = td.Width;
+		constants.inputTextureSize[1] = td.Height;
+		constants.outputOffset[0] = outputViewport.x;
+		constants.outputOffset[1] = outputViewport.y;
+		constants.outputSize[0] = outputViewport.width;
+		constants.outputSize[1] = outputViewport.height;
+		constants.blend = CURRENT_FRAME_WEIGHT;
+		constants.historyValid = eyeHistory.valid && input.temporal.hasPreviousFrame;
+		constants.depthOffset[0] = input.temporal.depthViewport.x;
+		constants.depthOffset[1] = input.temporal.depthViewport.y;
+		constants.depthSize[0] = input.temporal.depthViewport.width;
+		constants.depthSize[1] = input.temporal.depthViewport.height;
+		constants.jitter[0] = input.temporal.jitter.x;
+		constants.jitter[1] = input.temporal.jitter.y;
+		int constantsSet = ConstantsSet(&input, 1);
+		constantsBuffers[constantsSet]->Update(&constants);
+		constantsBuffers[constantsSet]->Bind(0);
+
+		context->CSSetSamplers(0, 1, &sampler);
+		ID3D11ShaderResourceView *srvs[3] = {input.inputView, input.temporal.depthView, eyeHistory.views[previous].Get()};
+		context->CSSetShaderResources(0, 3, srvs);
+		UINT uavCounts[2] = {(UINT)-1, (UINT)-1};
+		ID3D11UnorderedAccessView *uavs[2] = {input.outputUav, eyeHistory.uavs[next].Get()};
+		context->CSSetUnorderedAccessViews(0, 2, uavs, uavCounts);
+		context->CSSetShader(shader, nullptr, 0);
+		context->Dispatch((outputViewport.width + 7) >> 3, (outputViewport.height + 7) >> 3, 1);
+
+		// the history written now is read as a shader resource next frame, which fails while it is still bound here
+		ID3D11UnorderedAccessView *nullUav = nullptr;
+		context->CSSetUnorderedAccessViews(1, 1, &nullUav, uavCounts);
+
+		eyeHistory.current = next;
+		eyeHistory.valid = true;
+	}
+
+	void D3D11TemporalUpscaler::PrepareHistory(History &eyeHistory, const Viewport &outputViewport) {
+		if (eyeHistory.width == outputViewport.width && eyeHistory.height == outputViewport.height) {
+			return;
+		}
+
+		LOG_INFO << "Creating temporal history textures of size " << outputViewport.width << "x" << outputViewport.height;
+		for (int i = 0; i < 2; ++i) {
+			// kept in FP16, so that accumulating small contributions does not band
+			eyeHistory.textures[i] = CreatePostProcessTexture(device, outputViewport.width, outputViewport.height, DXGI_FORMAT_R16G16B16A16_FLOAT);
+			eyeHistory.views[i] = CreateShaderResourceView(device, eyeHistory.textures[i].Get());
+			eyeHistory.uavs[i] = CreateUnorderedAccessView(device, eyeHistory.textures[i].Get());
+		}
+		eyeHistory.width = outputViewport.width;
+		eyeHistory.height = outputViewport.height;
+		eyeHistory.current = 0;
+		eyeHistory.valid = false;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "d3d11_constant_buffer.h"
+#include "d3d11_post_processor.h"
+#include "d3d11_resource_cache.h"
+
+#include <d3d11.h>
+#include <memory>
+#include <wrl/client.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace vrperfkit {
+	// Temporal reconstruction for games that submit depth and pose: the previous output of each eye is
+	// reprojected into the current frame via depth and the pose delta, clamped to the current frame's
+	// neighbourhood and accumulated with the current low-resolution frame. The game's projection is jittered
+	// by a sub-pixel offset every frame, see temporal_jitter.h, so each input pixel adds to the output pixels
+	// closest to where it sampled the scene, and the history gathers more detail than a single frame has.
+	// Eyes without depth are handed to the fallback upscaler instead.
+	class D3D11TemporalUpscaler : public D3D11Upscaler {
+	public:
+		D3D11TemporalUpscaler(ID3D11Device *device, D3D11ResourceCache &resources, D3D11Upscaler *fallback);
+		void Upscale(const D3D11PostProcessInput &input, const Viewport &outputViewport) override;
+
+	private:
+		// accumulated output of an eye, read as the previous frame while the next one is written
+		struct History {
+			ComPtr<ID3D11Texture2D> textures[2];
+			ComPtr<ID3D11ShaderResourceView> views[2];
+			ComPtr<ID3D11UnorderedAccessView> uavs[2];
+			uint32_t width = 0;
+			uint32_t height = 0;
+			int current = 0;
+			bool valid = false;
+		};
+
+		ID3D11Device *device;
+		ComPtr<ID3D11DeviceContext> context;
+		D3D11ResourceCache &resources;
+		D3D11Upscaler *fallback;
+		std::unique_ptr<D3D11ConstantBuffer> constantsBuffers[CONSTANTS_SETS];
+		ID3D11ComputeShader *shader;
+		ID3D11SamplerState *sampler;
+		History history[2];
+
+		void PrepareHistory(History &eyeHistory, const Viewport &outputViewport);
+	};
+}
@@ -0,0 +1,101 @@
+#include "d3d11_texture_pool.h"
+
+#include "logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vrperfkit {
+	namespace {
+		// roughly a few seconds worth of frames, so that short resolution switches do not thrash the pool
+		const uint64_t TRIM_AFTER_FRAMES = 500;
+	}
+
+	D3D11TextureLease::D3D11TextureLease(D3D11TextureLease &&other) noexcept : pool(other.pool), texture(other.texture) {
+		other.pool = nullptr;
+		other.texture = nullptr;
+	}
+
+	D3D11TextureLease & D3D11TextureLease::operator=(D3D11TextureLease &&other) noexcept {
+		if (this != &other) {
+			Release();
+			pool = other.pool;
+			texture = other.texture;
+			other.pool = nullptr;
+			other.texture = nullptr;
+		}
+		return *this;
+	}
+
+	D3D11TextureLease::~D3D11TextureLease() {
+		Release();
+	}
+
+	void D3D11TextureLease::Release() {
+		if (texture != nullptr) {
+			pool->Return(texture);
+			pool = nullptr;
+			texture = nullptr;
+		}
+	}
+
+	D3D11TexturePool::D3D11TexturePool(ComPtr<ID3D11Device> device) : device(device) {}
+
+	D3D11TexturePool::~D3D11TexturePool() {
+		for (auto &texture : textures) {
+			if (texture->inUse) {
+				LOG_ERROR << "Texture pool destroyed while texture " << texture->texture.Get() << " is still in use";
+			}
+		}
+	}
+
+	D3D11TextureLease D3D11TexturePool::Acquire(const D3D11_TEXTURE2D_DESC &desc) {
+		D3D11PooledTexture *match = nullptr;
+		for (auto &texture : textures) {
+			// all members of the description are 4-byte values, so there is no padding to worry about
+			if (!texture->inUse && memcmp(&texture->desc, &desc, sizeof(desc)) == 0) {
+				match = texture.get();
+				break;
+			}
+		}
+
+		if (match == nullptr) {
+			LOG_DEBUG << "Creating pooled texture of size " << desc.Width << "x" << desc.Height << " and format " << desc.Format;
+			auto texture = std::make_unique<D3D11PooledTexture>();
+			texture->desc = desc;
+			CheckResult("creating pooled texture", device->CreateTexture2D(&desc, nullptr, texture->texture.GetAddressOf()));
+			if (desc.BindFlags & D3D11_BIND_SHADER_RESOURCE) {
+				texture->view = CreateShaderResourceView(device.Get(), texture->texture.Get());
+			}
+			if (desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS) {
+				texture->uav = CreateUnorderedAccessView(device.Get(), texture->texture.Get());
+			}
+			match = texture.get();
+			textures.push_back(std::move(texture));
+		}
+
+		match->inUse = true;
+		match->lastUsedFrame = frame;
+		D3D11TextureLease lease;
+		lease.pool = this;
+		lease.texture = match;
+		return lease;
+	}
+
+	void D3D11TexturePool::EndFrame() {
+		++frame;
+		auto isStale = [this](const std::unique_ptr<D3D11PooledTexture> &texture) {
+			return !texture->inUse && frame - texture->lastUsedFrame > TRIM_AFTER_FRAMES;
+		};
+		auto last = std::remove_if(textures.begin(), textures.end(), isStale);
+		if (last != textures.end()) {
+			LOG_DEBUG << "Freeing " << (textures.end() - last) << " unused pooled textures";
+			textures.erase(last, textures.end());
+		}
+	}
+
+	void D3D11TexturePool::Return(D3D11PooledTexture *texture) {
+		texture->inUse = false;
+		texture->lastUsedFrame = frame;
+	}
+}
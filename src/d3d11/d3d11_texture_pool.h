@@ -0,0 +1,68 @@
+#pragma once
+#include "d3d11_helper.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vrperfkit {
+	class D3D11TexturePool;
+
+	struct D3D11PooledTexture {
+		D3D11_TEXTURE2D_DESC desc;
+		ComPtr<ID3D11Texture2D> texture;
+		ComPtr<ID3D11ShaderResourceView> view;
+		ComPtr<ID3D11UnorderedAccessView> uav;
+		bool inUse = false;
+		uint64_t lastUsedFrame = 0;
+	};
+
+	// Exclusive use of a pooled texture, which is handed back to the pool when the lease is released or destroyed.
+	// Leases must not outlive the pool they were acquired from.
+	class D3D11TextureLease {
+	public:
+		D3D11TextureLease() = default;
+		D3D11TextureLease(D3D11TextureLease &&other) noexcept;
+		D3D11TextureLease & operator=(D3D11TextureLease &&other) noexcept;
+		D3D11TextureLease(const D3D11TextureLease &) = delete;
+		D3D11TextureLease & operator=(const D3D11TextureLease &) = delete;
+		~D3D11TextureLease();
+
+		void Release();
+
+		explicit operator bool() const { return texture != nullptr; }
+		ID3D11Texture2D * Texture() const { return texture->texture.Get(); }
+		ID3D11ShaderResourceView * View() const { return texture->view.Get(); }
+		ID3D11UnorderedAccessView * Uav() const { return texture->uav.Get(); }
+
+	private:
+		friend class D3D11TexturePool;
+		D3D11TexturePool *pool = nullptr;
+		D3D11PooledTexture *texture = nullptr;
+	};
+
+	// Hands out textures by description and takes them back once their user is done with them.
+	// The VR runtime managers keep their pool across resource reinitializations, so that recreating the
+	// post-processing resources, e.g. when the game recreates its swapchains or briefly changes resolution,
+	// picks up the existing resolve and output textures again instead of allocating new ones.
+	class D3D11TexturePool {
+	public:
+		D3D11TexturePool(ComPtr<ID3D11Device> device);
+		~D3D11TexturePool();
+
+		ID3D11Device * Device() const { return device.Get(); }
+
+		D3D11TextureLease Acquire(const D3D11_TEXTURE2D_DESC &desc);
+
+		// advances the frame counter and frees textures that have not been used for a while
+		void EndFrame();
+
+	private:
+		friend class D3D11TextureLease;
+		void Return(D3D11PooledTexture *texture);
+
+		ComPtr<ID3D11Device> device;
+		std::vector<std::unique_ptr<D3D11PooledTexture>> textures;
+		uint64_t frame = 0;
+	};
+}
@@ -0,0 +1,78 @@
+#include "d3d11_tile_edges.h"
+
+#include "logging.h"
+#include "shader_tile_edges.h"
+
+namespace vrperfkit {
+	namespace {
+		const uint32_t TILE_SIZE = 16;
+		const uint32_t EDGE_TEXELS = 4 * TILE_SIZE;
+
+		struct ShaderConstants {
+			uint32_t viewports[2][4];
+		};
+	}
+
+	D3D11TileEdges::D3D11TileEdges(ID3D11Device *device, D3D11ResourceCache &resources) : device(device), resources(resources) {
+		device->GetImmediateContext(context.GetAddressOf());
+		constantsBuffer.reset(new D3D11ConstantBuffer(device, sizeof(ShaderConstants)));
+	}
+
+	void D3D11TileEdges::Save(const D3D11PostProcessInput *inputs, const Viewport *viewports, int eyeCount) {
+		// with multiple eyes, they share views and sizes as in the sharpening pass
+		uint32_t tilesX = (viewports[0].width + TILE_SIZE - 1) / TILE_SIZE;
+		uint32_t tilesY = (viewports[0].height + TILE_SIZE - 1) / TILE_SIZE;
+		uint32_t texels = tilesX * tilesY * eyeCount * EDGE_TEXELS;
+		if (texels > capacity) {
+			LOG_INFO << "Creating tile edge buffer for " << tilesX << "x" << tilesY << " tiles";
+			D3D11_BUFFER_DESC bd;
+			bd.Usage = D3D11_USAGE_DEFAULT;
+			bd.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+			bd.CPUAccessFlags = 0;
+			bd.MiscFlags = 0;
+			bd.StructureByteStride = 0;
+			// FP32 holds every value the input's loads return, so the apron matches the texels read through the UAV
+			bd.ByteWidth = texels * 4 * sizeof(float);
+			buffer.Reset();
+			CheckResult("creating tile edge buffer", device->CreateBuffer(&bd, nullptr, buffer.GetAddressOf()));
+			capacity = texels;
+
+			D3D11_SHADER_RESOURCE_VIEW_DESC srvd;
+			srvd.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+			srvd.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+			srvd.Buffer.FirstElement = 0;
+			srvd.Buffer.NumElements = capacity;
+			view.Reset();
+			CheckResult("creating tile edge view", device->CreateShaderResourceView(buffer.Get(), &srvd, view.GetAddressOf()));
+
+			D3D11_UNORDERED_ACCESS_VIEW_DESC uavd;
+			uavd.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+			uavd.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+			uavd.Buffer.FirstElement = 0;
+			uavd.Buffer.NumElements = capacity;
+			uavd.Buffer.Flags = 0;
+			uav.Reset();
+			CheckResult("creating tile edge UAV", device->CreateUnorderedAccessView(buffer.Get(), &uavd, uav.GetAddressOf()));
+		}
+
+		ShaderConstants constants = {};
+		for (int eye = 0; eye < eyeCount; ++eye) {
+			constants.viewports[eye][0] = viewports[eye].x;
+			constants.viewports[eye][1] = viewports[eye].y;
+			constants.viewports[eye][2] = viewports[eye].width;
+			constants.viewports[eye][3] = viewports[eye].height;
+		}
+		constantsBuffer->Update(&constants);
+		constantsBuffer->Bind(0);
+
+		context->CSSetShaderResources(0, 1, &inputs[0].inputView);
+		UINT uavCount = -1;
+		context->CSSetUnorderedAccessViews(0, 1, uav.GetAddressOf(), &uavCount);
+		context->CSSetShader(resources.GetComputeShader(g_TileEdgesShader, sizeof(g_TileEdgesShader), "tile edges shader"), nullptr, 0);
+		context->Dispatch(tilesX, tilesY, eyeCount);
+
+		// the input is written through a UAV by the following pass, which fails while it is still bound as a resource
+		ID3D11ShaderResourceView *nullSrv = nullptr;
+		context->CSSetShaderResources(0, 1, &nullSrv);
+	}
+}
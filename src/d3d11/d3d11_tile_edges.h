@@ -0,0 +1,34 @@
+#pragma once
+#include "d3d11_constant_buffer.h"
+#include "d3d11_helper.h"
+#include "d3d11_post_processor.h"
+#include "d3d11_resource_cache.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace vrperfkit {
+	// The original outer texels of every 16x16 tile of the viewports, for sharpening in place: workgroups read
+	// their apron from here instead of from the neighbouring tiles, which other workgroups may already have
+	// overwritten. At a quarter of the texels this is much smaller than a separate output texture.
+	class D3D11TileEdges {
+	public:
+		D3D11TileEdges(ID3D11Device *device, D3D11ResourceCache &resources);
+
+		// runs the saving pass, so it must be called before the sharpening pass binds its resources
+		void Save(const D3D11PostProcessInput *inputs, const Viewport *viewports, int eyeCount);
+
+		// to be bound to t2 of the IN_PLACE shader permutations
+		ID3D11ShaderResourceView * View() const { return view.Get(); }
+
+	private:
+		ID3D11Device *device;
+		ComPtr<ID3D11DeviceContext> context;
+		D3D11ResourceCache &resources;
+		ComPtr<ID3D11Buffer> buffer;
+		ComPtr<ID3D11ShaderResourceView> view;
+		ComPtr<ID3D11UnorderedAccessView> uav;
+		std::unique_ptr<D3D11ConstantBuffer> constantsBuffer;
+		uint32_t capacity = 0;
+	};
+}
@@ -0,0 +1,244 @@
+#include "d3d11_tile_lists.h"
+
+#include "config.h"
+#include "d3d11_shader_permutations.h"
+#include "shader_tile_classify.h"
+
+#include <cstring>
+#include <iterator>
+
+namespace vrperfkit {
+	namespace {
+		struct ClassifyConstants {
+			struct Eye {
+				float inputOffset[2];
+				float inputScale[2];
+				uint32_t inputMin[2];
+				uint32_t inputMax[2];
+			} eyes[2];
+			uint32_t tileSize[2];
+			float threshold;
+			uint32_t flatListOffset;
+		};
+
+		// thread group counts of the busy and the flat list, before the classification pass increments the x counts
+		const UINT INITIAL_DISPATCH_ARGS[6] = { 0, 1, 1, 0, 1, 1 };
+	}
+
+	D3D11TileLists::D3D11TileLists(ID3D11Device *device, D3D11ResourceCache &resources) : device(device), resources(resources) {
+		device->GetImmediateContext(context.GetAddressOf());
+	}
+
+	bool D3D11TileLists::Update(const D3D11PostProcessInput *inputs, const Viewport *outputViewports, int eyeCount, uint32_t tileWidth, uint32_t tileHeight, uint32_t features) {
+		TileGrid newGrids[2] = {};
+		for (int eye = 0; eye < eyeCount; ++eye) {
+			// same values and truncation as in the shader constants, so that classification matches the shaders
+			const Viewport &outputViewport = outputViewports[eye];
+			TileGrid &grid = newGrids[eye];
+			float radius = 0.5f * g_config.upscaling.radius * outputViewport.height;
+			grid.tilesX = (outputViewport.width + tileWidth - 1) / tileWidth;
+			grid.tilesY = (outputViewport.height + tileHeight - 1) / tileHeight;
+			grid.tileWidth = tileWidth;
+			grid.tileHeight = tileHeight;
+			grid.projCentre[0] = outputViewport.width * inputs[eye].projectionCenter.x;
+			grid.projCentre[1] = outputViewport.height * inputs[eye].projectionCenter.y;
+			grid.squaredRadius = radius * radius;
+		}
+
+		if (eyeCount != gridCount || memcmp(newGrids, grids, sizeof(grids)) != 0) {
+			memcpy(grids, newGrids, sizeof(grids));
+			gridCount = eyeCount;
+			Rebuild();
+		}
+
+		// the classification pass reads the input as a single-sampled texture
+		classified = g_config.upscaling.contrastThreshold > 0 && fullCount > 0 && !(features & SHADER_MSAA_INPUT);
+		if (classified) {
+			Classify(inputs, outputViewports, eyeCount);
+		}
+
+		return cheapCount > 0 || classified;
+	}
+
+	void D3D11TileLists::Dispatch(UINT listSlot, ID3D11ComputeShader *fullShader, ID3D11ComputeShader *cheapShader) {
+		if (classified) {
+			context->CSSetShaderResources(listSlot, 1, busyTilesView.GetAddressOf());
+			context->CSSetShader(fullShader, nullptr, 0);
+			context->DispatchIndirect(argsBuffer.Get(), 0);
+			if (cheapShader != nullptr) {
+				context->CSSetShaderResources(listSlot, 1, flatTilesView.GetAddressOf());
+				context->CSSetShader(cheapShader, nullptr, 0);
+				context->DispatchIndirect(argsBuffer.Get(), 3 * sizeof(UINT));
+			}
+		}
+		else if (fullCount > 0) {
+			context->CSSetShaderResources(listSlot, 1, fullTilesView.GetAddressOf());
+			context->CSSetShader(fullShader, nullptr, 0);
+			context->Dispatch(fullCount, 1, 1);
+		}
+		if (cheapCount > 0 && cheapShader != nullptr) {
+			context->CSSetShaderResources(listSlot, 1, cheapTilesView.GetAddressOf());
+			context->CSSetShader(cheapShader, nullptr, 0);
+			context->Dispatch(cheapCount, 1, 1);
+		}
+	}
+
+	void D3D11TileLists::Rebuild() {
+		// full tiles are collected from the front, cheap tiles from the back of the same list
+		uint32_t total = 0;
+		for (int eye = 0; eye < gridCount; ++eye) {
+			total += grids[eye].tilesX * grids[eye].tilesY;
+		}
+		tiles.resize(total);
+		fullCount = 0;
+		cheapCount = 0;
+		fullTilesView.Reset();
+		cheapTilesView.Reset();
+		busyTilesView.Reset();
+		flatTilesView.Reset();
+		if (total == 0) {
+			return;
+		}
+
+		for (int eye = 0; eye < gridCount; ++eye) {
+			const TileGrid &grid = grids[eye];
+			for (uint32_t y = 0; y < grid.tilesY; ++y) {
+				for (uint32_t x = 0; x < grid.tilesX; ++x) {
+					int64_t dx = (int64_t)grid.projCentre[0] - (x * grid.tileWidth + grid.tileWidth / 2);
+					int64_t dy = (int64_t)grid.projCentre[1] - (y * grid.tileHeight + grid.tileHeight / 2);
+					uint32_t tile = x | (y << 12) | (eye << 24);
+					if (dx * dx + dy * dy <= grid.squaredRadius) {
+						tiles[fullCount++] = tile;
+					}
+					else {
+						tiles[total - ++cheapCount] = tile;
+					}
+				}
+			}
+		}
+
+		if (total > capacity) {
+			D3D11_BUFFER_DESC bd;
+			bd.Usage = D3D11_USAGE_DEFAULT;
+			bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			bd.CPUAccessFlags = 0;
+			bd.MiscFlags = 0;
+			bd.StructureByteStride = 0;
+			bd.ByteWidth = total * sizeof(uint32_t);
+			buffer.Reset();
+			CheckResult("creating tile list buffer", device->CreateBuffer(&bd, nullptr, buffer.GetAddressOf()));
+			capacity = total;
+		}
+
+		D3D11_BOX box = { 0, 0, 0, total * (UINT)sizeof(uint32_t), 1, 1 };
+		context->UpdateSubresource(buffer.Get(), 0, &box, tiles.data(), 0, 0);
+		if (fullCount > 0) {
+			fullTilesView = CreateListView(buffer.Get(), 0, fullCount);
+		}
+		if (cheapCount > 0) {
+			cheapTilesView = CreateListView(buffer.Get(), fullCount, cheapCount);
+		}
+	}
+
+	void D3D11TileLists::Classify(const D3D11PostProcessInput *inputs, const Viewport *outputViewports, int eyeCount) {
+		PrepareClassifiedLists();
+
+		ClassifyConstants constants;
+		memset(&constants, 0, sizeof(constants));
+		for (int eye = 0; eye < eyeCount; ++eye) {
+			const Viewport &inputViewport = inputs[eye].inputViewport;
+			const Viewport &outputViewport = outputViewports[eye];
+			ClassifyConstants::Eye &eyeConstants = constants.eyes[eye];
+			eyeConstants.inputOffset[0] = inputViewport.x;
+			eyeConstants.inputOffset[1] = inputViewport.y;
+			eyeConstants.inputScale[0] = float(inputViewport.width) / outputViewport.width;
+			eyeConstants.inputScale[1] = float(inputViewport.height) / outputViewport.height;
+			eyeConstants.inputMin[0] = inputViewport.x;
+			eyeConstants.inputMin[1] = inputViewport.y;
+			eyeConstants.inputMax[0] = inputViewport.x + inputViewport.width - 1;
+			eyeConstants.inputMax[1] = inputViewport.y + inputViewport.height - 1;
+		}
+		constants.tileSize[0] = grids[0].tileWidth;
+		constants.tileSize[1] = grids[0].tileHeight;
+		constants.threshold = g_config.upscaling.contrastThreshold;
+		constants.flatListOffset = fullCount;
+		classifyConstants->Update(&constants);
+		classifyConstants->Bind(0);
+
+		context->UpdateSubresource(argsBuffer.Get(), 0, nullptr, INITIAL_DISPATCH_ARGS, 0, 0);
+		ID3D11ShaderResourceView *srvs[2] = { inputs[0].inputView, fullTilesView.Get() };
+		context->CSSetShaderResources(0, 2, srvs);
+		UINT uavCounts[2] = { (UINT)-1, (UINT)-1 };
+		ID3D11UnorderedAccessView *uavs[2] = { classifiedUav.Get(), argsUav.Get() };
+		context->CSSetUnorderedAccessViews(0, 2, uavs, uavCounts);
+		context->CSSetShader(resources.GetComputeShader(g_TileClassifyShader, sizeof(g_TileClassifyShader), "tile classification shader"), nullptr, 0);
+		context->Dispatch(fullCount, 1, 1);
+
+		// the lists and arguments are read by the following dispatches, which fails while they are bound for writing
+		ID3D11UnorderedAccessView *nullUavs[2] = { nullptr, nullptr };
+		context->CSSetUnorderedAccessViews(0, 2, nullUavs, uavCounts);
+	}
+
+	void D3D11TileLists::PrepareClassifiedLists() {
+		if (busyTilesView) {
+			return;
+		}
+
+		if (2 * fullCount > classifiedCapacity) {
+			D3D11_BUFFER_DESC bd;
+			bd.Usage = D3D11_USAGE_DEFAULT;
+			bd.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+			bd.CPUAccessFlags = 0;
+			bd.MiscFlags = 0;
+			bd.StructureByteStride = 0;
+			bd.ByteWidth = 2 * fullCount * sizeof(uint32_t);
+			classifiedBuffer.Reset();
+			CheckResult("creating classified tile list buffer", device->CreateBuffer(&bd, nullptr, classifiedBuffer.GetAddressOf()));
+			classifiedCapacity = 2 * fullCount;
+
+			D3D11_UNORDERED_ACCESS_VIEW_DESC uavd;
+			uavd.Format = DXGI_FORMAT_R32_UINT;
+			uavd.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+			uavd.Buffer.FirstElement = 0;
+			uavd.Buffer.NumElements = classifiedCapacity;
+			uavd.Buffer.Flags = 0;
+			classifiedUav.Reset();
+			CheckResult("creating classified tile list UAV", device->CreateUnorderedAccessView(classifiedBuffer.Get(), &uavd, classifiedUav.GetAddressOf()));
+		}
+
+		if (!argsBuffer) {
+			D3D11_BUFFER_DESC bd;
+			bd.Usage = D3D11_USAGE_DEFAULT;
+			bd.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+			bd.CPUAccessFlags = 0;
+			bd.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+			bd.StructureByteStride = 0;
+			bd.ByteWidth = sizeof(INITIAL_DISPATCH_ARGS);
+			CheckResult("creating tile dispatch arguments buffer", device->CreateBuffer(&bd, nullptr, argsBuffer.GetAddressOf()));
+
+			D3D11_UNORDERED_ACCESS_VIEW_DESC uavd;
+			uavd.Format = DXGI_FORMAT_R32_TYPELESS;
+			uavd.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+			uavd.Buffer.FirstElement = 0;
+			uavd.Buffer.NumElements = std::size(INITIAL_DISPATCH_ARGS);
+			uavd.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+			CheckResult("creating tile dispatch arguments UAV", device->CreateUnorderedAccessView(argsBuffer.Get(), &uavd, argsUav.GetAddressOf()));
+
+			classifyConstants.reset(new D3D11ConstantBuffer(device, sizeof(ClassifyConstants)));
+		}
+
+		busyTilesView = CreateListView(classifiedBuffer.Get(), 0, fullCount);
+		flatTilesView = CreateListView(classifiedBuffer.Get(), fullCount, fullCount);
+	}
+
+	ComPtr<ID3D11ShaderResourceView> D3D11TileLists::CreateListView(ID3D11Buffer *listBuffer, uint32_t first, uint32_t count) {
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvd;
+		srvd.Format = DXGI_FORMAT_R32_UINT;
+		srvd.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvd.Buffer.FirstElement = first;
+		srvd.Buffer.NumElements = count;
+		ComPtr<ID3D11ShaderResourceView> view;
+		CheckResult("creating tile list view", device->CreateShaderResourceView(listBuffer, &srvd, view.GetAddressOf()));
+		return view;
+	}
+}
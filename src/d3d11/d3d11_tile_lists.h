@@ -0,0 +1,72 @@
+#pragma once
+#include "d3d11_constant_buffer.h"
+#include "d3d11_helper.h"
+#include "d3d11_post_processor.h"
+#include "d3d11_resource_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vrperfkit {
+	// Lists of the output tiles inside and outside of the foveation radius, so that the expensive and the
+	// cheap path can each be dispatched for exactly their tiles instead of every workgroup testing the radius
+	// and the two paths diverging within a wave. Tiles are packed as x | y << 12 | eye << 24, which the
+	// TILE_LIST shader permutations decode from their SV_GroupID.x.
+	// The lists only change with the output geometry and radius, so they are rebuilt on the CPU when those change.
+	// With a contrast threshold configured, the tiles inside the radius are additionally sorted on the GPU each
+	// frame by the luma range of their input, and the resulting lists are dispatched indirectly.
+	class D3D11TileLists {
+	public:
+		D3D11TileLists(ID3D11Device *device, D3D11ResourceCache &resources);
+
+		// classifies the tiles covering each eye's output viewport; returns false if all of them take the
+		// full path, in which case the full grid should be dispatched without any lists.
+		// Runs the contrast classification pass, so it must be called before the upscaler binds its resources.
+		bool Update(const D3D11PostProcessInput *inputs, const Viewport *outputViewports, int eyeCount, uint32_t tileWidth, uint32_t tileHeight, uint32_t features);
+
+		// dispatches one workgroup per listed tile, binding the respective list to the given SRV slot;
+		// without a cheap shader, the cheap and flat tiles are skipped
+		void Dispatch(UINT listSlot, ID3D11ComputeShader *fullShader, ID3D11ComputeShader *cheapShader);
+
+	private:
+		struct TileGrid {
+			uint32_t tilesX;
+			uint32_t tilesY;
+			uint32_t tileWidth;
+			uint32_t tileHeight;
+			uint32_t projCentre[2];
+			uint32_t squaredRadius;
+		};
+
+		ID3D11Device *device;
+		ComPtr<ID3D11DeviceContext> context;
+		D3D11ResourceCache &resources;
+		ComPtr<ID3D11Buffer> buffer;
+		ComPtr<ID3D11ShaderResourceView> fullTilesView;
+		ComPtr<ID3D11ShaderResourceView> cheapTilesView;
+		uint32_t capacity = 0;
+		uint32_t fullCount = 0;
+		uint32_t cheapCount = 0;
+
+		TileGrid grids[2] = {};
+		int gridCount = 0;
+		std::vector<uint32_t> tiles;
+
+		// busy tiles from the front, flat tiles from fullCount on, counted by the GPU into the dispatch arguments
+		ComPtr<ID3D11Buffer> classifiedBuffer;
+		ComPtr<ID3D11UnorderedAccessView> classifiedUav;
+		ComPtr<ID3D11ShaderResourceView> busyTilesView;
+		ComPtr<ID3D11ShaderResourceView> flatTilesView;
+		ComPtr<ID3D11Buffer> argsBuffer;
+		ComPtr<ID3D11UnorderedAccessView> argsUav;
+		std::unique_ptr<D3D11ConstantBuffer> classifyConstants;
+		uint32_t classifiedCapacity = 0;
+		bool classified = false;
+
+		void Rebuild();
+		void Classify(const D3D11PostProcessInput *inputs, const Viewport *outputViewports, int eyeCount);
+		void PrepareClassifiedLists();
+		ComPtr<ID3D11ShaderResourceView> CreateListView(ID3D11Buffer *listBuffer, uint32_t first, uint32_t count);
+	};
+}
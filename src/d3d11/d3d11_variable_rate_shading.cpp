@@ -17,7 +17,7 @@ namespace vrperfkit {
 	}
 
 	bool ResolutionMatches(int actualSize, int targetSize) {
-		return actualSize >= targetSize && actualSize <= targetSize + 2;
+		return actualSize >= targetSize && actualSize <= targetSize + g_config.ffr.targetSizeTolerance;
 	}
 
 	std::vector<uint8_t> CreateCombinedFixedFoveatedVRSPattern( int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY ) {
@@ -84,16 +84,19 @@ namespace vrperfkit {
 	}
 
 	void D3D11VariableRateShading::UpdateTargetInformation(int targetWidth, int targetHeight, TextureMode mode, float leftProjX, float leftProjY, float rightProjX, float rightProjY) {
-		this->targetWidth = targetWidth;
-		this->targetHeight = targetHeight;
-		this->targetMode = mode;
-		proj[0][0] = leftProjX;
-		proj[0][1] = leftProjY;
-		proj[1][0] = rightProjX;
-		proj[1][1] = rightProjY;
+		this->targetWidth.store(targetWidth, std::memory_order_relaxed);
+		this->targetHeight.store(targetHeight, std::memory_order_relaxed);
+		this->targetMode.store(mode, std::memory_order_relaxed);
+		proj[0][0].store(leftProjX, std::memory_order_relaxed);
+		proj[0][1].store(leftProjY, std::memory_order_relaxed);
+		proj[1][0].store(rightProjX, std::memory_order_relaxed);
+		proj[1][1].store(rightProjY, std::memory_order_relaxed);
 	}
 
 	void D3D11VariableRateShading::EndFrame() {
+		if (active) {
+			CreateRequestedPatterns();
+		}
 		if (currentSingleEyeRT > 0) {
 			if (currentSingleEyeRT != singleEyeOrder.size()) {
 				LOG_DEBUG << "Found " << currentSingleEyeRT << " single eye render targets in current frame";
@@ -123,10 +126,20 @@ namespace vrperfkit {
 		currentSingleEyeRT = 0;
 	}
 
-	void D3D11VariableRateShading::PostOMSetRenderTargets(UINT numViews, ID3D11RenderTargetView * const *renderTargetViews,
+	uint32_t D3D11VariableRateShading::EventInterest() {
+		bool wantEvents = active && g_config.ffr.enabled;
+		if (receivingEvents && !wantEvents) {
+			// we won't see the next render target changes anymore, so turn VRS off while we still can
+			DisableVRS(context.Get());
+		}
+		receivingEvents = wantEvents;
+		return wantEvents ? D3D11_EVENT_OM_SET_RENDER_TARGETS : 0;
+	}
+
+	void D3D11VariableRateShading::PostOMSetRenderTargets(ID3D11DeviceContext *context, UINT numViews, ID3D11RenderTargetView * const *renderTargetViews,
 			ID3D11DepthStencilView *depthStencilView) {
 		if (!active || numViews == 0 || renderTargetViews == nullptr || renderTargetViews[0] == nullptr || !g_config.ffr.enabled) {
-			DisableVRS();
+			DisableVRS(context);
 			return;
 		}
 
@@ -136,101 +149,222 @@ namespace vrperfkit {
 		renderTargetViews[0]->GetDesc( &rtd );
 		if (rtd.ViewDimension != D3D11_RTV_DIMENSION_TEXTURE2D && rtd.ViewDimension != D3D11_RTV_DIMENSION_TEXTURE2DARRAY
 				&& rtd.ViewDimension != D3D11_RTV_DIMENSION_TEXTURE2DMS && rtd.ViewDimension != D3D11_RTV_DIMENSION_TEXTURE2DMSARRAY) {
-			DisableVRS();
+			DisableVRS(context);
 			return;
 		}
 		ID3D11Texture2D *tex = (ID3D11Texture2D*)resource.Get();
 		D3D11_TEXTURE2D_DESC td;
 		tex->GetDesc( &td );
 
-		if (td.Width == td.Height) {
+		if (td.Width == td.Height && g_config.ffr.skipSquareTargets) {
 			// probably a shadow map or similar extra resources
-			DisableVRS();
+			DisableVRS(context);
 			return;
 		}
 
+		int targetWidth = this->targetWidth.load(std::memory_order_relaxed);
+		int targetHeight = this->targetHeight.load(std::memory_order_relaxed);
+		TextureMode targetMode = this->targetMode.load(std::memory_order_relaxed);
 		if (targetMode == TextureMode::SINGLE && ResolutionMatches(td.Width, 2 * targetWidth) && ResolutionMatches(td.Height, targetHeight)) {
-			ApplyCombinedVRS(td.Width, td.Height);
+			ApplyVRS(context, COMBINED_PATTERN, td.Width, td.Height);
 		}
 		else if (targetMode == TextureMode::COMBINED && ResolutionMatches(td.Width, targetWidth) && ResolutionMatches(td.Height, targetHeight)) {
-			ApplyCombinedVRS(td.Width, td.Height);
+			ApplyVRS(context, COMBINED_PATTERN, td.Width, td.Height);
 		}
 		else if (targetMode != TextureMode::COMBINED && td.ArraySize == 2 && ResolutionMatches(td.Width, targetWidth) && ResolutionMatches(td.Height, targetHeight)) {
-			ApplyArrayVRS(td.Width, td.Height);
+			ApplyVRS(context, ARRAY_PATTERN, td.Width, td.Height);
 		}
 		else if (targetMode == TextureMode::SINGLE && td.ArraySize == 1 && ResolutionMatches(td.Width, targetWidth) && ResolutionMatches(td.Height, targetHeight)) {
+			if (context->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED) {
+				// recording order on deferred contexts says nothing about execution order, so we can't tell the eyes apart
+				DisableVRS(context);
+				return;
+			}
 			if (currentSingleEyeRT < singleEyeOrder.size()) {
 				char eye = singleEyeOrder[currentSingleEyeRT];
 				switch (eye) {
 				case 'L':
 				case 'l':
-					ApplySingleEyeVRS(0, td.Width, td.Height);
+					ApplyVRS(context, LEFT_EYE_PATTERN, td.Width, td.Height);
 					break;
 				case 'R':
 				case 'r':
-					ApplySingleEyeVRS(1, td.Width, td.Height);
+					ApplyVRS(context, RIGHT_EYE_PATTERN, td.Width, td.Height);
 					break;
 				default:
-					DisableVRS();
+					DisableVRS(context);
 				}
 			}
 			else {
 				LOG_DEBUG << "VRS: Single eye target, don't know which eye";
-				DisableVRS();
+				DisableVRS(context);
 			}
 			++currentSingleEyeRT;
 		}
 		else {
-			DisableVRS();
+			DisableVRS(context);
 		}
 	}
 
-	void D3D11VariableRateShading::ApplyCombinedVRS(int width, int height) {
+	void D3D11VariableRateShading::ApplyVRS(ID3D11DeviceContext *context, PatternKind kind, int width, int height) {
 		if (!active)
 			return;
 
-		SetupCombinedVRS(width, height, proj[0][0], proj[0][1], proj[1][0], proj[1][1] );
-		NvAPI_Status status = NvAPI_D3D11_RSSetShadingRateResourceView( context.Get(), combinedVRSView.Get() );
+		int vrsWidth = width / NV_VARIABLE_PIXEL_SHADING_TILE_WIDTH;
+		int vrsHeight = height / NV_VARIABLE_PIXEL_SHADING_TILE_HEIGHT;
+		if (kind == COMBINED_PATTERN) {
+			if (vrsWidth & 1)
+				++vrsWidth;
+			if (vrsHeight & 1)
+				++vrsHeight;
+		}
+
+		ID3D11NvShadingRateResourceView *view = GetPattern(kind, vrsWidth, vrsHeight);
+		if (view == nullptr) {
+			// will be there from the next frame on
+			DisableVRS(context);
+			return;
+		}
+		NvAPI_Status status = NvAPI_D3D11_RSSetShadingRateResourceView( context, view );
 		if (status != NVAPI_OK) {
 			LOG_ERROR << "Error while setting shading rate resource view: " << status;
-			Shutdown();
+			Deactivate();
 			return;
 		}
 
-		EnableVRS();
+		EnableVRS(context);
 	}
 
-	void D3D11VariableRateShading::ApplyArrayVRS(int width, int height) {
-		if (!active)
-			return;
-
-		SetupArrayVRS( width, height, proj[0][0], proj[0][1], proj[1][0], proj[1][1] );
-		NvAPI_Status status = NvAPI_D3D11_RSSetShadingRateResourceView( context.Get(), arrayVRSView.Get() );
-		if (status != NVAPI_OK) {
-			LOG_ERROR << "Error while setting shading rate resource view: " << status;
-			Shutdown();
-			return;
+	ID3D11NvShadingRateResourceView * D3D11VariableRateShading::GetPattern(PatternKind kind, int vrsWidth, int vrsHeight) {
+		PatternSlot &slot = patternSlots[kind];
+		Pattern *pattern = slot.current.load(std::memory_order_acquire);
+		if (pattern != nullptr && pattern->width == vrsWidth && pattern->height == vrsHeight) {
+			return pattern->view.Get();
 		}
+		slot.requestedSize.store((vrsWidth << 16) | vrsHeight, std::memory_order_relaxed);
+		return nullptr;
+	}
 
-		EnableVRS();
+	void D3D11VariableRateShading::CreateRequestedPatterns() {
+		auto hasCurrentRadii = [](const Pattern &pattern) {
+			return pattern.radii[0] == g_config.ffr.innerRadius && pattern.radii[1] == g_config.ffr.midRadius && pattern.radii[2] == g_config.ffr.outerRadius;
+		};
+
+		for (int kind = 0; kind < PATTERN_KIND_COUNT; ++kind) {
+			PatternSlot &slot = patternSlots[kind];
+			uint32_t requestedSize = slot.requestedSize.exchange(0, std::memory_order_relaxed);
+			Pattern *current = slot.current.load(std::memory_order_relaxed);
+			if (requestedSize == 0 && current != nullptr && !hasCurrentRadii(*current)) {
+				requestedSize = (current->width << 16) | current->height;
+			}
+			if (requestedSize == 0) {
+				continue;
+			}
+			int vrsWidth = requestedSize >> 16;
+			int vrsHeight = requestedSize & 0xffff;
+
+			// render targets of slightly different sizes may take turns, so earlier patterns are reused
+			Pattern *pattern = nullptr;
+			for (auto &existing : slot.patterns) {
+				if (existing->width == vrsWidth && existing->height == vrsHeight && hasCurrentRadii(*existing)) {
+					pattern = existing.get();
+				}
+			}
+			if (pattern == nullptr) {
+				auto created = CreatePattern((PatternKind)kind, vrsWidth, vrsHeight);
+				if (created == nullptr) {
+					Deactivate();
+					return;
+				}
+				pattern = created.get();
+				slot.patterns.push_back(std::move(created));
+			}
+			slot.current.store(pattern, std::memory_order_release);
+		}
 	}
 
-	void D3D11VariableRateShading::ApplySingleEyeVRS(int eye, int width, int height) {
-		if (!active)
-			return;
+	std::unique_ptr<D3D11VariableRateShading::Pattern> D3D11VariableRateShading::CreatePattern(PatternKind kind, int vrsWidth, int vrsHeight) {
+		static const char *PATTERN_NAMES[PATTERN_KIND_COUNT] = { "left eye", "right eye", "combined", "array" };
+		LOG_INFO << "Creating " << PATTERN_NAMES[kind] << " VRS pattern texture of size " << vrsWidth << "x" << vrsHeight;
+
+		float leftProjX = proj[0][0].load(std::memory_order_relaxed);
+		float leftProjY = proj[0][1].load(std::memory_order_relaxed);
+		float rightProjX = proj[1][0].load(std::memory_order_relaxed);
+		float rightProjY = proj[1][1].load(std::memory_order_relaxed);
+
+		std::vector<uint8_t> data[2];
+		switch (kind) {
+		case LEFT_EYE_PATTERN:
+			data[0] = CreateSingleEyeFixedFoveatedVRSPattern(vrsWidth, vrsHeight, leftProjX, leftProjY);
+			break;
+		case RIGHT_EYE_PATTERN:
+			data[0] = CreateSingleEyeFixedFoveatedVRSPattern(vrsWidth, vrsHeight, rightProjX, rightProjY);
+			break;
+		case COMBINED_PATTERN:
+			data[0] = CreateCombinedFixedFoveatedVRSPattern(vrsWidth, vrsHeight, leftProjX, leftProjY, rightProjX, rightProjY);
+			break;
+		default:
+			// array rendering is most likely a new Unity engine game, which for some reason renders upside down.
+			// so we invert the y projection center coordinate to match the upside down render.
+			data[0] = CreateSingleEyeFixedFoveatedVRSPattern(vrsWidth, vrsHeight, leftProjX, 1.f - leftProjY);
+			data[1] = CreateSingleEyeFixedFoveatedVRSPattern(vrsWidth, vrsHeight, rightProjX, 1.f - rightProjY);
+			break;
+		}
+		int arraySize = kind == ARRAY_PATTERN ? 2 : 1;
 
-		SetupSingleEyeVRS( eye, width, height, proj[eye][0], proj[eye][1] );
-		NvAPI_Status status = NvAPI_D3D11_RSSetShadingRateResourceView( context.Get(), singleEyeVRSView[eye].Get() );
-		if (status != NVAPI_OK) {
-			LOG_ERROR << "Error while setting shading rate resource view: " << status;
-			Shutdown();
-			return;
+		D3D11_TEXTURE2D_DESC td = {};
+		td.Width = vrsWidth;
+		td.Height = vrsHeight;
+		td.ArraySize = arraySize;
+		td.Format = DXGI_FORMAT_R8_UINT;
+		td.SampleDesc.Count = 1;
+		td.SampleDesc.Quality = 0;
+		td.Usage = D3D11_USAGE_DEFAULT;
+		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		td.CPUAccessFlags = 0;
+		td.MiscFlags= 0;
+		td.MipLevels = 1;
+		D3D11_SUBRESOURCE_DATA srd[2];
+		for (int i = 0; i < arraySize; ++i) {
+			srd[i].pSysMem = data[i].data();
+			srd[i].SysMemPitch = vrsWidth;
+			srd[i].SysMemSlicePitch = 0;
+		}
+
+		std::unique_ptr<Pattern> pattern (new Pattern);
+		pattern->width = vrsWidth;
+		pattern->height = vrsHeight;
+		pattern->radii[0] = g_config.ffr.innerRadius;
+		pattern->radii[1] = g_config.ffr.midRadius;
+		pattern->radii[2] = g_config.ffr.outerRadius;
+		HRESULT result = device->CreateTexture2D( &td, srd, pattern->texture.GetAddressOf() );
+		if (FAILED(result)) {
+			LOG_ERROR << "Failed to create " << PATTERN_NAMES[kind] << " VRS pattern texture: " << std::hex << result << std::dec;
+			return nullptr;
 		}
 
-		EnableVRS();
+		NV_D3D11_SHADING_RATE_RESOURCE_VIEW_DESC vd = {};
+		vd.version = NV_D3D11_SHADING_RATE_RESOURCE_VIEW_DESC_VER;
+		vd.Format = td.Format;
+		if (kind == ARRAY_PATTERN) {
+			vd.ViewDimension = NV_SRRV_DIMENSION_TEXTURE2DARRAY;
+			vd.Texture2DArray.MipSlice = 0;
+			vd.Texture2DArray.ArraySize = 2;
+			vd.Texture2DArray.FirstArraySlice = 0;
+		}
+		else {
+			vd.ViewDimension = NV_SRRV_DIMENSION_TEXTURE2D;
+			vd.Texture2D.MipSlice = 0;
+		}
+		NvAPI_Status status = NvAPI_D3D11_CreateShadingRateResourceView( device.Get(), pattern->texture.Get(), &vd, pattern->view.GetAddressOf() );
+		if (status != NVAPI_OK) {
+			LOG_ERROR << "Failed to create " << PATTERN_NAMES[kind] << " VRS pattern view: " << status;
+			return nullptr;
+		}
+		return pattern;
 	}
 
-	void D3D11VariableRateShading::DisableVRS() {
+	void D3D11VariableRateShading::DisableVRS(ID3D11DeviceContext *context) {
 		if (!active)
 			return;
 
@@ -243,34 +377,34 @@ namespace vrperfkit {
 		srd.version = NV_D3D11_VIEWPORTS_SHADING_RATE_DESC_VER;
 		srd.numViewports = 2;
 		srd.pViewports = vsrd;
-		NvAPI_Status status = NvAPI_D3D11_RSSetViewportsPixelShadingRates( context.Get(), &srd );
+		NvAPI_Status status = NvAPI_D3D11_RSSetViewportsPixelShadingRates( context, &srd );
 		if (status != NVAPI_OK) {
 			LOG_ERROR << "Error while setting shading rates: " << status;
-			Shutdown();
+			Deactivate();
 		}
 	}
 
+	void D3D11VariableRateShading::Deactivate() {
+		active = false;
+	}
+
 	void D3D11VariableRateShading::Shutdown() {
-		DisableVRS();
+		DisableVRS(context.Get());
 
 		if (nvapiLoaded) {
 			NvAPI_Unload();
 		}
 		nvapiLoaded = false;
 		active = false;
-		for (int i = 0; i < 2; ++i) {
-			singleEyeVRSTex[i].Reset();
-			singleEyeVRSView[i].Reset();
+		for (auto &slot : patternSlots) {
+			slot.current = nullptr;
+			slot.patterns.clear();
 		}
-		combinedVRSTex.Reset();
-		combinedVRSView.Reset();
-		arrayVRSTex.Reset();
-		arrayVRSView.Reset();
 		device.Reset();
 		context.Reset();
 	}
 
-	void D3D11VariableRateShading::EnableVRS() {
+	void D3D11VariableRateShading::EnableVRS(ID3D11DeviceContext *context) {
 		NV_D3D11_VIEWPORT_SHADING_RATE_DESC vsrd[2];
 		for (int i = 0; i < 2; ++i) {
 			vsrd[i].enableVariablePixelShadingRate = true;
@@ -284,176 +418,10 @@ namespace vrperfkit {
 		srd.version = NV_D3D11_VIEWPORTS_SHADING_RATE_DESC_VER;
 		srd.numViewports = 2;
 		srd.pViewports = vsrd;
-		NvAPI_Status status = NvAPI_D3D11_RSSetViewportsPixelShadingRates( context.Get(), &srd );
+		NvAPI_Status status = NvAPI_D3D11_RSSetViewportsPixelShadingRates( context, &srd );
 		if (status != NVAPI_OK) {
 			LOG_ERROR << "Error while setting shading rates: " << status;
-			Shutdown();
-		}
-	}
-
-	void D3D11VariableRateShading::SetupSingleEyeVRS( int eye, int width, int height, float projX, float projY ) {
-		int vrsWidth = width / NV_VARIABLE_PIXEL_SHADING_TILE_WIDTH;
-		int vrsHeight = height / NV_VARIABLE_PIXEL_SHADING_TILE_HEIGHT;
-		if (!active || (singleEyeVRSTex[eye] && vrsWidth == singleWidth[eye] && vrsHeight == singleHeight[eye])) {
-			return;
-		}
-		singleEyeVRSTex[eye].Reset();
-		singleEyeVRSView[eye].Reset();
-
-		singleWidth[eye] = vrsWidth;
-		singleHeight[eye] = vrsHeight;
-
-		LOG_INFO << "Creating VRS pattern texture for eye " << eye << " of size " << vrsWidth << "x" << vrsHeight;
-
-		D3D11_TEXTURE2D_DESC td = {};
-		td.Width = vrsWidth;
-		td.Height = vrsHeight;
-		td.ArraySize = 1;
-		td.Format = DXGI_FORMAT_R8_UINT;
-		td.SampleDesc.Count = 1;
-		td.SampleDesc.Quality = 0;
-		td.Usage = D3D11_USAGE_DEFAULT;
-		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-		td.CPUAccessFlags = 0;
-		td.MiscFlags= 0;
-		td.MipLevels = 1;
-		auto data = CreateSingleEyeFixedFoveatedVRSPattern(vrsWidth, vrsHeight, projX, projY);
-		D3D11_SUBRESOURCE_DATA srd;
-		srd.pSysMem = data.data();
-		srd.SysMemPitch = vrsWidth;
-		srd.SysMemSlicePitch = 0;
-		HRESULT result = device->CreateTexture2D( &td, &srd, singleEyeVRSTex[eye].GetAddressOf() );
-		if (FAILED(result)) {
-			Shutdown();
-			LOG_ERROR << "Failed to create VRS pattern texture for eye " << eye << ": " << std::hex << result << std::dec;
-			return;
-		}
-
-		LOG_INFO << "Creating shading rate resource view for eye " << eye;
-		NV_D3D11_SHADING_RATE_RESOURCE_VIEW_DESC vd = {};
-		vd.version = NV_D3D11_SHADING_RATE_RESOURCE_VIEW_DESC_VER;
-		vd.Format = td.Format;
-		vd.ViewDimension = NV_SRRV_DIMENSION_TEXTURE2D;
-		vd.Texture2D.MipSlice = 0;
-		NvAPI_Status status = NvAPI_D3D11_CreateShadingRateResourceView( device.Get(), singleEyeVRSTex[eye].Get(), &vd, singleEyeVRSView[eye].GetAddressOf() );
-		if (status != NVAPI_OK) {
-			Shutdown();
-			LOG_ERROR << "Failed to create VRS pattern view for eye " << eye << ": " << status;
-			return;
-		}
-	}
-
-	void D3D11VariableRateShading::SetupCombinedVRS( int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY ) {
-		int vrsWidth = width / NV_VARIABLE_PIXEL_SHADING_TILE_WIDTH;
-		if (vrsWidth & 1)
-			++vrsWidth;
-		int vrsHeight = height / NV_VARIABLE_PIXEL_SHADING_TILE_HEIGHT;
-		if (vrsHeight & 1)
-			++vrsHeight;
-		if (!active || (combinedVRSTex && vrsWidth == combinedWidth && vrsHeight == combinedHeight)) {
-			return;
-		}
-
-		combinedVRSTex.Reset();
-		combinedVRSView.Reset();
-
-		combinedWidth = vrsWidth;
-		combinedHeight = vrsHeight;
-
-		LOG_INFO << "Creating combined VRS pattern texture of size " << vrsWidth << "x" << vrsHeight << " for input texture size " << width << "x" << height;
-
-		D3D11_TEXTURE2D_DESC td = {};
-		td.Width = vrsWidth;
-		td.Height = vrsHeight;
-		td.ArraySize = 1;
-		td.Format = DXGI_FORMAT_R8_UINT;
-		td.SampleDesc.Count = 1;
-		td.SampleDesc.Quality = 0;
-		td.Usage = D3D11_USAGE_DEFAULT;
-		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-		td.CPUAccessFlags = 0;
-		td.MiscFlags= 0;
-		td.MipLevels = 1;
-		auto data = CreateCombinedFixedFoveatedVRSPattern(vrsWidth, vrsHeight, leftProjX, leftProjY, rightProjX, rightProjY);
-		D3D11_SUBRESOURCE_DATA srd;
-		srd.pSysMem = data.data();
-		srd.SysMemPitch = vrsWidth;
-		srd.SysMemSlicePitch = 0;
-		HRESULT result = device->CreateTexture2D( &td, &srd, combinedVRSTex.GetAddressOf() );
-		if (FAILED(result)) {
-			Shutdown();
-			LOG_ERROR << "Failed to create combined VRS pattern texture: " << std::hex << result << std::dec;
-			return;
-		}
-
-		LOG_INFO << "Creating combined shading rate resource view";
-		NV_D3D11_SHADING_RATE_RESOURCE_VIEW_DESC vd = {};
-		vd.version = NV_D3D11_SHADING_RATE_RESOURCE_VIEW_DESC_VER;
-		vd.Format = td.Format;
-		vd.ViewDimension = NV_SRRV_DIMENSION_TEXTURE2D;
-		vd.Texture2D.MipSlice = 0;
-		NvAPI_Status status = NvAPI_D3D11_CreateShadingRateResourceView( device.Get(), combinedVRSTex.Get(), &vd, combinedVRSView.GetAddressOf() );
-		if (status != NVAPI_OK) {
-			Shutdown();
-			LOG_ERROR << "Failed to create combined VRS pattern view: " << status;
-			return;
+			Deactivate();
 		}
 	}
-
-	void D3D11VariableRateShading::SetupArrayVRS( int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY ) {
-		int vrsWidth = width / NV_VARIABLE_PIXEL_SHADING_TILE_WIDTH;
-		int vrsHeight = height / NV_VARIABLE_PIXEL_SHADING_TILE_HEIGHT;
-		if (!active || (arrayVRSTex && vrsWidth == arrayWidth && vrsHeight == arrayHeight)) {
-			return;
-		}
-		arrayVRSTex.Reset();
-		arrayVRSView.Reset();
-
-		arrayWidth = vrsWidth;
-		arrayHeight = vrsHeight;
-
-		LOG_INFO << "Creating array VRS pattern texture of size " << vrsWidth << "x" << vrsHeight;
-
-		D3D11_TEXTURE2D_DESC td = {};
-		td.Width = vrsWidth;
-		td.Height = vrsHeight;
-		td.ArraySize = 2;
-		td.Format = DXGI_FORMAT_R8_UINT;
-		td.SampleDesc.Count = 1;
-		td.SampleDesc.Quality = 0;
-		td.Usage = D3D11_USAGE_DEFAULT;
-		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-		td.CPUAccessFlags = 0;
-		td.MiscFlags= 0;
-		td.MipLevels = 1;
-		HRESULT result = device->CreateTexture2D( &td, nullptr, arrayVRSTex.GetAddressOf() );
-		if (FAILED(result)) {
-			Shutdown();
-			LOG_ERROR << "Failed to create array VRS pattern texture: " << std::hex << result << std::dec;
-			return;
-		}
-
-		// array rendering is most likely a new Unity engine game, which for some reason renders upside down.
-		// so we invert the y projection center coordinate to match the upside down render.
-		auto data = CreateSingleEyeFixedFoveatedVRSPattern( vrsWidth, vrsHeight, leftProjX, 1.f - leftProjY );
-		context->UpdateSubresource( arrayVRSTex.Get(), D3D11CalcSubresource( 0, 0, 1 ), nullptr, data.data(), vrsWidth, 0 );
-		data = CreateSingleEyeFixedFoveatedVRSPattern( vrsWidth, vrsHeight, rightProjX, 1.f - rightProjY );
-		context->UpdateSubresource( arrayVRSTex.Get(), D3D11CalcSubresource( 0, 1, 1 ), nullptr, data.data(), vrsWidth, 0 );
-
-		LOG_INFO << "Creating array shading rate resource view";
-		NV_D3D11_SHADING_RATE_RESOURCE_VIEW_DESC vd = {};
-		vd.version = NV_D3D11_SHADING_RATE_RESOURCE_VIEW_DESC_VER;
-		vd.Format = td.Format;
-		vd.ViewDimension = NV_SRRV_DIMENSION_TEXTURE2DARRAY;
-		vd.Texture2DArray.MipSlice = 0;
-		vd.Texture2DArray.ArraySize = 2;
-		vd.Texture2DArray.FirstArraySlice = 0;
-		NvAPI_Status status = NvAPI_D3D11_CreateShadingRateResourceView( device.Get(), arrayVRSTex.Get(), &vd, arrayVRSView.GetAddressOf() );
-		if (status != NVAPI_OK) {
-			Shutdown();
-			LOG_ERROR << "Failed to create array VRS pattern view: " << status;
-			return;
-		}
-	}
-
 }
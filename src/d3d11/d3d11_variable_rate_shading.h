@@ -3,6 +3,10 @@
 #include "d3d11_injector.h"
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
 #include "nvapi.h"
 #include "types.h"
 
@@ -17,45 +21,66 @@ namespace vrperfkit {
 		void UpdateTargetInformation(int targetWidth, int targetHeight, TextureMode mode, float leftProjX, float leftProjY, float rightProjX, float rightProjY);
 		void EndFrame();
 
-		void PostOMSetRenderTargets(UINT numViews, ID3D11RenderTargetView * const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) override;
+		uint32_t EventInterest() override;
+		void PostOMSetRenderTargets(ID3D11DeviceContext *context, UINT numViews, ID3D11RenderTargetView * const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) override;
 
 	private:
+		// Render targets may be bound concurrently from threads recording deferred contexts, so the hooks only read
+		// state that is published atomically. Anything that needs creating is left to the render thread.
 		bool nvapiLoaded = false;
-		bool active = false;
+		std::atomic_bool active = false;
+		bool receivingEvents = false;
 
-		int targetWidth = 1000000;
-		int targetHeight = 1000000;
-		TextureMode targetMode = TextureMode::SINGLE;
-		float proj[2][2] = { 0, 0, 0, 0 };
+		std::atomic_int targetWidth = 1000000;
+		std::atomic_int targetHeight = 1000000;
+		std::atomic<TextureMode> targetMode = TextureMode::SINGLE;
+		std::atomic<float> proj[2][2] = {};
 
 		ComPtr<ID3D11Device> device;
 		ComPtr<ID3D11DeviceContext> context;
-		int singleWidth[2] = { 0, 0 };
-		int singleHeight[2] = { 0, 0 };
-		ComPtr<ID3D11Texture2D> singleEyeVRSTex[2];
-		ComPtr<ID3D11NvShadingRateResourceView> singleEyeVRSView[2];
+
+		enum PatternKind {
+			LEFT_EYE_PATTERN,
+			RIGHT_EYE_PATTERN,
+			COMBINED_PATTERN,
+			ARRAY_PATTERN,
+			PATTERN_KIND_COUNT,
+		};
+
+		struct Pattern {
+			int width;
+			int height;
+			// the radii may be changed at runtime, which needs new patterns
+			float radii[3];
+			ComPtr<ID3D11Texture2D> texture;
+			ComPtr<ID3D11NvShadingRateResourceView> view;
+		};
+
+		// The hooks request a pattern size when they find a render target without a matching pattern, which
+		// EndFrame then creates. Replaced patterns are kept until shutdown, as a hook may still be using them.
+		struct PatternSlot {
+			std::atomic<Pattern*> current = nullptr;
+			std::atomic_uint32_t requestedSize = 0;
+			std::vector<std::unique_ptr<Pattern>> patterns;
+		};
+		PatternSlot patternSlots[PATTERN_KIND_COUNT];
+
+		// single eye targets can only be told apart on the immediate context. The game must not use that from
+		// several threads at once, and EndFrame runs during the submit on it, so these need no synchronization.
 		std::string singleEyeOrder;
 		int currentSingleEyeRT = 0;
-		int combinedWidth = 0;
-		int combinedHeight = 0;
-		ComPtr<ID3D11Texture2D> combinedVRSTex;
-		ComPtr<ID3D11NvShadingRateResourceView> combinedVRSView;
-		int arrayWidth = 0;
-		int arrayHeight = 0;
-		ComPtr<ID3D11Texture2D> arrayVRSTex;
-		ComPtr<ID3D11NvShadingRateResourceView> arrayVRSView;
 
 		void Shutdown();
+		// stops using VRS after an error; resources are only released on destruction, since other threads may still use them
+		void Deactivate();
 
-		void EnableVRS();
-		void DisableVRS();
-
-		void ApplyCombinedVRS(int width, int height);
-		void ApplyArrayVRS(int width, int height);
-		void ApplySingleEyeVRS(int eye, int width, int height);
+		void EnableVRS(ID3D11DeviceContext *context);
+		void DisableVRS(ID3D11DeviceContext *context);
 
-		void SetupSingleEyeVRS(int eye, int width, int height, float projX, float projY);
-		void SetupCombinedVRS(int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY);
-		void SetupArrayVRS(int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY);
+		void ApplyVRS(ID3D11DeviceContext *context, PatternKind kind, int vrsWidth, int vrsHeight);
+		// the pattern view for the given size if it exists, otherwise requests it for the next frame
+		ID3D11NvShadingRateResourceView * GetPattern(PatternKind kind, int vrsWidth, int vrsHeight);
+		void CreateRequestedPatterns();
+		std::unique_ptr<Pattern> CreatePattern(PatternKind kind, int vrsWidth, int vrsHeight);
 	};
 }
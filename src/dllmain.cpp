@@ -1,12 +1,17 @@
 #include "config.h"
+#include "control_server.h"
 #include "logging.h"
 #include "win_header_sane.h"
 #include "hooks.h"
 #include "hotkeys.h"
+#include "profiles.h"
+#include "startup.h"
 #include "oculus/oculus_hooks.h"
 #include "oculus/oculus_manager.h"
 #include "openvr/openvr_hooks.h"
+#include <atomic>
 #include <mutex>
+#include <yaml-cpp/yaml.h>
 
 namespace fs = std::filesystem;
 
@@ -21,97 +26,274 @@ namespace vrperfkit {
 		return GetModuleFileNameW(module, buf, ARRAYSIZE(buf)) ? buf : fs::path();
 	}
 
-	void InstallD3D11Hooks();
-	void InstallDXGIHooks();
+	bool InstallD3D11Hooks();
+	bool InstallDXGIHooks();
 }
 
 namespace {
 	std::mutex g_hookInstallMutex;
 
+	std::once_flag g_initOnce;
+	std::atomic_bool g_initialized = false;
+	// set while the deferred init is running, so that LoadLibrary calls it triggers do not re-enter it
+	thread_local bool g_initializing = false;
+
+	LARGE_INTEGER g_attachTime;
+	float g_attachDurationMs = 0;
+
+	float MillisecondsBetween(const LARGE_INTEGER &start, const LARGE_INTEGER &end) {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return 1000.f * (end.QuadPart - start.QuadPart) / frequency.QuadPart;
+	}
+
+	float MillisecondsSince(const LARGE_INTEGER &start) {
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		return MillisecondsBetween(start, now);
+	}
+
+	enum HookedSubsystem : uint32_t {
+		HOOKED_OPENVR = 1 << 0,
+		HOOKED_OCULUS = 1 << 1,
+		HOOKED_D3D11 = 1 << 2,
+		HOOKED_DXGI = 1 << 3,
+	};
+	std::atomic_uint32_t g_hookedSubsystems = 0;
+
+	const uint32_t HOOKED_ALL = HOOKED_OPENVR | HOOKED_OCULUS | HOOKED_D3D11 | HOOKED_DXGI;
+
+	// Hooking the one VR runtime does not make the other one irrelevant: Unity and Unreal games load
+	// LibOVRRT first and fall back to SteamVR's vrclient if there is no Oculus runtime. So each runtime
+	// counts on its own, and until both are hooked, target module loads keep being checked for.
+	bool IsHookingComplete(uint32_t hooked) {
+		return (hooked & HOOKED_ALL) == HOOKED_ALL;
+	}
+
+	// the modules whose presence lets the respective Install*Hooks call succeed
+	struct TargetModule {
+		uint32_t subsystem;
+		const wchar_t *name;
+	};
+	const TargetModule g_targetModules[] = {
+#ifdef WIN64
+		{ HOOKED_OPENVR, L"vrclient_x64.dll" },
+		{ HOOKED_OCULUS, L"LibOVRRT64_1.dll" },
+		{ HOOKED_OCULUS, L"VirtualDesktop.LibOVRRT64_1.dll" },
+		{ HOOKED_OCULUS, L"LibPVRRT64_1_X.dll" },
+#else
+		{ HOOKED_OPENVR, L"vrclient.dll" },
+		{ HOOKED_OCULUS, L"LibOVRRT32_1.dll" },
+		{ HOOKED_OCULUS, L"VirtualDesktop.LibOVRRT32_1.dll" },
+		{ HOOKED_OCULUS, L"LibPVRRT32_1_X.dll" },
+#endif
+		{ HOOKED_D3D11, L"d3d11.dll" },
+		{ HOOKED_DXGI, L"dxgi.dll" },
+	};
+
+	// catches target modules that were pulled in as imports of whatever module was actually requested
+	bool IsTargetModuleLoaded(uint32_t hooked) {
+		for (const TargetModule &module : g_targetModules) {
+			if (!(hooked & module.subsystem) && GetModuleHandleW(module.name) != nullptr) {
+				return true;
+			}
+		}
+		return false;
+	}
+
 	void InstallVrHooks() {
+		if (IsHookingComplete(g_hookedSubsystems.load(std::memory_order_acquire))) {
+			return;
+		}
+
 		std::lock_guard<std::mutex> lock (g_hookInstallMutex);
-		vrperfkit::InstallOpenVrHooks();
-		vrperfkit::InstallOculusHooks();
-		vrperfkit::InstallD3D11Hooks();
-		vrperfkit::InstallDXGIHooks();
+		uint32_t hooked = g_hookedSubsystems.load(std::memory_order_relaxed);
+		if (!(hooked & HOOKED_OPENVR) && vrperfkit::InstallOpenVrHooks()) {
+			hooked |= HOOKED_OPENVR;
+		}
+		if (!(hooked & HOOKED_OCULUS) && vrperfkit::InstallOculusHooks()) {
+			hooked |= HOOKED_OCULUS;
+		}
+		if (!(hooked & HOOKED_D3D11) && vrperfkit::InstallD3D11Hooks()) {
+			hooked |= HOOKED_D3D11;
+		}
+		if (!(hooked & HOOKED_DXGI) && vrperfkit::InstallDXGIHooks()) {
+			hooked |= HOOKED_DXGI;
+		}
+		g_hookedSubsystems.store(hooked, std::memory_order_release);
+	}
+
+	template<typename Char>
+	bool StartsWithIgnoreCase(const Char *str, const char *prefix) {
+		for (; *prefix; ++str, ++prefix) {
+			Char c = *str;
+			if (c >= 'A' && c <= 'Z') {
+				c += 'a' - 'A';
+			}
+			if (c != *prefix) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// only the VR runtimes and the graphics DLLs are of interest to us; everything else the game
+	// loads (plugins, codecs, ...) can skip the module lookups entirely
+	template<typename Char>
+	bool IsModuleOfInterest(const Char *fileName) {
+		if (fileName == nullptr) {
+			return false;
+		}
+
+		const Char *baseName = fileName;
+		for (const Char *c = fileName; *c; ++c) {
+			if (*c == '\\' || *c == '/') {
+				baseName = c + 1;
+			}
+		}
+
+		static const char *prefixes[] = { "vrclient", "libovrrt", "virtualdesktop.libovrrt", "libpvrrt", "d3d11", "dxgi" };
+		for (const char *prefix : prefixes) {
+			if (StartsWithIgnoreCase(baseName, prefix)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template<typename Char>
+	void OnLibraryLoaded(const Char *fileName) {
+		uint32_t hooked = g_hookedSubsystems.load(std::memory_order_acquire);
+		if (IsHookingComplete(hooked) || (!IsModuleOfInterest(fileName) && !IsTargetModuleLoaded(hooked))) {
+			return;
+		}
+		InstallVrHooks();
 	}
 
 	HMODULE WINAPI Hook_LoadLibraryA(LPCSTR lpFileName) {
-		HMODULE handle = vrperfkit::hooks::CallOriginal(Hook_LoadLibraryA)(lpFileName);
+		HMODULE handle = vrperfkit::hooks::CallOriginal<Hook_LoadLibraryA>()(lpFileName);
 
 		if (handle != nullptr && handle != vrperfkit::g_moduleSelf) {
+			vrperfkit::EnsureInitialized();
 			LOG_DEBUG << "LoadLibraryA(" << lpFileName << ")";
-			InstallVrHooks();
+			OnLibraryLoaded(lpFileName);
 		}
 
 		return handle;
 	}
 
 	HMODULE WINAPI Hook_LoadLibraryExA(LPCSTR lpFileName, HANDLE hFile, DWORD dwFlags) {
-		HMODULE handle = vrperfkit::hooks::CallOriginal(Hook_LoadLibraryExA)(lpFileName, hFile, dwFlags);
+		HMODULE handle = vrperfkit::hooks::CallOriginal<Hook_LoadLibraryExA>()(lpFileName, hFile, dwFlags);
 
 		if (handle != nullptr && handle != vrperfkit::g_moduleSelf && (dwFlags & (LOAD_LIBRARY_AS_DATAFILE | LOAD_LIBRARY_AS_DATAFILE_EXCLUSIVE | LOAD_LIBRARY_AS_IMAGE_RESOURCE)) == 0) {
+			vrperfkit::EnsureInitialized();
 			LOG_DEBUG << "LoadLibraryExA(" << lpFileName << ")";
-			InstallVrHooks();
+			OnLibraryLoaded(lpFileName);
 		}
 
 		return handle;
 	}
 
 	HMODULE WINAPI Hook_LoadLibraryW(LPCWSTR lpFileName) {
-		HMODULE handle = vrperfkit::hooks::CallOriginal(Hook_LoadLibraryW)(lpFileName);
+		HMODULE handle = vrperfkit::hooks::CallOriginal<Hook_LoadLibraryW>()(lpFileName);
 
 		if (handle != nullptr && handle != vrperfkit::g_moduleSelf) {
+			vrperfkit::EnsureInitialized();
 			LOG_DEBUG << "LoadLibraryW(" << lpFileName << ")";
-			InstallVrHooks();
+			OnLibraryLoaded(lpFileName);
 		}
 
 		return handle;
 	}
 
 	HMODULE WINAPI Hook_LoadLibraryExW(LPCWSTR lpFileName, HANDLE hFile, DWORD dwFlags) {
-		HMODULE handle = vrperfkit::hooks::CallOriginal(Hook_LoadLibraryExW)(lpFileName, hFile, dwFlags);
+		HMODULE handle = vrperfkit::hooks::CallOriginal<Hook_LoadLibraryExW>()(lpFileName, hFile, dwFlags);
 
 		if (handle != nullptr && handle != vrperfkit::g_moduleSelf && (dwFlags & (LOAD_LIBRARY_AS_DATAFILE | LOAD_LIBRARY_AS_DATAFILE_EXCLUSIVE | LOAD_LIBRARY_AS_IMAGE_RESOURCE)) == 0) {
+			vrperfkit::EnsureInitialized();
 			LOG_DEBUG << "LoadLibraryExW(" << lpFileName << ")";
-			InstallVrHooks();
+			OnLibraryLoaded(lpFileName);
 		}
 
 		return handle;
 	}
 
+	// runs under the loader lock, so only do the bare minimum needed to get control back later
 	void InitVrPerfkit(HMODULE module) {
+		QueryPerformanceCounter(&g_attachTime);
 		vrperfkit::g_moduleSelf = module;
 		vrperfkit::g_dllPath = vrperfkit::GetModulePath(module);
 		vrperfkit::g_basePath = vrperfkit::g_dllPath.parent_path();
 		vrperfkit::g_executablePath = vrperfkit::GetModulePath(nullptr);
 
+		// the log is not open yet, so anything the hook installation logs here is lost
+		vrperfkit::hooks::Init();
+		vrperfkit::hooks::InstallHook<Hook_LoadLibraryA>("LoadLibraryA", (void*)&LoadLibraryA);
+		vrperfkit::hooks::InstallHook<Hook_LoadLibraryExA>("LoadLibraryExA", (void*)&LoadLibraryExA);
+		vrperfkit::hooks::InstallHook<Hook_LoadLibraryW>("LoadLibraryW", (void*)LoadLibraryW);
+		vrperfkit::hooks::InstallHook<Hook_LoadLibraryExW>("LoadLibraryExW", (void*)&LoadLibraryExW);
+		g_attachDurationMs = MillisecondsSince(g_attachTime);
+	}
+
+	void DeferredInit() {
+		LARGE_INTEGER initStart;
+		QueryPerformanceCounter(&initStart);
+
 		vrperfkit::OpenLogFile(vrperfkit::g_basePath / "vrperfkit.log");
 		LOG_INFO << "======================";
 		LOG_INFO << "VR Performance Toolkit";
 		LOG_INFO << "======================\n";
 
-		vrperfkit::LoadConfig(vrperfkit::g_basePath / "vrperfkit.yml");
-		vrperfkit::LoadHotkeys(vrperfkit::g_basePath / "vrperfkit.yml");
+		YAML::Node cfg = vrperfkit::LoadConfigFile(vrperfkit::g_basePath / "vrperfkit.yml");
+		vrperfkit::LoadConfig(cfg);
+		if (!vrperfkit::g_config.profileDatabase.empty()) {
+			// relative paths are resolved against the DLL's directory; absolute paths replace it entirely
+			vrperfkit::ApplyApplicationProfile(vrperfkit::g_basePath / vrperfkit::g_config.profileDatabase, vrperfkit::g_executablePath);
+		}
+		vrperfkit::LoadHotkeys(cfg);
 		vrperfkit::PrintCurrentConfig();
 		vrperfkit::PrintHotkeys();
 
-		vrperfkit::hooks::Init();
-		vrperfkit::hooks::InstallHook("LoadLibraryA", (void*)&LoadLibraryA, (void*)&Hook_LoadLibraryA);
-		vrperfkit::hooks::InstallHook("LoadLibraryExA", (void*)&LoadLibraryExA, (void*)&Hook_LoadLibraryExA);
-		vrperfkit::hooks::InstallHook("LoadLibraryW", (void*)LoadLibraryW, (void*)Hook_LoadLibraryW);
-		vrperfkit::hooks::InstallHook("LoadLibraryExW", (void*)&LoadLibraryExW, (void*)&Hook_LoadLibraryExW);
 		InstallVrHooks();
+
+		vrperfkit::StartHotkeyPolling();
+		vrperfkit::StartControlServer();
+
+		LOG_INFO << "Startup: DLL attach took " << g_attachDurationMs << " ms, deferred init started "
+			<< MillisecondsBetween(g_attachTime, initStart) << " ms after attach and took "
+			<< MillisecondsSince(initStart) << " ms";
 	}
 
 	void ShutdownVrPerfkit() {
+		if (!g_initialized) {
+			vrperfkit::hooks::Shutdown();
+			return;
+		}
+
 		LOG_INFO << "Shutting down\n";
+		vrperfkit::StopHotkeyPolling();
+		vrperfkit::StopControlServer();
 		vrperfkit::g_oculus.Shutdown();
 		vrperfkit::hooks::Shutdown();
 		vrperfkit::FlushLog();
 	}
 }
 
+namespace vrperfkit {
+	void EnsureInitialized() {
+		if (g_initialized.load(std::memory_order_acquire) || g_initializing) {
+			return;
+		}
+
+		std::call_once(g_initOnce, []() {
+			g_initializing = true;
+			DeferredInit();
+			g_initializing = false;
+			g_initialized = true;
+		});
+	}
+}
+
 BOOL WINAPI DllMain(HMODULE module, DWORD reason, LPVOID) {
 	switch (reason) {
 	case DLL_PROCESS_ATTACH:
@@ -0,0 +1,367 @@
+// permutation defines, see add_shader_permutations in CMakeLists.txt
+#ifndef TILE_LIST
+#define TILE_LIST 0
+#endif
+#ifndef BILINEAR_ONLY
+#define BILINEAR_ONLY 0
+#endif
+#ifndef DEBUG_OVERLAY
+#define DEBUG_OVERLAY 0
+#endif
+#ifndef MSAA_INPUT
+#define MSAA_INPUT 0
+#endif
+#ifndef HDR_INPUT
+#define HDR_INPUT 0
+#endif
+#ifndef HALF_PRECISION
+#define HALF_PRECISION 0
+#endif
+#ifndef LUMA_ONLY
+#define LUMA_ONLY 0
+#endif
+
+#define A_GPU 1
+#define A_HLSL 1
+#if HALF_PRECISION
+#define A_HALF
+#define FSR_EASU_H 1
+#define FSR_RCAS_H 1
+#if LUMA_ONLY
+// for FsrEasuSetF, which the single-channel EASU below shares
+#define FSR_EASU_F 1
+#endif
+#else
+#define FSR_EASU_F 1
+#define FSR_RCAS_F 1
+#endif
+
+#include "ffx_a.h"
+
+struct EyeConstants {
+	uint4 Const0;
+	uint4 Const1;
+	uint4 Const2;
+	uint4 Const3; // store output offset in final 2
+	uint4 RcasConst; // store output viewport size in final 2
+	uint2 Centre;
+	uint  SquaredRadius;
+	uint  Padding;
+};
+
+// both eyes can be processed in one dispatch, the Z group index selects the eye
+cbuffer cb : register(b0) {
+	EyeConstants Eyes[2];
+};
+
+static uint4 Const0;
+static uint4 Const1;
+static uint4 Const2;
+static uint4 Const3;
+static uint4 RcasConst;
+static uint2 Centre;
+static uint SquaredRadius;
+
+SamplerState samLinearClamp : register(s0);
+#if MSAA_INPUT
+Texture2DMS<AF4> InputTexture : register(t0);
+#else
+Texture2D<AF4> InputTexture : register(t0);
+#endif
+RWTexture2D<AF4> OutputTexture: register(u0);
+
+#if TILE_LIST
+// the workgroups' tiles, packed as x | y << 12 | eye << 24
+Buffer<uint> TileList : register(t1);
+#endif
+
+#define TILE_SIZE 16
+#define APRON_TILE_SIZE (TILE_SIZE + 2)
+
+// EASU output for the workgroup's tile plus a 1 pixel apron, so that RCAS can run
+// on it directly instead of going through a full-resolution intermediate texture
+groupshared AF3 UpscaledTile[APRON_TILE_SIZE * APRON_TILE_SIZE];
+static AU2 TileOrigin;
+
+#include "../hdr/hdr_filter.h"
+#if MSAA_INPUT
+#include "fsr_msaa.h"
+#endif
+
+#if LUMA_ONLY
+// EASU and RCAS only filter luma, chroma is sampled bilinearly. Instead of three gathers per EASU tap,
+// the input texels the tile is reconstructed from are converted to luma once, up front.
+// The region covers the taps of 18 output pixels at up to 1:1 scale, from 2 texels before to 3 after.
+#define LUMA_REGION_SIZE 26
+groupshared AF1 LumaRegion[LUMA_REGION_SIZE * LUMA_REGION_SIZE];
+static ASU2 LumaOrigin;
+
+AF3 RgbToYCoCg(AF3 c) { return AF3(0.25 * c.r + 0.5 * c.g + 0.25 * c.b, 0.5 * c.r - 0.5 * c.b, -0.25 * c.r + 0.5 * c.g - 0.25 * c.b); }
+AF3 YCoCgToRgb(AF3 c) { AF1 t = c.x - c.z; return AF3(t + c.y, c.x + c.z, t - c.y); }
+
+void LoadLumaRegion(uint localIndex) {
+	int2 firstPos = max(int2(TileOrigin) - 1, int2(0, 0));
+	LumaOrigin = ASU2(floor(AF2(firstPos) * AF2_AU2(Const0.xy) + AF2_AU2(Const0.zw))) - 2;
+	for (uint i = localIndex; i < LUMA_REGION_SIZE * LUMA_REGION_SIZE; i += 64) {
+		ASU2 p = LumaOrigin + ASU2(i % LUMA_REGION_SIZE, i / LUMA_REGION_SIZE);
+#if MSAA_INPUT
+		AF3 c = LoadResolved(p);
+#else
+		uint width, height;
+		InputTexture.GetDimensions(width, height);
+		AF3 c = InputTexture.Load(int3(clamp(p, ASU2(0, 0), ASU2(width, height) - 1), 0)).rgb;
+#endif
+		LumaRegion[i] = RgbToYCoCg(HdrToFilter(c)).x;
+	}
+}
+
+AF1 LumaAt(ASU2 p) {
+	p = clamp(p, ASU2(0, 0), ASU2(LUMA_REGION_SIZE - 1, LUMA_REGION_SIZE - 1));
+	return LumaRegion[p.y * LUMA_REGION_SIZE + p.x];
+}
+
+// equivalent of Gather* on the luma region: (-,+), (+,+), (+,-), (-,-) texels around p
+AF4 GatherLuma(AF2 p) {
+	ASU2 base = ASU2(floor(p * rcp(AF2_AU2(Const1.xy)) - 0.5)) - LumaOrigin;
+	return AF4(LumaAt(base + ASU2(0, 1)), LumaAt(base + ASU2(1, 1)), LumaAt(base + ASU2(1, 0)), LumaAt(base));
+}
+#endif
+
+#if LUMA_ONLY
+// FsrEasuF is not used with luma only, see FsrEasuLumaF, but it is compiled for FsrEasuSetF
+AF4 FsrEasuRF(AF2 p) { return GatherLuma(p); }
+AF4 FsrEasuGF(AF2 p) { return GatherLuma(p); }
+AF4 FsrEasuBF(AF2 p) { return GatherLuma(p); }
+#elif MSAA_INPUT
+// EASU asks for the channels of each footprint one after the other, so resolve the footprint once for all three
+static AF2 ResolvedPos = AF2(-1, -1);
+static AF4 ResolvedR, ResolvedG, ResolvedB;
+AF4 FsrEasuRF(AF2 p) {
+	if (any(p != ResolvedPos)) {
+		GatherResolved(p, ResolvedR, ResolvedG, ResolvedB);
+		ResolvedPos = p;
+	}
+	return HdrToFilter(ResolvedR);
+}
+AF4 FsrEasuGF(AF2 p) { FsrEasuRF(p); return HdrToFilter(ResolvedG); }
+AF4 FsrEasuBF(AF2 p) { FsrEasuRF(p); return HdrToFilter(ResolvedB); }
+#else
+AF4 FsrEasuRF(AF2 p) { AF4 res = InputTexture.GatherRed(samLinearClamp, p, int2(0, 0)); return HdrToFilter(res); }
+AF4 FsrEasuGF(AF2 p) { AF4 res = InputTexture.GatherGreen(samLinearClamp, p, int2(0, 0)); return HdrToFilter(res); }
+AF4 FsrEasuBF(AF2 p) { AF4 res = InputTexture.GatherBlue(samLinearClamp, p, int2(0, 0)); return HdrToFilter(res); }
+#endif
+
+AF3 LoadUpscaled(ASU2 p) {
+	AU2 local = AU2(p - ASU2(TileOrigin) + 1);
+	return UpscaledTile[local.y * APRON_TILE_SIZE + local.x];
+}
+
+#if LUMA_ONLY
+// the tile holds YCoCg, RCAS only sharpens the luma
+AF4 FsrRcasLoadF(ASU2 p) { return AF4(LoadUpscaled(p).xxx, 1); }
+#else
+AF4 FsrRcasLoadF(ASU2 p) { return AF4(LoadUpscaled(p), 1); }
+#endif
+// the upscaled tile is already in the filter range
+void FsrRcasInputF(inout AF1 r, inout AF1 g, inout AF1 b) {}
+
+#if HALF_PRECISION
+// loads stay in 32 bits, so that the HDR tonemap is applied before the values are narrowed
+AH4 FsrEasuRH(AF2 p) { return AH4(FsrEasuRF(p)); }
+AH4 FsrEasuGH(AF2 p) { return AH4(FsrEasuGF(p)); }
+AH4 FsrEasuBH(AF2 p) { return AH4(FsrEasuBF(p)); }
+AH4 FsrRcasLoadH(ASW2 p) { return AH4(FsrRcasLoadF(ASU2(p))); }
+void FsrRcasInputH(inout AH1 r, inout AH1 g, inout AH1 b) {}
+#endif
+
+#include "ffx_fsr1.h"
+
+#if LUMA_ONLY
+// FsrEasuF on a single channel: 4 gathers instead of 12, and the taps accumulate one value instead of three.
+// The analysis gets the luma times 2 that FsrEasuF computes from three equal channels, so the result is the same.
+void FsrEasuTapLumaF(inout AF1 aC, inout AF1 aW, AF2 off, AF2 dir, AF2 len, AF1 lob, AF1 clp, AF1 c) {
+	AF2 v;
+	v.x = (off.x * (dir.x)) + (off.y * dir.y);
+	v.y = (off.x * (-dir.y)) + (off.y * dir.x);
+	v *= len;
+	AF1 d2 = v.x * v.x + v.y * v.y;
+	d2 = min(d2, clp);
+	AF1 wB = AF1_(2.0 / 5.0) * d2 + AF1_(-1.0);
+	AF1 wA = lob * d2 + AF1_(-1.0);
+	wB *= wB;
+	wA *= wA;
+	wB = AF1_(25.0 / 16.0) * wB + AF1_(-(25.0 / 16.0 - 1.0));
+	AF1 w = wB * wA;
+	aC += c * w;
+	aW += w;
+}
+
+void FsrEasuLumaF(out AF1 pix, AU2 ip, AU4 con0, AU4 con1, AU4 con2, AU4 con3) {
+	AF2 pp = AF2(ip) * AF2_AU2(con0.xy) + AF2_AU2(con0.zw);
+	AF2 fp = floor(pp);
+	pp -= fp;
+	AF2 p0 = fp * AF2_AU2(con1.xy) + AF2_AU2(con1.zw);
+	AF2 p1 = p0 + AF2_AU2(con2.xy);
+	AF2 p2 = p0 + AF2_AU2(con2.zw);
+	AF2 p3 = p0 + AF2_AU2(con3.xy);
+	AF4 bczz = GatherLuma(p0);
+	AF4 ijfe = GatherLuma(p1);
+	AF4 klhg = GatherLuma(p2);
+	AF4 zzon = GatherLuma(p3);
+	AF4 bczzL = bczz * AF4_(2.0);
+	AF4 ijfeL = ijfe * AF4_(2.0);
+	AF4 klhgL = klhg * AF4_(2.0);
+	AF4 zzonL = zzon * AF4_(2.0);
+
+	AF2 dir = AF2_(0.0);
+	AF1 len = AF1_(0.0);
+	FsrEasuSetF(dir, len, pp, true, false, false, false, bczzL.x, ijfeL.w, ijfeL.z, klhgL.w, ijfeL.y);
+	FsrEasuSetF(dir, len, pp, false, true, false, false, bczzL.y, ijfeL.z, klhgL.w, klhgL.z, klhgL.x);
+	FsrEasuSetF(dir, len, pp, false, false, true, false, ijfeL.z, ijfeL.x, ijfeL.y, klhgL.x, zzonL.w);
+	FsrEasuSetF(dir, len, pp, false, false, false, true, klhgL.w, ijfeL.y, klhgL.x, klhgL.y, zzonL.z);
+
+	AF2 dir2 = dir * dir;
+	AF1 dirR = dir2.x + dir2.y;
+	AP1 zro = dirR < AF1_(1.0 / 32768.0);
+	dirR = APrxLoRsqF1(dirR);
+	dirR = zro ? AF1_(1.0) : dirR;
+	dir.x = zro ? AF1_(1.0) : dir.x;
+	dir *= AF2_(dirR);
+	len = len * AF1_(0.5);
+	len *= len;
+	AF1 stretch = (dir.x * dir.x + dir.y * dir.y) * APrxLoRcpF1(max(abs(dir.x), abs(dir.y)));
+	AF2 len2 = AF2(AF1_(1.0) + (stretch - AF1_(1.0)) * len, AF1_(1.0) + AF1_(-0.5) * len);
+	AF1 lob = AF1_(0.5) + AF1_((1.0 / 4.0 - 0.04) - 0.5) * len;
+	AF1 clp = APrxLoRcpF1(lob);
+
+	// f g j k
+	AF1 min4 = min(AMin3F1(ijfe.z, klhg.w, ijfe.y), klhg.x);
+	AF1 max4 = max(AMax3F1(ijfe.z, klhg.w, ijfe.y), klhg.x);
+	AF1 aC = AF1_(0.0);
+	AF1 aW = AF1_(0.0);
+	FsrEasuTapLumaF(aC, aW, AF2( 0.0, -1.0) - pp, dir, len2, lob, clp, bczz.x); // b
+	FsrEasuTapLumaF(aC, aW, AF2( 1.0, -1.0) - pp, dir, len2, lob, clp, bczz.y); // c
+	FsrEasuTapLumaF(aC, aW, AF2(-1.0,  1.0) - pp, dir, len2, lob, clp, ijfe.x); // i
+	FsrEasuTapLumaF(aC, aW, AF2( 0.0,  1.0) - pp, dir, len2, lob, clp, ijfe.y); // j
+	FsrEasuTapLumaF(aC, aW, AF2( 0.0,  0.0) - pp, dir, len2, lob, clp, ijfe.z); // f
+	FsrEasuTapLumaF(aC, aW, AF2(-1.0,  0.0) - pp, dir, len2, lob, clp, ijfe.w); // e
+	FsrEasuTapLumaF(aC, aW, AF2( 1.0,  1.0) - pp, dir, len2, lob, clp, klhg.x); // k
+	FsrEasuTapLumaF(aC, aW, AF2( 2.0,  1.0) - pp, dir, len2, lob, clp, klhg.y); // l
+	FsrEasuTapLumaF(aC, aW, AF2( 2.0,  0.0) - pp, dir, len2, lob, clp, klhg.z); // h
+	FsrEasuTapLumaF(aC, aW, AF2( 1.0,  0.0) - pp, dir, len2, lob, clp, klhg.w); // g
+	FsrEasuTapLumaF(aC, aW, AF2( 1.0,  2.0) - pp, dir, len2, lob, clp, zzon.z); // o
+	FsrEasuTapLumaF(aC, aW, AF2( 0.0,  2.0) - pp, dir, len2, lob, clp, zzon.w); // n
+	pix = min(max4, max(min4, aC * ARcpF1(aW)));
+}
+#endif
+
+AF3 SampleBilinear(int2 pos) {
+	float2 samplePos = AF2_AU2(Const1.xy) * (AF2(pos) * AF2_AU2(Const0.xy) + AF2_AU2(Const0.zw) + 0.5);
+#if MSAA_INPUT
+	return SampleResolvedBilinear(samplePos);
+#else
+	return InputTexture.SampleLevel(samLinearClamp, samplePos, 0).rgb;
+#endif
+}
+
+void UpscaleTile(uint localIndex) {
+	// clamp the apron to the viewport, so that the edge pixels are sharpened against themselves
+	// rather than against whatever lies outside of the viewport
+	int2 maxPos = int2(RcasConst.zw) - 1;
+	for (uint i = localIndex; i < APRON_TILE_SIZE * APRON_TILE_SIZE; i += 64) {
+		int2 local = int2(i % APRON_TILE_SIZE, i / APRON_TILE_SIZE);
+		int2 pos = clamp(int2(TileOrigin) + local - 1, int2(0, 0), maxPos);
+#if LUMA_ONLY
+		// in 32 bits even in the half precision permutation, there is little left to pack
+		AF1 luma;
+		FsrEasuLumaF(luma, AU2(pos), Const0, Const1, Const2, Const3);
+		AF3 upscaled = AF3(luma, RgbToYCoCg(HdrToFilter(SampleBilinear(pos))).yz);
+#elif HALF_PRECISION
+		AH3 c;
+		FsrEasuH(c, AU2(pos), Const0, Const1, Const2, Const3);
+		AF3 upscaled = AF3(c);
+#else
+		AF3 upscaled;
+		FsrEasuF(upscaled, AU2(pos), Const0, Const1, Const2, Const3);
+#endif
+		UpscaledTile[i] = upscaled;
+	}
+}
+
+void Sharpen(int2 pos) {
+#if HALF_PRECISION
+	AH3 h;
+	FsrRcasH(h.r, h.g, h.b, pos, RcasConst);
+	AF3 c = AF3(h);
+#else
+	AF3 c;
+	FsrRcasF(c.r, c.g, c.b, pos, RcasConst);
+#endif
+#if LUMA_ONLY
+	c = YCoCgToRgb(AF3(c.x, LoadUpscaled(pos).yz));
+#endif
+	OutputTexture[pos + Const3.zw] = AF4(HdrFromFilter(c), 1);
+}
+
+void Bilinear(int2 pos) {
+#if DEBUG_OVERLAY
+	AF4 mul = AF4(1, 0.7, 0.7, 1);
+#else
+	AF4 mul = AF4(1, 1, 1, 1);
+#endif
+	OutputTexture[pos + Const3.zw] = mul * AF4(SampleBilinear(pos), 1);
+}
+
+[numthreads(64, 1, 1)]
+void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID, uint3 Dtid : SV_DispatchThreadID) {
+#if TILE_LIST
+	uint tile = TileList[WorkGroupId.x];
+	WorkGroupId = uint3(tile & 0xfff, (tile >> 12) & 0xfff, tile >> 24);
+#endif
+	EyeConstants eye = Eyes[WorkGroupId.z];
+	Const0 = eye.Const0;
+	Const1 = eye.Const1;
+	Const2 = eye.Const2;
+	Const3 = eye.Const3;
+	RcasConst = eye.RcasConst;
+	Centre = eye.Centre;
+	SquaredRadius = eye.SquaredRadius;
+
+#if MSAA_INPUT
+	QueryInputDimensions();
+#endif
+	TileOrigin = AU2(WorkGroupId.x << 4u, WorkGroupId.y << 4u);
+	// Do remapping of local xy in workgroup for a more PS-like swizzle pattern.
+	AU2 gxy = ARmp8x8(LocalThreadId.x) + TileOrigin;
+#if BILINEAR_ONLY
+	bool fullFilter = false;
+#else
+	bool fullFilter = true;
+#endif
+	if (fullFilter) {
+		// only do the expensive EASU and RCAS for tiles inside the foveation radius
+#if LUMA_ONLY
+		LoadLumaRegion(LocalThreadId.x);
+		GroupMemoryBarrierWithGroupSync();
+#endif
+		UpscaleTile(LocalThreadId.x);
+		GroupMemoryBarrierWithGroupSync();
+
+		Sharpen(gxy);
+		gxy.x += 8u;
+		Sharpen(gxy);
+		gxy.y += 8u;
+		Sharpen(gxy);
+		gxy.x -= 8u;
+		Sharpen(gxy);
+	} else {
+		// resort to cheaper bilinear sampling
+		Bilinear(gxy);
+		gxy.x += 8u;
+		Bilinear(gxy);
+		gxy.y += 8u;
+		Bilinear(gxy);
+		gxy.x -= 8u;
+		Bilinear(gxy);
+	}
+}
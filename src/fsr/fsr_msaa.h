@@ -0,0 +1,45 @@
+// Reading multi-sampled input directly, averaging the samples of each texel that is actually
+// touched instead of resolving the whole texture beforehand.
+// Expects InputTexture to be declared as Texture2DMS<AF4>.
+
+static ASU2 InputSize;
+static uint InputSamples;
+
+// must be called before any of the functions below
+void QueryInputDimensions() {
+	uint width, height, samples;
+	InputTexture.GetDimensions(width, height, samples);
+	InputSize = ASU2(width, height);
+	InputSamples = samples;
+}
+
+// average of all samples of a texel, with clamped addressing like samLinearClamp
+AF3 LoadResolved(ASU2 p) {
+	p = clamp(p, ASU2(0, 0), InputSize - 1);
+	AF3 sum = AF3(0, 0, 0);
+	for (uint s = 0; s < InputSamples; ++s) {
+		sum += InputTexture.Load(p, s).rgb;
+	}
+	return sum / AF1(InputSamples);
+}
+
+// equivalent of Gather* for all three channels at once: (-,+), (+,+), (+,-), (-,-) texels around p
+void GatherResolved(AF2 p, out AF4 r, out AF4 g, out AF4 b) {
+	ASU2 base = ASU2(floor(p * AF2(InputSize) - 0.5));
+	AF3 c0 = LoadResolved(base + ASU2(0, 1));
+	AF3 c1 = LoadResolved(base + ASU2(1, 1));
+	AF3 c2 = LoadResolved(base + ASU2(1, 0));
+	AF3 c3 = LoadResolved(base);
+	r = AF4(c0.r, c1.r, c2.r, c3.r);
+	g = AF4(c0.g, c1.g, c2.g, c3.g);
+	b = AF4(c0.b, c1.b, c2.b, c3.b);
+}
+
+AF3 SampleResolvedBilinear(AF2 p) {
+	AF2 pos = p * AF2(InputSize) - 0.5;
+	ASU2 base = ASU2(floor(pos));
+	AF2 f = pos - AF2(base);
+	AF3 top = lerp(LoadResolved(base), LoadResolved(base + ASU2(1, 0)), f.x);
+	AF3 bottom = lerp(LoadResolved(base + ASU2(0, 1)), LoadResolved(base + ASU2(1, 1)), f.x);
+	return lerp(top, bottom, f.y);
+}
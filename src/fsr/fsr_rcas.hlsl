@@ -1,41 +1,149 @@
+// permutation defines, see add_shader_permutations in CMakeLists.txt
+#ifndef TILE_LIST
+#define TILE_LIST 0
+#endif
+#ifndef BILINEAR_ONLY
+#define BILINEAR_ONLY 0
+#endif
+#ifndef DEBUG_OVERLAY
+#define DEBUG_OVERLAY 0
+#endif
+#ifndef MSAA_INPUT
+#define MSAA_INPUT 0
+#endif
+#ifndef HDR_INPUT
+#define HDR_INPUT 0
+#endif
+#ifndef HALF_PRECISION
+#define HALF_PRECISION 0
+#endif
+#ifndef IN_PLACE
+#define IN_PLACE 0
+#endif
+
 #define A_GPU 1
 #define A_HLSL 1
-//#define A_HALF
+#if HALF_PRECISION
+#define A_HALF
+#define FSR_RCAS_H
+#else
 #define FSR_RCAS_F
+#endif
 
 #include "ffx_a.h"
 
-cbuffer cb : register(b0) {
+struct EyeConstants {
 	uint4 Const0;
 	uint2 ProjCentre;
+	uint2 ViewportSize;
 	uint  SquaredRadius;
-	uint  DebugMode;
+	uint3 Padding;
+};
+
+// both eyes can be processed in one dispatch, the Z group index selects the eye
+cbuffer cb : register(b0) {
+	EyeConstants Eyes[2];
 };
 
+static uint4 Const0;
+static uint2 ProjCentre;
+static uint2 ViewportSize;
+static uint SquaredRadius;
+
 SamplerState samLinearClamp : register(s0);
+#if MSAA_INPUT
+Texture2DMS<AF4> InputTexture : register(t0);
+#else
 Texture2D<AF4> InputTexture : register(t0);
+#endif
 RWTexture2D<AF4> OutputTexture: register(u0);
 
+#if TILE_LIST
+// the workgroups' tiles, packed as x | y << 12 | eye << 24
+Buffer<uint> TileList : register(t1);
+#endif
+
+#if MSAA_INPUT
+#include "fsr_msaa.h"
+#endif
+
+#if IN_PLACE
+#include "../tiles/in_place_tile.h"
+
+AF4 FsrRcasLoadF(ASU2 p) { return AF4(LoadInPlaceTile(p - ASU2(Const0.zw)), 1); }
+#elif MSAA_INPUT
+AF4 FsrRcasLoadF(ASU2 p) { return AF4(LoadResolved(p), 1); }
+#else
 AF4 FsrRcasLoadF(ASU2 p) { return InputTexture.Load(int3(ASU2(p), 0)); }
-void FsrRcasInputF(inout AF1 r, inout AF1 g, inout AF1 b) {}
+#endif
+#include "../hdr/hdr_filter.h"
+
+void FsrRcasInputF(inout AF1 r, inout AF1 g, inout AF1 b) {
+	AF3 c = HdrToFilter(AF3(r, g, b));
+	r = c.r; g = c.g; b = c.b;
+}
+
+#if HALF_PRECISION
+// loads stay in 32 bits, so that the HDR tonemap is applied before the values are narrowed
+AH4 FsrRcasLoadH(ASW2 p) {
+	AF4 c = FsrRcasLoadF(ASU2(p));
+	return AH4(HdrToFilter(c.rgb), c.a);
+}
+void FsrRcasInputH(inout AH1 r, inout AH1 g, inout AH1 b) {}
+#endif
 
 #include "ffx_fsr1.h"
 
 void Sharpen(int2 pos) {
+#if HALF_PRECISION
+	AH3 h;
+	FsrRcasH(h.r, h.g, h.b, pos, Const0);
+	AF3 c = AF3(h);
+#else
 	AF3 c;
 	FsrRcasF(c.r, c.g, c.b, pos, Const0);
-	OutputTexture[pos] = AF4(c, 1);
+#endif
+#if IN_PLACE
+	// partial tiles must not touch whatever lies next to the viewport in the game's texture
+	if (any(AU2(pos) - Const0.zw >= ViewportSize)) {
+		return;
+	}
+	// the game's alpha is kept, only this thread writes the texel
+	OutputTexture[pos] = AF4(HdrFromFilter(c), OutputTexture[pos].a);
+#else
+	OutputTexture[pos] = AF4(HdrFromFilter(c), 1);
+#endif
 }
 
 [numthreads(64, 1, 1)]
 void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID, uint3 Dtid : SV_DispatchThreadID) {
+#if TILE_LIST
+	uint tile = TileList[WorkGroupId.x];
+	WorkGroupId = uint3(tile & 0xfff, (tile >> 12) & 0xfff, tile >> 24);
+#endif
+	EyeConstants eye = Eyes[WorkGroupId.z];
+	Const0 = eye.Const0;
+	ProjCentre = eye.ProjCentre;
+	ViewportSize = eye.ViewportSize;
+	SquaredRadius = eye.SquaredRadius;
+#if MSAA_INPUT
+	QueryInputDimensions();
+#endif
+
 	// Do remapping of local xy in workgroup for a more PS-like swizzle pattern.
 	AU2 gxy = ARmp8x8(LocalThreadId.x) + AU2(WorkGroupId.x << 4u, WorkGroupId.y << 4u);
-	AU2 groupCentre = AU2((WorkGroupId.x << 4u) + 8u, (WorkGroupId.y << 4u) + 8u);
-	AU2 dc = ProjCentre - groupCentre;
 	AU2 pos = gxy + Const0.zw;
-	if (dot(dc, dc) <= SquaredRadius) {
-		// only do RCAS for workgroups inside the given radius
+#if BILINEAR_ONLY
+	bool fullFilter = false;
+#else
+	bool fullFilter = true;
+#endif
+	if (fullFilter) {
+		// only do RCAS for tiles inside the foveation radius
+#if IN_PLACE
+		StageInPlaceTile(LocalThreadId.x, ASU2(WorkGroupId.x << 4u, WorkGroupId.y << 4u), WorkGroupId.z, ASU2(Const0.zw), ASU2(ViewportSize));
+		GroupMemoryBarrierWithGroupSync();
+#endif
 		Sharpen(pos);
 		pos.x += 8u;
 		Sharpen(pos);
@@ -44,13 +152,17 @@ void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID
 		pos.x -= 8u;
 		Sharpen(pos);
 	} else {
-		AF4 mul = AF4(1, 1, 1, 1) - DebugMode * AF4(0, 0.3, 0.3, 0);
-		OutputTexture[pos] = mul * InputTexture[pos];
+#if DEBUG_OVERLAY
+		AF4 mul = AF4(1, 0.7, 0.7, 1);
+#else
+		AF4 mul = AF4(1, 1, 1, 1);
+#endif
+		OutputTexture[pos] = mul * FsrRcasLoadF(pos);
 		pos.x += 8u;
-		OutputTexture[pos] = mul * InputTexture[pos];
+		OutputTexture[pos] = mul * FsrRcasLoadF(pos);
 		pos.y += 8u;
-		OutputTexture[pos] = mul * InputTexture[pos];
+		OutputTexture[pos] = mul * FsrRcasLoadF(pos);
 		pos.x -= 8u;
-		OutputTexture[pos] = mul * InputTexture[pos];
+		OutputTexture[pos] = mul * FsrRcasLoadF(pos);
 	}
 }
@@ -0,0 +1,15 @@
+// FSR and CAS are tuned for values in [0, 1], so linear HDR input is filtered in a reversibly tonemapped range.
+// The tonemap is applied per channel, which keeps it usable on the gathered channels EASU works with,
+// and is inverted when storing the result, so the output keeps the input's range without an extra pass.
+// Expects the AF types of ffx_a.h.
+
+#if HDR_INPUT
+AF3 HdrToFilter(AF3 c) { c = max(c, 0); return c * rcp(1 + c); }
+AF4 HdrToFilter(AF4 c) { c = max(c, 0); return c * rcp(1 + c); }
+// clamped to the largest half float rather than diverging towards 1
+AF3 HdrFromFilter(AF3 c) { return c * rcp(max(1 - c, AF1(1.0 / 65504.0))); }
+#else
+AF3 HdrToFilter(AF3 c) { return c; }
+AF4 HdrToFilter(AF4 c) { return c; }
+AF3 HdrFromFilter(AF3 c) { return c; }
+#endif
@@ -3,15 +3,37 @@
 #include "logging.h"
 #include "MinHook.h"
 
+#include <mutex>
 #include <unordered_map>
 
 namespace {
 	struct HookInfo {
-		intptr_t target;
-		intptr_t original;
-		intptr_t hook;
+		void *target;
+		std::atomic<void*> *slot;
 	};
-	std::unordered_map<intptr_t, HookInfo> g_hooksToOriginal;
+	// only used to find the target and slot again when removing a hook, never on the call path
+	std::unordered_map<void*, HookInfo> g_installedHooks;
+	std::mutex g_hooksMutex;
+
+	bool CreateAndEnableHook(void *target, void *detour, std::atomic<void*> *slot, MH_STATUS &status) {
+		LPVOID pOriginal = nullptr;
+		status = MH_CreateHook(target, detour, &pOriginal);
+		if (status != MH_OK) {
+			return false;
+		}
+
+		// the trampoline must be visible before the first call can reach the detour
+		slot->store(pOriginal, std::memory_order_release);
+		status = MH_EnableHook(target);
+		if (status != MH_OK) {
+			MH_RemoveHook(target);
+			slot->store(nullptr, std::memory_order_release);
+			return false;
+		}
+
+		g_installedHooks[detour] = HookInfo { target, slot };
+		return true;
+	}
 }
 
 namespace vrperfkit {
@@ -24,72 +46,63 @@ namespace vrperfkit {
 		}
 
 		void Shutdown() {
+			std::lock_guard<std::mutex> lock (g_hooksMutex);
 			MH_Uninitialize();
-			g_hooksToOriginal.clear();
+			for (auto &entry : g_installedHooks) {
+				entry.second.slot->store(nullptr, std::memory_order_release);
+			}
+			g_installedHooks.clear();
 		}
 
-		void InstallVirtualFunctionHook(const std::string &name, void *instance, uint32_t methodPos, void *detour) {
-			LOG_INFO << "Installing virtual function hook for " << name;
-			LPVOID *vtable = *((LPVOID**)instance);
-			LPVOID pTarget = vtable[methodPos];
+		namespace detail {
+			void InstallVirtualFunctionHook(const std::string &name, void *instance, uint32_t methodPos, void *detour, std::atomic<void*> *slot) {
+				LOG_INFO << "Installing virtual function hook for " << name;
+				LPVOID *vtable = *((LPVOID**)instance);
+				LPVOID pTarget = vtable[methodPos];
 
-			LPVOID pOriginal = nullptr;
-			MH_STATUS result = MH_CreateHook(pTarget, detour, &pOriginal);
-			if (result != MH_OK || MH_EnableHook(pTarget) != MH_OK) {
-				if (result == MH_ERROR_ALREADY_CREATED) {
-					LOG_INFO << "  Hook already installed.";
-				} else {
-					LOG_ERROR << "Failed to install hook for " << name;
+				std::lock_guard<std::mutex> lock (g_hooksMutex);
+				MH_STATUS result;
+				if (!CreateAndEnableHook(pTarget, detour, slot, result)) {
+					if (result == MH_ERROR_ALREADY_CREATED) {
+						LOG_INFO << "  Hook already installed.";
+					} else {
+						LOG_ERROR << "Failed to install hook for " << name;
+					}
 				}
-				return;
 			}
 
-			g_hooksToOriginal[reinterpret_cast<intptr_t>(detour)] = HookInfo {
-				reinterpret_cast<intptr_t>(pTarget),
-				reinterpret_cast<intptr_t>(pOriginal),
-				reinterpret_cast<intptr_t>(detour),
-			};
-		}
-
-		void RemoveHook(void *detour) {
-			auto entry = g_hooksToOriginal.find(reinterpret_cast<intptr_t>(detour));
-			if (entry != g_hooksToOriginal.end()) {
-				void *target = reinterpret_cast<void *>(entry->second.target);
-				LOG_INFO << "Removing hook to " << target;
-				if (MH_STATUS status; (status = MH_DisableHook(target)) != MH_OK) {
-					LOG_ERROR << "Error when disabling hook to " << target << ": " << status;
+			void RemoveHook(void *detour) {
+				std::lock_guard<std::mutex> lock (g_hooksMutex);
+				auto entry = g_installedHooks.find(detour);
+				if (entry != g_installedHooks.end()) {
+					void *target = entry->second.target;
+					LOG_INFO << "Removing hook to " << target;
+					if (MH_STATUS status; (status = MH_DisableHook(target)) != MH_OK) {
+						LOG_ERROR << "Error when disabling hook to " << target << ": " << status;
+					}
+					if (MH_STATUS status; (status = MH_RemoveHook(target)) != MH_OK) {
+						LOG_ERROR << "Error when removing hook to " << target << ": " << status;
+					}
+					entry->second.slot->store(nullptr, std::memory_order_release);
+					g_installedHooks.erase(entry);
 				}
-				if (MH_STATUS status; (status = MH_RemoveHook(target)) != MH_OK) {
-					LOG_ERROR << "Error when removing hook to " << target << ": " << status;
-				}
-				g_hooksToOriginal.erase(entry);
 			}
-		}
 
-		void InstallHook(const std::string &name, void *target, void *detour) {
-			LOG_INFO << "Installing hook for " << name << " from " << target << " to " << detour;
-			LPVOID pOriginal = nullptr;
-			if (MH_CreateHook(target, detour, &pOriginal) != MH_OK || MH_EnableHook(target) != MH_OK) {
-				LOG_ERROR << "Failed to install hook for " << name;
-				return;
+			void InstallHook(const std::string &name, void *target, void *detour, std::atomic<void*> *slot) {
+				LOG_INFO << "Installing hook for " << name << " from " << target << " to " << detour;
+				std::lock_guard<std::mutex> lock (g_hooksMutex);
+				MH_STATUS result;
+				if (!CreateAndEnableHook(target, detour, slot, result)) {
+					LOG_ERROR << "Failed to install hook for " << name;
+				}
 			}
 
-			g_hooksToOriginal[reinterpret_cast<intptr_t>(detour)] = HookInfo {
-				reinterpret_cast<intptr_t>(target),
-				reinterpret_cast<intptr_t>(pOriginal),
-				reinterpret_cast<intptr_t>(detour),
-			};
-		}
-
-		void InstallHookInDll(const std::string &name, HMODULE module, void *detour) {
-			LPVOID target = GetProcAddress(module, name.c_str());
-			if (target != nullptr) {
-				InstallHook(name, target, detour);
+			void InstallHookInDll(const std::string &name, HMODULE module, void *detour, std::atomic<void*> *slot) {
+				LPVOID target = GetProcAddress(module, name.c_str());
+				if (target != nullptr) {
+					InstallHook(name, target, detour, slot);
+				}
 			}
 		}
-
-		intptr_t HookToOriginal(intptr_t hook) {
-			return g_hooksToOriginal[hook].original;
-		}
 	}
 }
@@ -2,6 +2,7 @@
 #include "logging.h"
 #include "MinHook.h"
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 
@@ -22,16 +23,43 @@ namespace vrperfkit {
 			return reinterpret_cast<T>(fn);
 		}
 
-		void InstallHook(const std::string &name, void *target, void *detour);
-		void InstallHookInDll(const std::string &name, HMODULE module, void *detour);
-		void InstallVirtualFunctionHook(const std::string &name, void *instance, uint32_t methodPos, void *detour);
-		void RemoveHook(void *detour);
+		namespace detail {
+			// every detour gets its own slot holding the trampoline to the original function,
+			// so that calling the original from within a detour is a single atomic load
+			template<auto Detour>
+			struct DetourSlot {
+				static inline std::atomic<void*> original = nullptr;
+			};
 
-		intptr_t HookToOriginal(intptr_t hook);
+			void InstallHook(const std::string &name, void *target, void *detour, std::atomic<void*> *slot);
+			void InstallHookInDll(const std::string &name, HMODULE module, void *detour, std::atomic<void*> *slot);
+			void InstallVirtualFunctionHook(const std::string &name, void *instance, uint32_t methodPos, void *detour, std::atomic<void*> *slot);
+			void RemoveHook(void *detour);
+		}
 
-		template<typename T>
-		T CallOriginal(T hookFunction) {
-			return reinterpret_cast<T>(HookToOriginal(reinterpret_cast<intptr_t>(hookFunction)));
+		template<auto Detour>
+		void InstallHook(const std::string &name, void *target) {
+			detail::InstallHook(name, target, (void*)Detour, &detail::DetourSlot<Detour>::original);
+		}
+
+		template<auto Detour>
+		void InstallHookInDll(const std::string &name, HMODULE module) {
+			detail::InstallHookInDll(name, module, (void*)Detour, &detail::DetourSlot<Detour>::original);
+		}
+
+		template<auto Detour>
+		void InstallVirtualFunctionHook(const std::string &name, void *instance, uint32_t methodPos) {
+			detail::InstallVirtualFunctionHook(name, instance, methodPos, (void*)Detour, &detail::DetourSlot<Detour>::original);
+		}
+
+		template<auto Detour>
+		void RemoveHook() {
+			detail::RemoveHook((void*)Detour);
+		}
+
+		template<auto Detour>
+		decltype(Detour) CallOriginal() {
+			return reinterpret_cast<decltype(Detour)>(detail::DetourSlot<Detour>::original.load(std::memory_order_acquire));
 		}
 	}
 }
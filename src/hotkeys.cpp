@@ -1,7 +1,9 @@
 #include "hotkeys.h"
 #include "logging.h"
 
+#include <atomic>
 #include <functional>
+#include <thread>
 #include <yaml-cpp/yaml.h>
 
 #include "win_header_sane.h"
@@ -18,6 +20,8 @@ namespace {
 			g_config.upscaling.method = vrperfkit::UpscaleMethod::CAS;
 			break;
 		case vrperfkit::UpscaleMethod::CAS:
+		case vrperfkit::UpscaleMethod::TEMPORAL:
+			// temporal is experimental and only selected explicitly
 			g_config.upscaling.method = vrperfkit::UpscaleMethod::FSR;
 			break;
 		}
@@ -98,6 +102,12 @@ namespace {
 	};
 	std::vector<HotkeyState> g_hotkeyStates;
 
+	// keys are polled on a background thread, which sets the bit of each hotkey that was pressed;
+	// the render thread only picks up these bits and runs the actions, so config changes stay between frames
+	const DWORD POLL_INTERVAL_MS = 50;
+	std::atomic_uint32_t g_pressedHotkeys = 0;
+	HANDLE g_stopPollingEvent = nullptr;
+
 	std::unordered_map<std::string, int> g_virtualKeyMap = {
 		{ "backspace", VK_BACK },
 		{ "tab", VK_TAB },
@@ -172,20 +182,16 @@ namespace {
 
 namespace vrperfkit {
 
-	void LoadHotkeys(const std::filesystem::path &configPath) {
+	void LoadHotkeys(YAML::Node cfg) {
 		InitDefinitions();
 		g_hotkeyStates.clear();
 		g_hotkeysEnabled = false;
 
-		if (!exists(configPath)) {
-			LOG_ERROR << "Config file not found, hotkeys will be disabled";
+		if (!cfg.IsMap()) {
 			return;
 		}
 
 		try {
-			std::ifstream cfgFile (configPath);
-			YAML::Node cfg = YAML::Load(cfgFile);
-
 			YAML::Node hotkeysCfg = cfg["hotkeys"];
 			g_hotkeysEnabled = hotkeysCfg["enabled"].as<bool>(g_hotkeysEnabled);
 			for (const auto &def : g_hotkeyDefinitions) {
@@ -214,25 +220,53 @@ namespace vrperfkit {
 		return GetAsyncKeyState(key) & (~1);
 	}
 
-	void CheckHotkeys() {
-		if (!g_hotkeysEnabled) {
+	void PollHotkeys() {
+		while (WaitForSingleObject(g_stopPollingEvent, POLL_INTERVAL_MS) == WAIT_TIMEOUT) {
+			for (size_t i = 0; i < g_hotkeyStates.size(); ++i) {
+				HotkeyState &state = g_hotkeyStates[i];
+				if (state.keys.empty())
+					continue;
+
+				bool isActive = true;
+				for (int key : state.keys) {
+					isActive = isActive && CheckKey(key);
+				}
+
+				if (isActive && !state.wasActive) {
+					g_pressedHotkeys.fetch_or(1u << i);
+				}
+
+				state.wasActive = isActive;
+			}
+		}
+	}
+
+	void StartHotkeyPolling() {
+		if (!g_hotkeysEnabled || g_stopPollingEvent != nullptr) {
+			return;
+		}
+		if (g_hotkeyStates.size() > 32) {
+			LOG_ERROR << "Too many hotkey definitions, hotkeys are disabled";
 			return;
 		}
 
-		for (auto &state : g_hotkeyStates) {
-			if (state.keys.empty())
-				continue;
+		g_stopPollingEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		// like the control server thread, this is never joined, see StartControlServer
+		std::thread(PollHotkeys).detach();
+	}
 
-			bool isActive = true;
-			for (int key : state.keys) {
-				isActive = isActive && CheckKey(key);
-			}
+	void StopHotkeyPolling() {
+		if (g_stopPollingEvent != nullptr) {
+			SetEvent(g_stopPollingEvent);
+		}
+	}
 
-			if (isActive && !state.wasActive) {
-				state.action();
+	void CheckHotkeys() {
+		uint32_t pressed = g_pressedHotkeys.exchange(0);
+		for (size_t i = 0; pressed != 0; ++i, pressed >>= 1) {
+			if (pressed & 1) {
+				g_hotkeyStates[i].action();
 			}
-
-			state.wasActive = isActive;
 		}
 	}
 
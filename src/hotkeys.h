@@ -1,8 +1,15 @@
 #pragma once
-#include <filesystem>
+
+namespace YAML {
+	class Node;
+}
 
 namespace vrperfkit {
-	void LoadHotkeys(const std::filesystem::path &configPath);
+	void LoadHotkeys(YAML::Node cfg);
+	// polls the configured keys on a background thread, so that the render thread does not have to
+	void StartHotkeyPolling();
+	void StopHotkeyPolling();
+	// runs the actions of the hotkeys pressed since the last call; call once per frame from the render thread
 	void CheckHotkeys();
 	void PrintHotkeys();
 }
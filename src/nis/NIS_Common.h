@@ -39,7 +39,6 @@ cbuffer cb : register(b0)
 
 	uint2 projCentre;
 	uint squaredRadius;
-	uint debugMode;
 };
 
 SamplerState samplerLinearClamp : register(s0);
@@ -49,7 +48,11 @@ RWTexture2D<unorm float4> out_texture : register(u0);
 
 void DirectCopy(uint2 blockIdx, uint threadIdx)
 {
-	const float4 mul = float4(1, 1, 1, 1) - debugMode * float4(0, 0.3, 0.3, 0);
+#if DEBUG_OVERLAY
+	const float4 mul = float4(1, 0.7, 0.7, 1);
+#else
+	const float4 mul = float4(1, 1, 1, 1);
+#endif
 	const int dstBlockX = NIS_BLOCK_WIDTH * blockIdx.x;
 	const int dstBlockY = NIS_BLOCK_HEIGHT * blockIdx.y;
 	for (uint k = threadIdx; k < NIS_BLOCK_WIDTH * NIS_BLOCK_HEIGHT; k += NIS_THREAD_GROUP_SIZE)
@@ -74,7 +74,6 @@ struct NIS_ALIGNED(256) NISConfig
 
     uint32_t projCentre[2];
     uint32_t squaredRadius;
-	uint32_t debugMode;
 };
 
 enum class NISHDRMode : uint32_t
@@ -19,8 +19,22 @@
 // IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
-#define NIS_SCALER 1
+// permutation defines, see add_shader_permutations in CMakeLists.txt
+#ifndef TILE_LIST
+#define TILE_LIST 0
+#endif
+#ifndef BILINEAR_ONLY
+#define BILINEAR_ONLY 0
+#endif
+#ifndef DEBUG_OVERLAY
+#define DEBUG_OVERLAY 0
+#endif
+// 1 selects NIS_HDR_MODE_LINEAR for float input
+#ifndef NIS_HDR_MODE
 #define NIS_HDR_MODE 0
+#endif
+
+#define NIS_SCALER 1
 #define NIS_BLOCK_WIDTH 32
 #define NIS_BLOCK_HEIGHT 24
 #define NIS_THREAD_GROUP_SIZE 256
@@ -29,15 +43,27 @@
 Texture2D coef_scaler           : register(t1);
 Texture2D coef_usm              : register(t2);
 
+#if TILE_LIST
+// the workgroups' tiles, packed as x | y << 12
+Buffer<uint> TileList : register(t3);
+#endif
+
 #include "NIS_Common.h"
 #include "NIS_Scaler.h"
 
 [numthreads(NIS_THREAD_GROUP_SIZE, 1, 1)]
 void main(uint3 blockIdx : SV_GroupID, uint3 threadIdx : SV_GroupThreadID)
 {
-	uint2 groupCentre = uint2((blockIdx.x * 32) + 16, (blockIdx.y * 24) + 12);
-	uint2 dc = projCentre.xy - groupCentre;
-	if (dot(dc, dc) <= squaredRadius) {
+#if TILE_LIST
+	uint tile = TileList[blockIdx.x];
+	blockIdx = uint3(tile & 0xfff, (tile >> 12) & 0xfff, 0);
+#endif
+#if BILINEAR_ONLY
+	bool fullFilter = false;
+#else
+	bool fullFilter = true;
+#endif
+	if (fullFilter) {
 		NVScaler(blockIdx.xy, threadIdx.x);
 	}
 	else {
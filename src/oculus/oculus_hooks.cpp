@@ -30,7 +30,7 @@ namespace {
 	};
 
 	ovrSizei ovrHook_GetFovTextureSize(ovrSession session, ovrEyeType eye, ovrFovPort fov, float pixelsPerDisplayPixel) {
-		ovrSizei result = vrperfkit::hooks::CallOriginal(ovrHook_GetFovTextureSize)(session, eye, fov, pixelsPerDisplayPixel);
+		ovrSizei result = vrperfkit::hooks::CallOriginal<ovrHook_GetFovTextureSize>()(session, eye, fov, pixelsPerDisplayPixel);
 		if (result.w > 0 && result.h > 0) {
 			vrperfkit::AdjustRenderResolution(result.w, result.h);
 		}
@@ -95,13 +95,13 @@ namespace {
 			ovrOldLayerEyeFovDepth eyeLayer;
 			std::vector<const ovrOldLayerHeader*> modifiedLayers;
 			HandleOldFrameSubmission(session, (ovrOldLayerHeader const * const *)layerPtrList, layerCount, modifiedLayers, eyeLayer);
-			return vrperfkit::hooks::CallOriginal(ovrHook_EndFrame)(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
+			return vrperfkit::hooks::CallOriginal<ovrHook_EndFrame>()(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
 		}
 		else {
 			ovrLayerEyeFovDepth eyeLayer;
 			std::vector<const ovrLayerHeader*> modifiedLayers;
 			HandleFrameSubmission(session, (ovrLayerHeader const * const *)layerPtrList, layerCount, modifiedLayers, eyeLayer);
-			return vrperfkit::hooks::CallOriginal(ovrHook_EndFrame)(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
+			return vrperfkit::hooks::CallOriginal<ovrHook_EndFrame>()(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
 		}
 	}
 
@@ -110,13 +110,13 @@ namespace {
 			ovrOldLayerEyeFovDepth eyeLayer;
 			std::vector<const ovrOldLayerHeader*> modifiedLayers;
 			HandleOldFrameSubmission(session, (ovrOldLayerHeader const * const *)layerPtrList, layerCount, modifiedLayers, eyeLayer);
-			return vrperfkit::hooks::CallOriginal(ovrHook_SubmitFrame2)(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
+			return vrperfkit::hooks::CallOriginal<ovrHook_SubmitFrame2>()(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
 		}
 		else {
 			ovrLayerEyeFovDepth eyeLayer;
 			std::vector<const ovrLayerHeader*> modifiedLayers;
 			HandleFrameSubmission(session, (ovrLayerHeader const * const *)layerPtrList, layerCount, modifiedLayers, eyeLayer);
-			return vrperfkit::hooks::CallOriginal(ovrHook_SubmitFrame2)(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
+			return vrperfkit::hooks::CallOriginal<ovrHook_SubmitFrame2>()(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
 		}
 	}
 
@@ -125,27 +125,27 @@ namespace {
 			ovrOldLayerEyeFovDepth eyeLayer;
 			std::vector<const ovrOldLayerHeader*> modifiedLayers;
 			HandleOldFrameSubmission(session, (ovrOldLayerHeader const * const *)layerPtrList, layerCount, modifiedLayers, eyeLayer);
-			return vrperfkit::hooks::CallOriginal(ovrHook_SubmitFrame)(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
+			return vrperfkit::hooks::CallOriginal<ovrHook_SubmitFrame>()(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
 		}
 		else {
 			ovrLayerEyeFovDepth eyeLayer;
 			std::vector<const ovrLayerHeader*> modifiedLayers;
 			HandleFrameSubmission(session, (ovrLayerHeader const * const *)layerPtrList, layerCount, modifiedLayers, eyeLayer);
-			return vrperfkit::hooks::CallOriginal(ovrHook_SubmitFrame)(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
+			return vrperfkit::hooks::CallOriginal<ovrHook_SubmitFrame>()(session, frameIndex, viewScaleDesc, (const void**)modifiedLayers.data(), layerCount);
 		}
 	}
 
 	ovrResult ovrHook_Initialize(const ovrInitParams* params) {
 		g_oculusVersion = params->RequestedMinorVersion;
 		LOG_INFO << "Oculus runtime initialization for version " << g_oculusVersion;
-		return vrperfkit::hooks::CallOriginal(ovrHook_Initialize)(params);
+		return vrperfkit::hooks::CallOriginal<ovrHook_Initialize>()(params);
 	}
 }
 
 namespace vrperfkit {
-	void InstallOculusHooks() {
+	bool InstallOculusHooks() {
 		if (g_oculusDll != nullptr) {
-			return;
+			return true;
 		}
 
 #ifdef WIN64
@@ -160,15 +160,17 @@ namespace vrperfkit {
 			}
 
 			LOG_INFO << dllName << " is loaded in the process, installing hooks...";
-			hooks::InstallHookInDll("ovr_Initialize", handle, (void*)ovrHook_Initialize);
-			hooks::InstallHookInDll("ovr_GetFovTextureSize", handle, (void*)ovrHook_GetFovTextureSize);
-			hooks::InstallHookInDll("ovr_EndFrame", handle, (void*)ovrHook_EndFrame);
-			hooks::InstallHookInDll("ovr_SubmitFrame", handle, (void*)ovrHook_SubmitFrame);
-			hooks::InstallHookInDll("ovr_SubmitFrame2", handle, (void*)ovrHook_SubmitFrame2);
+			hooks::InstallHookInDll<ovrHook_Initialize>("ovr_Initialize", handle);
+			hooks::InstallHookInDll<ovrHook_GetFovTextureSize>("ovr_GetFovTextureSize", handle);
+			hooks::InstallHookInDll<ovrHook_EndFrame>("ovr_EndFrame", handle);
+			hooks::InstallHookInDll<ovrHook_SubmitFrame>("ovr_SubmitFrame", handle);
+			hooks::InstallHookInDll<ovrHook_SubmitFrame2>("ovr_SubmitFrame2", handle);
 
 			g_oculusDll = handle;
-			break;
+			return true;
 		}
+
+		return false;
 	}
 }
 
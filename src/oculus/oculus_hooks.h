@@ -1,5 +1,6 @@
 #pragma once
 
 namespace vrperfkit {
-	void InstallOculusHooks();
+	// returns true once the runtime has been found and hooked
+	bool InstallOculusHooks();
 }
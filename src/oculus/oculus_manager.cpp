@@ -1,11 +1,13 @@
 #include "oculus_manager.h"
 
+#include "control_server.h"
 #include "hotkeys.h"
 #include "logging.h"
 #include "resolution_scaling.h"
 #include "d3d11/d3d11_helper.h"
 #include "d3d11/d3d11_injector.h"
 #include "d3d11/d3d11_post_processor.h"
+#include "d3d11/d3d11_texture_pool.h"
 #include "d3d11/d3d11_variable_rate_shading.h"
 
 #include <wrl/client.h>
@@ -60,19 +62,30 @@ namespace vrperfkit {
 				return false;
 			}
 		}
+
+		bool IsSameChainDesc(const ovrTextureSwapChainDesc &a, const ovrTextureSwapChainDesc &b) {
+			return a.Type == b.Type && a.Format == b.Format && a.ArraySize == b.ArraySize && a.Width == b.Width && a.Height == b.Height
+				&& a.MipLevels == b.MipLevels && a.SampleCount == b.SampleCount && a.StaticImage == b.StaticImage
+				&& a.MiscFlags == b.MiscFlags && a.BindFlags == b.BindFlags;
+		}
 	}
 
 	OculusManager g_oculus;
 
 	struct OculusD3D11Resources {
-		std::unique_ptr<D3D11Injector> injector;
 		std::unique_ptr<D3D11VariableRateShading> variableRateShading;
 		std::unique_ptr<D3D11PostProcessor> postProcessor;
+		// destroyed before the listeners above, so that the hooks no longer call into them
+		std::unique_ptr<D3D11Injector> injector;
 		ComPtr<ID3D11Device> device;
 		ComPtr<ID3D11DeviceContext> context;
 		std::vector<ComPtr<ID3D11Texture2D>> submittedTextures[2];
+		// from the manager's texture pool; resolveTexture[1] may refer to the left eye's lease
+		D3D11TextureLease resolveLease[2];
 		ComPtr<ID3D11Texture2D> resolveTexture[2];
 		std::vector<ComPtr<ID3D11ShaderResourceView>> submittedViews[2];
+		// views of the multi-sampled textures themselves, for upscalers that can read them without a resolve
+		std::vector<ComPtr<ID3D11ShaderResourceView>> multisampledViews[2];
 		std::vector<ComPtr<ID3D11Texture2D>> outputTextures[2];
 		std::vector<ComPtr<ID3D11ShaderResourceView>> outputViews[2];
 		std::vector<ComPtr<ID3D11UnorderedAccessView>> outputUavs[2];
@@ -105,28 +118,68 @@ namespace vrperfkit {
 			Shutdown();
 			failed = true;
 		}
+		// whatever was not taken over does not match the new swapchains
+		DestroySpareOutputChains();
 
 		FlushLog();
 	}
 
 	void OculusManager::Shutdown() {
+		ReleaseResources(false);
+	}
+
+	void OculusManager::ReleaseResources(bool keepOutputChains) {
+		ID3D11Device *device = d3d11Res != nullptr ? d3d11Res->device.Get() : nullptr;
+		for (int i = 0; i < 2; ++i) {
+			// both eyes may share a single output swapchain
+			if (outputEyeChains[i] != nullptr && (i == 0 || outputEyeChains[1] != outputEyeChains[0])) {
+				if (keepOutputChains && device != nullptr) {
+					spareOutputChains.push_back({ outputEyeChains[i], outputChainDescs[i], device });
+				}
+				else {
+					ovr_DestroyTextureSwapChain(session, outputEyeChains[i]);
+				}
+			}
+			submittedEyeChains[i] = nullptr;
+			outputEyeChains[i] = nullptr;
+		}
+		if (!keepOutputChains) {
+			DestroySpareOutputChains();
+			session = nullptr;
+		}
+
 		initialized = false;
 		failed = false;
 		graphicsApi = GraphicsApi::UNKNOWN;
 		d3d11Res.reset();
-		for (int i = 0; i < 2; ++i) {
-			if (outputEyeChains[i] != nullptr) {
-				ovr_DestroyTextureSwapChain(session, outputEyeChains[i]);
+	}
+
+	ovrTextureSwapChain OculusManager::CreateOutputChain(ID3D11Device *device, const ovrTextureSwapChainDesc &desc) {
+		for (auto it = spareOutputChains.begin(); it != spareOutputChains.end(); ++it) {
+			if (it->device == device && IsSameChainDesc(it->desc, desc)) {
+				LOG_INFO << "Reusing output swapchain of the previous initialization";
+				ovrTextureSwapChain chain = it->chain;
+				spareOutputChains.erase(it);
+				return chain;
 			}
-			submittedEyeChains[i] = nullptr;
-			outputEyeChains[i] = nullptr;
 		}
-		session = nullptr;
+
+		ovrTextureSwapChain chain = nullptr;
+		Check("creating output swapchain", ovr_CreateTextureSwapChainDX(session, device, &desc, &chain));
+		return chain;
+	}
+
+	void OculusManager::DestroySpareOutputChains() {
+		for (const SpareOutputChain &spare : spareOutputChains) {
+			ovr_DestroyTextureSwapChain(session, spare.chain);
+		}
+		spareOutputChains.clear();
 	}
 
 	void OculusManager::EnsureInit(ovrSession session, ovrTextureSwapChain leftEyeChain, ovrTextureSwapChain rightEyeChain) {
 		if (!initialized || session != this->session || leftEyeChain != submittedEyeChains[0] || rightEyeChain != submittedEyeChains[1]) {
-			Shutdown();
+			// the game changed its swapchains; ours can be reused only within the same session
+			ReleaseResources(initialized && session == this->session);
 			Init(session, leftEyeChain, rightEyeChain);
 		}
 	}
@@ -146,6 +199,7 @@ namespace vrperfkit {
 			}
 
 			CheckHotkeys();
+			ProcessControlRequests();
 		}
 		catch (const std::exception &e) {
 			LOG_ERROR << "Failed during post processing: " << e.what();
@@ -182,6 +236,9 @@ namespace vrperfkit {
 			}
 			d3d11Res->submittedTextures[eye][0]->GetDevice(d3d11Res->device.ReleaseAndGetAddressOf());
 			d3d11Res->device->GetImmediateContext(d3d11Res->context.ReleaseAndGetAddressOf());
+			if (d3d11TexturePool == nullptr || d3d11TexturePool->Device() != d3d11Res->device.Get()) {
+				d3d11TexturePool.reset(new D3D11TexturePool(d3d11Res->device));
+			}
 
 			ovrTextureSwapChainDesc chainDesc;
 			Check("getting swapchain description", ovr_GetTextureSwapChainDesc(session, submittedEyeChains[eye], &chainDesc));
@@ -189,7 +246,8 @@ namespace vrperfkit {
 			ovrTextureFormat outputFormat = DetermineOutputFormat(chainDesc);
 			if (chainDesc.SampleCount > 1) {
 				LOG_INFO << "Submitted textures are multi-sampled, creating resolve texture";
-				d3d11Res->resolveTexture[eye] = CreateResolveTexture(d3d11Res->device.Get(), d3d11Res->submittedTextures[0][0].Get());
+				d3d11Res->resolveLease[eye] = d3d11TexturePool->Acquire(ResolveTextureDesc(d3d11Res->submittedTextures[0][0].Get()));
+				d3d11Res->resolveTexture[eye] = d3d11Res->resolveLease[eye].Texture();
 				d3d11Res->multisampled[eye] = true;
 			}
 
@@ -199,6 +257,9 @@ namespace vrperfkit {
 						? d3d11Res->resolveTexture[eye].Get()
 						: d3d11Res->submittedTextures[eye][i].Get());
 				d3d11Res->submittedViews[eye].push_back(view);
+				if (chainDesc.SampleCount > 1) {
+					d3d11Res->multisampledViews[eye].push_back(CreateShaderResourceView(d3d11Res->device.Get(), d3d11Res->submittedTextures[eye][i].Get()));
+				}
 			}
 
 			chainDesc.SampleCount = 1;
@@ -214,7 +275,8 @@ namespace vrperfkit {
 			AdjustOutputResolution(chainDesc.Width, chainDesc.Height);
 			LOG_INFO << "Eye " << eye << ": output resolution is " << chainDesc.Width << "x" << chainDesc.Height;
 			LOG_INFO << "Creating output swapchain in format " << chainDesc.Format;
-			Check("creating output swapchain", ovr_CreateTextureSwapChainDX(session, d3d11Res->device.Get(), &chainDesc, &outputEyeChains[eye]));
+			outputEyeChains[eye] = CreateOutputChain(d3d11Res->device.Get(), chainDesc);
+			outputChainDescs[eye] = chainDesc;
 
 			Check("getting texture swapchain length", ovr_GetTextureSwapChainLength(session, outputEyeChains[eye], &length));
 			for (int i = 0; i < length; ++i) {
@@ -237,11 +299,13 @@ namespace vrperfkit {
 			LOG_INFO << "Game is using a single texture for both eyes";
 			d3d11Res->submittedTextures[1] = d3d11Res->submittedTextures[0];
 			d3d11Res->resolveTexture[1] = d3d11Res->resolveTexture[0];
+			d3d11Res->multisampled[1] = d3d11Res->multisampled[0];
 			d3d11Res->outputTextures[1] = d3d11Res->outputTextures[0];
 			ovrTextureSwapChainDesc chainDesc;
 			Check("getting swapchain description", ovr_GetTextureSwapChainDesc(session, submittedEyeChains[0], &chainDesc));
 			if (chainDesc.ArraySize == 1) {
 				d3d11Res->submittedViews[1] = d3d11Res->submittedViews[0];
+				d3d11Res->multisampledViews[1] = d3d11Res->multisampledViews[0];
 				d3d11Res->outputViews[1] = d3d11Res->outputViews[0];
 				d3d11Res->outputUavs[1] = d3d11Res->outputUavs[0];
 			}
@@ -249,8 +313,13 @@ namespace vrperfkit {
 				LOG_INFO << "Game is using an array texture";
 				d3d11Res->usingArrayTex = true;
 				for (auto tex : d3d11Res->submittedTextures[0]) {
-					auto view = CreateShaderResourceView(d3d11Res->device.Get(), tex.Get(), 1);
-					d3d11Res->submittedViews[1].push_back(view);
+					if (d3d11Res->multisampled[0]) {
+						d3d11Res->multisampledViews[1].push_back(CreateShaderResourceView(d3d11Res->device.Get(), tex.Get(), 1));
+						d3d11Res->submittedViews[1].push_back(CreateShaderResourceView(d3d11Res->device.Get(), d3d11Res->resolveTexture[0].Get(), 1));
+					}
+					else {
+						d3d11Res->submittedViews[1].push_back(CreateShaderResourceView(d3d11Res->device.Get(), tex.Get(), 1));
+					}
 				}
 				for (auto tex : d3d11Res->outputTextures[0]) {
 					auto resolvedTex = d3d11Res->resolveTexture[1] != nullptr ? d3d11Res->resolveTexture[1] : tex;
@@ -274,9 +343,11 @@ namespace vrperfkit {
 
 	void OculusManager::PostProcessD3D11(ovrLayerEyeFovDepth &eyeLayer) {
 		auto projCenters = CalculateProjectionCenter(eyeLayer.Fov);
-		bool successfulPostprocessing = false;
 		bool isFlippedY = eyeLayer.Header.Flags & ovrLayerFlag_TextureOriginAtBottomLeft;
 
+		bool readMultisampled = d3d11Res->postProcessor->AcceptsMultisampledInput();
+
+		D3D11PostProcessInput inputs[2];
 		for (int eye = 0; eye < 2; ++eye) {
 			int index;
 			ovrTextureSwapChain curSwapChain = submittedEyeChains[eye] != nullptr ? submittedEyeChains[eye] : submittedEyeChains[0];
@@ -284,8 +355,9 @@ namespace vrperfkit {
 			// since the current submitted texture has already been committed, the index will point past the current texture
 			index = (index - 1 + d3d11Res->submittedTextures[eye].size()) % d3d11Res->submittedTextures[eye].size();
 
-			// if the incoming texture is multi-sampled, we need to resolve it before we can post-process it
-			if (d3d11Res->multisampled[eye]) {
+			// if the incoming texture is multi-sampled, we need to resolve it before we can post-process it,
+			// unless the upscaler reads the samples directly
+			if (d3d11Res->multisampled[eye] && !readMultisampled) {
 				if (d3d11Res->usingArrayTex || submittedEyeChains[eye] != nullptr) {
 					D3D11_TEXTURE2D_DESC td;
 					d3d11Res->submittedTextures[eye][index]->GetDesc(&td);
@@ -301,9 +373,11 @@ namespace vrperfkit {
 			int outIndex = 0;
 			ovr_GetTextureSwapChainCurrentIndex(session, outputEyeChains[eye], &outIndex);
 
-			D3D11PostProcessInput input;
+			D3D11PostProcessInput &input = inputs[eye];
 			input.inputTexture = d3d11Res->submittedTextures[eye][index].Get();
-			input.inputView = d3d11Res->submittedViews[eye][index].Get();
+			input.inputView = d3d11Res->multisampled[eye] && readMultisampled
+				? d3d11Res->multisampledViews[eye][index].Get()
+				: d3d11Res->submittedViews[eye][index].Get();
 			input.outputTexture = d3d11Res->outputTextures[eye][outIndex].Get();
 			input.outputView = d3d11Res->outputViews[eye][outIndex].Get();
 			input.outputUav = d3d11Res->outputUavs[eye][outIndex].Get();
@@ -327,27 +401,33 @@ namespace vrperfkit {
 			} else {
 				input.mode = TextureMode::SINGLE;
 			}
+		}
+
+		// both eyes are available at once, so process them together
+		Viewport outputViewports[2];
+		bool successfulPostprocessing = d3d11Res->postProcessor->ApplyStereo(inputs, outputViewports);
 
-			Viewport outputViewport;
-			if (d3d11Res->postProcessor->Apply(input, outputViewport)) {
+		for (int eye = 0; eye < 2; ++eye) {
+			if (successfulPostprocessing) {
 				eyeLayer.ColorTexture[eye] = outputEyeChains[eye];
-				eyeLayer.Viewport[eye].Pos.x = outputViewport.x;
-				eyeLayer.Viewport[eye].Pos.y = outputViewport.y;
-				eyeLayer.Viewport[eye].Size.w = outputViewport.width;
-				eyeLayer.Viewport[eye].Size.h = outputViewport.height;
-				successfulPostprocessing = true;
+				eyeLayer.Viewport[eye].Pos.x = outputViewports[eye].x;
+				eyeLayer.Viewport[eye].Pos.y = outputViewports[eye].y;
+				eyeLayer.Viewport[eye].Size.w = outputViewports[eye].width;
+				eyeLayer.Viewport[eye].Size.h = outputViewports[eye].height;
 			}
 
 			D3D11_TEXTURE2D_DESC td;
-			input.inputTexture->GetDesc(&td);
+			inputs[eye].inputTexture->GetDesc(&td);
 			float projLX = projCenters.eyeCenter[0].x;
 			float projLY = isFlippedY ? 1.f - projCenters.eyeCenter[0].y : projCenters.eyeCenter[0].y;
 			float projRX = projCenters.eyeCenter[1].x;
 			float projRY = isFlippedY ? 1.f - projCenters.eyeCenter[1].y : projCenters.eyeCenter[1].y;
-			d3d11Res->variableRateShading->UpdateTargetInformation(td.Width, td.Height, input.mode, projLX, projLY, projRX, projRY);
+			d3d11Res->variableRateShading->UpdateTargetInformation(td.Width, td.Height, inputs[eye].mode, projLX, projLY, projRX, projRY);
 		}
 
 		d3d11Res->variableRateShading->EndFrame();
+		d3d11Res->injector->UpdateInterests();
+		d3d11TexturePool->EndFrame();
 
 		if (successfulPostprocessing) {
 			ovr_CommitTextureSwapChain(session, outputEyeChains[0]);
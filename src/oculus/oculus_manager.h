@@ -3,9 +3,13 @@
 #include "types.h"
 
 #include <memory>
+#include <vector>
+
+struct ID3D11Device;
 
 namespace vrperfkit {
 	struct OculusD3D11Resources;
+	class D3D11TexturePool;
 
 	class OculusManager {
 	public:
@@ -22,9 +26,25 @@ namespace vrperfkit {
 		ovrSession session = nullptr;
 		ovrTextureSwapChain submittedEyeChains[2] = { nullptr, nullptr };
 		ovrTextureSwapChain outputEyeChains[2] = { nullptr, nullptr };
+		ovrTextureSwapChainDesc outputChainDescs[2];
+
+		// Output swapchains of the previous initialization of the same session, which a reinitialization takes
+		// over if their description matches. Their textures keep the device alive, so its address stays unique.
+		struct SpareOutputChain {
+			ovrTextureSwapChain chain;
+			ovrTextureSwapChainDesc desc;
+			ID3D11Device *device;
+		};
+		std::vector<SpareOutputChain> spareOutputChains;
 
 		ProjectionCenters CalculateProjectionCenter(const ovrFovPort *fov);
 
+		void ReleaseResources(bool keepOutputChains);
+		ovrTextureSwapChain CreateOutputChain(ID3D11Device *device, const ovrTextureSwapChainDesc &desc);
+		void DestroySpareOutputChains();
+
+		// kept across reinitializations, so must be declared before (and thus destroyed after) the resources
+		std::unique_ptr<D3D11TexturePool> d3d11TexturePool;
 		std::unique_ptr<OculusD3D11Resources> d3d11Res;
 		void InitD3D11();
 
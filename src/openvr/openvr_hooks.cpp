@@ -5,6 +5,7 @@
 #include "openvr.h"
 #include "openvr_manager.h"
 #include "resolution_scaling.h"
+#include "temporal/temporal_jitter.h"
 
 namespace vrperfkit {
 	extern HMODULE g_moduleSelf;
@@ -15,7 +16,7 @@ namespace vrperfkit {
 		int g_systemVersion = 0;
 
 		void IVRSystemHook_GetRecommendedRenderTargetSize(vr::IVRSystem *self, uint32_t *pnWidth, uint32_t *pnHeight) {
-			hooks::CallOriginal(IVRSystemHook_GetRecommendedRenderTargetSize)(self, pnWidth, pnHeight);
+			hooks::CallOriginal<IVRSystemHook_GetRecommendedRenderTargetSize>()(self, pnWidth, pnHeight);
 
 			if (pnWidth == nullptr || pnHeight == nullptr) {
 				return;
@@ -24,42 +25,81 @@ namespace vrperfkit {
 			AdjustRenderResolution(*pnWidth, *pnHeight);
 		}
 
+		// set while the runtime computes a projection matrix, in case it does so through GetProjectionRaw
+		thread_local bool t_inProjectionMatrix = false;
+
+		// The projection hooks shift the eye's projection by the temporal jitter. Like all member functions that
+		// return a struct on MSVC, GetProjectionMatrix takes a hidden pointer to the result after this.
+		vr::HmdMatrix44_t * IVRSystemHook_GetProjectionMatrix(vr::IVRSystem *self, vr::HmdMatrix44_t *result, vr::EVREye eEye, float fNearZ, float fFarZ) {
+			t_inProjectionMatrix = true;
+			hooks::CallOriginal<IVRSystemHook_GetProjectionMatrix>()(self, result, eEye, fNearZ, fFarZ);
+			t_inProjectionMatrix = false;
+			if (result->m[3][2] != 0) {
+				JitterProjectionMatrix(g_openVr.GetProjectionJitter(eEye, ProjectionCentre(result->m)), result->m);
+			}
+			return result;
+		}
+
+		void IVRSystemHook_GetProjectionRaw(vr::IVRSystem *self, vr::EVREye eEye, float *pfLeft, float *pfRight, float *pfTop, float *pfBottom) {
+			hooks::CallOriginal<IVRSystemHook_GetProjectionRaw>()(self, eEye, pfLeft, pfRight, pfTop, pfBottom);
+			if (t_inProjectionMatrix || pfLeft == nullptr || pfRight == nullptr || pfTop == nullptr || pfBottom == nullptr
+					|| *pfLeft == *pfRight || *pfTop == *pfBottom) {
+				return;
+			}
+			Point<float> centre = ProjectionCentreRaw(*pfLeft, *pfRight, *pfTop, *pfBottom);
+			JitterProjectionRaw(g_openVr.GetProjectionJitter(eEye, centre), *pfLeft, *pfRight, *pfTop, *pfBottom);
+		}
+
+		// passes the submit on to the compositor, preceded by the left eye if OpenVrManager held it back
+		template<typename SubmitFn>
+		vr::EVRCompositorError ProcessAndSubmit(OpenVrSubmitInfo &info, SubmitFn submit) {
+			if (!g_openVr.OnSubmit(info)) {
+				return vr::VRCompositorError_None;
+			}
+			g_openVr.PreCompositorWorkCall(true);
+			OpenVrSubmitInfo deferred;
+			if (g_openVr.TakeDeferredSubmit(deferred)) {
+				auto error = submit(deferred);
+				if (error != vr::VRCompositorError_None) {
+					LOG_DEBUG << "OpenVR submit of the held back left eye failed: " << error;
+				}
+			}
+			auto error = submit(info);
+			g_openVr.PostCompositorWorkCall(true);
+			return error;
+		}
+
 		vr::EVRCompositorError IVRCompositor009Hook_Submit(vr::IVRCompositor *self, vr::EVREye eEye, const vr::Texture_t *pTexture, const vr::VRTextureBounds_t *pBounds, vr::EVRSubmitFlags nSubmitFlags) {
 			OpenVrSubmitInfo info { eEye, pTexture, pBounds, nSubmitFlags };
-			g_openVr.OnSubmit(info);
-			g_openVr.PreCompositorWorkCall(true);
-			auto error = hooks::CallOriginal(IVRCompositor009Hook_Submit)(self, info.eye, info.texture, info.bounds, info.submitFlags);
+			auto error = ProcessAndSubmit(info, [self](const OpenVrSubmitInfo &info) {
+				return hooks::CallOriginal<IVRCompositor009Hook_Submit>()(self, info.eye, info.texture, info.bounds, info.submitFlags);
+			});
 			if (error != vr::VRCompositorError_None) {
 				LOG_DEBUG << "OpenVR submit failed: " << error;
 			}
-			g_openVr.PostCompositorWorkCall(true);
 			return error;
 		}
 
 		vr::EVRCompositorError IVRCompositor008Hook_Submit(vr::IVRCompositor *self, vr::EVREye eEye, unsigned int eTextureType, void *pTexture, const vr::VRTextureBounds_t *pBounds, vr::EVRSubmitFlags nSubmitFlags) {
 			vr::Texture_t texInfo { pTexture, (vr::ETextureType)eTextureType, vr::ColorSpace_Auto };
 			OpenVrSubmitInfo info { eEye, &texInfo, pBounds, nSubmitFlags };
-			g_openVr.OnSubmit(info);
-			g_openVr.PreCompositorWorkCall(true);
-			auto error = hooks::CallOriginal(IVRCompositor008Hook_Submit)(self, info.eye, info.texture->eType, info.texture->handle, info.bounds, info.submitFlags);
-			g_openVr.PostCompositorWorkCall(true);
-			return error;
+			return ProcessAndSubmit(info, [self](const OpenVrSubmitInfo &info) {
+				return hooks::CallOriginal<IVRCompositor008Hook_Submit>()(self, info.eye, info.texture->eType, info.texture->handle, info.bounds, info.submitFlags);
+			});
 		}
 
 		vr::EVRCompositorError IVRCompositor007Hook_Submit(vr::IVRCompositor *self, vr::EVREye eEye, unsigned int eTextureType, void *pTexture, const vr::VRTextureBounds_t *pBounds) {
 			vr::Texture_t texInfo { pTexture, (vr::ETextureType)eTextureType, vr::ColorSpace_Auto };
 			OpenVrSubmitInfo info { eEye, &texInfo, pBounds, vr::Submit_Default };
-			g_openVr.OnSubmit(info);
-			g_openVr.PreCompositorWorkCall(true);
-			auto error = hooks::CallOriginal(IVRCompositor007Hook_Submit)(self, info.eye, info.texture->eType, info.texture->handle, info.bounds);
-			g_openVr.PostCompositorWorkCall(true);
-			return error;
+			return ProcessAndSubmit(info, [self](const OpenVrSubmitInfo &info) {
+				return hooks::CallOriginal<IVRCompositor007Hook_Submit>()(self, info.eye, info.texture->eType, info.texture->handle, info.bounds);
+			});
 		}
 
 		vr::EVRCompositorError IVRCompositorHook_WaitGetPoses(vr::IVRCompositor *self, vr::TrackedDevicePose_t *pRenderPoseArray, uint32_t unRenderPoseArrayCount,
 				vr::TrackedDevicePose_t *pGamePoseArray, uint32_t unGamePoseArrayCount) {
 			g_openVr.PreWaitGetPoses();
-			auto error = hooks::CallOriginal(IVRCompositorHook_WaitGetPoses)(self, pRenderPoseArray, unRenderPoseArrayCount, pGamePoseArray, unGamePoseArrayCount);
+			auto error = hooks::CallOriginal<IVRCompositorHook_WaitGetPoses>()(self, pRenderPoseArray, unRenderPoseArrayCount, pGamePoseArray, unGamePoseArrayCount);
 			g_openVr.PostWaitGetPoses();
 			if (error != vr::VRCompositorError_None) {
 				LOG_DEBUG << "OpenVR WaitGetPoses failed: " << error;
@@ -69,42 +109,44 @@ namespace vrperfkit {
 
 		void IVRCompositorHook_PostPresentHandoff(vr::IVRCompositor *self) {
 			g_openVr.PreCompositorWorkCall();
-			hooks::CallOriginal(IVRCompositorHook_PostPresentHandoff)(self);
+			hooks::CallOriginal<IVRCompositorHook_PostPresentHandoff>()(self);
 			g_openVr.PostCompositorWorkCall();
 		}
 
 		void *Hook_VRClientCoreFactory(const char *pInterfaceName, int *pReturnCode) {
-			void *instance = hooks::CallOriginal(Hook_VRClientCoreFactory)(pInterfaceName, pReturnCode);
+			void *instance = hooks::CallOriginal<Hook_VRClientCoreFactory>()(pInterfaceName, pReturnCode);
 			HookOpenVrInterface(pInterfaceName, instance);
 			return instance;
 		}
 
 		void *IVRClientCoreHook_GetGenericInterface(void *self, const char *interfaceName, vr::EVRInitError *error) {
-			void *instance = hooks::CallOriginal(IVRClientCoreHook_GetGenericInterface)(self, interfaceName, error);
+			void *instance = hooks::CallOriginal<IVRClientCoreHook_GetGenericInterface>()(self, interfaceName, error);
 			HookOpenVrInterface(interfaceName, instance);
 			return instance;
 		}
 
 		void IVRClientCoreHook_Cleanup(void *self) {
-			hooks::CallOriginal(IVRClientCoreHook_Cleanup)(self);
+			hooks::CallOriginal<IVRClientCoreHook_Cleanup>()(self);
 			LOG_INFO << "IVRClientCore::Cleanup was called, deleting hooks...";
-			hooks::RemoveHook((void*)&IVRClientCoreHook_GetGenericInterface);
-			hooks::RemoveHook((void*)&IVRClientCoreHook_Cleanup);
-			hooks::RemoveHook((void*)IVRCompositor009Hook_Submit);
-			hooks::RemoveHook((void*)IVRCompositor008Hook_Submit);
-			hooks::RemoveHook((void*)IVRCompositor007Hook_Submit);
-			hooks::RemoveHook((void*)IVRSystemHook_GetRecommendedRenderTargetSize);
-			hooks::RemoveHook((void*)IVRCompositorHook_WaitGetPoses);
-			hooks::RemoveHook((void*)IVRCompositorHook_PostPresentHandoff);
+			hooks::RemoveHook<IVRClientCoreHook_GetGenericInterface>();
+			hooks::RemoveHook<IVRClientCoreHook_Cleanup>();
+			hooks::RemoveHook<IVRCompositor009Hook_Submit>();
+			hooks::RemoveHook<IVRCompositor008Hook_Submit>();
+			hooks::RemoveHook<IVRCompositor007Hook_Submit>();
+			hooks::RemoveHook<IVRSystemHook_GetRecommendedRenderTargetSize>();
+			hooks::RemoveHook<IVRSystemHook_GetProjectionMatrix>();
+			hooks::RemoveHook<IVRSystemHook_GetProjectionRaw>();
+			hooks::RemoveHook<IVRCompositorHook_WaitGetPoses>();
+			hooks::RemoveHook<IVRCompositorHook_PostPresentHandoff>();
 			g_compositorVersion = 0;
 			g_systemVersion = 0;
 		}
 	}
 
-	void InstallOpenVrHooks() {
+	bool InstallOpenVrHooks() {
 		static bool hooksLoaded = false;
 		if (hooksLoaded) {
-			return;
+			return true;
 		}
 
 #ifdef WIN64
@@ -113,14 +155,19 @@ namespace vrperfkit {
 		std::wstring dllName = L"vrclient.dll";
 #endif
 		HMODULE handle;
-		if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_PIN, dllName.c_str(), &handle) || handle == g_moduleSelf) {
-			return;
+		if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_PIN, dllName.c_str(), &handle)) {
+			return false;
+		}
+		if (handle == g_moduleSelf) {
+			// we are acting as the vrclient proxy ourselves, so there is nothing to hook
+			return true;
 		}
 
 		LOG_INFO << dllName << " is loaded in the process, installing hooks...";
-		hooks::InstallHookInDll("VRClientCoreFactory", handle, (void*)Hook_VRClientCoreFactory);
+		hooks::InstallHookInDll<Hook_VRClientCoreFactory>("VRClientCoreFactory", handle);
 
 		hooksLoaded = true;
+		return true;
 	}
 
 	void HookOpenVrInterface(const char *interfaceName, void *instance) {
@@ -130,11 +177,11 @@ namespace vrperfkit {
 		}
 
 		if (unsigned int version = 0; std::sscanf(interfaceName, "IVRClientCore_%u", &version)) {
-			hooks::RemoveHook((void*)&IVRClientCoreHook_Cleanup);
-			hooks::RemoveHook((void*)&IVRClientCoreHook_GetGenericInterface);
+			hooks::RemoveHook<IVRClientCoreHook_Cleanup>();
+			hooks::RemoveHook<IVRClientCoreHook_GetGenericInterface>();
 			if (version <= 3) {
-				hooks::InstallVirtualFunctionHook("IVRClientCore::GetGenericInterface", instance, 3, (void*)&IVRClientCoreHook_GetGenericInterface);
-				hooks::InstallVirtualFunctionHook("IVRClientCore::Cleanup", instance, 1, (void*)&IVRClientCoreHook_Cleanup);
+				hooks::InstallVirtualFunctionHook<IVRClientCoreHook_GetGenericInterface>("IVRClientCore::GetGenericInterface", instance, 3);
+				hooks::InstallVirtualFunctionHook<IVRClientCoreHook_Cleanup>("IVRClientCore::Cleanup", instance, 1);
 				g_clientCoreInstance = instance;
 			}
 			else {
@@ -145,19 +192,19 @@ namespace vrperfkit {
 		if (g_compositorVersion == 0 && std::sscanf(interfaceName, "IVRCompositor_%u", &g_compositorVersion)) {
 			// FIXME: investigate older versions
 			if (g_compositorVersion >= 15) {
-				hooks::InstallVirtualFunctionHook("IVRCompositor::WaitGetPoses", instance, 2, (void*)&IVRCompositorHook_WaitGetPoses);
-				hooks::InstallVirtualFunctionHook("IVRCompositor::PostPresentHandoff", instance, 7, (void*)&IVRCompositorHook_PostPresentHandoff);
+				hooks::InstallVirtualFunctionHook<IVRCompositorHook_WaitGetPoses>("IVRCompositor::WaitGetPoses", instance, 2);
+				hooks::InstallVirtualFunctionHook<IVRCompositorHook_PostPresentHandoff>("IVRCompositor::PostPresentHandoff", instance, 7);
 			}
 
 			if (g_compositorVersion >= 9) {
 				uint32_t methodPos = g_compositorVersion >= 12 ? 5 : 4;
-				hooks::InstallVirtualFunctionHook("IVRCompositor::Submit", instance, methodPos, (void*)&IVRCompositor009Hook_Submit);
+				hooks::InstallVirtualFunctionHook<IVRCompositor009Hook_Submit>("IVRCompositor::Submit", instance, methodPos);
 			}
 			else if (g_compositorVersion == 8) {
-				hooks::InstallVirtualFunctionHook("IVRCompositor::Submit", instance, 6, (void*)&IVRCompositor008Hook_Submit);
+				hooks::InstallVirtualFunctionHook<IVRCompositor008Hook_Submit>("IVRCompositor::Submit", instance, 6);
 			}
 			else if (g_compositorVersion == 7) {
-				hooks::InstallVirtualFunctionHook("IVRCompositor::Submit", instance, 6, (void*)&IVRCompositor007Hook_Submit);
+				hooks::InstallVirtualFunctionHook<IVRCompositor007Hook_Submit>("IVRCompositor::Submit", instance, 6);
 			}
 			else {
 				LOG_ERROR << "Don't know how to inject into version " << g_compositorVersion << " of IVRCompositor";
@@ -166,7 +213,15 @@ namespace vrperfkit {
 
 		if (g_systemVersion == 0 && std::sscanf(interfaceName, "IVRSystem_%u", &g_systemVersion)) {
 			uint32_t methodPos = (g_systemVersion >= 9 ? 0 : 1);
-			hooks::InstallVirtualFunctionHook("IVRSystem::GetRecommendedRenderTargetSize", instance, methodPos, (void*)&IVRSystemHook_GetRecommendedRenderTargetSize);
+			hooks::InstallVirtualFunctionHook<IVRSystemHook_GetRecommendedRenderTargetSize>("IVRSystem::GetRecommendedRenderTargetSize", instance, methodPos);
+
+			// older versions take an extra graphics API parameter for the projection matrix, or order the methods differently
+			if (g_systemVersion >= 15) {
+				hooks::InstallVirtualFunctionHook<IVRSystemHook_GetProjectionMatrix>("IVRSystem::GetProjectionMatrix", instance, 1);
+			}
+			if (g_systemVersion >= 9) {
+				hooks::InstallVirtualFunctionHook<IVRSystemHook_GetProjectionRaw>("IVRSystem::GetProjectionRaw", instance, 2);
+			}
 		}
 	}
 
@@ -2,7 +2,8 @@
 #include "openvr.h"
 
 namespace vrperfkit {
-	void InstallOpenVrHooks();
+	// returns true once the runtime has been found and hooked
+	bool InstallOpenVrHooks();
 
 	void HookOpenVrInterface(const char *interfaceName, void *instance);
 
@@ -1,5 +1,6 @@
 #include "openvr_manager.h"
 
+#include "control_server.h"
 #include "hotkeys.h"
 #include "logging.h"
 #include "openvr_hooks.h"
@@ -7,11 +8,16 @@
 
 #include "d3d11/d3d11_helper.h"
 #include "d3d11/d3d11_post_processor.h"
+#include "d3d11/d3d11_texture_pool.h"
 #include "d3d11/d3d11_variable_rate_shading.h"
 
+#include "temporal/temporal_jitter.h"
+
 #include "dxgi/dxgi_interfaces.h"
 
+#include <DirectXMath.h>
 #include <unordered_map>
+#include <vector>
 
 namespace vrperfkit {
 	OpenVrManager g_openVr;
@@ -19,6 +25,39 @@ namespace vrperfkit {
 	using namespace vr;
 
 	namespace {
+		// copies as much of the texture info as the submit flags say it has
+		void CopyTexInfo(std::unique_ptr<Texture_t> &copy, const Texture_t *input, EVRSubmitFlags submitFlags) {
+			if ((submitFlags & Submit_TextureWithDepth) && (submitFlags & Submit_TextureWithPose)) {
+				copy.reset(new VRTextureWithPoseAndDepth_t);
+				memcpy(copy.get(), input, sizeof(VRTextureWithPoseAndDepth_t));
+			}
+			else if (submitFlags & Submit_TextureWithDepth) {
+				copy.reset(new VRTextureWithDepth_t);
+				memcpy(copy.get(), input, sizeof(VRTextureWithDepth_t));
+			}
+			else if (submitFlags & Submit_TextureWithPose) {
+				copy.reset(new VRTextureWithPose_t);
+				memcpy(copy.get(), input, sizeof(VRTextureWithPose_t));
+			}
+			else {
+				copy.reset(new Texture_t);
+				memcpy(copy.get(), input, sizeof(Texture_t));
+			}
+		}
+
+		DirectX::XMMATRIX LoadMatrix(const HmdMatrix44_t &m) {
+			return DirectX::XMLoadFloat4x4(reinterpret_cast<const DirectX::XMFLOAT4X4*>(&m));
+		}
+
+		DirectX::XMMATRIX LoadMatrix(const HmdMatrix34_t &m) {
+			DirectX::XMFLOAT4X4 full(
+				m.m[0][0], m.m[0][1], m.m[0][2], m.m[0][3],
+				m.m[1][0], m.m[1][1], m.m[1][2], m.m[1][3],
+				m.m[2][0], m.m[2][1], m.m[2][2], m.m[2][3],
+				0, 0, 0, 1);
+			return DirectX::XMLoadFloat4x4(&full);
+		}
+
 		DXGI_FORMAT DetermineOutputFormat(DXGI_FORMAT inputFormat) {
 			switch (inputFormat) {
 			case DXGI_FORMAT_R10G10B10A2_UNORM:
@@ -27,6 +66,17 @@ namespace vrperfkit {
 				// with R8G8B8 textures, so we have to use a matching texture format for our own resources.
 				// Otherwise we'll get darkened pictures (applies to Revive mostly)
 				return DXGI_FORMAT_R10G10B10A2_UNORM;
+			case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+				return DXGI_FORMAT_R32G32B32A32_FLOAT;
+			case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+			// these can't be written through a UAV on all hardware, FP16 still keeps their range
+			case DXGI_FORMAT_R32G32B32_FLOAT:
+			case DXGI_FORMAT_R32G32B32_TYPELESS:
+			case DXGI_FORMAT_R11G11B10_FLOAT:
+				// keep HDR values and precision instead of clamping them to 8 bits, see IsHdrView
+				return DXGI_FORMAT_R16G16B16A16_FLOAT;
 			default:
 				return DXGI_FORMAT_R8G8B8A8_UNORM;
 			}
@@ -56,35 +106,109 @@ namespace vrperfkit {
 		std::unique_ptr<D3D11Injector> injector;
 		ComPtr<ID3D11Device> device;
 		ComPtr<ID3D11DeviceContext> context;
-		ComPtr<ID3D11Texture2D> resolveTexture;
-		ComPtr<ID3D11ShaderResourceView> resolveView;
-		ComPtr<ID3D11Texture2D> outputTexture;
-		ComPtr<ID3D11ShaderResourceView> outputView;
-		ComPtr<ID3D11UnorderedAccessView> outputUav;
+		// both come from the manager's texture pool, which outlives these resources
+		D3D11TextureLease resolveTexture;
+		D3D11TextureLease outputTexture;
+		// the output texture is only acquired once it is needed, i.e. not while sharpening in place
+		D3D11_TEXTURE2D_DESC outputDesc;
+		// textures that can't be bound directly always need a copy, multi-sampled textures only if the upscaler can't read them
 		bool requiresResolve;
+		bool multisampled;
 		bool usingArrayTex;
+		// sharpening without upscaling may write back into the submitted texture, which then needs no output texture
+		bool canSharpenInPlace;
+		bool sharpenInPlace = false;
+
+		// texture the right eye was last submitted from, the left eye is only held back if it is the same
+		ID3D11Texture2D *lastRightTexture = nullptr;
 
 		struct EyeViews {
 			ComPtr<ID3D11ShaderResourceView> view[2];
 		};
 		std::unordered_map<ID3D11Texture2D*, EyeViews> inputViews;
+		std::unordered_map<ID3D11Texture2D*, EyeViews> depthViews;
+
+		struct EyeUavs {
+			ComPtr<ID3D11UnorderedAccessView> uav[2];
+		};
+		std::unordered_map<ID3D11Texture2D*, EyeUavs> inPlaceUavs;
+
+		// Sharpening in place is not idempotent, so a texture the game submits again for the same frame,
+		// e.g. while it hitches or loads, must not be sharpened a second time.
+		struct InPlaceFrame {
+			ID3D11Texture2D *texture = nullptr;
+			uint64_t frame = 0;
+		} sharpenedInPlace[2];
+
+		bool WasSharpenedInPlace(ID3D11Texture2D *inputTexture, int eye, uint64_t frame) const {
+			return sharpenedInPlace[eye].texture == inputTexture && sharpenedInPlace[eye].frame == frame;
+		}
+
+		// game projection and last frame's view projection of each eye, used to reproject the temporal history
+		struct TemporalEyeState {
+			bool hasProjection = false;
+			HmdMatrix44_t projection;
+			bool hasPrevious = false;
+			DirectX::XMFLOAT4X4 previousViewProjection;
+			// set once the submitted projection could not be matched to the runtime's; the jitter is then left off,
+			// as it could not be told apart from the game's own offsets
+			bool unknownProjection = false;
+		} temporal[2];
+
+		// texels outside of the viewport the post-processing filters may read
+		static const UINT FILTER_REACH = 2;
+		// regions of the submitted textures already copied to the resolve texture this frame
+		struct ResolvedRegion {
+			ID3D11Texture2D *texture;
+			UINT subresource;
+			D3D11_BOX box;
+		};
+		std::vector<ResolvedRegion> resolvedRegions;
+		ComPtr<ID3D11ShaderResourceView> resolveViews[2];
+
+		bool IsAlreadyResolved(ID3D11Texture2D *inputTexture, UINT subresource, const D3D11_BOX &box) const {
+			for (const ResolvedRegion &r : resolvedRegions) {
+				if (r.texture == inputTexture && r.subresource == subresource
+						&& r.box.left <= box.left && r.box.top <= box.top && r.box.right >= box.right && r.box.bottom >= box.bottom) {
+					return true;
+				}
+			}
+			return false;
+		}
 
-		ID3D11ShaderResourceView *GetInputView(ID3D11Texture2D *inputTexture, int eye) {
+		ID3D11ShaderResourceView *GetInputView(ID3D11Texture2D *inputTexture, int eye, const Viewport &viewport, bool resolve) {
 			D3D11_TEXTURE2D_DESC td;
 			inputTexture->GetDesc(&td);
 
-			if (requiresResolve) {
+			if (resolve) {
+				UINT subresource = D3D11CalcSubresource(0, td.ArraySize > 1 ? eye : 0, td.MipLevels);
+				D3D11_BOX region;
+				region.front = 0;
+				region.back = 1;
 				if (td.SampleDesc.Count > 1) {
-					context->ResolveSubresource(resolveTexture.Get(), 0, inputTexture, 0, td.Format);
-				} else {
-					D3D11_BOX region;
-					region.left = region.top = region.front = 0;
+					// multi-sampled resolves always cover the whole subresource
+					region.left = region.top = 0;
 					region.right = td.Width;
 					region.bottom = td.Height;
-					region.back = 1;
-					context->CopySubresourceRegion(resolveTexture.Get(), 0, 0, 0, 0, inputTexture, 0, &region);
+				} else {
+					// only copy what this eye is going to read: the viewport plus the texels the EASU, bilinear and
+					// RCAS taps reach beyond it, which would otherwise be stale in the resolve texture
+					region.left = viewport.x > FILTER_REACH ? min(viewport.x - FILTER_REACH, td.Width) : 0;
+					region.top = viewport.y > FILTER_REACH ? min(viewport.y - FILTER_REACH, td.Height) : 0;
+					region.right = min(viewport.x + viewport.width + FILTER_REACH, td.Width);
+					region.bottom = min(viewport.y + viewport.height + FILTER_REACH, td.Height);
+				}
+
+				if (!IsAlreadyResolved(inputTexture, subresource, region)) {
+					UINT resolveSubresource = D3D11CalcSubresource(0, td.ArraySize > 1 ? eye : 0, 1);
+					if (td.SampleDesc.Count > 1) {
+						context->ResolveSubresource(resolveTexture.Texture(), resolveSubresource, inputTexture, subresource, td.Format);
+					} else {
+						context->CopySubresourceRegion(resolveTexture.Texture(), resolveSubresource, region.left, region.top, 0, inputTexture, subresource, &region);
+					}
+					resolvedRegions.push_back({ inputTexture, subresource, region });
 				}
-				return resolveView.Get();
+				return resolveViews[eye].Get();
 			}
 
 			if (inputViews.find(inputTexture) == inputViews.end()) {
@@ -101,6 +225,42 @@ namespace vrperfkit {
 
 			return inputViews[inputTexture].view[eye].Get();
 		}
+
+		ID3D11ShaderResourceView *GetDepthView(ID3D11Texture2D *depthTexture, int eye) {
+			if (depthViews.find(depthTexture) == depthViews.end()) {
+				LOG_INFO << "Creating shader resource view for depth texture " << depthTexture;
+				D3D11_TEXTURE2D_DESC td;
+				depthTexture->GetDesc(&td);
+				EyeViews &views = depthViews[depthTexture];
+				views.view[0] = CreateShaderResourceView(device.Get(), depthTexture);
+				if (td.ArraySize > 1) {
+					views.view[1] = CreateShaderResourceView(device.Get(), depthTexture, 1);
+				}
+				else {
+					views.view[1] = views.view[0];
+				}
+			}
+
+			return depthViews[depthTexture].view[eye].Get();
+		}
+
+		ID3D11UnorderedAccessView *GetInPlaceUav(ID3D11Texture2D *inputTexture, int eye) {
+			if (inPlaceUavs.find(inputTexture) == inPlaceUavs.end()) {
+				LOG_INFO << "Creating unordered access view for input texture " << inputTexture;
+				D3D11_TEXTURE2D_DESC td;
+				inputTexture->GetDesc(&td);
+				EyeUavs &uavs = inPlaceUavs[inputTexture];
+				uavs.uav[0] = CreateUnorderedAccessView(device.Get(), inputTexture);
+				if (td.ArraySize > 1) {
+					uavs.uav[1] = CreateUnorderedAccessView(device.Get(), inputTexture, 1);
+				}
+				else {
+					uavs.uav[1] = uavs.uav[0];
+				}
+			}
+
+			return inPlaceUavs[inputTexture].uav[eye].Get();
+		}
 	};
 
 	struct OpenVrDxvkResources {
@@ -120,9 +280,9 @@ namespace vrperfkit {
 		textureHeight = 0;
 	}
 
-	void OpenVrManager::OnSubmit(OpenVrSubmitInfo &info) {
+	bool OpenVrManager::OnSubmit(OpenVrSubmitInfo &info) {
 		if (failed || info.texture == nullptr || info.texture->handle == nullptr) {
-			return;
+			return true;
 		}
 
 		static VRTextureBounds_t defaultBounds { 0, 0, 1, 1 };
@@ -130,14 +290,18 @@ namespace vrperfkit {
 			info.bounds = &defaultBounds;
 		}
 
+		bool submitNow = true;
 		try {
 			EnsureInit(info);
 			if (!initialized || failed) {
-				return;
+				return true;
 			}
 
 			if (graphicsApi == GraphicsApi::D3D11) {
-				PostProcessD3D11(info);
+				submitNow = !DeferD3D11Submit(info);
+				if (submitNow) {
+					PostProcessD3D11(info);
+				}
 			}
 
 			if (graphicsApi == GraphicsApi::DXVK) {
@@ -150,7 +314,11 @@ namespace vrperfkit {
 			failed = true;
 		}
 
-		CheckHotkeys();
+		if (info.eye == Eye_Right) {
+			CheckHotkeys();
+			ProcessControlRequests();
+		}
+		return submitNow;
 	}
 
 	void OpenVrManager::PreCompositorWorkCall(bool transition) {
@@ -212,6 +380,10 @@ namespace vrperfkit {
 	}
 
 	void OpenVrManager::PostWaitGetPoses() {
+		++frameIndex;
+		if (jitter.active.load(std::memory_order_relaxed)) {
+			jitter.phase.fetch_add(1, std::memory_order_relaxed);
+		}
 		if (graphicsApi == GraphicsApi::DXVK) {
 			PreCompositorWorkCall();
 			compositor->SubmitExplicitTimingData();
@@ -219,6 +391,20 @@ namespace vrperfkit {
 		}
 	}
 
+	Point<float> OpenVrManager::GetProjectionJitter(EVREye eye, Point<float> centre) {
+		if (eye != Eye_Left && eye != Eye_Right) {
+			return { 0, 0 };
+		}
+		jitter.centreX[eye].store(centre.x, std::memory_order_relaxed);
+		jitter.centreY[eye].store(centre.y, std::memory_order_relaxed);
+		jitter.hasCentre[eye].store(true, std::memory_order_release);
+		if (!jitter.active.load(std::memory_order_relaxed)) {
+			return { 0, 0 };
+		}
+		Point<float> pixels = TemporalJitterPixels(jitter.phase.load(std::memory_order_relaxed));
+		return { pixels.x * jitter.pixelWidth.load(std::memory_order_relaxed), pixels.y * jitter.pixelHeight.load(std::memory_order_relaxed) };
+	}
+
 	void OpenVrManager::EnsureInit(const OpenVrSubmitInfo &info) {
 		if (info.texture->eType == TextureType_DirectX) {
 			ID3D11Texture2D *d3d11Tex = (ID3D11Texture2D*)info.texture->handle;
@@ -270,6 +456,9 @@ namespace vrperfkit {
 		tex->GetDesc(&td);
 		tex->GetDevice(d3d11Res->device.GetAddressOf());
 		d3d11Res->device->GetImmediateContext(d3d11Res->context.GetAddressOf());
+		if (d3d11TexturePool == nullptr || d3d11TexturePool->Device() != d3d11Res->device.Get()) {
+			d3d11TexturePool.reset(new D3D11TexturePool(d3d11Res->device));
+		}
 		d3d11Res->variableRateShading.reset(new D3D11VariableRateShading(d3d11Res->device));
 		d3d11Res->postProcessor.reset(new D3D11PostProcessor(d3d11Res->device));
 		
@@ -281,19 +470,27 @@ namespace vrperfkit {
 		textureWidth = td.Width;
 		textureHeight = td.Height;
 		d3d11Res->usingArrayTex = td.ArraySize > 1;
-		d3d11Res->requiresResolve = td.SampleDesc.Count > 1 || !(td.BindFlags & D3D11_BIND_SHADER_RESOURCE) || IsSrgbFormat(td.Format);
+		d3d11Res->requiresResolve = !(td.BindFlags & D3D11_BIND_SHADER_RESOURCE) || IsSrgbFormat(td.Format);
+		d3d11Res->multisampled = td.SampleDesc.Count > 1;
 
 		if (d3d11Res->requiresResolve) {
 			LOG_INFO << "Input texture can't be bound directly, need to resolve";
-			d3d11Res->resolveTexture = CreateResolveTexture(d3d11Res->device.Get(), tex, MakeSrgbFormatsTypeless(td.Format));
-			d3d11Res->resolveView = CreateShaderResourceView(d3d11Res->device.Get(), d3d11Res->resolveTexture.Get());
+			CreateResolveTexture(tex);
+		}
+		else if (d3d11Res->multisampled) {
+			LOG_INFO << "Input texture is multi-sampled, will be resolved only if the upscaler can't read it directly";
 		}
 
 		uint32_t outputWidth = td.Width, outputHeight = td.Height;
 		AdjustOutputResolution(outputWidth, outputHeight);
-		d3d11Res->outputTexture = CreatePostProcessTexture(d3d11Res->device.Get(), outputWidth, outputHeight, DetermineOutputFormat(td.Format));
-		d3d11Res->outputView = CreateShaderResourceView(d3d11Res->device.Get(), d3d11Res->outputTexture.Get());
-		d3d11Res->outputUav = CreateUnorderedAccessView(d3d11Res->device.Get(), d3d11Res->outputTexture.Get());
+		// acquired with the first frame that can't be sharpened in place
+		d3d11Res->outputDesc = PostProcessTextureDesc(outputWidth, outputHeight, DetermineOutputFormat(td.Format));
+		d3d11Res->canSharpenInPlace = !d3d11Res->requiresResolve && !d3d11Res->multisampled
+				&& (td.BindFlags & D3D11_BIND_UNORDERED_ACCESS) && outputWidth == td.Width && outputHeight == td.Height
+				&& SupportsTypedUavLoad(d3d11Res->device.Get(), td.Format);
+		if (d3d11Res->canSharpenInPlace) {
+			LOG_INFO << "Input texture can be sharpened in place, if the upscaler supports it";
+		}
 
 		CalculateProjectionCenters();
 		CalculateEyeTextureAspectRatio();
@@ -370,69 +567,298 @@ namespace vrperfkit {
 		aspectRatio = float(width) / height;
 	}
 
-	void OpenVrManager::PostProcessD3D11(OpenVrSubmitInfo &info) {
-		ID3D11Texture2D *inputTexture = reinterpret_cast<ID3D11Texture2D *>(info.texture->handle);
-		D3D11_TEXTURE2D_DESC itd, otd;
-		inputTexture->GetDesc(&itd);
-		d3d11Res->outputTexture->GetDesc(&otd);
+	TextureMode OpenVrManager::DetermineTextureMode(uint32_t width, uint32_t height, const VRTextureBounds_t &bounds) const {
+		if (d3d11Res->usingArrayTex) {
+			return TextureMode::ARRAY;
+		}
+		bool isCombinedTex = float(width) / height >= 1.5f * aspectRatio && std::abs(bounds.uMax - bounds.uMin) <= 0.5f;
+		return isCombinedTex ? TextureMode::COMBINED : TextureMode::SINGLE;
+	}
 
-		bool isFlippedX = info.bounds->uMin > info.bounds->uMax;
-		bool isFlippedY = info.bounds->vMin > info.bounds->vMax;
+	void OpenVrManager::CreateResolveTexture(ID3D11Texture2D *inputTexture) {
+		D3D11_TEXTURE2D_DESC td;
+		inputTexture->GetDesc(&td);
+		d3d11Res->resolveTexture = d3d11TexturePool->Acquire(ResolveTextureDesc(inputTexture, MakeSrgbFormatsTypeless(td.Format)));
+		if (td.ArraySize > 1) {
+			for (int eye = 0; eye < 2; ++eye) {
+				d3d11Res->resolveViews[eye] = CreateShaderResourceView(d3d11Res->device.Get(), d3d11Res->resolveTexture.Texture(), eye);
+			}
+		}
+		else {
+			d3d11Res->resolveViews[0] = d3d11Res->resolveTexture.View();
+			d3d11Res->resolveViews[1] = d3d11Res->resolveViews[0];
+		}
+	}
 
-		bool inputIsSrgb = info.texture->eColorSpace == ColorSpace_Gamma || (info.texture->eColorSpace == ColorSpace_Auto && IsConsideredSrgbByOpenVR(itd.Format));
-		bool isCombinedTex = float(itd.Width) / itd.Height >= 1.5f * aspectRatio && std::abs(info.bounds->uMax - info.bounds->uMin) <= 0.5f;
+	void OpenVrManager::CreateOutputTexture() {
+		d3d11Res->outputTexture = d3d11TexturePool->Acquire(d3d11Res->outputDesc);
+	}
+
+	void OpenVrManager::PreparePostProcessInput(EVREye eye, ID3D11Texture2D *inputTexture, const VRTextureBounds_t &bounds, D3D11PostProcessInput &input) {
+		D3D11_TEXTURE2D_DESC itd;
+		inputTexture->GetDesc(&itd);
 
-		D3D11PostProcessInput input;
-		input.eye = info.eye;
+		input.eye = eye;
 		input.inputTexture = inputTexture;
-		input.inputView = d3d11Res->GetInputView(inputTexture, info.eye);
-		input.inputViewport.x = std::roundf(itd.Width * min(info.bounds->uMin, info.bounds->uMax));
-		input.inputViewport.y = std::roundf(itd.Height * min(info.bounds->vMin, info.bounds->vMax));
-		input.inputViewport.width = std::roundf(itd.Width * std::abs(info.bounds->uMax - info.bounds->uMin));
-		input.inputViewport.height = std::roundf(itd.Height * std::abs(info.bounds->vMax - info.bounds->vMin));
-		input.outputTexture = d3d11Res->outputTexture.Get();
-		input.outputView = d3d11Res->outputView.Get();
-		input.outputUav = d3d11Res->outputUav.Get();
-		input.projectionCenter = projCenters.eyeCenter[info.eye];
-		input.mode = d3d11Res->usingArrayTex ? TextureMode::ARRAY : (isCombinedTex ? TextureMode::COMBINED : TextureMode::SINGLE);
-
-		if (isFlippedX) {
+		input.inputViewport.x = std::roundf(itd.Width * min(bounds.uMin, bounds.uMax));
+		input.inputViewport.y = std::roundf(itd.Height * min(bounds.vMin, bounds.vMax));
+		input.inputViewport.width = std::roundf(itd.Width * std::abs(bounds.uMax - bounds.uMin));
+		input.inputViewport.height = std::roundf(itd.Height * std::abs(bounds.vMax - bounds.vMin));
+		bool resolve = d3d11Res->requiresResolve || (d3d11Res->multisampled && !d3d11Res->postProcessor->AcceptsMultisampledInput());
+		if (resolve && !d3d11Res->resolveTexture) {
+			CreateResolveTexture(inputTexture);
+		}
+		input.inputView = d3d11Res->GetInputView(inputTexture, eye, input.inputViewport, resolve);
+		if (d3d11Res->sharpenInPlace) {
+			input.outputTexture = inputTexture;
+			input.outputView = input.inputView;
+			input.outputUav = d3d11Res->GetInPlaceUav(inputTexture, eye);
+			input.inPlace = true;
+		}
+		else {
+			input.outputTexture = d3d11Res->outputTexture.Texture();
+			input.outputView = d3d11Res->outputTexture.View();
+			input.outputUav = d3d11Res->outputTexture.Uav();
+		}
+		input.projectionCenter = projCenters.eyeCenter[eye];
+		input.mode = DetermineTextureMode(itd.Width, itd.Height, bounds);
+
+		if (bounds.uMin > bounds.uMax) {
 			input.projectionCenter.x = 1.f - input.projectionCenter.x;
 		}
-		if (isFlippedY) {
+		if (bounds.vMin > bounds.vMax) {
 			input.projectionCenter.y = 1.f - input.projectionCenter.y;
 		}
+	}
+
+	void OpenVrManager::PrepareTemporalInput(EVREye eye, const OpenVrSubmitInfo &info, const VRTextureBounds_t &bounds, D3D11PostProcessInput &input) {
+		// the game's frames only jitter while they are accumulated, anything else would just make them shake
+		if (!g_config.upscaling.enabled || g_config.upscaling.method != UpscaleMethod::TEMPORAL
+				|| !(info.submitFlags & Submit_TextureWithDepth) || !(info.submitFlags & Submit_TextureWithPose)) {
+			jitter.active.store(false, std::memory_order_relaxed);
+			return;
+		}
+
+		auto *texWithDepth = reinterpret_cast<const VRTextureWithPoseAndDepth_t*>(info.texture);
+		auto &state = d3d11Res->temporal[eye];
+		IVRSystem *vrSystem = GetOpenVrSystem();
+		ID3D11Texture2D *depthTexture = reinterpret_cast<ID3D11Texture2D*>(texWithDepth->depth.handle);
+		if (!state.hasProjection || vrSystem == nullptr || depthTexture == nullptr) {
+			jitter.active.store(false, std::memory_order_relaxed);
+			return;
+		}
+
+		D3D11_TEXTURE2D_DESC dtd;
+		depthTexture->GetDesc(&dtd);
+		if (!(dtd.BindFlags & D3D11_BIND_SHADER_RESOURCE) || dtd.SampleDesc.Count > 1) {
+			// no resolve for depth, so this eye is upscaled without history
+			jitter.active.store(false, std::memory_order_relaxed);
+			return;
+		}
+
+		input.temporal.depthView = d3d11Res->GetDepthView(depthTexture, eye);
+		input.temporal.depthViewport.x = std::roundf(dtd.Width * min(bounds.uMin, bounds.uMax));
+		input.temporal.depthViewport.y = std::roundf(dtd.Height * min(bounds.vMin, bounds.vMax));
+		input.temporal.depthViewport.width = std::roundf(dtd.Width * std::abs(bounds.uMax - bounds.uMin));
+		input.temporal.depthViewport.height = std::roundf(dtd.Height * std::abs(bounds.vMax - bounds.vMin));
+
+		// the history is reprojected without the jitter, which is instead taken out of the current frame by the shader
+		HmdMatrix44_t projection = state.projection;
+		Point<float> frameJitter = { 0, 0 };
+		if (jitter.hasCentre[eye].load(std::memory_order_acquire)) {
+			Point<float> centre = { jitter.centreX[eye].load(std::memory_order_relaxed), jitter.centreY[eye].load(std::memory_order_relaxed) };
+			Point<float> maxJitter = { 0.51f / input.inputViewport.width, 0.51f / input.inputViewport.height };
+			if (!RemoveProjectionJitter(centre, maxJitter, projection.m, frameJitter) && !state.unknownProjection) {
+				LOG_INFO << "Submitted projection does not match the runtime's, reprojecting it as is";
+				state.unknownProjection = true;
+			}
+		}
+		input.temporal.jitter.x = bounds.uMin > bounds.uMax ? -frameJitter.x : frameJitter.x;
+		input.temporal.jitter.y = bounds.vMin > bounds.vMax ? -frameJitter.y : frameJitter.y;
+
+		jitter.pixelWidth.store(1.f / input.inputViewport.width, std::memory_order_relaxed);
+		jitter.pixelHeight.store(1.f / input.inputViewport.height, std::memory_order_relaxed);
+		jitter.active.store(!d3d11Res->temporal[Eye_Left].unknownProjection && !d3d11Res->temporal[Eye_Right].unknownProjection, std::memory_order_relaxed);
+
+		// OpenVR matrices transform column vectors, as does the shader, so all products are in that order
+		using namespace DirectX;
+		XMMATRIX eyeToWorld = XMMatrixMultiply(LoadMatrix(texWithDepth->mDeviceToAbsoluteTracking), LoadMatrix(vrSystem->GetEyeToHeadTransform(eye)));
+		XMMATRIX viewProjection = XMMatrixMultiply(LoadMatrix(projection), XMMatrixInverse(nullptr, eyeToWorld));
+
+		if (state.hasPrevious) {
+			XMMATRIX reprojection = XMMatrixMultiply(XMLoadFloat4x4(&state.previousViewProjection), XMMatrixInverse(nullptr, viewProjection));
+			// the shader works in the orientation of the submitted image, so undo any flip around the reprojection
+			XMMATRIX flip = XMMatrixScaling(bounds.uMin > bounds.uMax ? -1.f : 1.f, bounds.vMin > bounds.vMax ? -1.f : 1.f, 1.f);
+			reprojection = XMMatrixMultiply(XMMatrixMultiply(flip, reprojection), flip);
+			XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(input.temporal.reprojection), reprojection);
+			input.temporal.hasPreviousFrame = true;
+		}
+		XMStoreFloat4x4(&state.previousViewProjection, viewProjection);
+		state.hasPrevious = true;
+	}
+
+	void OpenVrManager::RememberTemporalProjection(const OpenVrSubmitInfo &info) {
+		if ((info.submitFlags & Submit_TextureWithDepth) && (info.submitFlags & Submit_TextureWithPose)) {
+			auto &temporal = d3d11Res->temporal[info.eye];
+			temporal.projection = reinterpret_cast<const VRTextureWithPoseAndDepth_t*>(info.texture)->depth.mProjection;
+			temporal.hasProjection = true;
+		}
+	}
+
+	bool OpenVrManager::DeferD3D11Submit(OpenVrSubmitInfo &info) {
+		if (info.eye != Eye_Left) {
+			return false;
+		}
+		if (deferredLeft.pending) {
+			// the game did not submit the right eye after the last left eye, so stop waiting for it
+			LOG_INFO << "Right eye was not submitted, no longer holding back the left eye";
+			deferredLeft.pending = false;
+			d3d11Res->lastRightTexture = nullptr;
+			return false;
+		}
+
+		ID3D11Texture2D *inputTexture = reinterpret_cast<ID3D11Texture2D *>(info.texture->handle);
+		D3D11_TEXTURE2D_DESC itd;
+		inputTexture->GetDesc(&itd);
+		// In an array texture, each eye has its own slice and output, so they are processed one at a time.
+		// In a combined texture, the right half is only guaranteed to be rendered once the right eye is submitted.
+		if (inputTexture != d3d11Res->lastRightTexture || DetermineTextureMode(itd.Width, itd.Height, *info.bounds) != TextureMode::COMBINED) {
+			return false;
+		}
+
+		// the game may reuse the memory of its submit arguments, so keep copies
+		CopyTexInfo(deferredLeft.texture, info.texture, info.submitFlags);
+		deferredLeft.bounds = *info.bounds;
+		deferredLeft.info = { info.eye, deferredLeft.texture.get(), &deferredLeft.bounds, info.submitFlags };
+		deferredLeft.pending = true;
+		return true;
+	}
+
+	bool OpenVrManager::TakeDeferredSubmit(OpenVrSubmitInfo &info) {
+		if (!deferredLeft.pending) {
+			return false;
+		}
+		deferredLeft.pending = false;
+		info = deferredLeft.info;
+		return true;
+	}
+
+	void OpenVrManager::UseD3D11OutputTexture(OpenVrSubmitInfo &info, const Viewport &outputViewport) {
+		D3D11_TEXTURE2D_DESC itd;
+		reinterpret_cast<ID3D11Texture2D *>(info.texture->handle)->GetDesc(&itd);
+		bool inputIsSrgb = info.texture->eColorSpace == ColorSpace_Gamma || (info.texture->eColorSpace == ColorSpace_Auto && IsConsideredSrgbByOpenVR(itd.Format));
+
+		D3D11_TEXTURE2D_DESC otd;
+		d3d11Res->outputTexture.Texture()->GetDesc(&otd);
+		VRTextureBounds_t &bounds = outputBounds[info.eye];
+		bounds.uMin = float(outputViewport.x) / otd.Width;
+		bounds.vMin = float(outputViewport.y) / otd.Height;
+		bounds.uMax = float(outputViewport.width + outputViewport.x) / otd.Width;
+		bounds.vMax = float(outputViewport.height + outputViewport.y) / otd.Height;
+		if (info.bounds->uMin > info.bounds->uMax) {
+			std::swap(bounds.uMin, bounds.uMax);
+		}
+		if (info.bounds->vMin > info.bounds->vMax) {
+			std::swap(bounds.vMin, bounds.vMax);
+		}
+		info.bounds = &bounds;
+
+		Texture_t *texInfo = PrepareOutputTexInfo(info.eye, info.texture, info.submitFlags);
+		texInfo->handle = d3d11Res->outputTexture.Texture();
+		texInfo->eColorSpace = inputIsSrgb ? ColorSpace_Gamma : ColorSpace_Auto;
+		info.texture = texInfo;
+	}
+
+	void OpenVrManager::PostProcessD3D11(OpenVrSubmitInfo &info) {
+		ID3D11Texture2D *inputTexture = reinterpret_cast<ID3D11Texture2D *>(info.texture->handle);
+		D3D11_TEXTURE2D_DESC itd;
+		inputTexture->GetDesc(&itd);
+
+		// checked every frame, since the upscaling method and its toggle can change at runtime
+		d3d11Res->sharpenInPlace = d3d11Res->canSharpenInPlace && !g_config.debugMode && d3d11Res->postProcessor->AcceptsInPlaceSharpening();
+		if (!d3d11Res->sharpenInPlace && !d3d11Res->outputTexture) {
+			CreateOutputTexture();
+		}
+		bool inPlace = d3d11Res->sharpenInPlace;
+
+		bool isFlippedX = info.bounds->uMin > info.bounds->uMax;
+		bool isFlippedY = info.bounds->vMin > info.bounds->vMax;
+
+		TextureMode mode = DetermineTextureMode(itd.Width, itd.Height, *info.bounds);
+
+		RememberTemporalProjection(info);
 
 		Viewport outputViewport;
-		if (d3d11Res->postProcessor->Apply(input, outputViewport)) {
-			outputBounds.uMin = float(outputViewport.x) / otd.Width;
-			outputBounds.vMin = float(outputViewport.y) / otd.Height;
-			outputBounds.uMax = float(outputViewport.width + outputViewport.x) / otd.Width;
-			outputBounds.vMax = float(outputViewport.height + outputViewport.y) / otd.Height;
-			if (info.bounds->uMin > info.bounds->uMax) {
-				std::swap(outputBounds.uMin, outputBounds.uMax);
+		bool didPostprocessing;
+		if (info.eye == Eye_Right && deferredLeft.pending && deferredLeft.info.texture->handle == inputTexture && mode == TextureMode::COMBINED) {
+			// The left eye was held back, so that both halves of the combined texture are processed in one pass.
+			// Should the right eye come from a different texture after all, the left eye is passed on unprocessed.
+			OpenVrSubmitInfo &left = deferredLeft.info;
+			RememberTemporalProjection(left);
+			D3D11PostProcessInput inputs[2];
+			PreparePostProcessInput(Eye_Left, inputTexture, *left.bounds, inputs[0]);
+			PreparePostProcessInput(Eye_Right, inputTexture, *info.bounds, inputs[1]);
+			PrepareTemporalInput(Eye_Left, left, *left.bounds, inputs[0]);
+			PrepareTemporalInput(Eye_Right, info, *info.bounds, inputs[1]);
+			Viewport outputViewports[2];
+			if (inPlace && (d3d11Res->WasSharpenedInPlace(inputTexture, Eye_Left, frameIndex) || d3d11Res->WasSharpenedInPlace(inputTexture, Eye_Right, frameIndex))) {
+				didPostprocessing = false;
+			}
+			else {
+				didPostprocessing = d3d11Res->postProcessor->ApplyStereo(inputs, outputViewports);
+			}
+			if (didPostprocessing && inPlace) {
+				d3d11Res->sharpenedInPlace[Eye_Left] = { inputTexture, frameIndex };
+				d3d11Res->sharpenedInPlace[Eye_Right] = { inputTexture, frameIndex };
 			}
-			if (info.bounds->vMin > info.bounds->vMax) {
-				std::swap(outputBounds.vMin, outputBounds.vMax);
+			if (didPostprocessing && !inPlace) {
+				UseD3D11OutputTexture(left, outputViewports[0]);
 			}
-			info.bounds = &outputBounds;
+			outputViewport = outputViewports[1];
+		}
+		else {
+			D3D11PostProcessInput input;
+			PreparePostProcessInput(info.eye, inputTexture, *info.bounds, input);
+			PrepareTemporalInput(info.eye, info, *info.bounds, input);
+			if (inPlace && d3d11Res->WasSharpenedInPlace(inputTexture, info.eye, frameIndex)) {
+				didPostprocessing = false;
+			}
+			else {
+				didPostprocessing = d3d11Res->postProcessor->Apply(input, outputViewport);
+			}
+			if (didPostprocessing && inPlace) {
+				d3d11Res->sharpenedInPlace[info.eye] = { inputTexture, frameIndex };
+			}
+		}
 
-			PrepareOutputTexInfo(info.texture, info.submitFlags);
-			outputTexInfo->handle = d3d11Res->outputTexture.Get();
-			outputTexInfo->eColorSpace = inputIsSrgb ? ColorSpace_Gamma : ColorSpace_Auto;
-			info.texture = outputTexInfo.get();
+		if (info.eye == Eye_Right) {
+			d3d11Res->lastRightTexture = inputTexture;
+		}
+
+		// sharpened in place, the game's texture and bounds are submitted unchanged
+		if (didPostprocessing && !inPlace) {
+			UseD3D11OutputTexture(info, outputViewport);
 		}
 
 		float projLX = isFlippedX ? 1.f - projCenters.eyeCenter[0].x : projCenters.eyeCenter[0].x;
 		float projLY = isFlippedY ? 1.f - projCenters.eyeCenter[0].y : projCenters.eyeCenter[0].y;
 		float projRX = isFlippedX ? 1.f - projCenters.eyeCenter[1].x : projCenters.eyeCenter[1].x;
 		float projRY = isFlippedY ? 1.f - projCenters.eyeCenter[1].y : projCenters.eyeCenter[1].y;
-		d3d11Res->variableRateShading->UpdateTargetInformation(itd.Width, itd.Height, input.mode, projLX, projLY, projRX, projRY);
+		d3d11Res->variableRateShading->UpdateTargetInformation(itd.Width, itd.Height, mode, projLX, projLY, projRX, projRY);
 		d3d11Res->variableRateShading->EndFrame();
+		d3d11Res->injector->UpdateInterests();
+		if (info.eye == Eye_Right) {
+			if (inPlace) {
+				// no longer submitted; the pool frees it should sharpening in place continue
+				d3d11Res->outputTexture.Release();
+			}
+			d3d11Res->resolvedRegions.clear();
+			d3d11TexturePool->EndFrame();
+		}
 	}
 
 	void OpenVrManager::PatchDxvkSubmit(OpenVrSubmitInfo &info) {
-		PrepareOutputTexInfo(info.texture, info.submitFlags);
+		Texture_t *texInfo = PrepareOutputTexInfo(info.eye, info.texture, info.submitFlags);
 
 		ID3D11Texture2D *d3d11Tex = (ID3D11Texture2D*)info.texture->handle;
 
@@ -468,31 +894,17 @@ namespace vrperfkit {
 			LOG_ERROR << "Vulkan texture is missing required usage flags!";
 		}
 
-		outputTexInfo->handle = &dxvkRes->vkTexData;
-		outputTexInfo->eType = TextureType_Vulkan;
+		texInfo->handle = &dxvkRes->vkTexData;
+		texInfo->eType = TextureType_Vulkan;
 		info.submitFlags = Submit_Default;
 		if (create.arrayLayers > 1) {
 			info.submitFlags = Submit_VulkanTextureWithArrayData;
 		}
-		info.texture = outputTexInfo.get();
+		info.texture = texInfo;
 	}
 
-	void OpenVrManager::PrepareOutputTexInfo(const Texture_t *input, EVRSubmitFlags submitFlags) {
-		if ((submitFlags & Submit_TextureWithDepth) && (submitFlags & Submit_TextureWithPose)) {
-			outputTexInfo.reset(new VRTextureWithPoseAndDepth_t);
-			memcpy(outputTexInfo.get(), input, sizeof(VRTextureWithPoseAndDepth_t));
-		}
-		else if (submitFlags & Submit_TextureWithDepth) {
-			outputTexInfo.reset(new VRTextureWithDepth_t);
-			memcpy(outputTexInfo.get(), input, sizeof(VRTextureWithDepth_t));
-		}
-		else if (submitFlags & Submit_TextureWithPose) {
-			outputTexInfo.reset(new VRTextureWithPose_t);
-			memcpy(outputTexInfo.get(), input, sizeof(VRTextureWithPose_t));
-		}
-		else {
-			outputTexInfo.reset(new Texture_t);
-			memcpy(outputTexInfo.get(), input, sizeof(Texture_t));
-		}
+	Texture_t * OpenVrManager::PrepareOutputTexInfo(EVREye eye, const Texture_t *input, EVRSubmitFlags submitFlags) {
+		CopyTexInfo(outputTexInfo[eye], input, submitFlags);
+		return outputTexInfo[eye].get();
 	}
 }
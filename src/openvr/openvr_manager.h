@@ -2,8 +2,11 @@
 #include "openvr.h"
 #include "types.h"
 
+#include <atomic>
 #include <memory>
 
+struct ID3D11Texture2D;
+
 namespace vrperfkit {
 	struct OpenVrSubmitInfo {
 		vr::EVREye eye;
@@ -14,12 +17,18 @@ namespace vrperfkit {
 
 	struct OpenVrD3D11Resources;
 	struct OpenVrDxvkResources;
+	class D3D11TexturePool;
+	struct D3D11PostProcessInput;
 
 	class OpenVrManager {
 	public:
 		void Shutdown();
 
-		void OnSubmit(OpenVrSubmitInfo &info);
+		// May hold back the left eye of a combined texture, so that both eyes are processed together once the
+		// right eye is submitted. Returns false in that case, and the submit must not be passed on yet.
+		bool OnSubmit(OpenVrSubmitInfo &info);
+		// the held back left eye, which must be passed on right before the right eye's submit
+		bool TakeDeferredSubmit(OpenVrSubmitInfo &info);
 
 		void PreCompositorWorkCall(bool transition = false);
 		void PostCompositorWorkCall(bool transition = false);
@@ -27,19 +36,48 @@ namespace vrperfkit {
 		void PreWaitGetPoses();
 		void PostWaitGetPoses();
 
+		// Called by the IVRSystem projection hooks, from whichever thread the game uses, with the centre of the
+		// runtime's projection for the eye, see ProjectionCentre. Returns the jitter to apply to it in uv units,
+		// which is zero unless temporal upscaling currently accumulates the game's frames.
+		Point<float> GetProjectionJitter(vr::EVREye eye, Point<float> centre);
+
 	private:
 		vr::IVRCompositor *compositor = nullptr;
 
 		bool failed = false;
 		bool initialized = false;
+		// counts the game's calls to WaitGetPoses, so that submits can be told apart from resubmits of the same frame
+		uint64_t frameIndex = 0;
 		GraphicsApi graphicsApi = GraphicsApi::UNKNOWN;
 		uint32_t textureWidth = 0;
 		uint32_t textureHeight = 0;
 		ProjectionCenters projCenters;
 		float aspectRatio;
-		vr::VRTextureBounds_t outputBounds;
-		std::unique_ptr<vr::Texture_t> outputTexInfo;
-
+		vr::VRTextureBounds_t outputBounds[2];
+		std::unique_ptr<vr::Texture_t> outputTexInfo[2];
+
+		// state of the temporal jitter shared with the projection hooks
+		struct ProjectionJitter {
+			std::atomic<bool> active = false;
+			std::atomic<uint32_t> phase = 0;
+			// size of an input pixel in uv units
+			std::atomic<float> pixelWidth = 0;
+			std::atomic<float> pixelHeight = 0;
+			// last projection centres the runtime reported for each eye
+			std::atomic<bool> hasCentre[2] = {};
+			std::atomic<float> centreX[2] = {};
+			std::atomic<float> centreY[2] = {};
+		} jitter;
+
+		struct DeferredSubmit {
+			bool pending = false;
+			OpenVrSubmitInfo info;
+			std::unique_ptr<vr::Texture_t> texture;
+			vr::VRTextureBounds_t bounds;
+		} deferredLeft;
+
+		// kept across reinitializations, so must be declared before (and thus destroyed after) the resources
+		std::unique_ptr<D3D11TexturePool> d3d11TexturePool;
 		std::unique_ptr<OpenVrD3D11Resources> d3d11Res;
 		std::unique_ptr<OpenVrDxvkResources> dxvkRes;
 
@@ -51,10 +89,18 @@ namespace vrperfkit {
 		void CalculateProjectionCenters();
 		void CalculateEyeTextureAspectRatio();
 
+		void CreateResolveTexture(ID3D11Texture2D *inputTexture);
+		void CreateOutputTexture();
+		TextureMode DetermineTextureMode(uint32_t width, uint32_t height, const vr::VRTextureBounds_t &bounds) const;
+		void PreparePostProcessInput(vr::EVREye eye, ID3D11Texture2D *inputTexture, const vr::VRTextureBounds_t &bounds, D3D11PostProcessInput &input);
+		void PrepareTemporalInput(vr::EVREye eye, const OpenVrSubmitInfo &info, const vr::VRTextureBounds_t &bounds, D3D11PostProcessInput &input);
+		void RememberTemporalProjection(const OpenVrSubmitInfo &info);
+		bool DeferD3D11Submit(OpenVrSubmitInfo &info);
+		void UseD3D11OutputTexture(OpenVrSubmitInfo &info, const Viewport &outputViewport);
 		void PostProcessD3D11(OpenVrSubmitInfo &info);
 		void PatchDxvkSubmit(OpenVrSubmitInfo & info);
 
-		void PrepareOutputTexInfo(const vr::Texture_t *input, vr::EVRSubmitFlags submitFlags);
+		vr::Texture_t * PrepareOutputTexInfo(vr::EVREye eye, const vr::Texture_t *input, vr::EVRSubmitFlags submitFlags);
 	};
 
 	extern OpenVrManager g_openVr;
@@ -0,0 +1,246 @@
+#include "profiles.h"
+
+#include "config.h"
+#include "logging.h"
+#include "yaml-cpp/yaml.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace vrperfkit {
+	namespace {
+		const uint32_t PROFILE_DB_MAGIC = 0x504b5056; // "VPKP"
+		const uint32_t PROFILE_DB_VERSION = 1;
+		const size_t MAX_EYE_ORDER = 32;
+
+		enum ProfileField : uint32_t {
+			PF_UPSCALING_ENABLED = 1 << 0,
+			PF_UPSCALING_METHOD = 1 << 1,
+			PF_RENDER_SCALE = 1 << 2,
+			PF_SHARPNESS = 1 << 3,
+			PF_RADIUS = 1 << 4,
+			PF_APPLY_MIP_BIAS = 1 << 5,
+			PF_FFR_ENABLED = 1 << 6,
+			PF_FFR_INNER_RADIUS = 1 << 7,
+			PF_FFR_MID_RADIUS = 1 << 8,
+			PF_FFR_OUTER_RADIUS = 1 << 9,
+			PF_FFR_FAVOR_HORIZONTAL = 1 << 10,
+			PF_FFR_EYE_ORDER = 1 << 11,
+			PF_FFR_SKIP_SQUARE_TARGETS = 1 << 12,
+			PF_FFR_TARGET_SIZE_TOLERANCE = 1 << 13,
+		};
+
+		enum ProfileFlag : uint8_t {
+			PFLAG_UPSCALING_ENABLED = 1 << 0,
+			PFLAG_APPLY_MIP_BIAS = 1 << 1,
+			PFLAG_FFR_ENABLED = 1 << 2,
+			PFLAG_FFR_FAVOR_HORIZONTAL = 1 << 3,
+			PFLAG_FFR_SKIP_SQUARE_TARGETS = 1 << 4,
+		};
+
+#pragma pack(push, 1)
+		struct ProfileDbHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t count;
+		};
+
+		// fixed-size records sorted by hash, so that the index can be binary searched as-is
+		struct ProfileRecord {
+			uint64_t hash;
+			uint32_t present;
+			uint8_t flags;
+			uint8_t method;
+			uint16_t targetSizeTolerance;
+			float renderScale;
+			float sharpness;
+			float radius;
+			float innerRadius;
+			float midRadius;
+			float outerRadius;
+			char eyeOrder[MAX_EYE_ORDER];
+		};
+#pragma pack(pop)
+
+		void SetFlag(ProfileRecord &record, uint32_t field, uint8_t flag, const YAML::Node &node) {
+			if (node) {
+				record.present |= field;
+				if (node.as<bool>()) {
+					record.flags |= flag;
+				}
+			}
+		}
+
+		void SetFloat(ProfileRecord &record, uint32_t field, float &value, const YAML::Node &node) {
+			if (node) {
+				record.present |= field;
+				value = node.as<float>();
+			}
+		}
+
+		ProfileRecord ParseProfile(uint64_t hash, YAML::Node profile) {
+			ProfileRecord record = {};
+			record.hash = hash;
+
+			YAML::Node upscaleCfg = profile["upscaling"];
+			SetFlag(record, PF_UPSCALING_ENABLED, PFLAG_UPSCALING_ENABLED, upscaleCfg["enabled"]);
+			if (upscaleCfg["method"]) {
+				record.present |= PF_UPSCALING_METHOD;
+				record.method = (uint8_t)MethodFromString(upscaleCfg["method"].as<std::string>());
+			}
+			SetFloat(record, PF_RENDER_SCALE, record.renderScale, upscaleCfg["renderScale"]);
+			SetFloat(record, PF_SHARPNESS, record.sharpness, upscaleCfg["sharpness"]);
+			SetFloat(record, PF_RADIUS, record.radius, upscaleCfg["radius"]);
+			SetFlag(record, PF_APPLY_MIP_BIAS, PFLAG_APPLY_MIP_BIAS, upscaleCfg["applyMipBias"]);
+
+			YAML::Node ffrCfg = profile["fixedFoveated"];
+			SetFlag(record, PF_FFR_ENABLED, PFLAG_FFR_ENABLED, ffrCfg["enabled"]);
+			SetFloat(record, PF_FFR_INNER_RADIUS, record.innerRadius, ffrCfg["innerRadius"]);
+			SetFloat(record, PF_FFR_MID_RADIUS, record.midRadius, ffrCfg["midRadius"]);
+			SetFloat(record, PF_FFR_OUTER_RADIUS, record.outerRadius, ffrCfg["outerRadius"]);
+			SetFlag(record, PF_FFR_FAVOR_HORIZONTAL, PFLAG_FFR_FAVOR_HORIZONTAL, ffrCfg["favorHorizontal"]);
+			SetFlag(record, PF_FFR_SKIP_SQUARE_TARGETS, PFLAG_FFR_SKIP_SQUARE_TARGETS, ffrCfg["skipSquareTargets"]);
+			if (ffrCfg["overrideSingleEyeOrder"]) {
+				std::string order = ffrCfg["overrideSingleEyeOrder"].as<std::string>();
+				if (order.size() >= MAX_EYE_ORDER) {
+					LOG_ERROR << "Profile eye order " << order << " is too long, ignoring it";
+				}
+				else {
+					record.present |= PF_FFR_EYE_ORDER;
+					std::copy(order.begin(), order.end(), record.eyeOrder);
+				}
+			}
+			if (ffrCfg["targetSizeTolerance"]) {
+				record.present |= PF_FFR_TARGET_SIZE_TOLERANCE;
+				record.targetSizeTolerance = (uint16_t)std::max(0, ffrCfg["targetSizeTolerance"].as<int>());
+			}
+
+			return record;
+		}
+
+		std::vector<ProfileRecord> CompileProfiles(const fs::path &databasePath) {
+			std::vector<ProfileRecord> records;
+
+			std::ifstream dbFile (databasePath);
+			YAML::Node db = YAML::Load(dbFile);
+			for (const auto &entry : db["profiles"]) {
+				std::string name = entry.first.as<std::string>();
+				records.push_back(ParseProfile(HashExecutableName(name), entry.second));
+			}
+
+			std::stable_sort(records.begin(), records.end(), [](const ProfileRecord &a, const ProfileRecord &b) { return a.hash < b.hash; });
+			auto last = std::unique(records.begin(), records.end(), [](const ProfileRecord &a, const ProfileRecord &b) { return a.hash == b.hash; });
+			if (last != records.end()) {
+				LOG_ERROR << "Profile database contains duplicate executable names, only the first entry is used";
+				records.erase(last, records.end());
+			}
+
+			return records;
+		}
+
+		bool ReadCompiledProfiles(const fs::path &indexPath, std::vector<ProfileRecord> &records) {
+			std::ifstream indexFile (indexPath, std::ios::binary);
+			ProfileDbHeader header;
+			if (!indexFile.read((char*)&header, sizeof(header)) || header.magic != PROFILE_DB_MAGIC || header.version != PROFILE_DB_VERSION) {
+				return false;
+			}
+			// the count is only trusted if the file actually holds that many records
+			std::error_code ec;
+			uintmax_t fileSize = fs::file_size(indexPath, ec);
+			if (ec || fileSize - sizeof(header) != (uintmax_t)header.count * sizeof(ProfileRecord)) {
+				LOG_ERROR << "Compiled profile index " << indexPath << " is corrupt";
+				return false;
+			}
+			records.resize(header.count);
+			return (bool)indexFile.read((char*)records.data(), header.count * sizeof(ProfileRecord));
+		}
+
+		void WriteCompiledProfiles(const fs::path &indexPath, const std::vector<ProfileRecord> &records) {
+			std::ofstream indexFile (indexPath, std::ios::binary | std::ios::trunc);
+			ProfileDbHeader header { PROFILE_DB_MAGIC, PROFILE_DB_VERSION, (uint32_t)records.size() };
+			indexFile.write((const char*)&header, sizeof(header));
+			indexFile.write((const char*)records.data(), records.size() * sizeof(ProfileRecord));
+			if (!indexFile) {
+				LOG_ERROR << "Could not write compiled profile index " << indexPath;
+			}
+		}
+
+		bool IsIndexUpToDate(const fs::path &databasePath, const fs::path &indexPath) {
+			std::error_code ec;
+			auto indexTime = fs::last_write_time(indexPath, ec);
+			if (ec) {
+				return false;
+			}
+			auto databaseTime = fs::last_write_time(databasePath, ec);
+			return !ec && indexTime >= databaseTime;
+		}
+
+		void ApplyProfile(const ProfileRecord &record) {
+			UpscaleConfig &upscaling = g_config.upscaling;
+			FixedFoveatedConfig &ffr = g_config.ffr;
+			uint32_t present = record.present;
+
+			if (present & PF_UPSCALING_ENABLED) upscaling.enabled = (record.flags & PFLAG_UPSCALING_ENABLED) != 0;
+			if (present & PF_UPSCALING_METHOD) upscaling.method = (UpscaleMethod)record.method;
+			if (present & PF_RENDER_SCALE) upscaling.renderScale = std::max(0.5f, record.renderScale);
+			if (present & PF_SHARPNESS) upscaling.sharpness = std::max(0.f, record.sharpness);
+			if (present & PF_RADIUS) upscaling.radius = std::max(0.f, record.radius);
+			if (present & PF_APPLY_MIP_BIAS) upscaling.applyMipBias = (record.flags & PFLAG_APPLY_MIP_BIAS) != 0;
+			if (present & PF_FFR_ENABLED) ffr.enabled = (record.flags & PFLAG_FFR_ENABLED) != 0;
+			if (present & PF_FFR_INNER_RADIUS) ffr.innerRadius = record.innerRadius;
+			if (present & PF_FFR_MID_RADIUS) ffr.midRadius = record.midRadius;
+			if (present & PF_FFR_OUTER_RADIUS) ffr.outerRadius = record.outerRadius;
+			if (present & PF_FFR_FAVOR_HORIZONTAL) ffr.favorHorizontal = (record.flags & PFLAG_FFR_FAVOR_HORIZONTAL) != 0;
+			if (present & PF_FFR_EYE_ORDER) ffr.overrideSingleEyeOrder = std::string(record.eyeOrder, strnlen(record.eyeOrder, MAX_EYE_ORDER));
+			if (present & PF_FFR_SKIP_SQUARE_TARGETS) ffr.skipSquareTargets = (record.flags & PFLAG_FFR_SKIP_SQUARE_TARGETS) != 0;
+			if (present & PF_FFR_TARGET_SIZE_TOLERANCE) ffr.targetSizeTolerance = record.targetSizeTolerance;
+		}
+	}
+
+	uint64_t HashExecutableName(const std::string &executableName) {
+		uint64_t hash = 14695981039346656037ull;
+		for (unsigned char c : executableName) {
+			hash ^= (uint64_t)std::tolower(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	void ApplyApplicationProfile(const fs::path &databasePath, const fs::path &executablePath) {
+		if (!exists(databasePath)) {
+			return;
+		}
+
+		fs::path indexPath = databasePath;
+		indexPath.replace_extension(".bin");
+
+		std::vector<ProfileRecord> records;
+		if (!IsIndexUpToDate(databasePath, indexPath) || !ReadCompiledProfiles(indexPath, records)) {
+			LOG_INFO << "Compiling profile database " << databasePath;
+			try {
+				records = CompileProfiles(databasePath);
+			}
+			catch (const YAML::Exception &e) {
+				LOG_ERROR << "Failed to load profile database: " << e.msg;
+				return;
+			}
+			WriteCompiledProfiles(indexPath, records);
+		}
+
+		std::string executableName = executablePath.filename().u8string();
+		uint64_t hash = HashExecutableName(executableName);
+		auto it = std::lower_bound(records.begin(), records.end(), hash, [](const ProfileRecord &record, uint64_t hash) { return record.hash < hash; });
+		if (it == records.end() || it->hash != hash) {
+			LOG_INFO << "No profile found for " << executableName;
+			return;
+		}
+
+		LOG_INFO << "Applying profile for " << executableName;
+		ApplyProfile(*it);
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace vrperfkit {
+	// FNV-1a hash of the lower-cased executable file name, used as key in the profile database
+	uint64_t HashExecutableName(const std::string &executableName);
+
+	// Looks up the profile for the given executable and applies its overrides on top of g_config.
+	// The yml database is compiled to a binary index next to it whenever it changed, so that the
+	// regular startup path only needs to read and binary search the compact index.
+	void ApplyApplicationProfile(const std::filesystem::path &databasePath, const std::filesystem::path &executablePath);
+}
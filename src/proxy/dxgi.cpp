@@ -1,5 +1,6 @@
 #include "logging.h"
 #include "proxy_helpers.h"
+#include "startup.h"
 #include "win_header_sane.h"
 #include "hooks.h"
 #include <dxgi.h>
@@ -11,17 +12,17 @@ namespace {
 	HMODULE g_dxvkDll = nullptr;
 	bool isHooked = false;
 
-	template<typename T>
-	T* LoadRealFunction(T* fn, const std::string &name) {
+	template<auto Fn>
+	decltype(Fn) LoadRealFunction(const char *name) {
 		vrperfkit::EnsureLoadDll(g_realDll, vrperfkit::GetSystemPath() / "dxgi.dll");
 		if (isHooked) {
-			return vrperfkit::hooks::CallOriginal(fn);
+			return vrperfkit::hooks::CallOriginal<Fn>();
 		}
-		return static_cast<T*>(vrperfkit::GetDllFunctionPointer(g_realDll, name));
+		return reinterpret_cast<decltype(Fn)>(vrperfkit::GetDllFunctionPointer(g_realDll, name));
 	}
 
 	template<typename T>
-	T* LoadDxvkFunction(T*, const std::string &name) {
+	T* LoadDxvkFunction(T*, const char *name) {
 		if (vrperfkit::g_config.dxvk.enabled) {
 			vrperfkit::EnsureLoadDll(g_dxvkDll, vrperfkit::g_config.dxvk.dxgiDllPath);
 			return static_cast<T*>(vrperfkit::GetDllFunctionPointer(g_dxvkDll, name));
@@ -38,7 +39,7 @@ namespace {
 	}
 }
 
-#define LOAD_REAL_FUNC(name) static auto realFunc = LoadRealFunction(name, #name)
+#define LOAD_REAL_FUNC(name) vrperfkit::EnsureInitialized(); static auto realFunc = LoadRealFunction<name>(#name)
 #define LOAD_DXVK_FUNC(name) static auto dxvkFunc = LoadDxvkFunction(name, #name)
 
 extern "C" {
@@ -54,22 +55,22 @@ extern "C" {
 	}
 
 	HRESULT WINAPI CreateDXGIFactory(REFIID riid, _COM_Outptr_ void **ppFactory) {
-		LOG_DEBUG << "Redirecting " << __FUNCTION__ << " to " << (vrperfkit::g_config.dxvk.enabled && vrperfkit::g_config.dxvk.shouldUseDxvk ? "dxvk" : "system");
 		LOAD_REAL_FUNC(CreateDXGIFactory);
+		LOG_DEBUG << "Redirecting " << __FUNCTION__ << " to " << (vrperfkit::g_config.dxvk.enabled && vrperfkit::g_config.dxvk.shouldUseDxvk ? "dxvk" : "system");
 		LOAD_DXVK_FUNC(CreateDXGIFactory);
 		return Switch(realFunc, dxvkFunc)(riid, ppFactory);
 	}
 
 	HRESULT WINAPI CreateDXGIFactory1(REFIID riid, _COM_Outptr_ void **ppFactory) {
-		LOG_DEBUG << "Redirecting " << __FUNCTION__ << " to " << (vrperfkit::g_config.dxvk.enabled && vrperfkit::g_config.dxvk.shouldUseDxvk ? "dxvk" : "system");
 		LOAD_REAL_FUNC(CreateDXGIFactory1);
+		LOG_DEBUG << "Redirecting " << __FUNCTION__ << " to " << (vrperfkit::g_config.dxvk.enabled && vrperfkit::g_config.dxvk.shouldUseDxvk ? "dxvk" : "system");
 		LOAD_DXVK_FUNC(CreateDXGIFactory1);
 		return Switch(realFunc, dxvkFunc)(riid, ppFactory);
 	}
 
 	HRESULT WINAPI CreateDXGIFactory2(UINT Flags, REFIID riid, _Out_ void **ppFactory) {
-		LOG_DEBUG << "Redirecting " << __FUNCTION__ << " to " << (vrperfkit::g_config.dxvk.enabled && vrperfkit::g_config.dxvk.shouldUseDxvk ? "dxvk" : "system");
 		LOAD_REAL_FUNC(CreateDXGIFactory2);
+		LOG_DEBUG << "Redirecting " << __FUNCTION__ << " to " << (vrperfkit::g_config.dxvk.enabled && vrperfkit::g_config.dxvk.shouldUseDxvk ? "dxvk" : "system");
 		LOAD_DXVK_FUNC(CreateDXGIFactory2);
 		return Switch(realFunc, dxvkFunc)(Flags, riid, ppFactory);
 	}
@@ -95,8 +96,8 @@ extern "C" {
 	}
 
 	HRESULT WINAPI DXGIDeclareAdapterRemovalSupport() {
-		LOG_DEBUG << "Redirecting " << __FUNCTION__ << " to " << (vrperfkit::g_config.dxvk.enabled && vrperfkit::g_config.dxvk.shouldUseDxvk ? "dxvk" : "system");
 		LOAD_REAL_FUNC(DXGIDeclareAdapterRemovalSupport);
+		LOG_DEBUG << "Redirecting " << __FUNCTION__ << " to " << (vrperfkit::g_config.dxvk.enabled && vrperfkit::g_config.dxvk.shouldUseDxvk ? "dxvk" : "system");
 		LOAD_DXVK_FUNC(DXGIDeclareAdapterRemovalSupport);
 		return Switch(realFunc, dxvkFunc)();
 	}
@@ -107,8 +108,8 @@ extern "C" {
 	}
 
 	HRESULT WINAPI DXGIGetDebugInterface1(UINT Flags, REFIID riid, void **pDebug) {
-		LOG_DEBUG << "Redirecting " << __FUNCTION__ << " to " << (vrperfkit::g_config.dxvk.enabled && vrperfkit::g_config.dxvk.shouldUseDxvk ? "dxvk" : "system");
 		LOAD_REAL_FUNC(DXGIGetDebugInterface1);
+		LOG_DEBUG << "Redirecting " << __FUNCTION__ << " to " << (vrperfkit::g_config.dxvk.enabled && vrperfkit::g_config.dxvk.shouldUseDxvk ? "dxvk" : "system");
 		LOAD_DXVK_FUNC(DXGIGetDebugInterface1);
 		return Switch(realFunc, dxvkFunc)(Flags, riid, pDebug);
 	}
@@ -122,29 +123,31 @@ extern "C" {
 }
 
 namespace vrperfkit {
-	void InstallDXGIHooks() {
+	bool InstallDXGIHooks() {
 		if (g_realDll != nullptr) {
-			return;
+			return true;
 		}
 
 		std::wstring dllName = L"dxgi.dll";
 		HMODULE handle;
 		if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_PIN, dllName.c_str(), &handle)) {
-			return;
+			return false;
 		}
 
 		if (handle == g_moduleSelf) {
-			return;
+			// we are the proxy for this DLL, calls already go through our exports
+			return true;
 		}
 
 		LOG_INFO << dllName << " is loaded in the process, installing hooks...";
-		hooks::InstallHookInDll("CreateDXGIFactory", handle, (void*)CreateDXGIFactory);
-		hooks::InstallHookInDll("CreateDXGIFactory1", handle, (void*)CreateDXGIFactory1);
-		hooks::InstallHookInDll("CreateDXGIFactory2", handle, (void*)CreateDXGIFactory2);
-		hooks::InstallHookInDll("DXGIGetDebugInterface1", handle, (void*)DXGIGetDebugInterface1);
-		hooks::InstallHookInDll("DXGIDeclareAdapterRemovalSupport", handle, (void*)DXGIDeclareAdapterRemovalSupport);
+		hooks::InstallHookInDll<CreateDXGIFactory>("CreateDXGIFactory", handle);
+		hooks::InstallHookInDll<CreateDXGIFactory1>("CreateDXGIFactory1", handle);
+		hooks::InstallHookInDll<CreateDXGIFactory2>("CreateDXGIFactory2", handle);
+		hooks::InstallHookInDll<DXGIGetDebugInterface1>("DXGIGetDebugInterface1", handle);
+		hooks::InstallHookInDll<DXGIDeclareAdapterRemovalSupport>("DXGIDeclareAdapterRemovalSupport", handle);
 
 		g_realDll = handle;
 		isHooked = true;
+		return true;
 	}
 }
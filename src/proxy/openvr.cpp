@@ -1,5 +1,6 @@
 #include "logging.h"
 #include "proxy_helpers.h"
+#include "startup.h"
 #include "openvr/openvr_hooks.h"
 
 #include <dxgi.h>
@@ -8,7 +9,7 @@ namespace {
 	HMODULE g_realDll = nullptr;
 
 	template<typename T>
-	T LoadRealFunction(T, const std::string &name) {
+	T LoadRealFunction(T, const char *name) {
 #ifdef WIN64
 		std::string dllName = "vrclient_x64.dll";
 #else
@@ -19,7 +20,7 @@ namespace {
 	}
 }
 
-#define LOAD_REAL_FUNC(name) static auto realFunc = LoadRealFunction(name, #name)
+#define LOAD_REAL_FUNC(name) vrperfkit::EnsureInitialized(); static auto realFunc = LoadRealFunction(name, #name)
 
 extern "C" {
 
@@ -0,0 +1,95 @@
+#include "pe_exports.h"
+
+#include <cstring>
+
+namespace vrperfkit {
+	namespace {
+		// the parts of the PE headers we need, laid out as in winnt.h
+		const uint32_t DOS_LFANEW_OFFSET = 0x3c;
+		const uint32_t NT_SIGNATURE = 0x00004550; // "PE\0\0"
+		const uint32_t OPTIONAL_HEADER_OFFSET = 24; // signature and file header
+		const uint16_t PE32_MAGIC = 0x10b;
+		const uint16_t PE32_PLUS_MAGIC = 0x20b;
+		const uint32_t PE32_DATA_DIRECTORY_OFFSET = 96;
+		const uint32_t PE32_PLUS_DATA_DIRECTORY_OFFSET = 112;
+
+		struct DataDirectory {
+			uint32_t virtualAddress;
+			uint32_t size;
+		};
+
+		struct ExportDirectory {
+			uint32_t characteristics;
+			uint32_t timeDateStamp;
+			uint16_t majorVersion;
+			uint16_t minorVersion;
+			uint32_t name;
+			uint32_t base;
+			uint32_t numberOfFunctions;
+			uint32_t numberOfNames;
+			uint32_t addressOfFunctions;
+			uint32_t addressOfNames;
+			uint32_t addressOfNameOrdinals;
+		};
+
+		template<typename T>
+		T Read(const uint8_t *address) {
+			T value;
+			memcpy(&value, address, sizeof(T));
+			return value;
+		}
+	}
+
+	const void * FindPeExport(const uint8_t *imageBase, const char *name) {
+		if (imageBase == nullptr) {
+			return nullptr;
+		}
+
+		const uint8_t *ntHeader = imageBase + Read<uint32_t>(imageBase + DOS_LFANEW_OFFSET);
+		if (Read<uint32_t>(ntHeader) != NT_SIGNATURE) {
+			return nullptr; // the handle does not point to a valid module
+		}
+
+		const uint8_t *optionalHeader = ntHeader + OPTIONAL_HEADER_OFFSET;
+		uint16_t magic = Read<uint16_t>(optionalHeader);
+		if (magic != PE32_MAGIC && magic != PE32_PLUS_MAGIC) {
+			return nullptr;
+		}
+		// the export directory is the first entry of the data directories
+		auto exportEntry = Read<DataDirectory>(optionalHeader + (magic == PE32_MAGIC ? PE32_DATA_DIRECTORY_OFFSET : PE32_PLUS_DATA_DIRECTORY_OFFSET));
+		if (exportEntry.size == 0) {
+			return nullptr;
+		}
+
+		auto exportDir = Read<ExportDirectory>(imageBase + exportEntry.virtualAddress);
+		const uint8_t *names = imageBase + exportDir.addressOfNames;
+		const uint8_t *ordinals = imageBase + exportDir.addressOfNameOrdinals;
+		const uint8_t *functions = imageBase + exportDir.addressOfFunctions;
+
+		// The PE format requires the export name table to be sorted lexically (the Windows loader
+		// relies on that as well), so we can binary search it instead of comparing every name.
+		size_t lower = 0;
+		size_t upper = exportDir.numberOfNames;
+		while (lower < upper) {
+			size_t mid = lower + (upper - lower) / 2;
+			auto functionName = reinterpret_cast<const char *>(imageBase + Read<uint32_t>(names + mid * sizeof(uint32_t)));
+			int cmp = strcmp(name, functionName);
+			if (cmp == 0) {
+				// the name ordinal table holds indices into the function table that are not biased by Base
+				uint16_t ordinal = Read<uint16_t>(ordinals + mid * sizeof(uint16_t));
+				if (ordinal >= exportDir.numberOfFunctions) {
+					return nullptr;
+				}
+				return imageBase + Read<uint32_t>(functions + ordinal * sizeof(uint32_t));
+			}
+			if (cmp < 0) {
+				upper = mid;
+			}
+			else {
+				lower = mid + 1;
+			}
+		}
+
+		return nullptr;
+	}
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+
+namespace vrperfkit {
+	// Looks up an exported function in a PE image mapped at imageBase, the way GetProcAddress would.
+	// Reads the headers directly, so that it does not depend on the Windows SDK and can be tested on
+	// synthetic images anywhere. Returns nullptr if the image has no export of that name.
+	const void * FindPeExport(const uint8_t *imageBase, const char *name);
+}
@@ -8,7 +8,7 @@ namespace vrperfkit {
 
 	std::filesystem::path GetSystemPath();
 
-	void * GetDllFunctionPointer(HMODULE module, const std::string &name);
+	void * GetDllFunctionPointer(HMODULE module, const char *name);
 
 	void EnsureLoadDll(HMODULE &pModule, const std::filesystem::path &path);
 }
@@ -0,0 +1,8 @@
+#pragma once
+
+namespace vrperfkit {
+	// Runs the deferred part of the startup (logging, config, profiles, VR hooks) exactly once.
+	// DllMain only installs the LoadLibrary hooks; everything else happens on the first call of
+	// a LoadLibrary hook or one of the proxied exports, outside of the loader lock.
+	void EnsureInitialized();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "types.h"
+
+#include <cmath>
+#include <cstdint>
+
+// Sub-pixel jitter for temporal upscaling. While it runs, the projections the game gets from IVRSystem are
+// shifted a little every frame, so that successive frames sample the scene at different positions within
+// each input pixel, and the accumulation can recover detail that a single frame does not have.
+// All offsets are in uv units of the eye's image, with v pointing down: a jitter of (ju, jv) means that the
+// pixel centre at uv shows what the unjittered projection shows at uv + (ju, jv).
+namespace vrperfkit {
+	const uint32_t TEMPORAL_JITTER_PHASES = 8;
+
+	inline float Halton(uint32_t index, uint32_t base) {
+		float result = 0;
+		float fraction = 1;
+		while (index > 0) {
+			fraction /= base;
+			result += fraction * (index % base);
+			index /= base;
+		}
+		return result;
+	}
+
+	// jitter of the given frame in input pixels, each component within (-0.5, 0.5); the sequence starts
+	// at index 1, as index 0 would put the first phase on the pixel corner for both axes
+	inline Point<float> TemporalJitterPixels(uint32_t frame) {
+		uint32_t index = frame % TEMPORAL_JITTER_PHASES + 1;
+		return { Halton(index, 2) - 0.5f, Halton(index, 3) - 0.5f };
+	}
+
+	// OpenVR's raw projection: tangents of the half angles, where bottom is the upper edge of the image
+	inline void JitterProjectionRaw(Point<float> jitter, float &left, float &right, float &top, float &bottom) {
+		float shiftX = jitter.x * (right - left);
+		float shiftY = jitter.y * (bottom - top);
+		left += shiftX;
+		right += shiftX;
+		top -= shiftY;
+		bottom -= shiftY;
+	}
+
+	// a projection matrix that transforms column vectors, with w taken from m[3][2] times view space z
+	inline void JitterProjectionMatrix(Point<float> jitter, float m[4][4]) {
+		m[0][2] -= 2 * jitter.x * m[3][2];
+		m[1][2] += 2 * jitter.y * m[3][2];
+	}
+
+	// where the view axis ends up in normalized device coordinates; the jitter moves this by (-2 ju, 2 jv)
+	inline Point<float> ProjectionCentre(const float m[4][4]) {
+		return { m[0][2] / m[3][2], m[1][2] / m[3][2] };
+	}
+
+	inline Point<float> ProjectionCentreRaw(float left, float right, float top, float bottom) {
+		return { -(right + left) / (right - left), -(bottom + top) / (bottom - top) };
+	}
+
+	// Recovers the jitter a projection matrix was built with, given the centre of the same projection without
+	// jitter, and removes it from the matrix. The game may cache projections or build its own from the raw
+	// values, so this is what it actually rendered with. Returns false and leaves the matrix alone if the centre
+	// moved by more than the given jitter bounds, in which case it was not built from what we handed out.
+	inline bool RemoveProjectionJitter(Point<float> centre, Point<float> maxJitter, float m[4][4], Point<float> &jitter) {
+		if (m[3][2] == 0) {
+			return false;
+		}
+		Point<float> moved = ProjectionCentre(m);
+		Point<float> found = { (centre.x - moved.x) / 2, (moved.y - centre.y) / 2 };
+		if (!(std::abs(found.x) <= maxJitter.x && std::abs(found.y) <= maxJitter.y)) {
+			return false;
+		}
+		m[0][2] = centre.x * m[3][2];
+		m[1][2] = centre.y * m[3][2];
+		jitter = found;
+		return true;
+	}
+}
@@ -0,0 +1,83 @@
+// Temporal upscaling: the previous output is reprojected into the current frame via the game's depth
+// buffer and accumulated with the jittered current frame, see D3D11TemporalUpscaler.
+
+cbuffer cb : register(b0) {
+	row_major float4x4 Reprojection; // current clip space to previous clip space
+	uint2 InputOffset;
+	uint2 InputSize;
+	float2 InputTextureSize;
+	uint2 OutputOffset;
+	uint2 OutputSize;
+	float Blend; // weight of the current frame
+	uint HistoryValid;
+	uint2 DepthOffset;
+	uint2 DepthSize;
+	float2 Jitter; // the input's pixel centres show the scene at their uv plus this
+};
+
+// how quickly the weight of an input pixel falls off with its distance in output pixels
+static const float SAMPLE_FALLOFF = 4;
+
+SamplerState samLinearClamp : register(s0);
+Texture2D<float4> InputTexture : register(t0);
+Texture2D<float> DepthTexture : register(t1);
+Texture2D<float4> HistoryTexture : register(t2);
+RWTexture2D<float4> OutputTexture : register(u0);
+RWTexture2D<float4> HistoryOutput : register(u1);
+
+float3 LoadInput(int2 p) {
+	p = clamp(p, int2(InputOffset), int2(InputOffset + InputSize) - 1);
+	return InputTexture.Load(int3(p, 0)).rgb;
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 Dtid : SV_DispatchThreadID) {
+	uint2 pos = Dtid.xy;
+	if (any(pos >= OutputSize)) {
+		return;
+	}
+
+	// uv is the unjittered position in the scene, which the jittered input shows at uv - Jitter
+	float2 uv = (float2(pos) + 0.5) / float2(OutputSize);
+	float2 inputPos = float2(InputOffset) + (uv - Jitter) * float2(InputSize);
+	float3 current = InputTexture.SampleLevel(samLinearClamp, inputPos / InputTextureSize, 0).rgb;
+
+	// the history is only trusted within the colour range of the current frame's neighbourhood,
+	// which rejects disoccluded or changed content without needing motion vectors
+	int2 inputTexel = int2(floor(inputPos));
+	float3 minColour = current;
+	float3 maxColour = current;
+	for (int y = -1; y <= 1; ++y) {
+		for (int x = -1; x <= 1; ++x) {
+			float3 c = LoadInput(inputTexel + int2(x, y));
+			minColour = min(minColour, c);
+			maxColour = max(maxColour, c);
+		}
+	}
+
+	float3 result = current;
+	if (HistoryValid) {
+		float2 depthUv = saturate(uv - Jitter);
+		uint2 depthTexel = DepthOffset + min(uint2(depthUv * float2(DepthSize)), DepthSize - 1);
+		float depth = DepthTexture.Load(int3(depthTexel, 0));
+		float4 previous = mul(Reprojection, float4(uv.x * 2 - 1, 1 - uv.y * 2, depth, 1));
+		float2 previousUv = float2(0.5 + 0.5 * previous.x / previous.w, 0.5 - 0.5 * previous.y / previous.w);
+		if (previous.w > 0 && all(previousUv >= 0) && all(previousUv <= 1)) {
+			float3 history = HistoryTexture.SampleLevel(samLinearClamp, previousUv, 0).rgb;
+			// With jitter, the nearest input pixel is accumulated unfiltered, weighted by how close it sampled the
+			// scene to this output pixel, so that the history converges to the scene rather than its bilinear upscale.
+			// Without it, e.g. while the game uses a projection it fetched before, that would converge to blocks.
+			float3 contribution = current;
+			float weight = Blend;
+			if (any(Jitter != 0)) {
+				float2 offset = (inputPos - (float2(inputTexel) + 0.5)) * float2(OutputSize) / float2(InputSize);
+				contribution = LoadInput(inputTexel);
+				weight *= exp(-SAMPLE_FALLOFF * dot(offset, offset));
+			}
+			result = lerp(clamp(history, minColour, maxColour), contribution, weight);
+		}
+	}
+
+	OutputTexture[OutputOffset + pos] = float4(result, 1);
+	HistoryOutput[pos] = float4(result, 1);
+}
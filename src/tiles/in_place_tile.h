@@ -0,0 +1,56 @@
+// Sharpening in place, where the output texture is the input as well. Workgroups run in any order, so the
+// neighbouring tiles may already be sharpened when a workgroup reads its apron from them. Each workgroup
+// therefore stages its 16x16 tile plus a one pixel apron in groupshared memory before it writes anything:
+// its own texels come from the output UAV, which no other workgroup writes to, and the apron from the
+// original outer texels of the neighbouring tiles that tile_edges.hlsl saved beforehand.
+// Expects OutputTexture to be declared as RWTexture2D<AF4>; reading it needs typed UAV load support for its format.
+
+#define IN_PLACE_TILE_SIZE 16
+#define IN_PLACE_APRON_SIZE (IN_PLACE_TILE_SIZE + 2)
+
+// per tile: its top and bottom row, then its left and right column, see tile_edges.hlsl
+Buffer<float4> TileEdges : register(t2);
+
+groupshared AF3 InPlaceTile[IN_PLACE_APRON_SIZE * IN_PLACE_APRON_SIZE];
+static ASU2 InPlaceOrigin;
+
+// p must be an outer texel of its tile, given relative to the viewport
+AF3 LoadTileEdge(ASU2 p, uint eye, ASU2 viewportSize) {
+	AU2 tiles = (AU2(viewportSize) + IN_PLACE_TILE_SIZE - 1) / IN_PLACE_TILE_SIZE;
+	AU2 tile = AU2(p) / IN_PLACE_TILE_SIZE;
+	AU2 local = AU2(p) % IN_PLACE_TILE_SIZE;
+	uint entry;
+	if (local.y == 0) {
+		entry = local.x;
+	}
+	else if (local.y == IN_PLACE_TILE_SIZE - 1) {
+		entry = IN_PLACE_TILE_SIZE + local.x;
+	}
+	else if (local.x == 0) {
+		entry = 2 * IN_PLACE_TILE_SIZE + local.y;
+	}
+	else {
+		entry = 3 * IN_PLACE_TILE_SIZE + local.y;
+	}
+	return TileEdges[((eye * tiles.y + tile.y) * tiles.x + tile.x) * 4 * IN_PLACE_TILE_SIZE + entry].rgb;
+}
+
+// the apron is clamped to the viewport, so that edge pixels are filtered against themselves
+void StageInPlaceTile(uint localIndex, ASU2 tileOrigin, uint eye, ASU2 viewportOffset, ASU2 viewportSize) {
+	InPlaceOrigin = tileOrigin;
+	for (uint i = localIndex; i < IN_PLACE_APRON_SIZE * IN_PLACE_APRON_SIZE; i += 64) {
+		ASU2 p = clamp(tileOrigin + ASU2(i % IN_PLACE_APRON_SIZE, i / IN_PLACE_APRON_SIZE) - 1, ASU2(0, 0), viewportSize - 1);
+		if (all(p >= tileOrigin) && all(p < tileOrigin + IN_PLACE_TILE_SIZE)) {
+			InPlaceTile[i] = OutputTexture[p + viewportOffset].rgb;
+		}
+		else {
+			InPlaceTile[i] = LoadTileEdge(p, eye, viewportSize);
+		}
+	}
+}
+
+// p relative to the viewport, within the staged tile and apron
+AF3 LoadInPlaceTile(ASU2 p) {
+	ASU2 local = p - InPlaceOrigin + 1;
+	return InPlaceTile[local.y * IN_PLACE_APRON_SIZE + local.x];
+}
@@ -0,0 +1,71 @@
+// Sorts the tiles inside the foveation radius by the luma range of the input they are reconstructed from,
+// so that flat tiles can take the cheap path, see D3D11TileLists.
+
+struct EyeConstants {
+	float2 InputOffset;
+	float2 InputScale; // input pixels per output pixel
+	uint2 InputMin;
+	uint2 InputMax;
+};
+
+cbuffer cb : register(b0) {
+	EyeConstants Eyes[2];
+	uint2 TileSize;
+	float Threshold;
+	uint FlatListOffset;
+};
+
+Texture2D<float4> InputTexture : register(t0);
+// the workgroups' tiles, packed as x | y << 12 | eye << 24
+Buffer<uint> TileList : register(t1);
+RWBuffer<uint> ClassifiedTiles : register(u0);
+// DispatchIndirect arguments of the busy list at offset 0 and of the flat list at offset 12
+RWByteAddressBuffer DispatchArgs : register(u1);
+
+// luma is never negative, so its bit patterns order the same as the floats
+groupshared uint MinLuma;
+groupshared uint MaxLuma;
+
+[numthreads(8, 8, 1)]
+void main(uint3 GroupId : SV_GroupID, uint3 LocalId : SV_GroupThreadID, uint LocalIndex : SV_GroupIndex) {
+	uint tile = TileList[GroupId.x];
+	uint2 tilePos = uint2(tile & 0xfff, (tile >> 12) & 0xfff);
+	EyeConstants eye = Eyes[tile >> 24];
+
+	if (LocalIndex == 0) {
+		MinLuma = 0x7f7fffff;
+		MaxLuma = 0;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// the tile plus the one pixel apron the sharpening reads, widened by the upscaling filter's footprint
+	float2 outputFirst = float2(tilePos * TileSize) - 1;
+	float2 outputLast = float2((tilePos + 1) * TileSize) + 1;
+	int2 first = max(int2(floor(eye.InputOffset + outputFirst * eye.InputScale)) - 1, int2(eye.InputMin));
+	int2 last = min(int2(ceil(eye.InputOffset + outputLast * eye.InputScale)) + 1, int2(eye.InputMax));
+
+	float minLuma = asfloat(0x7f7fffff);
+	float maxLuma = 0;
+	for (int y = first.y + LocalId.y; y <= last.y; y += 8) {
+		for (int x = first.x + LocalId.x; x <= last.x; x += 8) {
+			float luma = max(0, dot(InputTexture.Load(int3(x, y, 0)).rgb, float3(0.2126, 0.7152, 0.0722)));
+			minLuma = min(minLuma, luma);
+			maxLuma = max(maxLuma, luma);
+		}
+	}
+	InterlockedMin(MinLuma, asuint(minLuma));
+	InterlockedMax(MaxLuma, asuint(maxLuma));
+	GroupMemoryBarrierWithGroupSync();
+
+	if (LocalIndex == 0) {
+		uint index;
+		if (asfloat(MaxLuma) - asfloat(MinLuma) < Threshold) {
+			DispatchArgs.InterlockedAdd(12, 1, index);
+			ClassifiedTiles[FlatListOffset + index] = tile;
+		}
+		else {
+			DispatchArgs.InterlockedAdd(0, 1, index);
+			ClassifiedTiles[index] = tile;
+		}
+	}
+}
@@ -0,0 +1,22 @@
+// Saves the outer texels of each 16x16 tile of the viewports before they are sharpened in place,
+// so that the neighbouring tiles can still read the original values, see in_place_tile.h.
+
+cbuffer cb : register(b0) {
+	uint4 Viewports[2]; // offset in xy, size in zw
+};
+
+Texture2D<float4> InputTexture : register(t0);
+// per tile: its top and bottom row, then its left and right column
+RWBuffer<float4> TileEdges : register(u0);
+
+[numthreads(64, 1, 1)]
+void main(uint3 GroupId : SV_GroupID, uint LocalIndex : SV_GroupIndex) {
+	uint4 viewport = Viewports[GroupId.z];
+	uint2 tiles = (viewport.zw + 15) / 16;
+	uint edge = LocalIndex / 16;
+	uint i = LocalIndex % 16;
+	uint2 local = edge == 0 ? uint2(i, 0) : edge == 1 ? uint2(i, 15) : edge == 2 ? uint2(0, i) : uint2(15, i);
+	// texels of partial tiles beyond the viewport are never read
+	uint2 pos = min(GroupId.xy * 16 + local, viewport.zw - 1);
+	TileEdges[((GroupId.z * tiles.y + GroupId.y) * tiles.x + GroupId.x) * 64 + LocalIndex] = InputTexture.Load(int3(viewport.xy + pos, 0));
+}
@@ -50,9 +50,14 @@ namespace vrperfkit {
 		FSR,
 		NIS,
 		CAS,
+		// experimental and not documented for users, see tests/temporal_test.cpp;
+		// needs depth and pose from the game, otherwise falls back to FSR
+		TEMPORAL,
 	};
 	UpscaleMethod MethodFromString(std::string s);
 	std::string MethodToString(UpscaleMethod method);
+	// logs why the method should be used with care, for every way of selecting it
+	void LogIfExperimental(UpscaleMethod method);
 
 	enum class FixedFoveatedMethod {
 		VRS,
@@ -0,0 +1,96 @@
+// Measures how far CAS in packed 16 bits, as the HALF_PRECISION permutations of cas.compute.h run it, drifts
+// from 32 bits on synthetic frames, for sharpening only and for upscaling. Like for FSR, the drift has to
+// stay below what 8-bit output can show in the bulk of the image, with only a few outliers at hard edges.
+// The 16-bit path also skips the approximations of the 32-bit one, which is measured separately.
+#include "half_float.h"
+#include "cas_reference.h"
+#include "test_common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace vrperfkit;
+using namespace vrperfkit::test;
+
+namespace {
+	void TestPairing() {
+		// the right pixel of a pair starts 8 output pixels further, whatever the scale
+		CasConstants con = MakeCasConstants(96, 72, 128, 96, 0.7f);
+		CHECK(std::abs(con.pairOffset - 8.f * con.scaleX) < 1e-5f);
+		CHECK(!con.sharpenOnly);
+		CHECK(MakeCasConstants(64, 64, 64, 64, 0.7f).sharpenOnly);
+		// the peak is negative and between -1/5 and -1/8
+		CHECK(con.sharp < -0.124f && con.sharp > -0.201f);
+	}
+
+	struct Drift {
+		float median;
+		float p99;
+		float max;
+		size_t outliers;
+		size_t count;
+		double psnr;
+	};
+
+	Drift Compare(const Image &reference, const Image &result) {
+		std::vector<float> diffs;
+		double squaredSum = 0;
+		for (size_t i = 0; i < reference.pixels.size(); ++i) {
+			for (int c = 0; c < 3; ++c) {
+				float diff = std::abs(reference.pixels[i][c] - result.pixels[i][c]);
+				diffs.push_back(std::isnan(diff) ? INFINITY : diff);
+				squaredSum += double(diff) * diff;
+			}
+		}
+		std::sort(diffs.begin(), diffs.end());
+		Drift drift;
+		drift.median = diffs[diffs.size() / 2];
+		drift.p99 = diffs[diffs.size() * 99 / 100];
+		drift.max = diffs.back();
+		drift.outliers = diffs.end() - std::upper_bound(diffs.begin(), diffs.end(), 1.f / 32.f);
+		drift.count = diffs.size();
+		drift.psnr = 10 * std::log10(1.0 / (squaredSum / diffs.size()));
+		return drift;
+	}
+
+	void Print(const char *what, const Drift &drift) {
+		printf("  %s: median %g, 99th percentile %g, max %g, %zu above 1/32, PSNR %.1f dB\n",
+				what, drift.median, drift.p99, drift.max, drift.outliers, drift.psnr);
+	}
+
+	void MeasureDrift(int inputWidth, int inputHeight, int outputWidth, int outputHeight) {
+		Image input = MakeSyntheticFrame(inputWidth, inputHeight, inputWidth * 31 + inputHeight);
+		CasConstants con = MakeCasConstants(inputWidth, inputHeight, outputWidth, outputHeight, 0.7f);
+
+		Image full = CasUpscale<float>(input, con);
+		Image exact = CasUpscale<float, false>(input, con);
+		Image half = CasUpscale<Half>(input, con);
+		printf("%dx%d -> %dx%d\n", inputWidth, inputHeight, outputWidth, outputHeight);
+
+		// the lower precision by itself, against the same math in 32 bits
+		Drift precision = Compare(exact, half);
+		Print("16 bits", precision);
+		CHECK(precision.median < 1.f / 512.f);
+		CHECK(precision.p99 < 1.f / 128.f);
+		CHECK(precision.outliers * 1000 < precision.count);
+		CHECK(precision.psnr > 50.0);
+
+		// what switching permutations changes: mostly the approximations that only the 32-bit path uses
+		Drift permutation = Compare(full, half);
+		Print("against the 32-bit permutation", permutation);
+		CHECK(permutation.median < 1.f / 512.f);
+		CHECK(permutation.p99 < 3.f / 255.f);
+		CHECK(permutation.outliers == 0);
+		CHECK(permutation.psnr > 50.0);
+	}
+}
+
+int main() {
+	TestPairing();
+	MeasureDrift(64, 64, 64, 64);
+	MeasureDrift(96, 72, 128, 96);
+	MeasureDrift(80, 48, 160, 96);
+	return test::Result();
+}
@@ -0,0 +1,173 @@
+#pragma once
+#include "fsr_reference.h"
+
+#include <cmath>
+#include <type_traits>
+
+// C++ port of CasFilter and CasFilterH of ffx_cas.h, as cas.compute.h runs them with CAS_BETTER_DIAGONALS.
+// The filter is templated on the scalar type like the FSR references. With float it follows the 32-bit
+// path and its bit-trick approximations; with any other type it follows the packed 16-bit path, which
+// ffx_cas.h builds with CAS_GO_SLOWER on HLSL, i.e. with exact reciprocals and square roots, and which
+// filters each pixel together with the one 8 to the right of it. Running float without the approximations
+// separates the effect of the lower precision from that of the different math.
+namespace vrperfkit {
+	namespace test {
+		struct CasConstants {
+			float scaleX, scaleY;
+			float offsetX, offsetY;
+			// distance to the right pixel of a packed pair in input pixels
+			float pairOffset;
+			float sharp;
+			int outputWidth;
+			int outputHeight;
+			bool sharpenOnly;
+		};
+
+		// same values as CasSetup
+		inline CasConstants MakeCasConstants(int inputWidth, int inputHeight, int outputWidth, int outputHeight, float sharpness) {
+			CasConstants con;
+			con.scaleX = inputWidth * (1.f / outputWidth);
+			con.scaleY = inputHeight * (1.f / outputHeight);
+			con.offsetX = 0.5f * inputWidth * (1.f / outputWidth) - 0.5f;
+			con.offsetY = 0.5f * inputHeight * (1.f / outputHeight) - 0.5f;
+			con.pairOffset = 8.f * inputWidth * (1.f / outputWidth);
+			float lerp = 5.f * sharpness + (-8.f * sharpness + 8.f);
+			con.sharp = -(1.f / lerp);
+			con.outputWidth = outputWidth;
+			con.outputHeight = outputHeight;
+			con.sharpenOnly = inputWidth == outputWidth && inputHeight == outputHeight;
+			return con;
+		}
+
+		// the approximations only exist for 32 bits
+		template<bool approximate, typename T>
+		T CasLoRcp(T a) {
+			if constexpr (approximate) return PrxLoRcp(a); else return Rcp(a);
+		}
+		template<bool approximate, typename T>
+		T CasMedRcp(T a) {
+			if constexpr (approximate) return PrxMedRcp(a); else return Rcp(a);
+		}
+		template<bool approximate, typename T>
+		T CasSqrt(T a) {
+			if constexpr (approximate) return FloatFromBits((BitsFromFloat(a) >> 1) + 0x1fbc4639u); else return T(std::sqrt(float(a)));
+		}
+
+		template<typename T>
+		T Min5(T a, T b, T c, T d, T e) { return Min(Min(Min(a, b), c), Min(d, e)); }
+		template<typename T>
+		T Max5(T a, T b, T c, T d, T e) { return Max(Max(Max(a, b), c), Max(d, e)); }
+
+		// soft min and max of green over the cross and the diagonals around a texel, both 2x bigger
+		template<typename T>
+		void CasSoftMinMax(const Rgb<T> &centre, const Rgb<T> &n, const Rgb<T> &w, const Rgb<T> &e, const Rgb<T> &s,
+				const Rgb<T> &nw, const Rgb<T> &ne, const Rgb<T> &sw, const Rgb<T> &se, T &mn, T &mx) {
+			mn = Min5(n[1], w[1], centre[1], e[1], s[1]);
+			mn = mn + Min5(mn, nw[1], ne[1], sw[1], se[1]);
+			mx = Max5(n[1], w[1], centre[1], e[1], s[1]);
+			mx = mx + Max5(mx, nw[1], ne[1], sw[1], se[1]);
+		}
+
+		// filter weight of the cross around a texel; only green is used, as CAS_SLOW is not defined
+		template<bool approximate, typename T>
+		T CasWeight(T mn, T mx, T peak) {
+			T amp = Sat(Min(mn, T(2.f) - mx) * CasLoRcp<approximate>(mx));
+			return CasSqrt<approximate>(amp) * peak;
+		}
+
+		// filters one output pixel, pp is its position in the input as computed in 32 bits
+		template<typename T, bool approximate>
+		Rgb<float> CasFilterAt(const Image &input, int x, int y, float ppx, float ppy, const CasConstants &con) {
+			T peak = T(con.sharp);
+			Rgb<float> out;
+			auto load = [&](int dx, int dy) { return ImageGather<T>::Convert(input.Clamped(x + dx, y + dy)); };
+
+			if (con.sharpenOnly) {
+				// a b c
+				// d e f
+				// g h i
+				Rgb<T> a = load(-1, -1), b = load(0, -1), c = load(1, -1);
+				Rgb<T> d = load(-1, 0), e = load(0, 0), f = load(1, 0);
+				Rgb<T> g = load(-1, 1), h = load(0, 1), i = load(1, 1);
+				T mn, mx;
+				CasSoftMinMax(e, b, d, f, h, a, c, g, i, mn, mx);
+				T w = CasWeight<approximate>(mn, mx, peak);
+				T rcpWeight = CasMedRcp<approximate>(T(1.f) + T(4.f) * w);
+				for (int ch = 0; ch < 3; ++ch) {
+					out[ch] = float(Sat((b[ch] * w + d[ch] * w + f[ch] * w + h[ch] * w + e[ch]) * rcpWeight));
+				}
+				return out;
+			}
+
+			// a b c d
+			// e f g h
+			// i j k l
+			// m n o p
+			Rgb<T> a = load(-1, -1), b = load(0, -1), c = load(1, -1), d = load(2, -1);
+			Rgb<T> e = load(-1, 0), f = load(0, 0), g = load(1, 0), h = load(2, 0);
+			Rgb<T> i = load(-1, 1), j = load(0, 1), k = load(1, 1), l = load(2, 1);
+			Rgb<T> m = load(-1, 2), n = load(0, 2), o = load(1, 2), p = load(2, 2);
+			T mnf, mxf, mng, mxg, mnj, mxj, mnk, mxk;
+			CasSoftMinMax(f, b, e, g, j, a, c, i, k, mnf, mxf);
+			CasSoftMinMax(g, c, f, h, k, b, d, j, l, mng, mxg);
+			CasSoftMinMax(j, f, i, k, n, e, g, m, o, mnj, mxj);
+			CasSoftMinMax(k, g, j, l, o, f, h, n, p, mnk, mxk);
+			T wf = CasWeight<approximate>(mnf, mxf, peak);
+			T wg = CasWeight<approximate>(mng, mxg, peak);
+			T wj = CasWeight<approximate>(mnj, mxj, peak);
+			T wk = CasWeight<approximate>(mnk, mxk, peak);
+
+			// the fractional position is narrowed only after it was computed in 32 bits
+			T fx = T(ppx - std::floor(ppx));
+			T fy = T(ppy - std::floor(ppy));
+			T s = (T(1.f) - fx) * (T(1.f) - fy);
+			T t = fx * (T(1.f) - fy);
+			T u = (T(1.f) - fx) * fy;
+			T v = fx * fy;
+			// thin edges to hide bilinear interpolation
+			T thinB = T(1.f / 32.f);
+			s = s * CasLoRcp<approximate>(thinB + (mxf - mnf));
+			t = t * CasLoRcp<approximate>(thinB + (mxg - mng));
+			u = u * CasLoRcp<approximate>(thinB + (mxj - mnj));
+			v = v * CasLoRcp<approximate>(thinB + (mxk - mnk));
+
+			T qbe = wf * s;
+			T qch = wg * t;
+			T qf = wg * t + wj * u + s;
+			T qg = wf * s + wk * v + t;
+			T qj = wf * s + wk * v + u;
+			T qk = wg * t + wj * u + v;
+			T qin = wj * u;
+			T qlo = wk * v;
+			T rcpW = CasMedRcp<approximate>(T(2.f) * qbe + T(2.f) * qch + T(2.f) * qin + T(2.f) * qlo + qf + qg + qj + qk);
+			for (int ch = 0; ch < 3; ++ch) {
+				out[ch] = float(Sat((b[ch] * qbe + e[ch] * qbe + c[ch] * qch + h[ch] * qch + i[ch] * qin + n[ch] * qin
+						+ l[ch] * qlo + o[ch] * qlo + f[ch] * qf + g[ch] * qg + j[ch] * qj + k[ch] * qk) * rcpW));
+			}
+			return out;
+		}
+
+		// the full output as cas.compute.h produces it: with 16 bits, each 16x8 region of a workgroup is
+		// filtered as pairs 8 pixels apart, and the right pixel's position is derived from the left one's
+		template<typename T, bool approximate = std::is_same<T, float>::value>
+		Image CasUpscale(const Image &input, const CasConstants &con) {
+			constexpr bool packed = !std::is_same<T, float>::value;
+			Image output (con.outputWidth, con.outputHeight);
+			for (int y = 0; y < con.outputHeight; ++y) {
+				for (int x = 0; x < con.outputWidth; ++x) {
+					bool right = packed && (x & 8) != 0;
+					int base = right ? x - 8 : x;
+					float ppx = float(base) * con.scaleX + con.offsetX;
+					float ppy = float(y) * con.scaleY + con.offsetY;
+					if (right) {
+						ppx = ppx + con.pairOffset;
+					}
+					int sx = con.sharpenOnly ? x : (int)std::floor(ppx);
+					int sy = con.sharpenOnly ? y : (int)std::floor(ppy);
+					output.At(x, y) = CasFilterAt<T, approximate>(input, sx, sy, ppx, ppy, con);
+				}
+			}
+			return output;
+		}
+	}
+}
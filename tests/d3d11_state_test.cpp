@@ -0,0 +1,317 @@
+// Runs StoreD3D11State and RestoreD3D11State against a mock context: every piece of state is queried
+// and set exactly once, only the slots post-processing uses are touched, the game's bindings come back
+// unchanged, including the constant buffer range on D3D11.1 contexts, and no references are leaked.
+#include "d3d11/d3d11_state.h"
+#include "test_common.h"
+
+#include <map>
+#include <string>
+
+using namespace vrperfkit;
+
+namespace {
+	template<typename I>
+	struct MockObject : I {
+		ULONG refs = 1;
+		ULONG AddRef() override { return ++refs; }
+		ULONG Release() override { return --refs; }
+		HRESULT QueryInterface(const void *, void **object) override {
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+	};
+
+	// like the runtime, bound objects are referenced by the context and getters return new references
+	template<typename I, UINT N>
+	struct Slots {
+		I *bound[N] = {};
+
+		void Set(UINT start, UINT count, I *const *objects) {
+			for (UINT i = 0; i < count; ++i) {
+				I *object = objects ? objects[i] : nullptr;
+				if (object) object->AddRef();
+				if (bound[start + i]) bound[start + i]->Release();
+				bound[start + i] = object;
+			}
+		}
+
+		void Get(UINT start, UINT count, I **objects) const {
+			for (UINT i = 0; i < count; ++i) {
+				objects[i] = bound[start + i];
+				if (objects[i]) objects[i]->AddRef();
+			}
+		}
+	};
+
+	class MockContext : public MockObject<ID3D11DeviceContext1> {
+	public:
+		explicit MockContext(bool supportsOffsets) : supportsOffsets(supportsOffsets) {}
+
+		bool supportsOffsets;
+		Slots<ID3D11ComputeShader, 1> shader;
+		Slots<ID3D11Buffer, 14> constantBuffers;
+		// bound range per slot in 16-byte constants, the whole buffer is reported as 0 and 4096
+		UINT firstConstant[14] = {};
+		UINT numConstants[14] = {};
+		Slots<ID3D11SamplerState, 16> samplers;
+		Slots<ID3D11ShaderResourceView, 128> srvs;
+		Slots<ID3D11UnorderedAccessView, 8> uavs;
+		Slots<ID3D11RenderTargetView, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT> renderTargets;
+		Slots<ID3D11DepthStencilView, 1> depthStencil;
+		UINT uavInitialCounts[8] = {};
+
+		// number of calls and the end of the last slot range touched, per method
+		std::map<std::string, int> calls;
+		std::map<std::string, UINT> rangeEnd;
+
+		HRESULT QueryInterface(const void *iid, void **object) override {
+			if (supportsOffsets && iid == MockIid<ID3D11DeviceContext1>()) {
+				AddRef();
+				*object = static_cast<ID3D11DeviceContext1*>(this);
+				return S_OK;
+			}
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		void CSGetShader(ID3D11ComputeShader **ppComputeShader, ID3D11ClassInstance **, UINT *pNumClassInstances) override {
+			Record("CSGetShader", 0, 1);
+			shader.Get(0, 1, ppComputeShader);
+			if (pNumClassInstances) *pNumClassInstances = 0;
+		}
+		void CSGetConstantBuffers(UINT start, UINT count, ID3D11Buffer **buffers) override {
+			Record("CSGetConstantBuffers", start, count);
+			constantBuffers.Get(start, count, buffers);
+		}
+		void CSGetConstantBuffers1(UINT start, UINT count, ID3D11Buffer **buffers, UINT *first, UINT *num) override {
+			Record("CSGetConstantBuffers1", start, count);
+			constantBuffers.Get(start, count, buffers);
+			for (UINT i = 0; i < count; ++i) {
+				first[i] = firstConstant[start + i];
+				num[i] = numConstants[start + i];
+			}
+		}
+		void CSGetSamplers(UINT start, UINT count, ID3D11SamplerState **samplerStates) override {
+			Record("CSGetSamplers", start, count);
+			samplers.Get(start, count, samplerStates);
+		}
+		void CSGetShaderResources(UINT start, UINT count, ID3D11ShaderResourceView **views) override {
+			Record("CSGetShaderResources", start, count);
+			srvs.Get(start, count, views);
+		}
+		void CSGetUnorderedAccessViews(UINT start, UINT count, ID3D11UnorderedAccessView **views) override {
+			Record("CSGetUnorderedAccessViews", start, count);
+			uavs.Get(start, count, views);
+		}
+		void OMGetRenderTargets(UINT count, ID3D11RenderTargetView **views, ID3D11DepthStencilView **dsv) override {
+			Record("OMGetRenderTargets", 0, count);
+			if (views) renderTargets.Get(0, count, views);
+			if (dsv) depthStencil.Get(0, 1, dsv);
+		}
+
+		void CSSetShader(ID3D11ComputeShader *computeShader, ID3D11ClassInstance *const *, UINT) override {
+			Record("CSSetShader", 0, 1);
+			shader.Set(0, 1, &computeShader);
+		}
+		void CSSetConstantBuffers(UINT start, UINT count, ID3D11Buffer *const *buffers) override {
+			Record("CSSetConstantBuffers", start, count);
+			SetConstantBuffers(start, count, buffers, nullptr, nullptr);
+		}
+		void CSSetConstantBuffers1(UINT start, UINT count, ID3D11Buffer *const *buffers, const UINT *first, const UINT *num) override {
+			Record("CSSetConstantBuffers1", start, count);
+			SetConstantBuffers(start, count, buffers, first, num);
+		}
+		void CSSetSamplers(UINT start, UINT count, ID3D11SamplerState *const *samplerStates) override {
+			Record("CSSetSamplers", start, count);
+			samplers.Set(start, count, samplerStates);
+		}
+		void CSSetShaderResources(UINT start, UINT count, ID3D11ShaderResourceView *const *views) override {
+			Record("CSSetShaderResources", start, count);
+			srvs.Set(start, count, views);
+		}
+		void CSSetUnorderedAccessViews(UINT start, UINT count, ID3D11UnorderedAccessView *const *views, const UINT *initialCounts) override {
+			Record("CSSetUnorderedAccessViews", start, count);
+			uavs.Set(start, count, views);
+			for (UINT i = 0; i < count; ++i) {
+				uavInitialCounts[start + i] = initialCounts ? initialCounts[i] : 0;
+			}
+		}
+		void OMSetRenderTargets(UINT count, ID3D11RenderTargetView *const *views, ID3D11DepthStencilView *dsv) override {
+			Record("OMSetRenderTargets", 0, count);
+			renderTargets.Set(0, count, views);
+			depthStencil.Set(0, 1, &dsv);
+		}
+
+		void SetConstantBuffers(UINT start, UINT count, ID3D11Buffer *const *buffers, const UINT *first, const UINT *num) {
+			constantBuffers.Set(start, count, buffers);
+			for (UINT i = 0; i < count; ++i) {
+				firstConstant[start + i] = first ? first[i] : 0;
+				numConstants[start + i] = num ? num[i] : 4096;
+			}
+		}
+
+		int TotalCalls() const {
+			int total = 0;
+			for (const auto &entry : calls) {
+				total += entry.second;
+			}
+			return total;
+		}
+
+	private:
+		void Record(const std::string &method, UINT start, UINT count) {
+			++calls[method];
+			rangeEnd[method] = start + count;
+		}
+	};
+
+	// the game's state, in more slots than post-processing touches
+	struct GameObjects {
+		MockObject<ID3D11ComputeShader> shader;
+		MockObject<ID3D11Buffer> constantBuffers[2];
+		MockObject<ID3D11SamplerState> samplers[2];
+		MockObject<ID3D11ShaderResourceView> srvs[6];
+		MockObject<ID3D11UnorderedAccessView> uavs[3];
+		MockObject<ID3D11RenderTargetView> renderTargets[2];
+		MockObject<ID3D11DepthStencilView> depthStencil;
+
+		// the game's b0 is a range within a larger buffer
+		static const UINT FIRST_CONSTANT = 48;
+		static const UINT NUM_CONSTANTS = 16;
+
+		void Bind(MockContext &context) {
+			ID3D11ComputeShader *cs = &shader;
+			context.shader.Set(0, 1, &cs);
+			for (UINT i = 0; i < 2; ++i) {
+				ID3D11Buffer *cb = &constantBuffers[i];
+				UINT first = i == 0 ? FIRST_CONSTANT : 0;
+				UINT num = i == 0 ? NUM_CONSTANTS : 4096;
+				context.SetConstantBuffers(i, 1, &cb, &first, &num);
+				ID3D11SamplerState *sampler = &samplers[i];
+				context.samplers.Set(i, 1, &sampler);
+				ID3D11RenderTargetView *rtv = &renderTargets[i];
+				context.renderTargets.Set(i, 1, &rtv);
+			}
+			for (UINT i = 0; i < 6; ++i) {
+				ID3D11ShaderResourceView *srv = &srvs[i];
+				context.srvs.Set(i, 1, &srv);
+			}
+			for (UINT i = 0; i < 3; ++i) {
+				ID3D11UnorderedAccessView *uav = &uavs[i];
+				context.uavs.Set(i, 1, &uav);
+			}
+			ID3D11DepthStencilView *dsv = &depthStencil;
+			context.depthStencil.Set(0, 1, &dsv);
+		}
+
+		// references held by the mock context only
+		bool AllReferencedOnce() const {
+			bool ok = shader.refs == 2 && depthStencil.refs == 2;
+			for (const auto &o : constantBuffers) ok = ok && o.refs == 2;
+			for (const auto &o : samplers) ok = ok && o.refs == 2;
+			for (const auto &o : srvs) ok = ok && o.refs == 2;
+			for (const auto &o : uavs) ok = ok && o.refs == 2;
+			for (const auto &o : renderTargets) ok = ok && o.refs == 2;
+			return ok;
+		}
+	};
+
+	// what the post-processor binds in between
+	void BindPostProcessing(MockContext &context) {
+		static MockObject<ID3D11ComputeShader> shader;
+		static MockObject<ID3D11Buffer> constants;
+		static MockObject<ID3D11SamplerState> sampler;
+		static MockObject<ID3D11ShaderResourceView> input;
+		static MockObject<ID3D11UnorderedAccessView> output;
+		ID3D11ComputeShader *cs = &shader;
+		context.shader.Set(0, 1, &cs);
+		ID3D11Buffer *cb = &constants;
+		context.SetConstantBuffers(0, 1, &cb, nullptr, nullptr);
+		ID3D11SamplerState *s = &sampler;
+		context.samplers.Set(0, 1, &s);
+		ID3D11ShaderResourceView *srvs[2] = { &input, nullptr };
+		context.srvs.Set(0, 2, srvs);
+		ID3D11UnorderedAccessView *uav = &output;
+		context.uavs.Set(0, 1, &uav);
+		ID3D11RenderTargetView *rtvs[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+		context.renderTargets.Set(0, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, rtvs);
+		ID3D11DepthStencilView *dsv = nullptr;
+		context.depthStencil.Set(0, 1, &dsv);
+	}
+
+	void TestRoundTrip(bool supportsOffsets) {
+		const char *getConstantBuffers = supportsOffsets ? "CSGetConstantBuffers1" : "CSGetConstantBuffers";
+		const char *setConstantBuffers = supportsOffsets ? "CSSetConstantBuffers1" : "CSSetConstantBuffers";
+		MockContext context (supportsOffsets);
+		GameObjects game;
+		game.Bind(context);
+		CHECK(game.AllReferencedOnce());
+
+		D3D11State state;
+		StoreD3D11State(&context, state);
+		CHECK(context.TotalCalls() == 6);
+		for (const char *method : { "CSGetShader", getConstantBuffers, "CSGetSamplers", "CSGetShaderResources", "CSGetUnorderedAccessViews", "OMGetRenderTargets" }) {
+			CHECK(context.calls[method] == 1);
+		}
+		CHECK(context.rangeEnd[getConstantBuffers] == 1);
+		CHECK(context.rangeEnd["CSGetSamplers"] == 1);
+		CHECK(context.rangeEnd["CSGetShaderResources"] == D3D11State::CS_SRV_COUNT);
+		CHECK(context.rangeEnd["CSGetUnorderedAccessViews"] == D3D11State::CS_UAV_COUNT);
+
+		BindPostProcessing(context);
+		context.calls.clear();
+		RestoreD3D11State(&context, state);
+		CHECK(context.TotalCalls() == 6);
+		for (const char *method : { "CSSetShader", setConstantBuffers, "CSSetSamplers", "CSSetShaderResources", "CSSetUnorderedAccessViews", "OMSetRenderTargets" }) {
+			CHECK(context.calls[method] == 1);
+		}
+		CHECK(context.rangeEnd["CSSetShaderResources"] == D3D11State::CS_SRV_COUNT);
+		CHECK(context.rangeEnd["CSSetUnorderedAccessViews"] == D3D11State::CS_UAV_COUNT);
+		// append/consume counters are left alone
+		CHECK(context.uavInitialCounts[0] == (UINT)-1 && context.uavInitialCounts[1] == (UINT)-1);
+
+		CHECK(context.shader.bound[0] == &game.shader);
+		CHECK(context.constantBuffers.bound[0] == &game.constantBuffers[0]);
+		CHECK(context.rangeEnd[setConstantBuffers] == 1);
+		if (supportsOffsets) {
+			CHECK(context.firstConstant[0] == GameObjects::FIRST_CONSTANT);
+			CHECK(context.numConstants[0] == GameObjects::NUM_CONSTANTS);
+		}
+		CHECK(context.samplers.bound[0] == &game.samplers[0]);
+		for (UINT i = 0; i < 6; ++i) {
+			CHECK(context.srvs.bound[i] == &game.srvs[i]);
+		}
+		for (UINT i = 0; i < 3; ++i) {
+			CHECK(context.uavs.bound[i] == &game.uavs[i]);
+		}
+		CHECK(context.renderTargets.bound[0] == &game.renderTargets[0]);
+		CHECK(context.renderTargets.bound[1] == &game.renderTargets[1]);
+		CHECK(context.depthStencil.bound[0] == &game.depthStencil);
+
+		// the ComPtr members still hold their references until the state goes away
+		state = D3D11State();
+		CHECK(game.AllReferencedOnce());
+		CHECK(context.refs == 1);
+	}
+
+	void TestEmptyState() {
+		MockContext context (true);
+		D3D11State state;
+		StoreD3D11State(&context, state);
+		RestoreD3D11State(&context, state);
+		CHECK(context.TotalCalls() == 12);
+		// an unbound constant buffer is restored without a range
+		CHECK(context.calls["CSSetConstantBuffers"] == 1);
+		CHECK(context.constantBuffers.bound[0] == nullptr);
+		CHECK(context.shader.bound[0] == nullptr);
+		CHECK(context.srvs.bound[0] == nullptr);
+		CHECK(context.renderTargets.bound[0] == nullptr);
+	}
+}
+
+int main() {
+	TestRoundTrip(false);
+	TestRoundTrip(true);
+	TestEmptyState();
+	return test::Result();
+}
@@ -0,0 +1,72 @@
+// Checks the half float emulation, then measures how far EASU and RCAS in 16 bits, as the HALF_PRECISION
+// permutations run them, drift from 32 bits on synthetic frames. The drift has to stay below what 8-bit
+// output can show in the bulk of the image, with only a few outliers at hard edges.
+#include "half_float.h"
+#include "fsr_reference.h"
+#include "test_common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace vrperfkit;
+using namespace vrperfkit::test;
+
+namespace {
+	void TestHalfRounding() {
+		CHECK(float(Half(1.f)) == 1.f);
+		// 11 bits of precision: 1 + 2^-11 is halfway and rounds to even, 1 + 3 * 2^-11 rounds up
+		CHECK(float(Half(1.f + 1.f / 2048.f)) == 1.f);
+		CHECK(float(Half(1.f + 3.f / 2048.f)) == 1.f + 2.f / 1024.f);
+		CHECK(float(Half(65504.f)) == 65504.f);
+		CHECK(std::isinf(float(Half(65520.f))));
+		CHECK(float(Half(std::ldexp(1.f, -24))) == std::ldexp(1.f, -24));
+		CHECK(float(Half(std::ldexp(1.f, -26))) == 0.f);
+		CHECK(float(-Half(0.5f)) == -0.5f);
+		CHECK(float(Half(0.1f) + Half(0.2f)) == float(Half(float(Half(0.1f)) + float(Half(0.2f)))));
+		// the low precision approximations are within a few percent
+		CHECK(std::abs(float(PrxLoRcp(Half(3.f))) - 1.f / 3.f) < 0.02f);
+		CHECK(std::abs(float(PrxMedRcp(Half(3.f))) - 1.f / 3.f) < 0.001f);
+		CHECK(std::abs(float(PrxLoRsq(Half(4.f))) - 0.5f) < 0.03f);
+	}
+
+	void MeasureDrift(int inputWidth, int inputHeight, int outputWidth, int outputHeight) {
+		Image input = MakeSyntheticFrame(inputWidth, inputHeight, inputWidth * 17 + inputHeight);
+		FsrConstants con = MakeFsrConstants(inputWidth, inputHeight, outputWidth, outputHeight, 0.5f);
+
+		Image full = UpscaleTwoPass<float>(con, ImageGather<float> { input });
+		Image half = UpscaleTwoPass<Half>(con, ImageGather<Half> { input });
+
+		std::vector<float> diffs;
+		double squaredSum = 0;
+		for (size_t i = 0; i < full.pixels.size(); ++i) {
+			for (int c = 0; c < 3; ++c) {
+				float diff = std::abs(full.pixels[i][c] - half.pixels[i][c]);
+				diffs.push_back(std::isnan(diff) ? INFINITY : diff);
+				squaredSum += double(diff) * diff;
+			}
+		}
+		std::sort(diffs.begin(), diffs.end());
+		float median = diffs[diffs.size() / 2];
+		float p99 = diffs[diffs.size() * 99 / 100];
+		float maxDiff = diffs.back();
+		// where an edge is nearly ambiguous, the rounding can tip EASU towards a different direction
+		size_t outliers = diffs.end() - std::upper_bound(diffs.begin(), diffs.end(), 1.f / 32.f);
+		double psnr = 10 * std::log10(1.0 / (squaredSum / diffs.size()));
+		printf("%dx%d -> %dx%d: median %g, 99th percentile %g, max %g, %zu above 1/32, PSNR %.1f dB\n",
+				inputWidth, inputHeight, outputWidth, outputHeight, median, p99, maxDiff, outliers, psnr);
+		CHECK(median < 1.f / 512.f);
+		CHECK(p99 < 1.f / 128.f);
+		CHECK(outliers * 1000 < diffs.size());
+		CHECK(psnr > 50.0);
+	}
+}
+
+int main() {
+	TestHalfRounding();
+	MeasureDrift(64, 64, 64, 64);
+	MeasureDrift(96, 72, 128, 96);
+	MeasureDrift(80, 48, 160, 96);
+	return test::Result();
+}
@@ -0,0 +1,74 @@
+// Checks the single-channel EASU of fsr_fused.hlsl's LUMA_ONLY path against FsrEasuF on three equal
+// channels, then reports how much quality the luma-only mode gives up against full FSR on synthetic frames,
+// next to plain bilinear upscaling for scale.
+#include "fsr_reference.h"
+#include "test_common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace vrperfkit;
+using namespace vrperfkit::test;
+
+namespace {
+	double Psnr(const Image &a, const Image &b) {
+		double squaredSum = 0;
+		for (size_t i = 0; i < a.pixels.size(); ++i) {
+			for (int c = 0; c < 3; ++c) {
+				double diff = std::clamp(a.pixels[i][c], 0.f, 1.f) - std::clamp(b.pixels[i][c], 0.f, 1.f);
+				squaredSum += diff * diff;
+			}
+		}
+		return 10 * std::log10(1.0 / (squaredSum / (3 * a.pixels.size())));
+	}
+
+	void CheckSingleChannelMatchesTriplicated(int inputWidth, int inputHeight, int outputWidth, int outputHeight) {
+		Image input = MakeSyntheticFrame(inputWidth, inputHeight, inputWidth + inputHeight);
+		Image luma (inputWidth, inputHeight);
+		for (size_t i = 0; i < input.pixels.size(); ++i) {
+			float y = RgbToYCoCg(input.pixels[i])[0];
+			luma.pixels[i] = { y, y, y };
+		}
+		FsrConstants con = MakeFsrConstants(inputWidth, inputHeight, outputWidth, outputHeight, 0.5f);
+		ImageGather<float> rgbGather { luma };
+		LumaGather<float> lumaGather { luma };
+		float maxDiff = 0;
+		for (int y = 0; y < outputHeight; ++y) {
+			for (int x = 0; x < outputWidth; ++x) {
+				Rgb<float> triplicated = Easu<float>(x, y, con, rgbGather);
+				maxDiff = std::max(maxDiff, std::abs(EasuLuma<float>(x, y, con, lumaGather) - triplicated[0]));
+			}
+		}
+		printf("%dx%d -> %dx%d: single-channel EASU differs from three channels by at most %g\n", inputWidth, inputHeight, outputWidth, outputHeight, maxDiff);
+		// only the rounding of the luma times 2 differs
+		CHECK(maxDiff < 1e-5f);
+	}
+
+	void ReportQualityDelta(int inputWidth, int inputHeight, int outputWidth, int outputHeight) {
+		Image input = MakeSyntheticFrame(inputWidth, inputHeight, inputWidth * 3 + inputHeight);
+		FsrConstants con = MakeFsrConstants(inputWidth, inputHeight, outputWidth, outputHeight, 0.5f);
+		Image full = UpscaleTwoPass<float>(con, ImageGather<float> { input });
+		Image lumaOnly = UpscaleLumaOnly<float>(con, input);
+		Image bilinear (outputWidth, outputHeight);
+		for (int y = 0; y < outputHeight; ++y) {
+			for (int x = 0; x < outputWidth; ++x) {
+				bilinear.At(x, y) = SampleLinearClamp(input, (x + 0.5f) / outputWidth, (y + 0.5f) / outputHeight);
+			}
+		}
+		double lumaPsnr = Psnr(full, lumaOnly), bilinearPsnr = Psnr(full, bilinear);
+		printf("%dx%d -> %dx%d: against full FSR, luma only %.1f dB, bilinear %.1f dB\n",
+				inputWidth, inputHeight, outputWidth, outputHeight, lumaPsnr, bilinearPsnr);
+		// the synthetic frame's saturated checkerboard is a worst case for bilinear chroma
+		CHECK(lumaPsnr > bilinearPsnr + 3);
+		CHECK(lumaPsnr > 25);
+	}
+}
+
+int main() {
+	CheckSingleChannelMatchesTriplicated(64, 48, 83, 62);
+	CheckSingleChannelMatchesTriplicated(40, 40, 80, 80);
+	ReportQualityDelta(154, 128, 200, 166);
+	ReportQualityDelta(100, 80, 200, 160);
+	return test::Result();
+}
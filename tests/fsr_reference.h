@@ -0,0 +1,410 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#define A_CPU
+#include "fsr/ffx_a.h"
+#include "fsr/ffx_fsr1.h"
+
+#include "test_images.h"
+
+// C++ ports of the EASU and RCAS filters of ffx_fsr1.h, whose A_CPU path only contains the constant setup,
+// and of the way fsr_fused.hlsl tiles them. The filters are templated on the scalar type, so that they can
+// also run with an emulated lower precision. Positions are always computed in 32 bits, like the shaders do.
+namespace vrperfkit {
+	namespace test {
+		template<typename T>
+		using Rgb = std::array<T, 3>;
+		// the four texels of a Gather*, in its (-,+), (+,+), (+,-), (-,-) order
+		template<typename T>
+		using Quad = std::array<Rgb<T>, 4>;
+
+		template<typename T>
+		struct Vec2 {
+			T x, y;
+		};
+
+		inline float FloatFromBits(uint32_t u) { float f; memcpy(&f, &u, sizeof(f)); return f; }
+		inline uint32_t BitsFromFloat(float f) { uint32_t u; memcpy(&u, &f, sizeof(u)); return u; }
+
+		// the approximations from ffx_a.h, the half emulation brings its own
+		inline float PrxLoRcp(float a) { return FloatFromBits(0x7ef07ebbu - BitsFromFloat(a)); }
+		inline float PrxMedRcp(float a) { float b = FloatFromBits(0x7ef19fffu - BitsFromFloat(a)); return b * (-b * a + 2.f); }
+		inline float PrxLoRsq(float a) { return FloatFromBits(0x5f347d74u - (BitsFromFloat(a) >> 1)); }
+
+		template<typename T> T Min(T a, T b) { return b < a ? b : a; }
+		template<typename T> T Max(T a, T b) { return a < b ? b : a; }
+		template<typename T> T Abs(T a) { return a < T(0.f) ? -a : a; }
+		template<typename T> T Sat(T a) { return Min(Max(a, T(0.f)), T(1.f)); }
+		template<typename T> T Rcp(T a) { return T(1.f) / a; }
+
+		// luma times 2, as used by both filters
+		template<typename T>
+		T Luma2(const Rgb<T> &c) { return c[2] * T(0.5f) + (c[0] * T(0.5f) + c[1]); }
+
+		struct FsrConstants {
+			AU1 const0[4];
+			AU1 const1[4];
+			AU1 const2[4];
+			AU1 const3[4];
+			AU1 rcasConst[4];
+			int outputWidth;
+			int outputHeight;
+		};
+
+		inline FsrConstants MakeFsrConstants(int inputWidth, int inputHeight, int outputWidth, int outputHeight, float sharpness) {
+			FsrConstants con = {};
+			FsrEasuCon(con.const0, con.const1, con.const2, con.const3, inputWidth, inputHeight, inputWidth, inputHeight, outputWidth, outputHeight);
+			FsrRcasCon(con.rcasConst, sharpness);
+			con.outputWidth = outputWidth;
+			con.outputHeight = outputHeight;
+			return con;
+		}
+
+		// Gather* on an image with a clamping sampler
+		template<typename T>
+		struct ImageGather {
+			const Image &image;
+
+			Quad<T> operator()(float u, float v) const {
+				int x = (int)std::floor(u * image.width - 0.5f);
+				int y = (int)std::floor(v * image.height - 0.5f);
+				return { Convert(image.Clamped(x, y + 1)), Convert(image.Clamped(x + 1, y + 1)), Convert(image.Clamped(x + 1, y)), Convert(image.Clamped(x, y)) };
+			}
+
+			static Rgb<T> Convert(const Rgb<float> &c) { return { T(c[0]), T(c[1]), T(c[2]) }; }
+		};
+
+		template<typename T>
+		void EasuSet(Vec2<T> &dir, T &len, Vec2<T> pp, int corner, T lA, T lB, T lC, T lD, T lE) {
+			T w;
+			switch (corner) {
+			case 0: w = (T(1.f) - pp.x) * (T(1.f) - pp.y); break;
+			case 1: w = pp.x * (T(1.f) - pp.y); break;
+			case 2: w = (T(1.f) - pp.x) * pp.y; break;
+			default: w = pp.x * pp.y; break;
+			}
+			T dc = lD - lC;
+			T cb = lC - lB;
+			T lenX = PrxLoRcp(Max(Abs(dc), Abs(cb)));
+			T dirX = lD - lB;
+			dir.x = dir.x + dirX * w;
+			lenX = Sat(Abs(dirX) * lenX);
+			lenX = lenX * lenX;
+			len = len + lenX * w;
+			T ec = lE - lC;
+			T ca = lC - lA;
+			T lenY = PrxLoRcp(Max(Abs(ec), Abs(ca)));
+			T dirY = lE - lA;
+			dir.y = dir.y + dirY * w;
+			lenY = Sat(Abs(dirY) * lenY);
+			lenY = lenY * lenY;
+			len = len + lenY * w;
+		}
+
+		template<typename T, typename C>
+		void EasuTap(C &aC, T &aW, Vec2<T> off, Vec2<T> dir, Vec2<T> len, T lob, T clp, const C &c) {
+			Vec2<T> v = { off.x * dir.x + off.y * dir.y, off.x * -dir.y + off.y * dir.x };
+			v.x = v.x * len.x;
+			v.y = v.y * len.y;
+			T d2 = Min(v.x * v.x + v.y * v.y, clp);
+			T wB = T(2.f / 5.f) * d2 + T(-1.f);
+			T wA = lob * d2 + T(-1.f);
+			wB = wB * wB;
+			wA = wA * wA;
+			wB = T(25.f / 16.f) * wB + T(-(25.f / 16.f - 1.f));
+			T w = wB * wA;
+			for (size_t i = 0; i < c.size(); ++i) {
+				aC[i] = aC[i] + c[i] * w;
+			}
+			aW = aW + w;
+		}
+
+		// The part of FsrEasuF that only depends on luma: the gradient direction, the anisotropic lengths,
+		// the lobe and the clipping point for the sample position within the 'f' texel.
+		template<typename T>
+		struct EasuKernel {
+			Vec2<T> dir;
+			Vec2<T> len2;
+			T lob;
+			T clp;
+		};
+
+		// luma of the 12 taps in the b c e f g h i j k l n o order
+		template<typename T>
+		EasuKernel<T> EasuAnalyze(Vec2<T> pp, const std::array<T, 12> &l) {
+			enum { B, C, E, F, G, H, I, J, K, L, N, O };
+			Vec2<T> dir = { T(0.f), T(0.f) };
+			T len = T(0.f);
+			EasuSet(dir, len, pp, 0, l[B], l[E], l[F], l[G], l[J]);
+			EasuSet(dir, len, pp, 1, l[C], l[F], l[G], l[H], l[K]);
+			EasuSet(dir, len, pp, 2, l[F], l[I], l[J], l[K], l[N]);
+			EasuSet(dir, len, pp, 3, l[G], l[J], l[K], l[L], l[O]);
+
+			T dirR = dir.x * dir.x + dir.y * dir.y;
+			bool zro = dirR < T(1.f / 32768.f);
+			dirR = PrxLoRsq(dirR);
+			dirR = zro ? T(1.f) : dirR;
+			dir.x = zro ? T(1.f) : dir.x;
+			dir.x = dir.x * dirR;
+			dir.y = dir.y * dirR;
+			len = len * T(0.5f);
+			len = len * len;
+			T stretch = (dir.x * dir.x + dir.y * dir.y) * PrxLoRcp(Max(Abs(dir.x), Abs(dir.y)));
+			EasuKernel<T> kernel;
+			kernel.dir = dir;
+			kernel.len2 = { T(1.f) + (stretch - T(1.f)) * len, T(1.f) + T(-0.5f) * len };
+			kernel.lob = T(0.5f) + T((1.f / 4.f - 0.04f) - 0.5f) * len;
+			kernel.clp = PrxLoRcp(kernel.lob);
+			return kernel;
+		}
+
+		// offsets of the 12 taps from the top left of 'f', in the same order
+		inline const std::array<Vec2<float>, 12> & EasuTapOffsets() {
+			static const std::array<Vec2<float>, 12> offsets = {{
+				{ 0, -1 }, { 1, -1 }, { -1, 0 }, { 0, 0 }, { 1, 0 }, { 2, 0 },
+				{ -1, 1 }, { 0, 1 }, { 1, 1 }, { 2, 1 }, { 0, 2 }, { 1, 2 },
+			}};
+			return offsets;
+		}
+
+		// Gather positions of FsrEasuF for output pixel ip, returns the fractional position within 'f'
+		inline Vec2<float> EasuGatherPositions(int ipx, int ipy, const FsrConstants &con, std::array<Vec2<float>, 4> &p) {
+			float ppx = float(ipx) * FloatFromBits(con.const0[0]) + FloatFromBits(con.const0[2]);
+			float ppy = float(ipy) * FloatFromBits(con.const0[1]) + FloatFromBits(con.const0[3]);
+			float fpx = std::floor(ppx);
+			float fpy = std::floor(ppy);
+			p[0] = { fpx * FloatFromBits(con.const1[0]) + FloatFromBits(con.const1[2]), fpy * FloatFromBits(con.const1[1]) + FloatFromBits(con.const1[3]) };
+			p[1] = { p[0].x + FloatFromBits(con.const2[0]), p[0].y + FloatFromBits(con.const2[1]) };
+			p[2] = { p[0].x + FloatFromBits(con.const2[2]), p[0].y + FloatFromBits(con.const2[3]) };
+			p[3] = { p[0].x + FloatFromBits(con.const3[0]), p[0].y + FloatFromBits(con.const3[1]) };
+			return { ppx - fpx, ppy - fpy };
+		}
+
+		// FsrEasuF, gather(u, v) returns the Quad<T> at the normalized position
+		template<typename T, typename Gather>
+		Rgb<T> Easu(int ipx, int ipy, const FsrConstants &con, const Gather &gather) {
+			std::array<Vec2<float>, 4> p;
+			Vec2<float> fraction = EasuGatherPositions(ipx, ipy, con, p);
+			Vec2<T> pp = { T(fraction.x), T(fraction.y) };
+			Quad<T> bczz = gather(p[0].x, p[0].y);
+			Quad<T> ijfe = gather(p[1].x, p[1].y);
+			Quad<T> klhg = gather(p[2].x, p[2].y);
+			Quad<T> zzon = gather(p[3].x, p[3].y);
+			// b c e f g h i j k l n o
+			std::array<Rgb<T>, 12> taps = { bczz[0], bczz[1], ijfe[3], ijfe[2], klhg[3], klhg[2], ijfe[0], ijfe[1], klhg[0], klhg[1], zzon[3], zzon[2] };
+
+			std::array<T, 12> luma;
+			for (int i = 0; i < 12; ++i) {
+				luma[i] = Luma2(taps[i]);
+			}
+			EasuKernel<T> k = EasuAnalyze(pp, luma);
+
+			Rgb<T> aC = { T(0.f), T(0.f), T(0.f) };
+			T aW = T(0.f);
+			for (int i = 0; i < 12; ++i) {
+				Vec2<T> off = { T(EasuTapOffsets()[i].x) - pp.x, T(EasuTapOffsets()[i].y) - pp.y };
+				EasuTap(aC, aW, off, k.dir, k.len2, k.lob, k.clp, taps[i]);
+			}
+
+			// dering with the min/max of the 4 nearest: f g j k
+			Rgb<T> pix;
+			T rcpW = Rcp(aW);
+			for (int i = 0; i < 3; ++i) {
+				T min4 = Min(Min(Min(taps[3][i], taps[4][i]), taps[7][i]), taps[8][i]);
+				T max4 = Max(Max(Max(taps[3][i], taps[4][i]), taps[7][i]), taps[8][i]);
+				pix[i] = Min(max4, Max(min4, aC[i] * rcpW));
+			}
+			return pix;
+		}
+
+		// FsrRcasF without denoising, load(x, y) returns the Rgb<T> to be sharpened
+		template<typename T, typename Load>
+		Rgb<T> Rcas(int x, int y, const FsrConstants &con, const Load &load) {
+			Rgb<T> b = load(x, y - 1);
+			Rgb<T> d = load(x - 1, y);
+			Rgb<T> e = load(x, y);
+			Rgb<T> f = load(x + 1, y);
+			Rgb<T> h = load(x, y + 1);
+
+			T lobes[3];
+			for (int i = 0; i < 3; ++i) {
+				T mn4 = Min(Min(Min(b[i], d[i]), f[i]), h[i]);
+				T mx4 = Max(Max(Max(b[i], d[i]), f[i]), h[i]);
+				T hitMin = Min(mn4, e[i]) * Rcp(T(4.f) * mx4);
+				T hitMax = (T(1.f) - Max(mx4, e[i])) * Rcp(T(4.f) * mn4 + T(-4.f));
+				lobes[i] = Max(-hitMin, hitMax);
+			}
+			T lobe = Max(T(float(-FSR_RCAS_LIMIT)), Min(Max(Max(lobes[0], lobes[1]), lobes[2]), T(0.f))) * T(FloatFromBits(con.rcasConst[0]));
+			T rcpL = PrxMedRcp(T(4.f) * lobe + T(1.f));
+			Rgb<T> pix;
+			for (int i = 0; i < 3; ++i) {
+				pix[i] = (lobe * b[i] + lobe * d[i] + lobe * h[i] + lobe * f[i] + e[i]) * rcpL;
+			}
+			return pix;
+		}
+
+		// the YCoCg conversion of fsr_fused.hlsl's LUMA_ONLY path, which filters Y and samples CoCg bilinearly
+		inline Rgb<float> RgbToYCoCg(const Rgb<float> &c) {
+			return { 0.25f * c[0] + 0.5f * c[1] + 0.25f * c[2], 0.5f * c[0] - 0.5f * c[2], -0.25f * c[0] + 0.5f * c[1] - 0.25f * c[2] };
+		}
+		inline Rgb<float> YCoCgToRgb(const Rgb<float> &c) {
+			float t = c[0] - c[2];
+			return { t + c[1], c[0] + c[2], t - c[1] };
+		}
+
+		// GatherLuma of fsr_fused.hlsl, on an image whose first channel holds the luma
+		template<typename T>
+		struct LumaGather {
+			const Image &luma;
+
+			std::array<T, 4> operator()(float u, float v) const {
+				int x = (int)std::floor(u * luma.width - 0.5f);
+				int y = (int)std::floor(v * luma.height - 0.5f);
+				return { T(luma.Clamped(x, y + 1)[0]), T(luma.Clamped(x + 1, y + 1)[0]), T(luma.Clamped(x + 1, y)[0]), T(luma.Clamped(x, y)[0]) };
+			}
+		};
+
+		// FsrEasuLumaF of fsr_fused.hlsl: FsrEasuF on a single channel, whose analysis gets the luma times 2
+		// that FsrEasuF computes from three equal channels
+		template<typename T, typename Gather>
+		T EasuLuma(int ipx, int ipy, const FsrConstants &con, const Gather &gather) {
+			std::array<Vec2<float>, 4> p;
+			Vec2<float> fraction = EasuGatherPositions(ipx, ipy, con, p);
+			Vec2<T> pp = { T(fraction.x), T(fraction.y) };
+			std::array<T, 4> bczz = gather(p[0].x, p[0].y);
+			std::array<T, 4> ijfe = gather(p[1].x, p[1].y);
+			std::array<T, 4> klhg = gather(p[2].x, p[2].y);
+			std::array<T, 4> zzon = gather(p[3].x, p[3].y);
+			// b c e f g h i j k l n o
+			std::array<T, 12> taps = { bczz[0], bczz[1], ijfe[3], ijfe[2], klhg[3], klhg[2], ijfe[0], ijfe[1], klhg[0], klhg[1], zzon[3], zzon[2] };
+
+			std::array<T, 12> luma;
+			for (int i = 0; i < 12; ++i) {
+				luma[i] = taps[i] * T(2.f);
+			}
+			EasuKernel<T> k = EasuAnalyze(pp, luma);
+
+			std::array<T, 1> aC = { T(0.f) };
+			T aW = T(0.f);
+			for (int i = 0; i < 12; ++i) {
+				Vec2<T> off = { T(EasuTapOffsets()[i].x) - pp.x, T(EasuTapOffsets()[i].y) - pp.y };
+				EasuTap(aC, aW, off, k.dir, k.len2, k.lob, k.clp, std::array<T, 1> { taps[i] });
+			}
+
+			// dering with the min/max of the 4 nearest: f g j k
+			T min4 = Min(Min(Min(taps[3], taps[4]), taps[7]), taps[8]);
+			T max4 = Max(Max(Max(taps[3], taps[4]), taps[7]), taps[8]);
+			return Min(max4, Max(min4, aC[0] * Rcp(aW)));
+		}
+
+		template<typename T>
+		Rgb<float> ToFloat(const Rgb<T> &c) { return { float(c[0]), float(c[1]), float(c[2]) }; }
+
+		// EASU into a full-size intermediate, then RCAS on it, as the separate upscale and sharpen passes did.
+		// RCAS loads are clamped to the output viewport.
+		template<typename T, typename Gather>
+		Image UpscaleTwoPass(const FsrConstants &con, const Gather &gather) {
+			int width = con.outputWidth, height = con.outputHeight;
+			std::vector<Rgb<T>> upscaled (width * height);
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x) {
+					upscaled[y * width + x] = Easu<T>(x, y, con, gather);
+				}
+			}
+			auto load = [&](int x, int y) {
+				return upscaled[std::clamp(y, 0, height - 1) * width + std::clamp(x, 0, width - 1)];
+			};
+			Image output (width, height);
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x) {
+					output.At(x, y) = ToFloat(Rcas<T>(x, y, con, load));
+				}
+			}
+			return output;
+		}
+
+		// the LUMA_ONLY path of fsr_fused.hlsl without the tiling, which the fused test covers already:
+		// EASU and RCAS on the Y of YCoCg, with CoCg sampled bilinearly at the output pixel
+		template<typename T>
+		Image UpscaleLumaOnly(const FsrConstants &con, const Image &input) {
+			int width = con.outputWidth, height = con.outputHeight;
+			Image luma (input.width, input.height);
+			for (size_t i = 0; i < input.pixels.size(); ++i) {
+				luma.pixels[i][0] = RgbToYCoCg(input.pixels[i])[0];
+			}
+			LumaGather<T> gather { luma };
+			std::vector<Rgb<float>> upscaled (width * height);
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x) {
+					Rgb<float> chroma = RgbToYCoCg(SampleLinearClamp(input, (x + 0.5f) / width, (y + 0.5f) / height));
+					upscaled[y * width + x] = { float(EasuLuma<T>(x, y, con, gather)), chroma[1], chroma[2] };
+				}
+			}
+			// RCAS sees the luma in all three channels
+			auto load = [&](int x, int y) {
+				T l = T(upscaled[std::clamp(y, 0, height - 1) * width + std::clamp(x, 0, width - 1)][0]);
+				return Rgb<T> { l, l, l };
+			};
+			Image output (width, height);
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x) {
+					const Rgb<float> &c = upscaled[y * width + x];
+					output.At(x, y) = YCoCgToRgb({ float(Rcas<T>(x, y, con, load)[0]), c[1], c[2] });
+				}
+			}
+			return output;
+		}
+
+		// ARmp8x8 from ffx_a.h: thread index to position in the 8x8 quadrant
+		inline Vec2<int> Remap8x8(uint32_t a) {
+			return { int((a >> 1) & 7), int((((a >> 3) & 7) & ~1u) | (a & 1)) };
+		}
+
+		const int FUSED_TILE_SIZE = 16;
+		const int FUSED_APRON_TILE_SIZE = FUSED_TILE_SIZE + 2;
+
+		// main() of fsr_fused.hlsl for one workgroup: EASU into the tile plus its apron, then RCAS from the tile.
+		// easu(x, y) upscales a single output pixel.
+		template<typename T, typename EasuFn>
+		void UpscaleFusedTile(int tileX, int tileY, const FsrConstants &con, const EasuFn &easu, Image &output) {
+			int originX = tileX * FUSED_TILE_SIZE, originY = tileY * FUSED_TILE_SIZE;
+			std::array<Rgb<T>, FUSED_APRON_TILE_SIZE * FUSED_APRON_TILE_SIZE> tile;
+			for (int i = 0; i < FUSED_APRON_TILE_SIZE * FUSED_APRON_TILE_SIZE; ++i) {
+				int x = std::clamp(originX + i % FUSED_APRON_TILE_SIZE - 1, 0, con.outputWidth - 1);
+				int y = std::clamp(originY + i / FUSED_APRON_TILE_SIZE - 1, 0, con.outputHeight - 1);
+				tile[i] = easu(x, y);
+			}
+			auto loadUpscaled = [&](int x, int y) {
+				return tile[(y - originY + 1) * FUSED_APRON_TILE_SIZE + (x - originX + 1)];
+			};
+			const Vec2<int> quadrants[4] = { { 0, 0 }, { 8, 0 }, { 8, 8 }, { 0, 8 } };
+			for (uint32_t thread = 0; thread < 64; ++thread) {
+				Vec2<int> local = Remap8x8(thread);
+				for (const Vec2<int> &quadrant : quadrants) {
+					int x = originX + local.x + quadrant.x, y = originY + local.y + quadrant.y;
+					// the output texture ends at the viewport, writes beyond it are dropped
+					if (x < con.outputWidth && y < con.outputHeight) {
+						output.At(x, y) = ToFloat(Rcas<T>(x, y, con, loadUpscaled));
+					}
+				}
+			}
+		}
+
+		template<typename T, typename Gather>
+		Image UpscaleFused(const FsrConstants &con, const Gather &gather) {
+			Image output (con.outputWidth, con.outputHeight, NAN);
+			auto easu = [&](int x, int y) { return Easu<T>(x, y, con, gather); };
+			for (int tileY = 0; tileY * FUSED_TILE_SIZE < con.outputHeight; ++tileY) {
+				for (int tileX = 0; tileX * FUSED_TILE_SIZE < con.outputWidth; ++tileX) {
+					UpscaleFusedTile<T>(tileX, tileY, con, easu, output);
+				}
+			}
+			return output;
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Emulation of the 16-bit floats the HALF_PRECISION shader permutations compute with, to measure how far
+// they drift from 32 bits. Every operation is done in float and rounded to the nearest half, which gives
+// the correctly rounded half result, as float has more than twice the precision of half.
+namespace vrperfkit {
+	namespace test {
+		inline uint16_t HalfBitsFromFloat(float f) {
+			uint32_t u;
+			memcpy(&u, &f, sizeof(u));
+			uint16_t sign = (u >> 16) & 0x8000;
+			u &= 0x7fffffff;
+			if (u >= 0x7f800000) {
+				// infinity stays infinity, NaN stays NaN
+				return sign | 0x7c00 | (u > 0x7f800000 ? 0x200 : 0);
+			}
+			if (u >= 0x477ff000) {
+				// 65520 and above round to infinity
+				return sign | 0x7c00;
+			}
+			if (u < 0x38800000) {
+				// subnormal halves are multiples of 2^-24, nearbyint rounds to nearest even
+				float abs;
+				memcpy(&abs, &u, sizeof(abs));
+				return sign | (uint16_t)std::nearbyint(abs * 16777216.f);
+			}
+			// rebias the exponent and round the mantissa to nearest even
+			u += 0xfff + ((u >> 13) & 1);
+			return sign | (uint16_t)((u - 0x38000000) >> 13);
+		}
+
+		inline float FloatFromHalfBits(uint16_t h) {
+			uint32_t sign = uint32_t(h & 0x8000) << 16;
+			uint32_t exponent = (h >> 10) & 0x1f;
+			uint32_t mantissa = h & 0x3ff;
+			if (exponent == 0) {
+				float value = mantissa / 16777216.f;
+				return sign ? -value : value;
+			}
+			uint32_t u = exponent == 0x1f
+				? sign | 0x7f800000 | (mantissa << 13)
+				: sign | ((exponent + 112) << 23) | (mantissa << 13);
+			float f;
+			memcpy(&f, &u, sizeof(f));
+			return f;
+		}
+
+		struct Half {
+			float value;
+
+			Half() = default;
+			explicit Half(float f) : value(FloatFromHalfBits(HalfBitsFromFloat(f))) {}
+			explicit operator float() const { return value; }
+
+			uint16_t Bits() const { return HalfBitsFromFloat(value); }
+			static Half FromBits(uint16_t bits) { Half h; h.value = FloatFromHalfBits(bits); return h; }
+		};
+
+		inline Half operator+(Half a, Half b) { return Half(a.value + b.value); }
+		inline Half operator-(Half a, Half b) { return Half(a.value - b.value); }
+		inline Half operator*(Half a, Half b) { return Half(a.value * b.value); }
+		inline Half operator/(Half a, Half b) { return Half(a.value / b.value); }
+		inline Half operator-(Half a) { return Half::FromBits(a.Bits() ^ 0x8000); }
+		inline bool operator<(Half a, Half b) { return a.value < b.value; }
+
+		// the half versions of the approximations from ffx_a.h, found by argument-dependent lookup
+		inline Half PrxLoRcp(Half a) { return Half::FromBits(uint16_t(0x7784 - a.Bits())); }
+		inline Half PrxMedRcp(Half a) { Half b = Half::FromBits(uint16_t(0x778d - a.Bits())); return b * (-b * a + Half(2.f)); }
+		inline Half PrxLoRsq(Half a) { return Half::FromBits(uint16_t(0x59a3 - (a.Bits() >> 1))); }
+	}
+}
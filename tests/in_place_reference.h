@@ -0,0 +1,110 @@
+#pragma once
+#include "test_images.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// C++ port of sharpening in place: tile_edges.hlsl saving the outer texels of each tile, and in_place_tile.h
+// staging a workgroup's tile and apron before the workgroup writes into the same texture. Workgroups only ever
+// read their own texels from the texture, so running them one after the other in any order covers every way
+// the GPU may interleave them.
+namespace vrperfkit {
+	namespace test {
+		const int IN_PLACE_TILE_SIZE = 16;
+		const int IN_PLACE_APRON_SIZE = IN_PLACE_TILE_SIZE + 2;
+
+		struct InPlaceViewport {
+			int x, y, width, height;
+		};
+
+		// a workgroup of the sharpening dispatch
+		struct InPlaceTile {
+			int x, y, eye;
+		};
+
+		inline int InPlaceTilesX(const InPlaceViewport &viewport) { return (viewport.width + IN_PLACE_TILE_SIZE - 1) / IN_PLACE_TILE_SIZE; }
+		inline int InPlaceTilesY(const InPlaceViewport &viewport) { return (viewport.height + IN_PLACE_TILE_SIZE - 1) / IN_PLACE_TILE_SIZE; }
+
+		// main() of tile_edges.hlsl over all tiles; like D3D11TileEdges, the eyes share the first viewport's size
+		inline std::vector<std::array<float, 3>> SaveTileEdges(const Image &texture, const std::vector<InPlaceViewport> &viewports) {
+			int tilesX = InPlaceTilesX(viewports[0]), tilesY = InPlaceTilesY(viewports[0]);
+			std::vector<std::array<float, 3>> edges (viewports.size() * tilesX * tilesY * 4 * IN_PLACE_TILE_SIZE);
+			for (int eye = 0; eye < (int)viewports.size(); ++eye) {
+				const InPlaceViewport &viewport = viewports[eye];
+				for (int tileY = 0; tileY < tilesY; ++tileY) {
+					for (int tileX = 0; tileX < tilesX; ++tileX) {
+						for (int index = 0; index < 4 * IN_PLACE_TILE_SIZE; ++index) {
+							int edge = index / IN_PLACE_TILE_SIZE, i = index % IN_PLACE_TILE_SIZE;
+							int localX = edge == 0 || edge == 1 ? i : edge == 2 ? 0 : IN_PLACE_TILE_SIZE - 1;
+							int localY = edge == 2 || edge == 3 ? i : edge == 0 ? 0 : IN_PLACE_TILE_SIZE - 1;
+							int x = std::min(tileX * IN_PLACE_TILE_SIZE + localX, viewport.width - 1);
+							int y = std::min(tileY * IN_PLACE_TILE_SIZE + localY, viewport.height - 1);
+							edges[((eye * tilesY + tileY) * tilesX + tileX) * 4 * IN_PLACE_TILE_SIZE + index] = texture.At(viewport.x + x, viewport.y + y);
+						}
+					}
+				}
+			}
+			return edges;
+		}
+
+		// LoadTileEdge of in_place_tile.h, p is an outer texel of its tile relative to the viewport
+		inline const std::array<float, 3> & LoadTileEdge(const std::vector<std::array<float, 3>> &edges, int x, int y, int eye, const InPlaceViewport &viewport) {
+			int tilesX = InPlaceTilesX(viewport), tilesY = InPlaceTilesY(viewport);
+			int tileX = x / IN_PLACE_TILE_SIZE, tileY = y / IN_PLACE_TILE_SIZE;
+			int localX = x % IN_PLACE_TILE_SIZE, localY = y % IN_PLACE_TILE_SIZE;
+			int entry;
+			if (localY == 0) {
+				entry = localX;
+			}
+			else if (localY == IN_PLACE_TILE_SIZE - 1) {
+				entry = IN_PLACE_TILE_SIZE + localX;
+			}
+			else if (localX == 0) {
+				entry = 2 * IN_PLACE_TILE_SIZE + localY;
+			}
+			else {
+				entry = 3 * IN_PLACE_TILE_SIZE + localY;
+			}
+			return edges[((eye * tilesY + tileY) * tilesX + tileX) * 4 * IN_PLACE_TILE_SIZE + entry];
+		}
+
+		// StageInPlaceTile of in_place_tile.h: the tile from the texture as it is now, the apron from the saved edges.
+		// Without the edges, the apron is read from the texture as well, which is the hazard the edges avoid.
+		inline Image StageInPlaceTile(const Image &texture, const std::vector<std::array<float, 3>> *edges, const InPlaceTile &tile, const InPlaceViewport &viewport) {
+			Image staged (IN_PLACE_APRON_SIZE, IN_PLACE_APRON_SIZE);
+			int originX = tile.x * IN_PLACE_TILE_SIZE, originY = tile.y * IN_PLACE_TILE_SIZE;
+			for (int i = 0; i < IN_PLACE_APRON_SIZE * IN_PLACE_APRON_SIZE; ++i) {
+				int x = std::clamp(originX + i % IN_PLACE_APRON_SIZE - 1, 0, viewport.width - 1);
+				int y = std::clamp(originY + i / IN_PLACE_APRON_SIZE - 1, 0, viewport.height - 1);
+				bool own = x >= originX && y >= originY && x < originX + IN_PLACE_TILE_SIZE && y < originY + IN_PLACE_TILE_SIZE;
+				if (own || edges == nullptr) {
+					staged.pixels[i] = texture.At(viewport.x + x, viewport.y + y);
+				}
+				else {
+					staged.pixels[i] = LoadTileEdge(*edges, x, y, tile.eye, viewport);
+				}
+			}
+			return staged;
+		}
+
+		// Runs the workgroups in the given order. filter(staged, x, y) returns the sharpened texel at x, y of the
+		// staged tile, whose own texels start at 1, 1. Texels of partial tiles beyond the viewport are not written.
+		template<typename Filter>
+		void SharpenInPlace(Image &texture, const std::vector<InPlaceViewport> &viewports, const std::vector<InPlaceTile> &tiles, bool useTileEdges, const Filter &filter) {
+			std::vector<std::array<float, 3>> edges = SaveTileEdges(texture, viewports);
+			for (const InPlaceTile &tile : tiles) {
+				const InPlaceViewport &viewport = viewports[tile.eye];
+				Image staged = StageInPlaceTile(texture, useTileEdges ? &edges : nullptr, tile, viewport);
+				for (int ly = 0; ly < IN_PLACE_TILE_SIZE; ++ly) {
+					for (int lx = 0; lx < IN_PLACE_TILE_SIZE; ++lx) {
+						int x = tile.x * IN_PLACE_TILE_SIZE + lx, y = tile.y * IN_PLACE_TILE_SIZE + ly;
+						if (x < viewport.width && y < viewport.height) {
+							texture.At(viewport.x + x, viewport.y + y) = filter(staged, lx + 1, ly + 1);
+						}
+					}
+				}
+			}
+		}
+	}
+}
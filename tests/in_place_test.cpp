@@ -0,0 +1,158 @@
+// Checks that sharpening in place, as the IN_PLACE permutations of cas.compute.h and fsr_rcas.hlsl run it,
+// gives exactly the same frame as sharpening into a separate texture, whatever order the workgroups run in.
+// The texture holds both eyes side by side, with viewports that start off the origin and are not a multiple
+// of the tile size, so that clamping at the viewport edges and partial tiles are covered as well.
+#include "half_float.h"
+#include "cas_reference.h"
+#include "in_place_reference.h"
+#include "test_common.h"
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+using namespace vrperfkit;
+using namespace vrperfkit::test;
+
+namespace {
+	const std::vector<InPlaceViewport> VIEWPORTS = { { 3, 2, 70, 61 }, { 79, 2, 70, 61 } };
+	const int TEXTURE_WIDTH = 152;
+	const int TEXTURE_HEIGHT = 66;
+
+	std::vector<InPlaceTile> AllTiles() {
+		std::vector<InPlaceTile> tiles;
+		for (int eye = 0; eye < (int)VIEWPORTS.size(); ++eye) {
+			for (int y = 0; y < InPlaceTilesY(VIEWPORTS[eye]); ++y) {
+				for (int x = 0; x < InPlaceTilesX(VIEWPORTS[eye]); ++x) {
+					tiles.push_back({ x, y, eye });
+				}
+			}
+		}
+		return tiles;
+	}
+
+	std::vector<InPlaceTile> Shuffled(std::vector<InPlaceTile> tiles, uint32_t seed) {
+		Random random (seed);
+		for (size_t i = tiles.size() - 1; i > 0; --i) {
+			std::swap(tiles[i], tiles[std::min(i, (size_t)(random.Next() * (i + 1)))]);
+		}
+		return tiles;
+	}
+
+	Image ExtractViewport(const Image &texture, const InPlaceViewport &viewport) {
+		Image image (viewport.width, viewport.height);
+		for (int y = 0; y < viewport.height; ++y) {
+			for (int x = 0; x < viewport.width; ++x) {
+				image.At(x, y) = texture.At(viewport.x + x, viewport.y + y);
+			}
+		}
+		return image;
+	}
+
+	bool InTile(const InPlaceTile &tile, int x, int y) {
+		return x / IN_PLACE_TILE_SIZE == tile.x && y / IN_PLACE_TILE_SIZE == tile.y;
+	}
+
+	// sharpens each viewport of the original texture into a separate image, as without IN_PLACE
+	template<typename Sharpen>
+	std::vector<Image> SharpenSeparately(const Image &texture, const Sharpen &sharpen) {
+		std::vector<Image> expected;
+		for (const InPlaceViewport &viewport : VIEWPORTS) {
+			expected.push_back(sharpen(ExtractViewport(texture, viewport)));
+		}
+		return expected;
+	}
+
+	// texels of the dispatched tiles must be sharpened exactly as without IN_PLACE, all others left alone
+	size_t CountMismatches(const Image &original, const Image &result, const std::vector<Image> &expected, const std::vector<InPlaceTile> &tiles) {
+		size_t mismatches = 0;
+		for (int y = 0; y < TEXTURE_HEIGHT; ++y) {
+			for (int x = 0; x < TEXTURE_WIDTH; ++x) {
+				const std::array<float, 3> *want = &original.At(x, y);
+				for (int eye = 0; eye < (int)VIEWPORTS.size(); ++eye) {
+					const InPlaceViewport &viewport = VIEWPORTS[eye];
+					int vx = x - viewport.x, vy = y - viewport.y;
+					if (vx < 0 || vy < 0 || vx >= viewport.width || vy >= viewport.height) {
+						continue;
+					}
+					for (const InPlaceTile &tile : tiles) {
+						if (tile.eye == eye && InTile(tile, vx, vy)) {
+							want = &expected[eye].At(vx, vy);
+						}
+					}
+				}
+				if (result.At(x, y) != *want) {
+					++mismatches;
+				}
+			}
+		}
+		return mismatches;
+	}
+
+	template<typename Filter, typename Sharpen>
+	void CheckInPlace(const char *what, const Filter &filter, const Sharpen &sharpen) {
+		Image original = MakeSyntheticFrame(TEXTURE_WIDTH, TEXTURE_HEIGHT, 17);
+		std::vector<Image> expected = SharpenSeparately(original, sharpen);
+		std::vector<InPlaceTile> all = AllTiles();
+		printf("%s: %zu tiles\n", what, all.size());
+
+		std::vector<InPlaceTile> reversed (all.rbegin(), all.rend());
+		for (const std::vector<InPlaceTile> &order : { all, reversed, Shuffled(all, 1), Shuffled(all, 2) }) {
+			Image texture = original;
+			SharpenInPlace(texture, VIEWPORTS, order, true, filter);
+			CHECK(CountMismatches(original, texture, expected, order) == 0);
+		}
+
+		// with a tile list, skipped tiles keep the game's texels, and their neighbours still see them
+		std::vector<InPlaceTile> listed;
+		for (size_t i = 0; i < all.size(); ++i) {
+			if (i % 3 != 1) {
+				listed.push_back(all[i]);
+			}
+		}
+		Image texture = original;
+		SharpenInPlace(texture, VIEWPORTS, Shuffled(listed, 3), true, filter);
+		CHECK(CountMismatches(original, texture, expected, listed) == 0);
+
+		// without the saved edges, the apron is read after neighbouring tiles may have been sharpened
+		texture = original;
+		SharpenInPlace(texture, VIEWPORTS, Shuffled(all, 4), false, filter);
+		size_t hazards = CountMismatches(original, texture, expected, all);
+		printf("  %zu texels differ without the saved tile edges\n", hazards);
+		CHECK(hazards > 0);
+	}
+
+	void TestCas() {
+		CasConstants con = MakeCasConstants(VIEWPORTS[0].width, VIEWPORTS[0].height, VIEWPORTS[0].width, VIEWPORTS[0].height, 0.7f);
+		CHECK(con.sharpenOnly);
+		CheckInPlace("CAS",
+			[&](const Image &staged, int x, int y) { return CasFilterAt<float, true>(staged, x, y, 0, 0, con); },
+			[&](const Image &input) { return CasUpscale<float>(input, con); });
+		CheckInPlace("CAS 16 bits",
+			[&](const Image &staged, int x, int y) { return CasFilterAt<Half, false>(staged, x, y, 0, 0, con); },
+			[&](const Image &input) { return CasUpscale<Half>(input, con); });
+	}
+
+	void TestRcas() {
+		FsrConstants con = MakeFsrConstants(VIEWPORTS[0].width, VIEWPORTS[0].height, VIEWPORTS[0].width, VIEWPORTS[0].height, 0.7f);
+		CheckInPlace("RCAS",
+			[&](const Image &staged, int x, int y) {
+				return ToFloat(Rcas<float>(x, y, con, [&](int lx, int ly) { return staged.At(lx, ly); }));
+			},
+			[&](const Image &input) {
+				Image output (input.width, input.height);
+				for (int y = 0; y < input.height; ++y) {
+					for (int x = 0; x < input.width; ++x) {
+						output.At(x, y) = ToFloat(Rcas<float>(x, y, con, [&](int lx, int ly) { return input.Clamped(lx, ly); }));
+					}
+				}
+				return output;
+			});
+	}
+}
+
+int main() {
+	TestCas();
+	TestRcas();
+	return test::Result();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// Just enough of d3d11.h for building the pipeline state save and restore against a mock context.
+// Only the methods the mod's state handling may call are declared, so any other call fails to compile.
+typedef unsigned int UINT;
+typedef unsigned long ULONG;
+typedef int HRESULT; // 32 bits like on Windows, so that failure codes are negative
+
+#define S_OK ((HRESULT)0)
+#define E_NOINTERFACE ((HRESULT)0x80004002)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+
+// stands in for __uuidof, one distinct address per interface
+template<typename I>
+const void * MockIid() {
+	static const char id = 0;
+	return &id;
+}
+
+#define D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT 8
+
+struct IUnknown {
+	virtual ~IUnknown() = default;
+	virtual HRESULT QueryInterface(const void *iid, void **object) = 0;
+	template<typename Q>
+	HRESULT QueryInterface(Q **object) { return QueryInterface(MockIid<Q>(), (void**)object); }
+	virtual ULONG AddRef() = 0;
+	virtual ULONG Release() = 0;
+};
+
+struct ID3D11DeviceChild : IUnknown {};
+struct ID3D11ComputeShader : ID3D11DeviceChild {};
+struct ID3D11ClassInstance : ID3D11DeviceChild {};
+struct ID3D11Buffer : ID3D11DeviceChild {};
+struct ID3D11SamplerState : ID3D11DeviceChild {};
+struct ID3D11ShaderResourceView : ID3D11DeviceChild {};
+struct ID3D11UnorderedAccessView : ID3D11DeviceChild {};
+struct ID3D11RenderTargetView : ID3D11DeviceChild {};
+struct ID3D11DepthStencilView : ID3D11DeviceChild {};
+
+struct ID3D11DeviceContext : ID3D11DeviceChild {
+	virtual void CSGetShader(ID3D11ComputeShader **ppComputeShader, ID3D11ClassInstance **ppClassInstances, UINT *pNumClassInstances) = 0;
+	virtual void CSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers) = 0;
+	virtual void CSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState **ppSamplers) = 0;
+	virtual void CSGetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView **ppShaderResourceViews) = 0;
+	virtual void CSGetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs, ID3D11UnorderedAccessView **ppUnorderedAccessViews) = 0;
+	virtual void OMGetRenderTargets(UINT NumViews, ID3D11RenderTargetView **ppRenderTargetViews, ID3D11DepthStencilView **ppDepthStencilView) = 0;
+
+	virtual void CSSetShader(ID3D11ComputeShader *pComputeShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances) = 0;
+	virtual void CSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers) = 0;
+	virtual void CSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState *const *ppSamplers) = 0;
+	virtual void CSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews) = 0;
+	virtual void CSSetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs, ID3D11UnorderedAccessView *const *ppUnorderedAccessViews, const UINT *pUAVInitialCounts) = 0;
+	virtual void OMSetRenderTargets(UINT NumViews, ID3D11RenderTargetView *const *ppRenderTargetViews, ID3D11DepthStencilView *pDepthStencilView) = 0;
+};
@@ -0,0 +1,8 @@
+#pragma once
+#include "d3d11.h"
+
+// Just enough of d3d11_1.h for saving and restoring constant buffer ranges, see d3d11.h.
+struct ID3D11DeviceContext1 : ID3D11DeviceContext {
+	virtual void CSGetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers, UINT *pFirstConstant, UINT *pNumConstants) = 0;
+	virtual void CSSetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers, const UINT *pFirstConstant, const UINT *pNumConstants) = 0;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+// Just enough of ComPtr for building D3D11 code against the mock interfaces in d3d11.h.
+namespace Microsoft {
+	namespace WRL {
+		template<typename T>
+		class ComPtr {
+		public:
+			ComPtr() = default;
+			ComPtr(const ComPtr &other) : ptr(other.ptr) { if (ptr) ptr->AddRef(); }
+			~ComPtr() { Reset(); }
+
+			ComPtr & operator=(const ComPtr &other) {
+				if (other.ptr) other.ptr->AddRef();
+				Reset();
+				ptr = other.ptr;
+				return *this;
+			}
+
+			T * Get() const { return ptr; }
+			explicit operator bool() const { return ptr != nullptr; }
+			T * operator->() const { return ptr; }
+			T ** GetAddressOf() { return &ptr; }
+			T * const * GetAddressOf() const { return &ptr; }
+			T ** ReleaseAndGetAddressOf() { Reset(); return &ptr; }
+
+			void Reset() {
+				if (ptr) {
+					ptr->Release();
+					ptr = nullptr;
+				}
+			}
+
+		private:
+			T *ptr = nullptr;
+		};
+	}
+}
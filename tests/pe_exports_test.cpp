@@ -0,0 +1,132 @@
+// Runs FindPeExport against synthetic PE images, covering both header variants, the binary search
+// over the sorted name table and the unbiased name ordinals.
+#include "proxy/pe_exports.h"
+#include "test_common.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace vrperfkit;
+
+namespace {
+	const uint32_t NT_HEADER = 0x80;
+	const uint32_t EXPORT_DIR = 0x200;
+
+	struct Export {
+		std::string name;
+		uint32_t function; // index into the function table
+	};
+
+	template<typename T>
+	void Write(std::vector<uint8_t> &image, uint32_t offset, T value) {
+		memcpy(image.data() + offset, &value, sizeof(T));
+	}
+
+	// builds an image whose function table holds the RVA 0x1000 + 0x10 * index for each entry
+	std::vector<uint8_t> BuildImage(const std::vector<Export> &exports, uint32_t functionCount, bool pe32Plus = true) {
+		std::vector<uint8_t> image (0x2000, 0);
+		Write<uint16_t>(image, 0, 0x5a4d); // "MZ"
+		Write<uint32_t>(image, 0x3c, NT_HEADER);
+		Write<uint32_t>(image, NT_HEADER, 0x00004550);
+		uint32_t optionalHeader = NT_HEADER + 24;
+		Write<uint16_t>(image, optionalHeader, pe32Plus ? 0x20b : 0x10b);
+		uint32_t dataDirectories = optionalHeader + (pe32Plus ? 112 : 96);
+
+		uint32_t functions = EXPORT_DIR + 40;
+		uint32_t names = functions + functionCount * 4;
+		uint32_t ordinals = names + (uint32_t)exports.size() * 4;
+		uint32_t strings = ordinals + (uint32_t)exports.size() * 2;
+		Write<uint32_t>(image, EXPORT_DIR + 16, 1); // Base, which must not affect the lookup
+		Write<uint32_t>(image, EXPORT_DIR + 20, functionCount);
+		Write<uint32_t>(image, EXPORT_DIR + 24, (uint32_t)exports.size());
+		Write<uint32_t>(image, EXPORT_DIR + 28, functions);
+		Write<uint32_t>(image, EXPORT_DIR + 32, names);
+		Write<uint32_t>(image, EXPORT_DIR + 36, ordinals);
+		for (uint32_t i = 0; i < functionCount; ++i) {
+			Write<uint32_t>(image, functions + i * 4, 0x1000 + 0x10 * i);
+		}
+		for (size_t i = 0; i < exports.size(); ++i) {
+			Write<uint32_t>(image, names + (uint32_t)i * 4, strings);
+			Write<uint16_t>(image, ordinals + (uint32_t)i * 2, (uint16_t)exports[i].function);
+			memcpy(image.data() + strings, exports[i].name.c_str(), exports[i].name.size() + 1);
+			strings += (uint32_t)exports[i].name.size() + 1;
+		}
+
+		uint32_t exportDirSize = strings - EXPORT_DIR;
+		Write<uint32_t>(image, dataDirectories, EXPORT_DIR);
+		Write<uint32_t>(image, dataDirectories + 4, exportDirSize);
+		return image;
+	}
+
+	const void * Expected(const std::vector<uint8_t> &image, uint32_t function) {
+		return image.data() + 0x1000 + 0x10 * function;
+	}
+
+	void TestLookup(bool pe32Plus) {
+		// sorted as the PE format requires, with the functions deliberately not in name order
+		std::vector<Export> exports = {
+			{ "CreateDXGIFactory", 4 },
+			{ "CreateDXGIFactory1", 0 },
+			{ "CreateDXGIFactory2", 2 },
+			{ "D3D11CreateDevice", 1 },
+			{ "D3D11CreateDeviceAndSwapChain", 5 },
+			{ "VRClientCoreFactory", 3 },
+		};
+		auto image = BuildImage(exports, 6, pe32Plus);
+		for (const auto &e : exports) {
+			CHECK(FindPeExport(image.data(), e.name.c_str()) == Expected(image, e.function));
+		}
+		CHECK(FindPeExport(image.data(), "AAA") == nullptr);
+		CHECK(FindPeExport(image.data(), "CreateDXGIFactory3") == nullptr);
+		CHECK(FindPeExport(image.data(), "CreateDXGI") == nullptr);
+		CHECK(FindPeExport(image.data(), "ZZZ") == nullptr);
+		CHECK(FindPeExport(image.data(), "") == nullptr);
+	}
+
+	void TestEveryTableSize() {
+		// covers the edges of the binary search for odd and even counts
+		for (uint32_t count = 1; count <= 17; ++count) {
+			std::vector<Export> exports;
+			for (uint32_t i = 0; i < count; ++i) {
+				char name[8];
+				snprintf(name, sizeof(name), "Fn%02u", i);
+				exports.push_back({ name, count - 1 - i });
+			}
+			auto image = BuildImage(exports, count);
+			for (const auto &e : exports) {
+				CHECK(FindPeExport(image.data(), e.name.c_str()) == Expected(image, e.function));
+			}
+			CHECK(FindPeExport(image.data(), "Fn") == nullptr);
+			CHECK(FindPeExport(image.data(), "Fn99") == nullptr);
+		}
+	}
+
+	void TestInvalidImages() {
+		CHECK(FindPeExport(nullptr, "D3D11CreateDevice") == nullptr);
+
+		auto noExports = BuildImage({}, 0);
+		Write<uint32_t>(noExports, NT_HEADER + 24 + 112 + 4, 0);
+		CHECK(FindPeExport(noExports.data(), "D3D11CreateDevice") == nullptr);
+
+		auto badSignature = BuildImage({ { "D3D11CreateDevice", 0 } }, 1);
+		Write<uint32_t>(badSignature, NT_HEADER, 0);
+		CHECK(FindPeExport(badSignature.data(), "D3D11CreateDevice") == nullptr);
+
+		auto badMagic = BuildImage({ { "D3D11CreateDevice", 0 } }, 1);
+		Write<uint16_t>(badMagic, NT_HEADER + 24, 0x107);
+		CHECK(FindPeExport(badMagic.data(), "D3D11CreateDevice") == nullptr);
+
+		// a name ordinal pointing past the function table
+		auto badOrdinal = BuildImage({ { "D3D11CreateDevice", 3 } }, 1);
+		CHECK(FindPeExport(badOrdinal.data(), "D3D11CreateDevice") == nullptr);
+	}
+}
+
+int main() {
+	TestLookup(true);
+	TestLookup(false);
+	TestEveryTableSize();
+	TestInvalidImages();
+	return test::Result();
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "half_float.h"
+#include "test_images.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+// C++ port of temporal_upscale.hlsl, for validating the accumulation offline. One call is one dispatch:
+// it returns the output viewport and replaces the history, which is stored in FP16 like on the GPU.
+namespace vrperfkit {
+	namespace test {
+		struct TemporalConstants {
+			// current clip space to previous clip space, row major and applied to column vectors like mul(M, v)
+			float reprojection[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+			int inputOffset[2] = {};
+			int inputSize[2] = {};
+			int outputSize[2] = {};
+			float blend = 0.1f;
+			bool historyValid = false;
+			int depthOffset[2] = {};
+			int depthSize[2] = {};
+			// the input's pixel centres show the scene at their uv plus this
+			float jitter[2] = {};
+		};
+
+		const float TEMPORAL_SAMPLE_FALLOFF = 4;
+
+		// depth is read from the first channel
+		inline Image TemporalUpscale(const TemporalConstants &con, const Image &input, const Image &depth, Image &history) {
+			int outputWidth = con.outputSize[0], outputHeight = con.outputSize[1];
+			Image output (outputWidth, outputHeight);
+			Image nextHistory (outputWidth, outputHeight);
+			for (int py = 0; py < outputHeight; ++py) {
+				for (int px = 0; px < outputWidth; ++px) {
+					float u = (px + 0.5f) / outputWidth, v = (py + 0.5f) / outputHeight;
+					float inputX = con.inputOffset[0] + (u - con.jitter[0]) * con.inputSize[0];
+					float inputY = con.inputOffset[1] + (v - con.jitter[1]) * con.inputSize[1];
+					std::array<float, 3> current = SampleLinearClamp(input, inputX / input.width, inputY / input.height);
+
+					int texelX = (int)std::floor(inputX), texelY = (int)std::floor(inputY);
+					std::array<float, 3> minColour = current, maxColour = current;
+					for (int y = -1; y <= 1; ++y) {
+						for (int x = -1; x <= 1; ++x) {
+							int lx = std::clamp(texelX + x, con.inputOffset[0], con.inputOffset[0] + con.inputSize[0] - 1);
+							int ly = std::clamp(texelY + y, con.inputOffset[1], con.inputOffset[1] + con.inputSize[1] - 1);
+							const std::array<float, 3> &c = input.At(lx, ly);
+							for (int i = 0; i < 3; ++i) {
+								minColour[i] = std::min(minColour[i], c[i]);
+								maxColour[i] = std::max(maxColour[i], c[i]);
+							}
+						}
+					}
+
+					std::array<float, 3> result = current;
+					if (con.historyValid) {
+						float depthU = std::clamp(u - con.jitter[0], 0.f, 1.f), depthV = std::clamp(v - con.jitter[1], 0.f, 1.f);
+						int depthX = con.depthOffset[0] + std::min(int(depthU * con.depthSize[0]), con.depthSize[0] - 1);
+						int depthY = con.depthOffset[1] + std::min(int(depthV * con.depthSize[1]), con.depthSize[1] - 1);
+						float clip[4] = { u * 2 - 1, 1 - v * 2, depth.At(depthX, depthY)[0], 1 };
+						float previous[4];
+						for (int r = 0; r < 4; ++r) {
+							previous[r] = 0;
+							for (int c = 0; c < 4; ++c) {
+								previous[r] += con.reprojection[r][c] * clip[c];
+							}
+						}
+						float previousU = 0.5f + 0.5f * previous[0] / previous[3];
+						float previousV = 0.5f - 0.5f * previous[1] / previous[3];
+						if (previous[3] > 0 && previousU >= 0 && previousV >= 0 && previousU <= 1 && previousV <= 1) {
+							std::array<float, 3> h = SampleLinearClamp(history, previousU, previousV);
+							std::array<float, 3> contribution = current;
+							float weight = con.blend;
+							if (con.jitter[0] != 0 || con.jitter[1] != 0) {
+								int lx = std::clamp(texelX, con.inputOffset[0], con.inputOffset[0] + con.inputSize[0] - 1);
+								int ly = std::clamp(texelY, con.inputOffset[1], con.inputOffset[1] + con.inputSize[1] - 1);
+								// in output pixels
+								float offsetX = (inputX - (texelX + 0.5f)) * outputWidth / con.inputSize[0];
+								float offsetY = (inputY - (texelY + 0.5f)) * outputHeight / con.inputSize[1];
+								contribution = input.At(lx, ly);
+								weight *= std::exp(-TEMPORAL_SAMPLE_FALLOFF * (offsetX * offsetX + offsetY * offsetY));
+							}
+							for (int i = 0; i < 3; ++i) {
+								float clamped = std::clamp(h[i], minColour[i], maxColour[i]);
+								result[i] = clamped + (contribution[i] - clamped) * weight;
+							}
+						}
+					}
+
+					output.At(px, py) = result;
+					for (int i = 0; i < 3; ++i) {
+						nextHistory.At(px, py)[i] = float(Half(result[i]));
+					}
+				}
+			}
+			history = nextHistory;
+			return output;
+		}
+	}
+}
@@ -0,0 +1,285 @@
+// Validates the accumulation of temporal_upscale.hlsl on the CPU: reprojected history lines up with moving
+// content, disoccluded pixels fall back to the current frame, and the neighbourhood clamp bounds ghosting.
+// With the jitter of temporal_jitter.h, a static scene converges closer to the full resolution scene than
+// the bilinear upscale does; without it, e.g. when the game does not pick up the jittered projection, it
+// converges to the bilinear upscale of the current frame, so the history adds no detail.
+#include "temporal/temporal_jitter.h"
+#include "temporal_reference.h"
+#include "test_common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace vrperfkit;
+using namespace vrperfkit::test;
+
+namespace {
+	const int INPUT_WIDTH = 48, INPUT_HEIGHT = 40;
+	const int OUTPUT_WIDTH = 96, OUTPUT_HEIGHT = 80;
+
+	TemporalConstants MakeConstants() {
+		TemporalConstants con;
+		con.inputSize[0] = INPUT_WIDTH;
+		con.inputSize[1] = INPUT_HEIGHT;
+		con.outputSize[0] = OUTPUT_WIDTH;
+		con.outputSize[1] = OUTPUT_HEIGHT;
+		con.depthSize[0] = INPUT_WIDTH;
+		con.depthSize[1] = INPUT_HEIGHT;
+		return con;
+	}
+
+	// the frame with its content moved left by the given number of input texels
+	Image Shifted(const Image &image, int shift) {
+		Image shifted (image.width, image.height);
+		for (int y = 0; y < image.height; ++y) {
+			for (int x = 0; x < image.width; ++x) {
+				shifted.At(x, y) = image.Clamped(x + shift, y);
+			}
+		}
+		return shifted;
+	}
+
+	// largest difference within the output, leaving out the given margin at the edges
+	float MaxDifference(const Image &a, const Image &b, int margin) {
+		float maxDiff = 0;
+		for (int y = margin; y < a.height - margin; ++y) {
+			for (int x = margin; x < a.width - margin; ++x) {
+				for (int c = 0; c < 3; ++c) {
+					maxDiff = std::max(maxDiff, std::abs(a.At(x, y)[c] - b.At(x, y)[c]));
+				}
+			}
+		}
+		return maxDiff;
+	}
+
+	Image BilinearUpscale(const Image &input) {
+		TemporalConstants con = MakeConstants();
+		Image depth (INPUT_WIDTH, INPUT_HEIGHT, 0.5f);
+		Image history;
+		return TemporalUpscale(con, input, depth, history);
+	}
+
+	void TestStaticSceneConvergesToBilinear() {
+		Image input = MakeSyntheticFrame(INPUT_WIDTH, INPUT_HEIGHT, 1);
+		Image depth (INPUT_WIDTH, INPUT_HEIGHT, 0.5f);
+		Image bilinear = BilinearUpscale(input);
+		TemporalConstants con = MakeConstants();
+		Image history;
+		Image output = TemporalUpscale(con, input, depth, history);
+		CHECK(MaxDifference(output, bilinear, 0) == 0);
+		con.historyValid = true;
+		for (int frame = 0; frame < 30; ++frame) {
+			output = TemporalUpscale(con, input, depth, history);
+		}
+		float diff = MaxDifference(output, bilinear, 0);
+		printf("static scene after 30 frames: max difference to bilinear %g\n", diff);
+		// only the FP16 rounding of the history remains
+		CHECK(diff < 1.f / 1024.f);
+	}
+
+	void TestPanReprojectsHistory() {
+		Image first = MakeSyntheticFrame(INPUT_WIDTH, INPUT_HEIGHT, 2);
+		Image second = Shifted(first, 1);
+		Image depth (INPUT_WIDTH, INPUT_HEIGHT, 0.5f);
+		TemporalConstants con = MakeConstants();
+		Image history;
+		TemporalUpscale(con, first, depth, history);
+
+		// what is at u now was at u + 1 / INPUT_WIDTH in the previous frame
+		con.historyValid = true;
+		con.reprojection[0][3] = 2.f / INPUT_WIDTH;
+		Image output = TemporalUpscale(con, second, depth, history);
+		float diff = MaxDifference(output, BilinearUpscale(second), 2);
+		printf("pan by one input texel: max difference to the current frame %g\n", diff);
+		CHECK(diff < 1.f / 1024.f);
+
+		// the column that only becomes visible now has no history and shows the current frame
+		Image fresh = BilinearUpscale(second);
+		bool disoccludedIsCurrent = true;
+		for (int y = 0; y < OUTPUT_HEIGHT; ++y) {
+			for (int c = 0; c < 3; ++c) {
+				disoccludedIsCurrent = disoccludedIsCurrent && output.At(OUTPUT_WIDTH - 1, y)[c] == fresh.At(OUTPUT_WIDTH - 1, y)[c];
+			}
+		}
+		CHECK(disoccludedIsCurrent);
+	}
+
+	void TestSceneChangeIsClamped() {
+		Image before = MakeSyntheticFrame(INPUT_WIDTH, INPUT_HEIGHT, 3);
+		// a different scene entirely: the old frame upside down
+		Image after (INPUT_WIDTH, INPUT_HEIGHT);
+		for (int y = 0; y < INPUT_HEIGHT; ++y) {
+			for (int x = 0; x < INPUT_WIDTH; ++x) {
+				after.At(x, y) = before.At(x, INPUT_HEIGHT - 1 - y);
+			}
+		}
+		Image depth (INPUT_WIDTH, INPUT_HEIGHT, 0.5f);
+		TemporalConstants con = MakeConstants();
+		Image history;
+		TemporalUpscale(con, before, depth, history);
+		con.historyValid = true;
+		Image output = TemporalUpscale(con, after, depth, history);
+
+		// every output pixel stays within the range of the current 3x3 input neighbourhood
+		int outside = 0;
+		for (int py = 0; py < OUTPUT_HEIGHT; ++py) {
+			for (int px = 0; px < OUTPUT_WIDTH; ++px) {
+				int tx = (int)std::floor((px + 0.5f) * INPUT_WIDTH / OUTPUT_WIDTH);
+				int ty = (int)std::floor((py + 0.5f) * INPUT_HEIGHT / OUTPUT_HEIGHT);
+				for (int c = 0; c < 3; ++c) {
+					float lo = INFINITY, hi = -INFINITY;
+					for (int y = -1; y <= 1; ++y) {
+						for (int x = -1; x <= 1; ++x) {
+							float v = after.Clamped(tx + x, ty + y)[c];
+							lo = std::min(lo, v);
+							hi = std::max(hi, v);
+						}
+					}
+					float value = output.At(px, py)[c];
+					if (value < lo - 1e-6f || value > hi + 1e-6f) {
+						++outside;
+					}
+				}
+			}
+		}
+		float ghosting = MaxDifference(output, BilinearUpscale(after), 0);
+		printf("scene change: %d values outside the neighbourhood, max difference to the current frame %g\n", outside, ghosting);
+		CHECK(outside == 0);
+		// the clamped history still pulls the result away from the current frame for a few frames
+		CHECK(ghosting > 0);
+	}
+
+	// the projection matrix OpenVR composes from the raw tangents
+	void ComposeProjection(float left, float right, float top, float bottom, float m[4][4]) {
+		float nearZ = 0.1f, farZ = 100.f;
+		for (int r = 0; r < 4; ++r) {
+			for (int c = 0; c < 4; ++c) {
+				m[r][c] = 0;
+			}
+		}
+		m[0][0] = 2 / (right - left);
+		m[0][2] = (right + left) / (right - left);
+		m[1][1] = 2 / (bottom - top);
+		m[1][2] = (bottom + top) / (bottom - top);
+		m[2][2] = -farZ / (farZ - nearZ);
+		m[2][3] = -farZ * nearZ / (farZ - nearZ);
+		m[3][2] = -1;
+	}
+
+	// uv at which the projection shows the given view space direction, with v pointing down
+	Point<float> ProjectToUv(const float m[4][4], float x, float y, float z) {
+		float clipX = m[0][0] * x + m[0][1] * y + m[0][2] * z;
+		float clipY = m[1][0] * x + m[1][1] * y + m[1][2] * z;
+		float w = m[3][2] * z;
+		return { 0.5f + 0.5f * clipX / w, 0.5f - 0.5f * clipY / w };
+	}
+
+	void TestProjectionJitter() {
+		float sumX = 0, sumY = 0;
+		for (uint32_t frame = 0; frame < TEMPORAL_JITTER_PHASES; ++frame) {
+			Point<float> pixels = TemporalJitterPixels(frame);
+			CHECK(std::abs(pixels.x) < 0.5f && std::abs(pixels.y) < 0.5f);
+			// the shader tells jittered frames apart by a jitter other than zero
+			CHECK(pixels.y != 0);
+			sumX += pixels.x;
+			sumY += pixels.y;
+		}
+		CHECK(std::abs(sumX) < 0.1f * TEMPORAL_JITTER_PHASES && std::abs(sumY) < 0.1f * TEMPORAL_JITTER_PHASES);
+
+		// an asymmetric frustum, like that of a real headset
+		float left = -1.2f, right = 1.05f, top = -1.1f, bottom = 1.15f;
+		float m[4][4];
+		ComposeProjection(left, right, top, bottom, m);
+		Point<float> centre = ProjectionCentre(m);
+		Point<float> centreRaw = ProjectionCentreRaw(left, right, top, bottom);
+		CHECK(std::abs(centre.x - centreRaw.x) < 1e-6f && std::abs(centre.y - centreRaw.y) < 1e-6f);
+
+		Point<float> jitter = { 0.3f / INPUT_WIDTH, -0.2f / INPUT_HEIGHT };
+		float jittered[4][4], jitteredRaw[4][4];
+		memcpy(jittered, m, sizeof(m));
+		JitterProjectionMatrix(jitter, jittered);
+		float l = left, r = right, t = top, b = bottom;
+		JitterProjectionRaw(jitter, l, r, t, b);
+		ComposeProjection(l, r, t, b, jitteredRaw);
+
+		// what the unjittered projection shows at uv, the jittered one shows at uv - jitter
+		Point<float> uv = ProjectToUv(m, 0.3f, -0.4f, -2.f);
+		Point<float> moved = ProjectToUv(jittered, 0.3f, -0.4f, -2.f);
+		Point<float> movedRaw = ProjectToUv(jitteredRaw, 0.3f, -0.4f, -2.f);
+		CHECK(std::abs(moved.x - (uv.x - jitter.x)) < 1e-6f && std::abs(moved.y - (uv.y - jitter.y)) < 1e-6f);
+		CHECK(std::abs(movedRaw.x - moved.x) < 1e-5f && std::abs(movedRaw.y - moved.y) < 1e-5f);
+
+		// the jitter is recovered from the submitted projection and taken out of it
+		Point<float> maxJitter = { 0.51f / INPUT_WIDTH, 0.51f / INPUT_HEIGHT };
+		Point<float> found = { 0, 0 };
+		CHECK(RemoveProjectionJitter(centre, maxJitter, jitteredRaw, found));
+		CHECK(std::abs(found.x - jitter.x) < 1e-5f && std::abs(found.y - jitter.y) < 1e-5f);
+		CHECK(std::abs(jitteredRaw[0][2] - m[0][2]) < 1e-6f && std::abs(jitteredRaw[1][2] - m[1][2]) < 1e-6f);
+
+		// a projection that was not built from the runtime's is left alone
+		float other[4][4];
+		ComposeProjection(-1.f, 1.f, -1.f, 1.f, other);
+		CHECK(!RemoveProjectionJitter(centre, maxJitter, other, found));
+		CHECK(other[0][2] == 0 && other[1][2] == 0);
+	}
+
+	// renders the scene at the given resolution, with each pixel showing the scene at its centre plus the jitter
+	Image Render(const Image &scene, int width, int height, Point<float> jitter) {
+		Image image (width, height);
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				image.At(x, y) = SampleLinearClamp(scene, (x + 0.5f) / width + jitter.x, (y + 0.5f) / height + jitter.y);
+			}
+		}
+		return image;
+	}
+
+	double RootMeanSquareError(const Image &a, const Image &b, int margin) {
+		double sum = 0;
+		int count = 0;
+		for (int y = margin; y < a.height - margin; ++y) {
+			for (int x = margin; x < a.width - margin; ++x) {
+				for (int c = 0; c < 3; ++c) {
+					double diff = a.At(x, y)[c] - b.At(x, y)[c];
+					sum += diff * diff;
+					++count;
+				}
+			}
+		}
+		return std::sqrt(sum / count);
+	}
+
+	void TestJitterRecoversDetail() {
+		// finer than the output, so that its edges and fine detail do not line up with either pixel grid
+		Image scene = MakeSyntheticFrame(OUTPUT_WIDTH * 3 / 2, OUTPUT_HEIGHT * 3 / 2, 4);
+		Image expected = Render(scene, OUTPUT_WIDTH, OUTPUT_HEIGHT, { 0, 0 });
+		Image depth (INPUT_WIDTH, INPUT_HEIGHT, 0.5f);
+		double bilinearError = RootMeanSquareError(BilinearUpscale(Render(scene, INPUT_WIDTH, INPUT_HEIGHT, { 0, 0 })), expected, 2);
+
+		TemporalConstants con = MakeConstants();
+		Image history;
+		Image output;
+		for (uint32_t frame = 0; frame < 8 * TEMPORAL_JITTER_PHASES; ++frame) {
+			Point<float> pixels = TemporalJitterPixels(frame);
+			Point<float> jitter = { pixels.x / INPUT_WIDTH, pixels.y / INPUT_HEIGHT };
+			con.jitter[0] = jitter.x;
+			con.jitter[1] = jitter.y;
+			output = TemporalUpscale(con, Render(scene, INPUT_WIDTH, INPUT_HEIGHT, jitter), depth, history);
+			con.historyValid = true;
+		}
+		double jitteredError = RootMeanSquareError(output, expected, 2);
+		printf("static scene with jitter: RMS error %g, bilinear upscale %g\n", jitteredError, bilinearError);
+		CHECK(jitteredError < 0.6 * bilinearError);
+	}
+}
+
+int main() {
+	TestStaticSceneConvergesToBilinear();
+	TestPanReprojectsHistory();
+	TestSceneChangeIsClamped();
+	TestProjectionJitter();
+	TestJitterRecoversDetail();
+	return test::Result();
+}
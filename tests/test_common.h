@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdio>
+
+// Minimal checking for the headless tests: failed checks are reported and counted, and the test
+// executable returns the count, so that ctest marks it as failed.
+namespace vrperfkit {
+	namespace test {
+		inline int g_failures = 0;
+
+		inline void Check(bool condition, const char *expression, const char *file, int line) {
+			if (!condition) {
+				fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+				++g_failures;
+			}
+		}
+
+		inline int Result() {
+			if (g_failures > 0) {
+				fprintf(stderr, "%d check(s) failed\n", g_failures);
+			}
+			return g_failures;
+		}
+	}
+}
+
+#define CHECK(expr) ::vrperfkit::test::Check((expr), #expr, __FILE__, __LINE__)
@@ -0,0 +1,112 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Images for the CPU references of the shaders, and synthetic frames with the kind of content
+// the filters react to: smooth gradients, hard and diagonal edges, fine detail and noise.
+namespace vrperfkit {
+	namespace test {
+		struct Image {
+			int width = 0;
+			int height = 0;
+			std::vector<std::array<float, 3>> pixels;
+
+			Image() = default;
+			Image(int width, int height, float fill = 0.f) : width(width), height(height), pixels(width * height, { fill, fill, fill }) {}
+
+			std::array<float, 3> & At(int x, int y) { return pixels[y * width + x]; }
+			const std::array<float, 3> & At(int x, int y) const { return pixels[y * width + x]; }
+			// texel fetch with clamp addressing
+			const std::array<float, 3> & Clamped(int x, int y) const {
+				return At(std::clamp(x, 0, width - 1), std::clamp(y, 0, height - 1));
+			}
+		};
+
+		// SampleLevel with a linear clamping sampler
+		inline std::array<float, 3> SampleLinearClamp(const Image &image, float u, float v) {
+			float x = u * image.width - 0.5f, y = v * image.height - 0.5f;
+			int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+			float fx = x - x0, fy = y - y0;
+			std::array<float, 3> result;
+			for (int c = 0; c < 3; ++c) {
+				float top = image.Clamped(x0, y0)[c] * (1 - fx) + image.Clamped(x0 + 1, y0)[c] * fx;
+				float bottom = image.Clamped(x0, y0 + 1)[c] * (1 - fx) + image.Clamped(x0 + 1, y0 + 1)[c] * fx;
+				result[c] = top * (1 - fy) + bottom * fy;
+			}
+			return result;
+		}
+
+		// small deterministic generator, so that the results do not depend on the standard library
+		class Random {
+		public:
+			explicit Random(uint32_t seed) : state(seed * 747796405u + 2891336453u) {}
+
+			float Next() {
+				state = state * 1664525u + 1013904223u;
+				return float(state >> 8) / float(1u << 24);
+			}
+
+		private:
+			uint32_t state;
+		};
+
+		inline Image MakeSyntheticFrame(int width, int height, uint32_t seed) {
+			Random random (seed);
+			Image image (width, height);
+			float phase = random.Next() * 6.28f;
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x) {
+					float u = float(x) / width, v = float(y) / height;
+					std::array<float, 3> c = { 0.2f + 0.6f * u, 0.3f + 0.4f * v, 0.5f + 0.3f * std::sin(phase + 4.f * u) };
+					if (u > 0.55f && v < 0.45f) {
+						// a hard edged panel with a checkerboard of fine detail
+						float checker = ((x / 2 + y / 2) & 1) ? 0.9f : 0.1f;
+						c = { checker, checker * 0.8f, 0.2f };
+					}
+					if (std::abs((x - y * 0.7f) - width * 0.2f) < 1.5f) {
+						// a thin diagonal line
+						c = { 1.f, 1.f, 1.f };
+					}
+					if (v > 0.7f) {
+						// noisy floor
+						float n = random.Next();
+						c = { 0.3f * n + 0.1f, 0.25f * n + 0.1f, 0.2f * n + 0.1f };
+					}
+					image.At(x, y) = c;
+				}
+			}
+			return image;
+		}
+
+		// reads a binary 8-bit PPM, as captured frames are stored, with the texel values mapped to [0, 1]
+		inline bool LoadPpm(const char *path, Image &image) {
+			FILE *file = fopen(path, "rb");
+			if (file == nullptr) {
+				return false;
+			}
+			int width = 0, height = 0, maxValue = 0;
+			bool ok = fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) == 3 && fgetc(file) != EOF
+				&& width > 0 && height > 0 && maxValue > 0 && maxValue < 256;
+			std::vector<uint8_t> data;
+			if (ok) {
+				data.resize(size_t(width) * height * 3);
+				ok = fread(data.data(), 1, data.size(), file) == data.size();
+			}
+			fclose(file);
+			if (!ok) {
+				return false;
+			}
+			image = Image(width, height);
+			for (size_t i = 0; i < image.pixels.size(); ++i) {
+				for (int c = 0; c < 3; ++c) {
+					image.pixels[i][c] = data[i * 3 + c] / float(maxValue);
+				}
+			}
+			return true;
+		}
+	}
+}
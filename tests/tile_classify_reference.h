@@ -0,0 +1,92 @@
+#pragma once
+#include "test_images.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// C++ port of the tile classification of D3D11TileLists: Rebuild's split by the foveation radius on the CPU,
+// and the min/max luma test of tile_classify.hlsl that sorts the tiles inside the radius into busy and flat.
+namespace vrperfkit {
+	namespace test {
+		struct ClassifyEye {
+			float inputOffset[2] = {};
+			float inputScale[2] = { 1, 1 };
+			int inputMin[2] = {};
+			int inputMax[2] = {};
+		};
+
+		// the constants D3D11TileLists::Classify sets up for an input and output viewport at the origin
+		inline ClassifyEye MakeClassifyEye(int inputWidth, int inputHeight, int outputWidth, int outputHeight) {
+			ClassifyEye eye;
+			eye.inputScale[0] = float(inputWidth) / outputWidth;
+			eye.inputScale[1] = float(inputHeight) / outputHeight;
+			eye.inputMax[0] = inputWidth - 1;
+			eye.inputMax[1] = inputHeight - 1;
+			return eye;
+		}
+
+		inline float ClassifyLuma(const std::array<float, 3> &c) {
+			return std::max(0.f, c[0] * 0.2126f + c[1] * 0.7152f + c[2] * 0.0722f);
+		}
+
+		// main() of tile_classify.hlsl for one tile: true if it is flat and takes the cheap path
+		inline bool IsFlatTile(const Image &input, const ClassifyEye &eye, int tileWidth, int tileHeight, int tileX, int tileY, float threshold) {
+			// the tile plus the one pixel apron the sharpening reads, widened by the upscaling filter's footprint
+			float outputFirst[2] = { float(tileX * tileWidth) - 1, float(tileY * tileHeight) - 1 };
+			float outputLast[2] = { float((tileX + 1) * tileWidth) + 1, float((tileY + 1) * tileHeight) + 1 };
+			int first[2], last[2];
+			for (int i = 0; i < 2; ++i) {
+				first[i] = std::max(int(std::floor(eye.inputOffset[i] + outputFirst[i] * eye.inputScale[i])) - 1, eye.inputMin[i]);
+				last[i] = std::min(int(std::ceil(eye.inputOffset[i] + outputLast[i] * eye.inputScale[i])) + 1, eye.inputMax[i]);
+			}
+			float minLuma = 3.402823466e38f, maxLuma = 0;
+			for (int y = first[1]; y <= last[1]; ++y) {
+				for (int x = first[0]; x <= last[0]; ++x) {
+					float luma = ClassifyLuma(input.At(x, y));
+					minLuma = std::min(minLuma, luma);
+					maxLuma = std::max(maxLuma, luma);
+				}
+			}
+			return maxLuma - minLuma < threshold;
+		}
+
+		struct TileCounts {
+			int cheap = 0;
+			int flat = 0;
+			int busy = 0;
+
+			int Total() const { return cheap + flat + busy; }
+		};
+
+		// tiles outside the radius are cheap by position, those inside are classified by their luma range
+		inline TileCounts ClassifyTiles(const Image &input, int outputWidth, int outputHeight, int tileWidth, int tileHeight,
+				float radius, float projCentreX, float projCentreY, float threshold) {
+			ClassifyEye eye = MakeClassifyEye(input.width, input.height, outputWidth, outputHeight);
+			float radiusPixels = 0.5f * radius * outputHeight;
+			uint32_t squaredRadius = uint32_t(radiusPixels * radiusPixels);
+			uint32_t centre[2] = { uint32_t(outputWidth * projCentreX), uint32_t(outputHeight * projCentreY) };
+			int tilesX = (outputWidth + tileWidth - 1) / tileWidth;
+			int tilesY = (outputHeight + tileHeight - 1) / tileHeight;
+			TileCounts counts;
+			for (int y = 0; y < tilesY; ++y) {
+				for (int x = 0; x < tilesX; ++x) {
+					int64_t dx = (int64_t)centre[0] - (x * tileWidth + tileWidth / 2);
+					int64_t dy = (int64_t)centre[1] - (y * tileHeight + tileHeight / 2);
+					if (dx * dx + dy * dy > squaredRadius) {
+						++counts.cheap;
+					}
+					else if (threshold > 0 && IsFlatTile(input, eye, tileWidth, tileHeight, x, y, threshold)) {
+						++counts.flat;
+					}
+					else {
+						++counts.busy;
+					}
+				}
+			}
+			return counts;
+		}
+	}
+}
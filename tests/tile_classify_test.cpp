@@ -0,0 +1,78 @@
+// Checks the luma range classification of tile_classify.hlsl on the CPU, then reports how many of the tiles
+// inside the radius it lets skip the full filter, for synthetic frames and for any captured frames passed as
+// binary PPM paths on the command line:  tile_classify_test frame1.ppm frame2.ppm ...
+#include "tile_classify_reference.h"
+#include "test_common.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace vrperfkit;
+using namespace vrperfkit::test;
+
+namespace {
+	const int TILE_SIZE = 16;
+	const float THRESHOLDS[] = { 0.01f, 0.02f, 0.05f };
+
+	void TestFootprint() {
+		// 1:1 scale, so a tile reads its own 16x16 texels, the one texel apron and one more for the filter
+		Image input (64, 64, 0.5f);
+		ClassifyEye eye = MakeClassifyEye(64, 64, 64, 64);
+		CHECK(IsFlatTile(input, eye, TILE_SIZE, TILE_SIZE, 1, 1, 0.01f));
+		// two texels left of tile (1, 1) are within its reach, three are not
+		input.At(14, 20) = { 1, 1, 1 };
+		CHECK(!IsFlatTile(input, eye, TILE_SIZE, TILE_SIZE, 1, 1, 0.01f));
+		input.At(14, 20) = { 0.5f, 0.5f, 0.5f };
+		input.At(13, 20) = { 1, 1, 1 };
+		CHECK(IsFlatTile(input, eye, TILE_SIZE, TILE_SIZE, 1, 1, 0.01f));
+		// a range exactly at the threshold is busy
+		input.At(40, 40) = { 0.6f, 0.6f, 0.6f };
+		CHECK(!IsFlatTile(input, eye, TILE_SIZE, TILE_SIZE, 2, 2, ClassifyLuma(input.At(40, 40)) - ClassifyLuma(input.At(0, 0))));
+	}
+
+	void TestUniformFrameIsFlat() {
+		Image input (96, 96, 0.25f);
+		TileCounts counts = ClassifyTiles(input, 128, 128, TILE_SIZE, TILE_SIZE, 0.6f, 0.5f, 0.5f, 0.001f);
+		CHECK(counts.busy == 0);
+		CHECK(counts.flat > 0);
+		CHECK(counts.Total() == 64);
+	}
+
+	// prints the skip ratio of one frame upscaled by 1 / 0.77 for each threshold, returns the flat counts
+	std::vector<int> ReportSkipRatio(const char *name, const Image &input) {
+		int outputWidth = int(input.width / 0.77f), outputHeight = int(input.height / 0.77f);
+		std::vector<int> flat;
+		for (float threshold : THRESHOLDS) {
+			TileCounts counts = ClassifyTiles(input, outputWidth, outputHeight, TILE_SIZE, TILE_SIZE, 0.6f, 0.5f, 0.5f, threshold);
+			int inside = counts.flat + counts.busy;
+			printf("%s: threshold %.2f, %d of %d tiles inside the radius flat (%.1f%%), %d outside\n",
+					name, threshold, counts.flat, inside, inside > 0 ? 100.f * counts.flat / inside : 0.f, counts.cheap);
+			flat.push_back(counts.flat);
+		}
+		return flat;
+	}
+
+	void TestSyntheticSkipRatio() {
+		Image input = MakeSyntheticFrame(384, 320, 7);
+		std::vector<int> flat = ReportSkipRatio("synthetic frame", input);
+		// the smooth gradients are flat at the higher thresholds, the detail and noise never are
+		CHECK(flat[0] <= flat[1] && flat[1] <= flat[2]);
+		CHECK(flat[2] > 0);
+		TileCounts counts = ClassifyTiles(input, 498, 415, TILE_SIZE, TILE_SIZE, 0.6f, 0.5f, 0.5f, 1.f);
+		CHECK(counts.busy == 0);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	TestFootprint();
+	TestUniformFrameIsFlat();
+	TestSyntheticSkipRatio();
+	for (int i = 1; i < argc; ++i) {
+		Image frame;
+		CHECK(LoadPpm(argv[i], frame));
+		if (frame.width > 0) {
+			ReportSkipRatio(argv[i], frame);
+		}
+	}
+	return test::Result();
+}
@@ -0,0 +1,207 @@
+// Small command line client for the vrperfkit control server.
+//
+// Usage:
+//   vrperfkit_ctl [--pipe <name>] get
+//   vrperfkit_ctl [--pipe <name>] set <field> <value>
+//   vrperfkit_ctl [--pipe <name>] watch
+//   vrperfkit_ctl [--pipe <name>] capture
+//   vrperfkit_ctl [--pipe <name>] benchmark <frames>
+
+#include "control_protocol.h"
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace vrperfkit::control;
+
+namespace {
+	HANDLE g_pipe = INVALID_HANDLE_VALUE;
+
+	bool Connect(const std::string &pipeName) {
+		std::string path = "\\\\.\\pipe\\" + pipeName;
+		g_pipe = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+		if (g_pipe == INVALID_HANDLE_VALUE) {
+			fprintf(stderr, "Could not connect to %s (error %lu). Is the game running with controlServer enabled?\n", path.c_str(), GetLastError());
+			return false;
+		}
+		DWORD mode = PIPE_READMODE_MESSAGE;
+		SetNamedPipeHandleState(g_pipe, &mode, nullptr, nullptr);
+		return true;
+	}
+
+	bool Send(MessageType type, const void *payload = nullptr, uint16_t payloadSize = 0) {
+		uint8_t buffer[MAX_MESSAGE_SIZE];
+		MessageHeader header { type, 0, payloadSize };
+		memcpy(buffer, &header, sizeof(header));
+		if (payloadSize > 0) {
+			memcpy(buffer + sizeof(header), payload, payloadSize);
+		}
+		DWORD written;
+		return WriteFile(g_pipe, buffer, sizeof(header) + payloadSize, &written, nullptr) != FALSE;
+	}
+
+	bool Receive(MessageHeader &header, std::vector<uint8_t> &payload) {
+		uint8_t buffer[MAX_MESSAGE_SIZE];
+		DWORD bytesRead = 0;
+		if (!ReadFile(g_pipe, buffer, sizeof(buffer), &bytesRead, nullptr) || bytesRead < sizeof(MessageHeader)) {
+			fprintf(stderr, "Connection to control server lost\n");
+			return false;
+		}
+		memcpy(&header, buffer, sizeof(header));
+		payload.assign(buffer + sizeof(header), buffer + bytesRead);
+		return true;
+	}
+
+	template<typename T>
+	bool ReadPayload(const std::vector<uint8_t> &payload, T &out) {
+		if (payload.size() != sizeof(T)) {
+			return false;
+		}
+		memcpy(&out, payload.data(), sizeof(T));
+		return true;
+	}
+
+	// waits for a message of the given type, printing any errors the server reports in between
+	bool WaitFor(MessageType type, std::vector<uint8_t> &payload) {
+		MessageHeader header;
+		while (Receive(header, payload)) {
+			if (header.type == type) {
+				return true;
+			}
+			ErrorMessage error;
+			if (header.type == MessageType::Error && ReadPayload(payload, error)) {
+				fprintf(stderr, "Server reported error %d\n", (int)error.code);
+				return false;
+			}
+		}
+		return false;
+	}
+
+	void PrintState(const StateMessage &state) {
+		printf("protocol version %u, frame %u\n", state.protocolVersion, state.frameIndex);
+		for (uint8_t i = 0; i < (uint8_t)Field::Count; ++i) {
+			printf("  %-32s %g\n", FieldName((Field)i), state.values[i]);
+		}
+	}
+
+	int Get() {
+		std::vector<uint8_t> payload;
+		StateMessage state;
+		if (!Send(MessageType::QueryState) || !WaitFor(MessageType::State, payload) || !ReadPayload(payload, state)) {
+			return 1;
+		}
+		PrintState(state);
+		return 0;
+	}
+
+	int Set(const char *name, const char *value) {
+		SetFieldMessage msg = {};
+		if (!FieldFromName(name, msg.field)) {
+			fprintf(stderr, "Unknown field %s\n", name);
+			return 1;
+		}
+		std::string v = value;
+		if (v == "true" || v == "on") {
+			msg.value = 1;
+		} else if (v == "false" || v == "off") {
+			msg.value = 0;
+		} else if (v == "fsr" || v == "FSR") {
+			msg.value = 0;
+		} else if (v == "nis" || v == "NIS") {
+			msg.value = 1;
+		} else if (v == "cas" || v == "CAS") {
+			msg.value = 2;
+		} else if (v == "temporal") {
+			msg.value = 3;
+		} else {
+			msg.value = (float)atof(value);
+		}
+
+		std::vector<uint8_t> payload;
+		StateMessage state;
+		if (!Send(MessageType::SetField, &msg, sizeof(msg)) || !WaitFor(MessageType::State, payload) || !ReadPayload(payload, state)) {
+			return 1;
+		}
+		PrintState(state);
+		return 0;
+	}
+
+	int Watch() {
+		if (!Send(MessageType::Subscribe)) {
+			return 1;
+		}
+		std::vector<uint8_t> payload;
+		FrameMetricsMessage metrics;
+		while (WaitFor(MessageType::FrameMetrics, payload)) {
+			if (ReadPayload(payload, metrics)) {
+				printf("frame %u: %.2f ms, post-processing %.3f ms\n", metrics.frameIndex, metrics.frameTimeMs, metrics.postProcessGpuMs);
+			}
+		}
+		return 1;
+	}
+
+	int Capture() {
+		return Send(MessageType::Capture) ? 0 : 1;
+	}
+
+	int Benchmark(const char *frames) {
+		BenchmarkMessage msg { (uint32_t)atoi(frames) };
+		std::vector<uint8_t> payload;
+		BenchmarkResultMessage result;
+		if (!Send(MessageType::Benchmark, &msg, sizeof(msg)) || !WaitFor(MessageType::BenchmarkResult, payload) || !ReadPayload(payload, result)) {
+			return 1;
+		}
+		printf("frames:               %u\n", result.frameCount);
+		printf("avg frame time:       %.3f ms\n", result.avgFrameTimeMs);
+		printf("max frame time:       %.3f ms\n", result.maxFrameTimeMs);
+		printf("avg post-processing:  %.3f ms\n", result.avgPostProcessGpuMs);
+		return 0;
+	}
+
+	int Usage() {
+		fprintf(stderr, "Usage: vrperfkit_ctl [--pipe <name>] get|set <field> <value>|watch|capture|benchmark <frames>\n");
+		return 2;
+	}
+}
+
+int main(int argc, char **argv) {
+	std::string pipeName = DEFAULT_PIPE_NAME;
+	int arg = 1;
+	if (argc > 2 && std::string(argv[1]) == "--pipe") {
+		pipeName = argv[2];
+		arg = 3;
+	}
+	if (arg >= argc) {
+		return Usage();
+	}
+
+	std::string command = argv[arg];
+	int remaining = argc - arg - 1;
+	if (!Connect(pipeName)) {
+		return 1;
+	}
+
+	int result;
+	if (command == "get") {
+		result = Get();
+	} else if (command == "set" && remaining == 2) {
+		result = Set(argv[arg + 1], argv[arg + 2]);
+	} else if (command == "watch") {
+		result = Watch();
+	} else if (command == "capture") {
+		result = Capture();
+	} else if (command == "benchmark" && remaining == 1) {
+		result = Benchmark(argv[arg + 1]);
+	} else {
+		result = Usage();
+	}
+
+	CloseHandle(g_pipe);
+	return result;
+}